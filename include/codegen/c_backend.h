@@ -0,0 +1,44 @@
+/**
+ * @file codegen/c_backend.h
+ * @brief C source generation from three-address code
+ */
+
+#ifndef C_BACKEND_H
+#define C_BACKEND_H
+
+#include "codegen/tac.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Flags the generated source is meant to be compiled with */
+#define C_BACKEND_CFLAGS "-O2"
+
+/**
+ * @brief Write a program as a C translation unit
+ *
+ * The program becomes a single function tac_run() returning 0, or 1 after
+ * a division by zero. Variables and temporaries are locals, labels are C
+ * labels and conditional jumps are `if (...) goto`, so the host compiler
+ * is free to keep everything in registers and optimize across the whole
+ * program. Arithmetic wraps at 32 bits like the interpreter. Variables are
+ * copied to the tac_vars array on exit, and a main() wrapper times the
+ * call, prints the run time to stderr and each variable to stdout in the
+ * format of tac_vm_print_vars(), like the x86-64 backend.
+ *
+ * @param program TAC program
+ * @param out Destination stream
+ * @return bool true on success, false if the program cannot be translated
+ * (param, call)
+ */
+bool c_emit_program(const TACProgram *program, FILE *out);
+
+/**
+ * @brief Write a program as C source to a file
+ *
+ * @param program TAC program
+ * @param filename Output path
+ * @return bool true on success
+ */
+bool c_write_program(const TACProgram *program, const char *filename);
+
+#endif /* C_BACKEND_H */
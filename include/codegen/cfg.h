@@ -0,0 +1,104 @@
+/**
+ * @file codegen/cfg.h
+ * @brief Control-flow graph over three-address code
+ */
+
+#ifndef CFG_H
+#define CFG_H
+
+#include "codegen/tac.h"
+#include <stdbool.h>
+
+/**
+ * @brief Control-flow graph of a TAC program
+ *
+ * Basic blocks are maximal runs of instructions entered only at the top and
+ * left only at the bottom: a block starts at a label (a run of consecutive
+ * labels shares one block) or after a jump. Block b covers instructions
+ * [block_start[b], block_start[b + 1]); block 0 is the entry.
+ *
+ * Edges are stored in compressed sparse row form: the successors of b are
+ * succ[succ_offset[b]] .. succ[succ_offset[b + 1] - 1], and likewise for
+ * predecessors. Natural loops use the same layout for their bodies.
+ *
+ * The graph refers to instruction indices, so it is invalidated by any
+ * change that adds, removes or reorders instructions.
+ */
+typedef struct CFG {
+  int block_count;  /* Number of basic blocks */
+  int *block_start; /* First instruction per block, plus a final sentinel */
+  int *label_block; /* Block defining each label id, or -1 */
+
+  int *succ_offset; /* CSR offsets into succ (block_count + 1 entries) */
+  int *succ;        /* Successor block indices */
+  int *pred_offset; /* CSR offsets into pred (block_count + 1 entries) */
+  int *pred;        /* Predecessor block indices */
+
+  int *rpo;         /* Reachable blocks in reverse postorder */
+  int rpo_count;    /* Number of reachable blocks */
+  int *rpo_index;   /* Position of each block in rpo, or -1 if unreachable */
+  int *idom;        /* Immediate dominator (entry: itself, unreachable: -1) */
+  int *dom_pre;     /* Dominator tree preorder number */
+  int *dom_post;    /* Dominator tree postorder number */
+
+  int loop_count;        /* Number of natural loops */
+  int *loop_header;      /* Header block per loop */
+  int *loop_parent;      /* Innermost enclosing loop, or -1 */
+  int *loop_offset;      /* CSR offsets into loop_blocks */
+  int *loop_blocks;      /* Blocks of each loop body, header first */
+  int *block_loop;       /* Innermost loop containing each block, or -1 */
+} CFG;
+
+/**
+ * @brief Build the control-flow graph of a program
+ *
+ * Partitions the program into basic blocks, resolves jump targets, builds
+ * successor and predecessor lists, then computes dominators with the
+ * Cooper-Harvey-Kennedy iterative algorithm and the natural loop of every
+ * back edge (loops sharing a header are merged). Everything except the
+ * dominator iteration and loop bodies is a constant number of linear
+ * passes; no step recurses, so very deep nesting is safe.
+ *
+ * @param program TAC program
+ * @return CFG* Control-flow graph, or NULL if a jump targets an undefined
+ * label or allocation fails
+ */
+CFG *cfg_build(const TACProgram *program);
+
+/**
+ * @brief Find the block containing an instruction
+ *
+ * @param cfg Control-flow graph
+ * @param inst Instruction index
+ * @return int Block index, or -1 if inst is out of range
+ */
+int cfg_block_of(const CFG *cfg, int inst);
+
+/**
+ * @brief Check whether block a dominates block b
+ *
+ * Every block dominates itself. Unreachable blocks dominate nothing and are
+ * dominated by nothing.
+ *
+ * @param cfg Control-flow graph
+ * @param a Dominating block candidate
+ * @param b Dominated block candidate
+ * @return bool Whether a dominates b
+ */
+bool cfg_dominates(const CFG *cfg, int a, int b);
+
+/**
+ * @brief Print blocks, edges, dominators and loops to stdout
+ *
+ * @param cfg Control-flow graph
+ */
+void cfg_print(const CFG *cfg);
+
+/**
+ * @brief Free control-flow graph resources
+ *
+ * @param cfg Control-flow graph to destroy
+ */
+void cfg_destroy(CFG *cfg);
+
+#endif /* CFG_H */
@@ -0,0 +1,312 @@
+/**
+ * @file codegen/dataflow.h
+ * @brief Bit-vector dataflow analysis over the control-flow graph
+ */
+
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include "codegen/cfg.h"
+#include "codegen/tac.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Word of a packed bit set
+ */
+typedef uint64_t BitWord;
+
+#define BITWORD_BITS 64
+
+/**
+ * @brief Number of words needed for a set of bits
+ */
+static inline int bitset_words(int bits) {
+  return (bits + BITWORD_BITS - 1) / BITWORD_BITS;
+}
+
+static inline bool bitset_test(const BitWord *set, int bit) {
+  return (set[bit / BITWORD_BITS] >> (bit % BITWORD_BITS)) & 1;
+}
+
+static inline void bitset_set(BitWord *set, int bit) {
+  set[bit / BITWORD_BITS] |= (BitWord)1 << (bit % BITWORD_BITS);
+}
+
+static inline void bitset_reset(BitWord *set, int bit) {
+  set[bit / BITWORD_BITS] &= ~((BitWord)1 << (bit % BITWORD_BITS));
+}
+
+/**
+ * @brief Find the first set bit in [from, to)
+ *
+ * @return int Bit index, or -1 if none is set
+ */
+static inline int bitset_next(const BitWord *set, int from, int to) {
+  if (from >= to) {
+    return -1;
+  }
+  int w = from / BITWORD_BITS;
+  BitWord word = set[w] & (~(BitWord)0 << (from % BITWORD_BITS));
+  int last = (to - 1) / BITWORD_BITS;
+  while (!word) {
+    if (++w > last) {
+      return -1;
+    }
+    word = set[w];
+  }
+  int bit = w * BITWORD_BITS + __builtin_ctzll(word);
+  return bit < to ? bit : -1;
+}
+
+/**
+ * @brief Dense index of a variable or temporary
+ *
+ * Variables keep their ids from the symbol table, temporaries follow them:
+ * variable v is location v, temporary t is location var_count + t.
+ *
+ * @return int Location, or -1 for constants, labels and unused operands
+ */
+static inline int dataflow_location(const TACProgram *program,
+                                    TACOperand operand) {
+  if (operand.kind == TAC_OPND_VAR) {
+    return operand.id;
+  }
+  if (operand.kind == TAC_OPND_TEMP) {
+    return program->var_count + operand.id;
+  }
+  return -1;
+}
+
+/**
+ * @brief Number of dense locations (variables plus temporaries)
+ */
+static inline int dataflow_location_count(const TACProgram *program) {
+  return program->var_count + program->temp_count;
+}
+
+/**
+ * @brief Direction in which facts flow
+ */
+typedef enum {
+  DATAFLOW_FORWARD, /* From block entry to exit, along edges */
+  DATAFLOW_BACKWARD /* From block exit to entry, against edges */
+} DataflowDirection;
+
+/**
+ * @brief How facts from several edges are combined
+ */
+typedef enum {
+  DATAFLOW_UNION,    /* May problems: a fact on any path */
+  DATAFLOW_INTERSECT /* Must problems: a fact on every path */
+} DataflowMeet;
+
+/**
+ * @brief Transfer function of a block
+ *
+ * Computes the set leaving a block (its out set for forward problems, its
+ * in set for backward ones) from the set entering it.
+ *
+ * @param context Problem context
+ * @param block Block index
+ * @param entering Set entering the block
+ * @param leaving Output: set leaving the block
+ * @param words Words per set
+ */
+typedef void (*DataflowTransfer)(const void *context, int block,
+                                 const BitWord *entering, BitWord *leaving,
+                                 int words);
+
+/**
+ * @brief A dataflow problem over a control-flow graph
+ */
+typedef struct DataflowProblem {
+  DataflowDirection direction; /* Direction facts flow in */
+  DataflowMeet meet;           /* Combination at join points */
+  int bits;                    /* Size of the fact universe */
+  const BitWord *boundary;     /* Facts at program entry (forward) or exit
+                                  (backward); NULL for none */
+  DataflowTransfer transfer;   /* Block transfer function */
+  const void *context;         /* Passed to transfer */
+} DataflowProblem;
+
+/**
+ * @brief Per-block gen and kill sets for the common transfer function
+ *
+ * Stored sparsely in CSR form: block b kills the bit ranges
+ * kill[2k] .. kill[2k + 1] - 1 for kill_offset[b] <= k < kill_offset[b + 1]
+ * and generates gen[gen_offset[b]] .. gen[gen_offset[b + 1] - 1]. Blocks are
+ * filled in order, closing each with dataflow_gen_kill_end_block().
+ */
+typedef struct DataflowGenKill {
+  int block_count;  /* Blocks closed so far */
+  int *gen_offset;  /* CSR offsets into gen */
+  int *gen;         /* Generated bits */
+  int gen_count;    /* Number of generated bits */
+  int gen_capacity; /* Capacity of gen */
+  int *kill_offset; /* CSR offsets into kill, in ranges */
+  int *kill;        /* Killed [first, end) bit ranges, two ints each */
+  int kill_count;   /* Number of killed ranges */
+  int kill_capacity; /* Capacity of kill, in ranges */
+} DataflowGenKill;
+
+/**
+ * @brief Solution of a dataflow problem
+ *
+ * Only the sets leaving each block are stored, one dense row of words per
+ * block; the set entering a block is recomputed from its neighbours on
+ * request, which halves the memory of large solutions. The meaning of a bit
+ * depends on the client: each bit stands for an item (an instruction or a
+ * location), mapped through item_bit and bit_item.
+ */
+typedef struct DataflowResult {
+  const CFG *cfg;              /* Graph the solution belongs to */
+  DataflowDirection direction; /* Direction facts flow in */
+  DataflowMeet meet;           /* Combination at join points */
+  int block_count;             /* Number of blocks */
+  int bits;                    /* Size of the fact universe */
+  int words;                   /* Words per set */
+  BitWord *leaving;  /* Facts leaving each block: out sets for forward
+                        problems, in sets for backward ones */
+  BitWord *boundary; /* Facts at program entry or exit */
+  int visits;        /* Transfer function evaluations until fixpoint */
+
+  int item_count;       /* Number of items */
+  int *item_bit;        /* Bit of each item, or -1 if untracked */
+  int *bit_item;        /* Item of each bit (-1 for entry definitions) */
+  int *location_offset; /* Reaching definitions only: the bits of location
+                           l are [location_offset[l], location_offset[l+1]) */
+} DataflowResult;
+
+/**
+ * @brief Facts at the entry of a block
+ *
+ * @param result Solution (its CFG must still be alive)
+ * @param block Block index
+ * @param set Output: result->words words
+ */
+void dataflow_in(const DataflowResult *result, int block, BitWord *set);
+
+/**
+ * @brief Facts at the exit of a block
+ *
+ * @param result Solution (its CFG must still be alive)
+ * @param block Block index
+ * @param set Output: result->words words
+ */
+void dataflow_out(const DataflowResult *result, int block, BitWord *set);
+
+/**
+ * @brief Solve a dataflow problem to its maximal fixpoint
+ *
+ * Iterates a worklist ordered by reverse postorder (postorder for backward
+ * problems), so acyclic regions converge in one visit per block and each
+ * loop costs about one extra round per nesting level. Only blocks reachable
+ * from the entry are visited; the sets of other blocks keep their initial
+ * value (empty for union, full for intersection).
+ *
+ * @param cfg Control-flow graph
+ * @param problem Problem description
+ * @return DataflowResult* Solution without item maps, or NULL on failure
+ */
+DataflowResult *dataflow_solve(const CFG *cfg, const DataflowProblem *problem);
+
+/**
+ * @brief Free a dataflow solution
+ *
+ * @param result Solution to destroy
+ */
+void dataflow_result_destroy(DataflowResult *result);
+
+/**
+ * @brief Start empty gen and kill sets
+ *
+ * @param sets Sets to initialize
+ * @param blocks Number of blocks to be filled
+ */
+void dataflow_gen_kill_init(DataflowGenKill *sets, int blocks);
+
+/**
+ * @brief Add a bit to the gen set of the current block
+ */
+void dataflow_gen_kill_add_gen(DataflowGenKill *sets, int bit);
+
+/**
+ * @brief Add the bits [first, end) to the kill set of the current block
+ */
+void dataflow_gen_kill_add_kill(DataflowGenKill *sets, int first, int end);
+
+/**
+ * @brief Close the current block and start the next one
+ */
+void dataflow_gen_kill_end_block(DataflowGenKill *sets);
+
+/**
+ * @brief Release gen and kill sets
+ */
+void dataflow_gen_kill_free(DataflowGenKill *sets);
+
+/**
+ * @brief Transfer function leaving = gen | (entering & ~kill)
+ *
+ * @param context const DataflowGenKill*
+ */
+void dataflow_gen_kill_transfer(const void *context, int block,
+                                const BitWord *entering, BitWord *leaving,
+                                int words);
+
+/**
+ * @brief Live variables and temporaries
+ *
+ * Backward union problem; items are locations. Only locations read in some
+ * block before being written there are tracked, since no other location is
+ * live across a block boundary. When program variables are live at exit, an
+ * untracked variable may still be live out of a block that reaches the exit
+ * without writing it.
+ *
+ * @param program TAC program
+ * @param cfg Control-flow graph of program
+ * @param results_live Treat variables as read at program exit; clients that
+ * keep variables in memory anyway (code generators) pass false
+ * @return DataflowResult* Solution, or NULL on failure
+ */
+DataflowResult *dataflow_liveness(const TACProgram *program, const CFG *cfg,
+                                  bool results_live);
+
+/**
+ * @brief Reaching definitions
+ *
+ * Forward union problem; items are instructions. Each tracked location has
+ * one bit for its value at program entry (variables start at zero) followed
+ * by one bit per instruction writing it, so the definitions of a location
+ * are a contiguous bit range. Only locations read in some block before being
+ * written there are tracked.
+ *
+ * @param program TAC program
+ * @param cfg Control-flow graph of program
+ * @param track Optional per-location filter further restricting what is
+ * tracked (NULL to track all such locations)
+ * @return DataflowResult* Solution, or NULL on failure
+ */
+DataflowResult *dataflow_reaching_definitions(const TACProgram *program,
+                                              const CFG *cfg,
+                                              const bool *track);
+
+/**
+ * @brief Available expressions
+ *
+ * Forward intersection problem; items are instructions, and every
+ * arithmetic instruction computing the same (op, arg1, arg2), with the
+ * arguments of + and * in canonical order, maps to the same bit. Writing a
+ * location kills the expressions reading it. Only expressions computed in
+ * at least two blocks are tracked, since no other expression can be
+ * available where it is recomputed in another block.
+ *
+ * @param program TAC program
+ * @param cfg Control-flow graph of program
+ * @return DataflowResult* Solution, or NULL on failure
+ */
+DataflowResult *dataflow_available_expressions(const TACProgram *program,
+                                               const CFG *cfg);
+
+#endif /* DATAFLOW_H */
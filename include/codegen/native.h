@@ -0,0 +1,54 @@
+/**
+ * @file codegen/native.h
+ * @brief Building and running generated programs with the host compiler
+ */
+
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Outcome of a native run
+ *
+ * Generated executables print "Native run <ms> ms" to stderr and then each
+ * variable as "  name = value" to stdout, in variable id order.
+ */
+typedef struct NativeResult {
+  double build_seconds; /* Time spent in the host compiler */
+  double run_seconds;   /* Run time reported by the program itself */
+  int *values;          /* Final variable values */
+  int value_count;      /* Number of values read */
+  int status;           /* Exit status of the program */
+} NativeResult;
+
+/**
+ * @brief Compile and link a generated source file with gcc
+ *
+ * @param source Assembler (.s) or C (.c) source path
+ * @param executable Output path
+ * @param flags Extra compiler flags, e.g. "-O2"
+ * @param result Output: build_seconds is set
+ * @return bool true if the compiler succeeded
+ */
+bool native_build(const char *source, const char *executable,
+                  const char *flags, NativeResult *result);
+
+/**
+ * @brief Run a generated executable and collect its results
+ *
+ * @param executable Program path
+ * @param var_count Number of variables the program prints
+ * @param result Output: run_seconds, values and status are set
+ * @return bool true if the program ran and printed every variable
+ */
+bool native_run(const char *executable, int var_count, NativeResult *result);
+
+/**
+ * @brief Release the values of a native run
+ *
+ * @param result Result to clear
+ */
+void native_result_free(NativeResult *result);
+
+#endif /* NATIVE_H */
@@ -0,0 +1,66 @@
+/**
+ * @file codegen/regalloc.h
+ * @brief Linear-scan register allocation over TAC locations
+ */
+
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "codegen/cfg.h"
+#include "codegen/tac.h"
+
+/**
+ * @brief Register assignment of every variable and temporary
+ *
+ * Locations are numbered as in dataflow_location(). Positions are
+ * 2 * instruction for reads and 2 * instruction + 1 for writes, so a
+ * location whose last read is in the instruction defining another can hand
+ * its register over. Live intervals have no holes: a location owns its
+ * register from the first to the last position where it is live.
+ *
+ * Variables are not treated as live at exit, so a code generator using this
+ * assignment must also store each write of a variable to its memory home.
+ */
+typedef struct RegAllocation {
+  int location_count; /* Number of locations */
+  int register_count; /* Registers available to the allocator */
+  int *reg;           /* Register 0..register_count-1 of each location, or -1
+                         if it lives in memory */
+  int *start;         /* First position of each live interval, or -1 */
+  int *end;           /* Last position of each live interval, or -1 */
+  int intervals;      /* Locations with a live interval */
+  int spilled;        /* Intervals left in memory */
+  int registers_used; /* Distinct registers assigned */
+} RegAllocation;
+
+/**
+ * @brief Assign registers by linear scan
+ *
+ * Intervals are visited in order of their start; when every register is
+ * taken, the interval ending last is spilled (Poletto and Sarkar), so
+ * values used inside a loop win over values merely live across it.
+ *
+ * @param program TAC program
+ * @param cfg Control-flow graph of program
+ * @param registers Number of registers available
+ * @return RegAllocation* Assignment, or NULL on failure
+ */
+RegAllocation *regalloc_linear_scan(const TACProgram *program, const CFG *cfg,
+                                    int registers);
+
+/**
+ * @brief Get the register of an operand
+ *
+ * @return int Register, or -1 for memory, constants and unused operands
+ */
+int regalloc_register(const RegAllocation *alloc, const TACProgram *program,
+                      TACOperand operand);
+
+/**
+ * @brief Free a register assignment
+ *
+ * @param alloc Assignment to destroy
+ */
+void regalloc_destroy(RegAllocation *alloc);
+
+#endif /* REGALLOC_H */
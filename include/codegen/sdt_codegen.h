@@ -23,8 +23,15 @@ typedef struct SDTCodeGen {
   struct LabelManager
       *label_manager; /* Label manager for generating unique labels */
 
-  /* Current attributes being processed */
-  struct SDTAttributes *curr_attr; /* Current node's attributes */
+  /* Semantic attributes, indexed by the id of each non-terminal node */
+  struct SDTAttributes *attributes; /* One record per non-terminal node */
+  int node_count;                   /* Number of attribute records */
+
+  struct JumpLists *jump_lists; /* Jumps waiting for their target */
+
+  /* One-pass translation, driven by an LR parser */
+  struct SDTValue *values; /* Attributes of the parser stack symbols */
+  int value_capacity;      /* Number of values allocated */
 
   /* Error handling */
   bool has_error;           /* Error flag */
@@ -49,10 +56,60 @@ bool sdt_codegen_init(SDTCodeGen *gen);
 /**
  * @brief Generate three-address code for a syntax tree
  *
+ * Allocates the attributes of all the tree's non-terminals in one array,
+ * indexed by node id, and runs the semantic action of each node's
+ * production.
+ *
+ * @param gen Initialized code generator
+ * @param tree Syntax tree
+ */
+void sdt_codegen_generate(SDTCodeGen *gen, const SyntaxTree *tree);
+
+/**
+ * @brief Generate three-address code for a syntax tree on several threads
+ *
+ * The top-level statements are split into contiguous ranges translated
+ * concurrently, and the fragments are joined with their temporaries,
+ * labels and variables renumbered, giving the same program as
+ * sdt_codegen_generate.
+ *
  * @param gen Initialized code generator
- * @param node Root of the syntax tree
+ * @param tree Syntax tree
+ * @param threads Number of threads; 1 or fewer generates serially
+ */
+void sdt_codegen_generate_parallel(SDTCodeGen *gen, const SyntaxTree *tree,
+                                   int threads);
+
+/**
+ * @brief Run the semantic action of a terminal shifted by an LR parser
+ *
+ * Together with sdt_codegen_reduce, generates three-address code while
+ * the input is parsed, without building a syntax tree. The code
+ * generator keeps the attributes of each symbol of the parser stack at
+ * the symbol's depth.
+ *
+ * @param gen Initialized code generator
+ * @param depth Depth of the terminal on the parser stack (1 for the first)
+ * @param token Shifted token, which must stay valid during the parse
+ * @return bool Success status
+ */
+bool sdt_codegen_shift(SDTCodeGen *gen, int depth, const Token *token);
+
+/**
+ * @brief Run the semantic action of a production reduced by an LR parser
+ *
+ * Called before the right-hand side is popped; the attributes of the
+ * left-hand side replace those of the first popped symbol.
+ *
+ * @param gen Initialized code generator
+ * @param depth Depth of the first symbol of the right-hand side (one above
+ * the top for an epsilon production)
+ * @param production_id Production being reduced
+ * @param length Number of symbols popped
+ * @return bool Success status
  */
-void sdt_codegen_generate(SDTCodeGen *gen, SyntaxTreeNode *node);
+bool sdt_codegen_reduce(SDTCodeGen *gen, int depth, int production_id,
+                        int length);
 
 /**
  * @brief Get error message from the code generator
@@ -73,17 +130,60 @@ void sdt_codegen_destroy(SDTCodeGen *gen);
  * @brief Generate a new temporary variable
  *
  * @param gen Code generator
- * @return char* Temporary variable name, or NULL on failure
+ * @return TACOperand Temporary operand, or a TAC_OPND_NONE operand on failure
  */
-char *sdt_new_temp(SDTCodeGen *gen);
+TACOperand sdt_new_temp(SDTCodeGen *gen);
 
 /**
  * @brief Generate a new label
  *
  * @param gen Code generator
- * @return char* Label name, or NULL on failure
+ * @return int Label id, or -1 on failure
+ */
+int sdt_new_label(SDTCodeGen *gen);
+
+/**
+ * @brief Emit a jump whose target is backpatched later
+ *
+ * @param gen Code generator
+ * @param op TAC_OP_GOTO or a conditional jump
+ * @param arg1 First operand of a conditional jump
+ * @param arg2 Second operand of a conditional jump
+ * @return int A jump list holding the jump
+ */
+int sdt_emit_jump(SDTCodeGen *gen, TACOpType op, TACOperand arg1,
+                  TACOperand arg2);
+
+/**
+ * @brief Emit a new label and backpatch a jump list to it
+ *
+ * @param gen Code generator
+ * @param list Jumps to the label, possibly empty
+ * @return int Label id, or -1 on failure
+ */
+int sdt_emit_label(SDTCodeGen *gen, int list);
+
+/**
+ * @brief Backpatch a jump list to the next instruction
+ *
+ * Emits a label only if the list is not empty.
+ *
+ * @param gen Code generator
+ * @param list Jumps to the next instruction
+ */
+void sdt_emit_target(SDTCodeGen *gen, int list);
+
+/**
+ * @brief Intern a source variable and get its operand
+ *
+ * The first use of a name registers it in the symbol table and assigns it a
+ * dense TAC variable id; later uses return the same id.
+ *
+ * @param gen Code generator
+ * @param name Variable name
+ * @return TACOperand Variable operand, or a TAC_OPND_NONE operand on failure
  */
-char *sdt_new_label(SDTCodeGen *gen);
+TACOperand sdt_variable(SDTCodeGen *gen, const char *name);
 
 /**
  * @brief Add instruction to the program
@@ -96,8 +196,8 @@ char *sdt_new_label(SDTCodeGen *gen);
  * @param lineno Line number
  * @return bool Success status
  */
-bool sdt_add_instruction(SDTCodeGen *gen, TACOpType op, const char *result,
-                         const char *arg1, const char *arg2, int lineno);
+bool sdt_add_instruction(SDTCodeGen *gen, TACOpType op, TACOperand result,
+                         TACOperand arg1, TACOperand arg2, int lineno);
 
 /**
  * @brief Set error message
@@ -0,0 +1,109 @@
+/**
+ * @file codegen/ssa.h
+ * @brief Static single assignment form over three-address code
+ */
+
+#ifndef SSA_H
+#define SSA_H
+
+#include "codegen/cfg.h"
+#include "codegen/tac.h"
+#include <stdbool.h>
+
+/**
+ * @brief Phi node: merges the versions of one location at a block entry
+ */
+typedef struct SSAPhi {
+  int value;    /* Value defined */
+  int location; /* Location whose versions are merged */
+  int args;     /* Offset of the arguments in SSAForm.phi_args */
+} SSAPhi;
+
+/**
+ * @brief SSA form of a TAC program
+ *
+ * Every write of a variable or temporary defines a new value, numbered
+ * densely. Values 0 .. location_count - 1 are the versions each location
+ * has on entry (zero); phis and instructions define the rest. The program
+ * itself is left untouched: the value each instruction reads and writes is
+ * kept in side arrays indexed by instruction.
+ *
+ * Phis are stored per block in compressed sparse row form, like the CFG:
+ * the phis of block b are phis[phi_offset[b]] .. phis[phi_offset[b + 1] - 1].
+ * A phi has one argument per predecessor of its block, in the order of
+ * cfg->pred, starting at phi_args[phi.args]; phis of the entry block take
+ * the entry value as one more, last argument. Arguments from unreachable
+ * predecessors are -1. Instructions in unreachable blocks have no values.
+ */
+typedef struct SSAForm {
+  const TACProgram *program; /* Program the form describes */
+  const CFG *cfg;            /* Its control-flow graph (must outlive this) */
+  int location_count;        /* Variables plus temporaries */
+
+  int value_count;      /* Number of values */
+  int *value_location;  /* Location each value is a version of */
+  int *value_def;       /* Defining instruction, -1 on entry, -2 - phi */
+
+  int *inst_def;  /* Value written by each instruction, or -1 */
+  int *inst_use;  /* Values read by each instruction: 2 per instruction,
+                     for arg1 and arg2, -1 when not a location */
+
+  int phi_count;   /* Number of phis */
+  int *phi_offset; /* CSR offsets into phis (block_count + 1 entries) */
+  SSAPhi *phis;    /* Phis grouped by block */
+  int *phi_args;   /* Argument values of all phis */
+} SSAForm;
+
+/**
+ * @brief Build the SSA form of a program
+ *
+ * Places phis at the iterated dominance frontiers of each location's
+ * definitions (Cytron et al.), restricted to locations read in some block
+ * before being written there (semi-pruned form), with dominance frontiers
+ * computed by walking up from the predecessors of each join block (Cooper,
+ * Harvey and Kennedy). Values are then assigned by a preorder walk of the
+ * dominator tree, undoing each block's definitions on the way back up.
+ * Every step is linear in the program and CFG apart from the frontier
+ * sizes; nothing recurses.
+ *
+ * @param program TAC program
+ * @param cfg Control-flow graph of program
+ * @return SSAForm* SSA form, or NULL on invalid arguments
+ */
+SSAForm *ssa_build(const TACProgram *program, const CFG *cfg);
+
+/**
+ * @brief Translate out of SSA form, rewriting the program
+ *
+ * Each value is stored in the location it is a version of, so reads and
+ * writes are renamed back and the phis of a block become one parallel copy
+ * per incoming edge. The copies are sequentialized (Boissinot et al.):
+ * a copy is emitted once its destination is no longer needed as a source,
+ * and a cycle is broken through a new temporary. Copies go at the end of
+ * a predecessor that jumps or falls into the block unconditionally. A
+ * conditional jump's fall-through copies go right after it and its taken
+ * edge is split into a new block. This is exact for the form ssa_build()
+ * produces, where versions of one location are never live at the same
+ * time, and stays so for passes that preserve that.
+ *
+ * @param ssa SSA form of program
+ * @param program The program ssa was built from, unchanged since
+ * @return bool Success status; ssa and its CFG are stale afterwards
+ */
+bool ssa_to_tac(const SSAForm *ssa, TACProgram *program);
+
+/**
+ * @brief Print the phis of every block to stdout
+ *
+ * @param ssa SSA form
+ */
+void ssa_print(const SSAForm *ssa);
+
+/**
+ * @brief Free SSA form resources
+ *
+ * @param ssa SSA form to destroy
+ */
+void ssa_destroy(SSAForm *ssa);
+
+#endif /* SSA_H */
@@ -7,6 +7,7 @@
 #define TAC_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief Three-address code operation types
@@ -17,6 +18,9 @@ typedef enum {
   TAC_OP_SUB,    /* x := y - z */
   TAC_OP_MUL,    /* x := y * z */
   TAC_OP_DIV,    /* x := y / z */
+  TAC_OP_NEG,    /* x := -y */
+  TAC_OP_SHL,    /* x := y << z (z a constant in 0..31) */
+  TAC_OP_SHR,    /* x := y >> z, rounding toward zero: y / 2^z */
   TAC_OP_EQ,     /* if y = z goto L */
   TAC_OP_NE,     /* if y != z goto L */
   TAC_OP_LT,     /* if y < z goto L */
@@ -30,26 +34,179 @@ typedef enum {
   TAC_OP_RETURN  /* return x */
 } TACOpType;
 
+/**
+ * @brief Three-address code operand kinds
+ */
+typedef enum {
+  TAC_OPND_NONE,  /* Operand slot unused */
+  TAC_OPND_VAR,   /* Program variable, id indexes TACProgram.var_names */
+  TAC_OPND_TEMP,  /* Compiler temporary, printed as t<id> */
+  TAC_OPND_CONST, /* Integer constant */
+  TAC_OPND_LABEL  /* Jump target, printed as L<id> */
+} TACOperandKind;
+
+/**
+ * @brief Three-address code operand
+ *
+ * Operands are 8-byte values: a kind tag plus either a dense id (variables,
+ * temporaries, labels) or the constant value itself. Names are only rendered
+ * when the program is printed.
+ */
+typedef struct TACOperand {
+  TACOperandKind kind; /* Operand kind */
+  union {
+    int id;    /* Variable, temporary or label id */
+    int value; /* Constant value */
+  };
+} TACOperand;
+
 /**
  * @brief Three-address code instruction
  */
 typedef struct TACInst {
-  TACOpType op; /* Operation type */
-  char *result; /* Result operand */
-  char *arg1;   /* First argument */
-  char *arg2;   /* Second argument */
-  int lineno;   /* Line number for error reporting */
+  TACOpType op;      /* Operation type */
+  TACOperand result; /* Result operand (jump target for branches) */
+  TACOperand arg1;   /* First argument */
+  TACOperand arg2;   /* Second argument */
+  int lineno;        /* Line number for error reporting */
 } TACInst;
 
 /**
  * @brief Three-address code program
+ *
+ * Instructions are fixed-size records stored contiguously, so passes and
+ * printers iterate with a linear scan. Variable names live in a chunked
+ * string pool owned by the program.
  */
 typedef struct TACProgram {
-  TACInst **instructions; /* Array of instructions */
-  int count;              /* Number of instructions */
-  int capacity;           /* Capacity of instructions array */
+  TACInst *instructions; /* Contiguous array of instructions */
+  int count;             /* Number of instructions */
+  int capacity;          /* Capacity of instructions array */
+
+  const char **var_names;              /* Names indexed by variable id */
+  int var_count;                       /* Number of variables */
+  int var_capacity;                    /* Capacity of var_names array */
+  struct TACStringChunk *string_chunks; /* Pool backing var_names */
+  int temp_count;  /* One past the highest temporary id in use */
+  int label_count; /* One past the highest label id in use */
 } TACProgram;
 
+/**
+ * @brief A pending edit to a TAC program
+ */
+typedef struct TACEdit {
+  int index;    /* Instruction index in the unedited program */
+  int seq;      /* Recording order, keeps edits at one index stable */
+  bool remove;  /* Remove the instruction at index */
+  TACInst inst; /* Otherwise: instruction to insert before index */
+} TACEdit;
+
+/**
+ * @brief Side list of edits against a TAC program
+ *
+ * Passes record removals and insertions by original instruction index while
+ * scanning, then apply them all with one linear merge. Indices seen by the
+ * pass stay valid until the list is applied.
+ */
+typedef struct TACEditList {
+  TACEdit *edits; /* Recorded edits */
+  int count;      /* Number of edits */
+  int capacity;   /* Capacity of edits array */
+} TACEditList;
+
+/**
+ * @brief Construct operands of each kind
+ */
+static inline TACOperand tac_none(void) {
+  TACOperand o = {TAC_OPND_NONE, {0}};
+  return o;
+}
+static inline TACOperand tac_var(int id) {
+  TACOperand o = {TAC_OPND_VAR, {id}};
+  return o;
+}
+static inline TACOperand tac_temp(int id) {
+  TACOperand o = {TAC_OPND_TEMP, {id}};
+  return o;
+}
+static inline TACOperand tac_const(int value) {
+  TACOperand o = {TAC_OPND_CONST, {value}};
+  return o;
+}
+static inline TACOperand tac_label(int id) {
+  TACOperand o = {TAC_OPND_LABEL, {id}};
+  return o;
+}
+
+/**
+ * @brief Check whether two operands denote the same value location
+ */
+static inline bool tac_operand_equals(TACOperand a, TACOperand b) {
+  return a.kind == b.kind && a.id == b.id;
+}
+
+/**
+ * @brief Check whether an operation is a conditional jump (if y relop z)
+ */
+static inline bool tac_op_is_cond_jump(TACOpType op) {
+  return op >= TAC_OP_EQ && op <= TAC_OP_GE;
+}
+
+/**
+ * @brief Check whether an operation computes from y alone (x := op y)
+ */
+static inline bool tac_op_is_unary(TACOpType op) { return op == TAC_OP_NEG; }
+
+/**
+ * @brief Check whether an operation transfers control to its result label
+ */
+static inline bool tac_op_is_jump(TACOpType op) {
+  return tac_op_is_cond_jump(op) || op == TAC_OP_GOTO;
+}
+
+/**
+ * @brief Get the conditional jump taken exactly when op is not taken
+ */
+static inline TACOpType tac_op_negate_relop(TACOpType op) {
+  switch (op) {
+  case TAC_OP_EQ:
+    return TAC_OP_NE;
+  case TAC_OP_NE:
+    return TAC_OP_EQ;
+  case TAC_OP_LT:
+    return TAC_OP_GE;
+  case TAC_OP_GE:
+    return TAC_OP_LT;
+  case TAC_OP_GT:
+    return TAC_OP_LE;
+  case TAC_OP_LE:
+    return TAC_OP_GT;
+  default:
+    return op;
+  }
+}
+
+/**
+ * @brief Check whether an operation writes its result operand
+ *
+ * For all other operations a non-label result operand is read.
+ */
+static inline bool tac_op_writes_result(TACOpType op) {
+  switch (op) {
+  case TAC_OP_ASSIGN:
+  case TAC_OP_ADD:
+  case TAC_OP_SUB:
+  case TAC_OP_MUL:
+  case TAC_OP_DIV:
+  case TAC_OP_NEG:
+  case TAC_OP_SHL:
+  case TAC_OP_SHR:
+    return true;
+  default:
+    return false;
+  }
+}
+
 /**
  * @brief Create a new TAC program
  *
@@ -62,24 +219,131 @@ TACProgram *tac_program_create(void);
  *
  * @param program TAC program
  * @param op Operation type
- * @param result Result operand (can be NULL)
- * @param arg1 First argument (can be NULL)
- * @param arg2 Second argument (can be NULL)
+ * @param result Result operand (tac_none() if unused)
+ * @param arg1 First argument (tac_none() if unused)
+ * @param arg2 Second argument (tac_none() if unused)
  * @param lineno Line number
  * @return int Index of added instruction, or -1 on failure
  */
-int tac_program_add_inst(TACProgram *program, TACOpType op, const char *result,
-                         const char *arg1, const char *arg2, int lineno);
+int tac_program_add_inst(TACProgram *program, TACOpType op, TACOperand result,
+                         TACOperand arg1, TACOperand arg2, int lineno);
+
+/**
+ * @brief Register a variable name with a TAC program
+ *
+ * The name is copied once; instructions refer to it by the returned id.
+ * Callers are expected to intern names (see the SDT symbol table) so that
+ * each name is added only once.
+ *
+ * @param program TAC program
+ * @param name Variable name
+ * @return int Variable id, or -1 on failure
+ */
+int tac_program_add_var(TACProgram *program, const char *name);
+
+/**
+ * @brief Get the name of a variable id
+ *
+ * @param program TAC program
+ * @param id Variable id
+ * @return const char* Variable name, or NULL if id is out of range
+ */
+const char *tac_program_var_name(const TACProgram *program, int id);
+
+/**
+ * @brief Allocate a fresh temporary id not used by any instruction
+ *
+ * @param program TAC program
+ * @return TACOperand New temporary operand
+ */
+TACOperand tac_program_new_temp(TACProgram *program);
+
+/**
+ * @brief Allocate a fresh label id not used by any instruction
+ *
+ * @param program TAC program
+ * @return TACOperand New label operand
+ */
+TACOperand tac_program_new_label(TACProgram *program);
+
+/**
+ * @brief Render an operand as text
+ *
+ * @param program TAC program (for variable names)
+ * @param operand Operand to render
+ * @param buffer Output buffer
+ * @param buffer_size Size of the output buffer
+ * @return const char* buffer
+ */
+const char *tac_operand_to_string(const TACProgram *program, TACOperand operand,
+                                  char *buffer, size_t buffer_size);
 
 /**
  * @brief Get an instruction from a TAC program
  *
+ * The returned pointer is invalidated by any call that adds instructions.
+ *
  * @param program TAC program
  * @param index Instruction index
  * @return TACInst* Instruction at index, or NULL if index is out of bounds
  */
 TACInst *tac_program_get_inst(TACProgram *program, int index);
 
+/**
+ * @brief Initialize an empty edit list
+ *
+ * @param edits Edit list
+ */
+void tac_edit_list_init(TACEditList *edits);
+
+/**
+ * @brief Release the storage of an edit list
+ *
+ * @param edits Edit list
+ */
+void tac_edit_list_free(TACEditList *edits);
+
+/**
+ * @brief Record removal of an instruction
+ *
+ * @param edits Edit list
+ * @param index Index of the instruction to remove
+ * @return bool Success status
+ */
+bool tac_edit_remove(TACEditList *edits, int index);
+
+/**
+ * @brief Record insertion of an instruction
+ *
+ * Several insertions before the same index keep their recording order.
+ *
+ * @param edits Edit list
+ * @param before Index of the instruction to insert before (count = append)
+ * @param inst Instruction to insert
+ * @return bool Success status
+ */
+bool tac_edit_insert(TACEditList *edits, int before, TACInst inst);
+
+/**
+ * @brief Apply and clear all recorded edits in one linear pass
+ *
+ * @param program TAC program
+ * @param edits Edit list (emptied on success)
+ * @return bool Success status
+ */
+bool tac_program_apply_edits(TACProgram *program, TACEditList *edits);
+
+/**
+ * @brief Rebuild the instruction array in a new order
+ *
+ * @param program TAC program
+ * @param order Original indices in their new order; omitted indices are
+ * dropped, repeated indices are duplicated
+ * @param count Number of entries in order
+ * @return bool Success status
+ */
+bool tac_program_reorder(TACProgram *program, const int *order, int count);
+
 /**
  * @brief Print a TAC program to stdout
  *
@@ -103,6 +367,43 @@ bool tac_program_write_to_file(TACProgram *program, const char *filename);
  */
 void tac_program_destroy(TACProgram *program);
 
+/**
+ * @brief Divide by 2^b with an arithmetic shift, rounding toward zero
+ *
+ * Negative dividends are biased by 2^b - 1 first, so the result equals
+ * a / 2^b for every a. The count is taken modulo 32.
+ */
+static inline int tac_shift_right(int a, int b) {
+  unsigned int k = (unsigned int)b & 31;
+  unsigned int bias = a < 0 ? (1u << k) - 1u : 0u;
+  return (int)((unsigned int)a + bias) >> k;
+}
+
+/**
+ * @brief Evaluate an arithmetic operation on constants
+ *
+ * Arithmetic is on 32-bit two's complement integers and wraps on overflow
+ * (INT_MIN / -1 is INT_MIN). Division and TAC_OP_SHR truncate toward zero;
+ * shift counts are taken modulo 32.
+ *
+ * @param op TAC_OP_ADD .. TAC_OP_SHR
+ * @param a Left operand
+ * @param b Right operand (ignored by TAC_OP_NEG)
+ * @param result Output value
+ * @return bool false for division by zero or a non-arithmetic op
+ */
+bool tac_eval_arith(TACOpType op, int a, int b, int *result);
+
+/**
+ * @brief Evaluate the condition of a conditional jump on constants
+ *
+ * @param op Relational operation (TAC_OP_EQ .. TAC_OP_GE)
+ * @param a Left operand
+ * @param b Right operand
+ * @return bool Whether the jump is taken
+ */
+bool tac_eval_relop(TACOpType op, int a, int b);
+
 /**
  * @brief Create a string representation of a TAC operation type
  *
@@ -0,0 +1,144 @@
+/**
+ * @file codegen/tac_bytecode.h
+ * @brief Binary three-address code that is loaded by mapping the file
+ */
+
+#ifndef TAC_BYTECODE_H
+#define TAC_BYTECODE_H
+
+#include "codegen/tac.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* File signature and format revision */
+#define TAC_BYTECODE_MAGIC "TACB"
+#define TAC_BYTECODE_VERSION 1
+
+/* Written in the writer's byte order; a loader on a host of the other
+ * order reads it swapped and rejects the file */
+#define TAC_BYTECODE_BYTE_ORDER 0x01020304u
+
+/* Alignment of every section, from the start of the file */
+#define TAC_BYTECODE_ALIGN 8
+
+/* Instruction records staged before each write */
+#define TAC_BYTECODE_BATCH 4096
+
+/**
+ * @brief File header
+ *
+ * The sections follow in this order, each at an aligned offset: the
+ * constant pool, the variable name offsets, the string pool and the
+ * instruction records.
+ */
+typedef struct TACBytecodeHeader {
+  char magic[4];         /* TAC_BYTECODE_MAGIC, not NUL-terminated */
+  uint32_t version;      /* TAC_BYTECODE_VERSION */
+  uint32_t byte_order;   /* TAC_BYTECODE_BYTE_ORDER */
+  uint32_t inst_size;    /* sizeof(TACBytecodeInst) */
+  uint32_t inst_count;   /* Number of instruction records */
+  uint32_t const_count;  /* Number of distinct constants */
+  uint32_t var_count;    /* Number of variables */
+  uint32_t temp_count;   /* One past the highest temporary id */
+  uint32_t label_count;  /* One past the highest label id */
+  uint32_t reserved;     /* Zero */
+  uint64_t string_size;  /* Bytes in the string pool */
+  uint64_t const_offset; /* int32_t constants, in order of first use */
+  uint64_t var_offset;   /* uint32_t string pool offset of each variable */
+  uint64_t string_offset; /* NUL-terminated variable names */
+  uint64_t inst_offset;  /* TACBytecodeInst records */
+  uint64_t file_size;    /* Size of the whole file */
+} TACBytecodeHeader;
+
+/**
+ * @brief Fixed-width instruction record
+ *
+ * Each operand is a kind and a number: a variable id, a temporary id or an
+ * index into the constant pool. A label operand is already resolved: a
+ * jump holds the index of the record defining its target, and only that
+ * TAC_OP_LABEL record keeps the label id, for printing.
+ */
+typedef struct TACBytecodeInst {
+  uint8_t op;         /* TACOpType */
+  uint8_t kind[3];    /* TACOperandKind of result, arg1 and arg2 */
+  int32_t operand[3]; /* Result, arg1 and arg2 */
+  int32_t lineno;     /* Line number */
+} TACBytecodeInst;
+
+/**
+ * @brief Bytecode file mapped into memory
+ *
+ * All pointers are into the mapping: nothing is copied or decoded when the
+ * file is opened.
+ */
+typedef struct TACBytecode {
+  const TACBytecodeHeader *header;     /* Start of the mapping */
+  const int32_t *constants;            /* Constant pool */
+  const uint32_t *var_names;           /* Name offset of each variable */
+  const char *strings;                 /* String pool */
+  const TACBytecodeInst *instructions; /* Instruction records */
+  void *map;                           /* Mapped file */
+  size_t size;                         /* Bytes mapped */
+} TACBytecode;
+
+/**
+ * @brief Write a program as bytecode
+ *
+ * Labels and constants are resolved with one scan of the program, then the
+ * file is written front to back through a buffer.
+ *
+ * @param program TAC program
+ * @param filename Output path
+ * @return bool true on success, false if the file cannot be written or a
+ * jump targets an undefined label
+ */
+bool tac_bytecode_write(const TACProgram *program, const char *filename);
+
+/**
+ * @brief Map a bytecode file
+ *
+ * Checks the header and that every section lies inside the file; the
+ * records themselves are only checked by tac_bytecode_verify().
+ *
+ * @param filename Input path
+ * @return TACBytecode* Mapped file, or NULL if it cannot be read or is not
+ * bytecode of this version and byte order
+ */
+TACBytecode *tac_bytecode_open(const char *filename);
+
+/**
+ * @brief Check that every record and name is in range
+ *
+ * After a successful check, operands can be used as indices without
+ * bounds checks.
+ *
+ * @param bytecode Mapped file
+ * @return bool true if the file is well formed
+ */
+bool tac_bytecode_verify(const TACBytecode *bytecode);
+
+/**
+ * @brief Unmap a bytecode file
+ *
+ * @param bytecode Mapped file to close
+ */
+void tac_bytecode_close(TACBytecode *bytecode);
+
+/**
+ * @brief Get the name of a variable id
+ */
+static inline const char *tac_bytecode_var_name(const TACBytecode *bytecode,
+                                                int id) {
+  return bytecode->strings + bytecode->var_names[id];
+}
+
+/**
+ * @brief Get the label id of a jump's target record
+ */
+static inline int tac_bytecode_label_id(const TACBytecode *bytecode,
+                                        int target) {
+  return bytecode->instructions[target].operand[0];
+}
+
+#endif /* TAC_BYTECODE_H */
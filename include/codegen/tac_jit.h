@@ -0,0 +1,93 @@
+/**
+ * @file codegen/tac_jit.h
+ * @brief In-process x86-64 compiler for three-address code
+ */
+
+#ifndef TAC_JIT_H
+#define TAC_JIT_H
+
+#include "codegen/tac.h"
+#include "codegen/tac_vm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Compilation and execution statistics
+ */
+typedef struct TACJITStats {
+  double compile_seconds; /* Allocation, selection, fixups and mapping */
+  double run_seconds;     /* Wall time of the last run */
+  size_t code_bytes;      /* Machine code size */
+  int fixups;             /* Jumps patched through the fixup table */
+  int intervals;          /* Locations with a live interval */
+  int spilled;            /* Intervals kept in memory */
+  int registers_used;     /* Distinct machine registers assigned */
+} TACJITStats;
+
+/**
+ * @brief A program compiled to machine code, or its interpreter fallback
+ *
+ * Machine code is written into an anonymous mapping that is made
+ * executable, and no longer writable, once every jump is patched. The
+ * compiled function keeps variables and temporaries in one slot array laid
+ * out like dataflow_location(). Programs the compiler cannot translate, or
+ * hosts that refuse executable mappings, run on the TAC virtual machine.
+ */
+typedef struct TACJIT {
+  void *code;           /* Executable mapping, or NULL when falling back */
+  size_t mapped;        /* Size of the mapping */
+  int32_t *slots;       /* Variables, then temporaries */
+  int var_count;        /* Number of variables */
+  int slot_count;       /* Number of slots */
+  TACVM *fallback;      /* Interpreter used when code is NULL */
+  const char *fallback_reason; /* Why the program is interpreted */
+  TACJITStats stats;    /* Statistics */
+  const char *error;    /* Last runtime error, or NULL */
+} TACJIT;
+
+/**
+ * @brief Compile a program, falling back to the interpreter if needed
+ *
+ * @param program TAC program (must outlive the JIT while falling back)
+ * @return TACJIT* Compiled program, or NULL if neither the compiler nor the
+ * interpreter accepts it
+ */
+TACJIT *tac_jit_create(const TACProgram *program);
+
+/**
+ * @brief Check whether a program runs as machine code
+ */
+bool tac_jit_is_compiled(const TACJIT *jit);
+
+/**
+ * @brief Run the program from the start with all variables zeroed
+ *
+ * @param jit Compiled program
+ * @return bool true if the program ran to completion, false after a
+ * division by zero (see tac_jit_error())
+ */
+bool tac_jit_run(TACJIT *jit);
+
+/**
+ * @brief Get the value of a variable after a run
+ *
+ * @return int Value, or 0 if id is out of range
+ */
+int tac_jit_get_var(const TACJIT *jit, int id);
+
+/**
+ * @brief Get the last runtime error message
+ *
+ * @return const char* Message, or NULL if the last run succeeded
+ */
+const char *tac_jit_error(const TACJIT *jit);
+
+/**
+ * @brief Unmap the code and free JIT resources
+ *
+ * @param jit JIT to destroy
+ */
+void tac_jit_destroy(TACJIT *jit);
+
+#endif /* TAC_JIT_H */
@@ -0,0 +1,225 @@
+/**
+ * @file codegen/tac_opt.h
+ * @brief Transformation passes over three-address code
+ */
+
+#ifndef TAC_OPT_H
+#define TAC_OPT_H
+
+#include "codegen/tac.h"
+
+typedef struct TACPeepholeStats TACPeepholeStats;
+
+/**
+ * @brief Run the optimization passes enabled at a level
+ *
+ * Level 0 leaves the program unchanged. Level 1 enables local constant
+ * folding and propagation, local value numbering, copy propagation,
+ * global constant propagation, loop rotation, loop-invariant code motion,
+ * loop unrolling by CONFIG_UNROLL_FACTOR, peephole simplification and jump
+ * cleanup.
+ *
+ * @param program TAC program
+ * @param level Optimization level (as given by -O)
+ * @param stats Optional output: peephole rewrites per rule, summed over the
+ * peephole runs
+ * @return bool Success status
+ */
+bool tac_optimize(TACProgram *program, int level, TACPeepholeStats *stats);
+
+/**
+ * @brief Fold constant arithmetic and branches within basic blocks
+ *
+ * Propagates constants assigned to variables and temporaries into later
+ * reads in the same basic block, evaluates arithmetic whose operands are all
+ * constant (division by zero is left for run time), turns a conditional
+ * jump with a constant condition into a goto or removes it, and deletes
+ * temporaries whose constant value was copied into every reader.
+ *
+ * @param program TAC program
+ * @return int Number of instructions changed or removed, or -1 on failure
+ */
+int tac_opt_fold_constants(TACProgram *program);
+
+/**
+ * @brief Replace recomputed expressions within basic blocks by copies
+ *
+ * Numbers every value in a basic block, keying expressions by
+ * (op, vn(arg1), vn(arg2)) with the arguments of + and * put in canonical
+ * order. An expression whose value was already computed becomes a copy
+ * from a location still holding it. Writing a variable or temporary gives
+ * it a new value number, which kills expressions that were only available
+ * in its old value.
+ *
+ * @param program TAC program
+ * @return int Number of expressions replaced, or -1 on failure
+ */
+int tac_opt_value_numbering(TACProgram *program);
+
+/**
+ * @brief Coalesce and propagate copies
+ *
+ * A temporary computed once and read only by a later "x := t" in the same
+ * basic block is coalesced: its computation writes x directly and the copy
+ * is removed. Reads are then rewritten through copies recorded earlier in
+ * the same block, and, across blocks, through "d := s" when d is written
+ * only there, that write dominates every read of d, and s is a constant or
+ * is written once outside any loop before the copy. Self-copies left over
+ * are removed; copies that become dead are left for tac_opt_cleanup().
+ *
+ * @param program TAC program
+ * @return int Number of instructions changed or removed, or -1 on failure
+ */
+int tac_opt_copy_propagation(TACProgram *program);
+
+/**
+ * @brief Propagate constants across basic blocks
+ *
+ * Solves reaching definitions for the locations that have some constant
+ * write, then replaces each read that comes before any write in its block
+ * by a constant when every definition reaching the block assigns that same
+ * constant (a location's initial zero counts as a definition). Variables
+ * that are never written read as zero everywhere. Like GCC's
+ * max-gcse-memory, the dataflow step is skipped when its solution would
+ * exceed a fixed size. Follow with tac_opt_fold_constants() to fold what
+ * becomes constant.
+ *
+ * @param program TAC program
+ * @return int Number of reads replaced, or -1 on failure
+ */
+int tac_opt_global_constants(TACProgram *program);
+
+/**
+ * @brief Turn top-tested loops into a guard and bottom tests
+ *
+ * A while loop is laid out as "Lh: X; if !C goto Lexit; body; goto Lh", so
+ * every iteration takes the goto and then tests C. When the header ends in
+ * a conditional jump with one way into the loop and one out, and is at
+ * most a few instructions long, each unconditional back edge is replaced
+ * by a copy of the header's code ending in "if C goto Lbody; goto Lexit".
+ * The original header stays in front as the guard that runs once, and an
+ * iteration now takes a single conditional jump. Labels are added where
+ * the body or exit has none.
+ *
+ * @param program TAC program
+ * @return int Number of back edges rewritten, or -1 on failure
+ */
+int tac_opt_rotate_loops(TACProgram *program);
+
+/**
+ * @brief Hoist loop-invariant computations into loop preheaders
+ *
+ * For every natural loop, outermost first, moves out the computations
+ * whose operands are constants or are not written in the loop, repeating
+ * as hoisted definitions make more operands invariant. Only side-effect
+ * free instructions writing a temporary qualify: the temporary must be
+ * written nowhere else, read only inside the loop, and its definition must
+ * dominate those reads. A loop that was not rotated tests its condition in
+ * the header, so the preheader also runs when the body runs zero times;
+ * these conditions make that unobservable, and division only moves with a
+ * nonzero constant divisor so nothing new can trap. The preheader is a new
+ * label placed right before the header, and jumps entering the loop from
+ * outside are redirected to it.
+ *
+ * @param program TAC program
+ * @return int Number of instructions hoisted, or -1 on failure
+ */
+int tac_opt_licm(TACProgram *program);
+
+/**
+ * @brief Unroll counted loops
+ *
+ * Recognizes loops of a single block, such as rotated "while i < N do
+ * i = i + c" loops, whose body writes an induction variable once by a
+ * constant step and which test it against a constant or a location the
+ * body does not write. When the entry value is a known constant and the
+ * loop runs at most a few times, it is replaced by that many copies of
+ * its body. Otherwise, when the variable moves toward the bound, the body
+ * is repeated factor times with one test per copy group, while the
+ * original loop stays behind to run the remaining iterations. Limits on
+ * the unrolled body and on the program's total growth keep code size in
+ * check, the way GCC's max-unrolled-insns and related parameters do.
+ *
+ * @param program TAC program
+ * @param factor Copies of the body per iteration of a partially unrolled
+ * loop (below 2 disables partial unrolling)
+ * @return int Number of loops unrolled, or -1 on failure
+ */
+int tac_opt_unroll_loops(TACProgram *program, int factor);
+
+/**
+ * @brief Rewrite rules of tac_opt_peephole(), in the order they are tried
+ */
+typedef enum {
+  TAC_PEEPHOLE_REASSOCIATE,     /* (a + c1) + c2 -> a + (c1 + c2), also * << */
+  TAC_PEEPHOLE_DOUBLE_NEGATION, /* -(-a) -> a */
+  TAC_PEEPHOLE_IDENTITY,        /* a + 0, a * 1, a / 1, a << 0 -> a */
+  TAC_PEEPHOLE_ZERO,            /* a * 0, a - a -> 0 */
+  TAC_PEEPHOLE_NEGATE,          /* 0 - a, a * -1, a / -1 -> -a */
+  TAC_PEEPHOLE_MUL_TO_SHIFT,    /* a * 2^k -> a << k */
+  TAC_PEEPHOLE_DIV_TO_SHIFT,    /* a / 2^k -> a >> k */
+  TAC_PEEPHOLE_RULE_COUNT
+} TACPeepholeRule;
+
+/**
+ * @brief Rewrites made by one run of tac_opt_peephole(), per rule
+ */
+struct TACPeepholeStats {
+  int rewrites[TAC_PEEPHOLE_RULE_COUNT];
+};
+
+/**
+ * @brief Simplify arithmetic through a pattern table over a sliding window
+ *
+ * Each arithmetic instruction is matched against the rules in turn, with
+ * constants of + and * moved second, until none applies. Rules may look
+ * back up to a few instructions in the same basic block for the definition
+ * of the first operand, provided that definition's own operands have not
+ * been written since, which lets constant chains be reassociated into one
+ * instruction. Definitions left unread are removed by tac_opt_cleanup().
+ * Division by a power of two becomes TAC_OP_SHR, which rounds toward zero
+ * like division; division by zero is left alone so it still traps.
+ *
+ * @param program TAC program
+ * @param stats Optional output: rewrites per rule
+ * @return int Number of instructions changed, or -1 on failure
+ */
+int tac_opt_peephole(TACProgram *program, TACPeepholeStats *stats);
+
+/**
+ * @brief Get the name of a peephole rule
+ */
+const char *tac_opt_peephole_rule_name(TACPeepholeRule rule);
+
+/**
+ * @brief Clean up jumps, labels and dead code
+ *
+ * Repeats until nothing changes: threads jumps through labels that lead
+ * straight to another goto (and onto the first of a run of labels), removes
+ * instructions unreachable from the entry, drops jumps to the next
+ * instruction, inverts a conditional jump over a goto so that it falls
+ * through, deletes labels nothing jumps to, removes writes to
+ * temporaries that are never read, and removes stores that are overwritten
+ * later in the same basic block before being read (unless a division that
+ * may trap comes between).
+ *
+ * @param program TAC program
+ * @return int Number of changes made, or -1 on failure
+ */
+int tac_opt_cleanup(TACProgram *program);
+
+/**
+ * @brief Renumber temporaries so that ones with disjoint lifetimes share ids
+ *
+ * Computes the live interval of every temporary over the instruction order,
+ * widened to cover whole loops where a value is carried around a back edge,
+ * and assigns ids greedily in order of interval start, always reusing the
+ * lowest free id. This uses the minimum number of temporaries for the
+ * computed intervals.
+ *
+ * @param program TAC program
+ * @return int Number of temporaries after renumbering, or -1 on failure
+ */
+int tac_opt_recycle_temps(TACProgram *program);
+
+#endif /* TAC_OPT_H */
@@ -0,0 +1,99 @@
+/**
+ * @file codegen/tac_vm.h
+ * @brief Virtual machine executing three-address code
+ */
+
+#ifndef TAC_VM_H
+#define TAC_VM_H
+
+#include "codegen/tac.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Execution statistics of one run
+ */
+typedef struct TACVMStats {
+  uint64_t executed;   /* TAC instructions executed (labels excluded) */
+  uint64_t dispatched; /* VM instructions dispatched, after fusion */
+  uint64_t jumps;      /* TAC jumps executed, conditional or not */
+  uint64_t taken;      /* Jumps among them that were taken */
+  double load_seconds; /* Time to translate the program */
+  double run_seconds;  /* Wall time of the last run */
+} TACVMStats;
+
+/**
+ * @brief Loaded program ready to execute
+ *
+ * Loading resolves every label to a code index and every variable, temporary
+ * and constant to a dense slot, so execution never looks at operand kinds.
+ * Common instruction pairs are fused into superinstructions: a conditional
+ * jump followed by a goto becomes a two-way branch, arithmetic into a
+ * temporary followed by a copy to a variable stores both at once, and a
+ * goto to a branch executes the branch directly.
+ */
+typedef struct TACVM {
+  struct TACVMCode *code; /* Translated instructions, ending in a halt */
+  int code_count;         /* Number of translated instructions */
+  int32_t *slots;         /* Variables, then temporaries, then constants */
+  int slot_count;         /* Number of slots */
+  int var_count;          /* Number of variable slots */
+  int const_base;         /* First constant slot, after the temporaries */
+  const TACProgram *program; /* Source program (for names) */
+  TACVMStats stats;       /* Statistics of the last run */
+  int error_line;         /* Line of the last runtime error, or 0 */
+  const char *error;      /* Last runtime error, or NULL */
+} TACVM;
+
+/**
+ * @brief Translate a program for execution
+ *
+ * @param program TAC program (must outlive the VM)
+ * @return TACVM* Loaded program, or NULL if it jumps to an undefined label
+ * or uses an operation the VM does not implement (param, call)
+ */
+TACVM *tac_vm_create(const TACProgram *program);
+
+/**
+ * @brief Run the program from the start with all variables zeroed
+ *
+ * Arithmetic wraps on 32-bit overflow; division by zero stops the run.
+ *
+ * @param vm Loaded program
+ * @return bool true if the program ran to completion, false on a runtime
+ * error (see tac_vm_error())
+ */
+bool tac_vm_run(TACVM *vm);
+
+/**
+ * @brief Get the value of a variable after a run
+ *
+ * @param vm Loaded program
+ * @param id Variable id
+ * @return int Value, or 0 if id is out of range
+ */
+int tac_vm_get_var(const TACVM *vm, int id);
+
+/**
+ * @brief Get the last runtime error message
+ *
+ * @param vm Loaded program
+ * @return const char* Message, or NULL if the last run succeeded
+ */
+const char *tac_vm_error(const TACVM *vm);
+
+/**
+ * @brief Print each variable and its value to stdout
+ *
+ * @param vm Loaded program
+ */
+void tac_vm_print_vars(const TACVM *vm);
+
+/**
+ * @brief Free VM resources
+ *
+ * @param vm VM to destroy
+ */
+void tac_vm_destroy(TACVM *vm);
+
+#endif /* TAC_VM_H */
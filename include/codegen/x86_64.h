@@ -0,0 +1,89 @@
+/**
+ * @file codegen/x86_64.h
+ * @brief x86-64 code generation from three-address code
+ */
+
+#ifndef X86_64_H
+#define X86_64_H
+
+#include "codegen/tac.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief General-purpose registers, numbered as in instruction encodings
+ */
+typedef enum {
+  X86_RAX,
+  X86_RCX,
+  X86_RDX,
+  X86_RBX,
+  X86_RSP,
+  X86_RBP,
+  X86_RSI,
+  X86_RDI,
+  X86_R8,
+  X86_R9,
+  X86_R10,
+  X86_R11,
+  X86_R12,
+  X86_R13,
+  X86_R14,
+  X86_R15
+} X86Register;
+
+/* Registers handed to the allocator; rax, rdx and r11 are kept as scratch
+ * for division and memory-to-memory operations */
+#define X86_ALLOCATABLE 11
+
+/**
+ * @brief Machine register of each allocator register, callee-saved first
+ */
+extern const X86Register x86_allocatable[X86_ALLOCATABLE];
+
+/**
+ * @brief Statistics of one translation
+ */
+typedef struct X86Stats {
+  int intervals;      /* Locations with a live interval */
+  int spilled;        /* Intervals kept in memory */
+  int registers_used; /* Distinct machine registers assigned */
+} X86Stats;
+
+/**
+ * @brief Get the AT&T name of the low 32 bits of a register
+ */
+const char *x86_register_name32(X86Register reg);
+
+/**
+ * @brief Write a program as GNU assembler source
+ *
+ * The program becomes a function tac_run() returning 0, or 1 after a
+ * division by zero, with variables in the tac_vars array and spilled
+ * temporaries in tac_temps. Values are allocated to registers by linear
+ * scan; every write of a variable is also stored to tac_vars, so the array
+ * holds the results however the run ends. A main() wrapper times the call,
+ * prints the run time to stderr and each variable to stdout in the format
+ * of tac_vm_print_vars().
+ *
+ * @param program TAC program
+ * @param out Destination stream
+ * @param stats Optional output: allocation statistics
+ * @return bool true on success, false if the program cannot be translated
+ * (param, call, a shift by a non-constant count) or its graph cannot be
+ * built
+ */
+bool x86_emit_program(const TACProgram *program, FILE *out, X86Stats *stats);
+
+/**
+ * @brief Write a program as assembler source to a file
+ *
+ * @param program TAC program
+ * @param filename Output path
+ * @param stats Optional output: allocation statistics
+ * @return bool true on success
+ */
+bool x86_write_program(const TACProgram *program, const char *filename,
+                       X86Stats *stats);
+
+#endif /* X86_64_H */
@@ -28,6 +28,10 @@
 #define CONFIG_MAX_TOKENS 1000
 #endif
 
+#ifndef CONFIG_UNROLL_FACTOR
+#define CONFIG_UNROLL_FACTOR 4
+#endif
+
 #ifndef CONFIG_GENERATE_SAMPLES
 #define CONFIG_GENERATE_SAMPLES 5
 #endif
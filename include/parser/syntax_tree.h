@@ -19,11 +19,6 @@ typedef enum {
   NODE_EPSILON      /* Epsilon (empty) node */
 } NodeType;
 
-#ifdef CONFIG_TAC
-/* Forward declaration of SDTAttributes */
-struct SDTAttributes;
-#endif
-
 /**
  * @brief Syntax tree node structure
  */
@@ -44,10 +39,8 @@ typedef struct SyntaxTreeNode {
   /* Production information */
   int production_id; /* ID of the production used */
 
-#ifdef CONFIG_TAC
-  /* Semantic attributes for code generation */
-  struct SDTAttributes *attributes; /* Attributes for code generation */
-#endif
+  /* Index among the tree's non-terminals, -1 for other nodes */
+  int id;
 
 } SyntaxTreeNode;
 
@@ -56,6 +49,7 @@ typedef struct SyntaxTreeNode {
  */
 typedef struct {
   SyntaxTreeNode *root; /* Root node of the tree */
+  int node_count;       /* Non-terminal ids handed out, an upper bound */
 } SyntaxTree;
 
 /**
@@ -67,7 +61,7 @@ typedef struct {
 SyntaxTree *syntax_tree_create(void);
 
 /**
- * @brief Helper function to destroy a syntax tree node recursively
+ * @brief Helper function to destroy a syntax tree node and its subtree
  *
  * @param node Node to destroy
  */
@@ -83,12 +77,18 @@ void syntax_tree_destroy(SyntaxTree *tree);
 /**
  * @brief Create a non-terminal node
  *
+ * The node gets the next id of the tree it is built for, so later passes
+ * can keep per-node data in arrays of tree->node_count entries. Nodes
+ * dropped while parsing leave their ids unused.
+ *
+ * @param tree Tree the node is built for, or NULL to leave it unnumbered
  * @param nonterminal_id ID of the non-terminal
  * @param symbol_name Symbol name for display
  * @param production_id ID of the production used
  * @return SyntaxTreeNode* Created node
  */
-SyntaxTreeNode *syntax_tree_create_nonterminal(int nonterminal_id,
+SyntaxTreeNode *syntax_tree_create_nonterminal(SyntaxTree *tree,
+                                               int nonterminal_id,
                                                const char *symbol_name,
                                                int production_id);
 
@@ -72,6 +72,23 @@ void *safe_realloc(void *ptr, size_t size);
  */
 char *safe_strdup(const char *str);
 
+/**
+ * @brief Allocate an array of ints filled with -1
+ *
+ * One extra element is allocated, so n may be zero and index n is valid.
+ *
+ * @param n Number of elements
+ * @return int* Pointer to allocated array
+ */
+int *alloc_ints(int n);
+
+/**
+ * @brief Monotonic wall-clock time in seconds
+ *
+ * @return double Seconds since an arbitrary fixed point
+ */
+double now_seconds(void);
+
 /**
  * @brief Read entire file into memory
  *
@@ -0,0 +1,312 @@
+/**
+ * @file codegen/c_backend.c
+ * @brief C source generation from three-address code
+ */
+
+#include "codegen/c_backend.h"
+#include "common.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest operand rendered by format_operand(): an identifier plus a prefix */
+#define C_OPERAND_SIZE (CONFIG_MAX_TOKEN_LEN + 16)
+
+/**
+ * @brief Translation state
+ */
+typedef struct CEmitter {
+  const TACProgram *program;
+  FILE *out;
+  bool *label_used; /* Labels targeted by a jump */
+} CEmitter;
+
+/**
+ * @brief Render an operand as a C expression of type int32_t
+ */
+static const char *format_operand(const CEmitter *e, TACOperand operand,
+                                  char *buf) {
+  switch (operand.kind) {
+  case TAC_OPND_VAR:
+    snprintf(buf, C_OPERAND_SIZE, "v_%s",
+             tac_program_var_name(e->program, operand.id));
+    break;
+  case TAC_OPND_TEMP:
+    snprintf(buf, C_OPERAND_SIZE, "t%d", operand.id);
+    break;
+  case TAC_OPND_CONST:
+    if (operand.value == INT_MIN) {
+      snprintf(buf, C_OPERAND_SIZE, "INT32_MIN");
+    } else {
+      snprintf(buf, C_OPERAND_SIZE, "%d", operand.value);
+    }
+    break;
+  default:
+    snprintf(buf, C_OPERAND_SIZE, "0");
+    break;
+  }
+  return buf;
+}
+
+/**
+ * @brief dst = a + b, a - b or a * b, wrapping at 32 bits
+ */
+static void emit_arith(const CEmitter *e, const TACInst *inst) {
+  char d[C_OPERAND_SIZE], a[C_OPERAND_SIZE], b[C_OPERAND_SIZE];
+  const char *op = inst->op == TAC_OP_ADD   ? "+"
+                   : inst->op == TAC_OP_SUB ? "-"
+                                            : "*";
+  fprintf(e->out, "  %s = (int32_t)((uint32_t)%s %s (uint32_t)%s);\n",
+          format_operand(e, inst->result, d), format_operand(e, inst->arg1, a),
+          op, format_operand(e, inst->arg2, b));
+}
+
+/**
+ * @brief dst = -a, a << b or a >> b
+ */
+static void emit_unary_shift(const CEmitter *e, const TACInst *inst) {
+  char d[C_OPERAND_SIZE], a[C_OPERAND_SIZE], b[C_OPERAND_SIZE];
+  format_operand(e, inst->result, d);
+  format_operand(e, inst->arg1, a);
+  format_operand(e, inst->arg2, b);
+  if (inst->op == TAC_OP_NEG) {
+    fprintf(e->out, "  %s = (int32_t)(0u - (uint32_t)%s);\n", d, a);
+  } else if (inst->op == TAC_OP_SHL) {
+    fprintf(e->out, "  %s = (int32_t)((uint32_t)%s << (%s & 31));\n", d, a,
+            b);
+  } else {
+    fprintf(e->out, "  %s = tac_shr(%s, %s);\n", d, a, b);
+  }
+}
+
+/**
+ * @brief dst = a / b, leaving through tac_divzero on a zero divisor
+ */
+static void emit_div(const CEmitter *e, const TACInst *inst) {
+  char d[C_OPERAND_SIZE], a[C_OPERAND_SIZE], b[C_OPERAND_SIZE];
+  format_operand(e, inst->result, d);
+  format_operand(e, inst->arg1, a);
+  format_operand(e, inst->arg2, b);
+
+  if (inst->arg2.kind == TAC_OPND_CONST && inst->arg2.value == 0) {
+    fprintf(e->out, "  goto tac_divzero;\n");
+  } else if (inst->arg2.kind == TAC_OPND_CONST && inst->arg2.value == -1) {
+    fprintf(e->out, "  %s = (int32_t)(0u - (uint32_t)%s);\n", d, a);
+  } else if (inst->arg2.kind == TAC_OPND_CONST) {
+    fprintf(e->out, "  %s = %s / %s;\n", d, a, b);
+  } else {
+    fprintf(e->out, "  if (%s == 0)\n    goto tac_divzero;\n", b);
+    fprintf(e->out, "  %s = tac_div(%s, %s);\n", d, a, b);
+  }
+}
+
+/**
+ * @brief if (a relop b) goto L
+ */
+static void emit_cond_jump(const CEmitter *e, const TACInst *inst) {
+  static const char *const relops[] = {"==", "!=", "<", "<=", ">", ">="};
+  char a[C_OPERAND_SIZE], b[C_OPERAND_SIZE];
+  fprintf(e->out, "  if (%s %s %s)\n    goto L%d;\n",
+          format_operand(e, inst->arg1, a), relops[inst->op - TAC_OP_EQ],
+          format_operand(e, inst->arg2, b), inst->result.id);
+}
+
+/**
+ * @brief Emit the declarations of tac_run()'s locals
+ */
+static void emit_locals(const CEmitter *e) {
+  const TACProgram *program = e->program;
+  char buf[C_OPERAND_SIZE];
+  for (int v = 0; v < program->var_count; v++) {
+    fprintf(e->out, "  int32_t %s = 0;\n",
+            format_operand(e, tac_var(v), buf));
+  }
+
+  /* Only temporaries still in use, after recycling */
+  bool *used = (bool *)safe_malloc(
+      ((size_t)program->temp_count + 1) * sizeof(bool));
+  memset(used, 0, ((size_t)program->temp_count + 1) * sizeof(bool));
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    const TACOperand *operands[] = {&inst->result, &inst->arg1, &inst->arg2};
+    for (int k = 0; k < 3; k++) {
+      if (operands[k]->kind == TAC_OPND_TEMP) {
+        used[operands[k]->id] = true;
+      }
+    }
+  }
+  for (int t = 0; t < program->temp_count; t++) {
+    if (used[t]) {
+      fprintf(e->out, "  int32_t t%d = 0;\n", t);
+    }
+  }
+  free(used);
+}
+
+/**
+ * @brief Emit tac_run()
+ */
+static bool emit_function(const CEmitter *e) {
+  const TACProgram *program = e->program;
+  FILE *out = e->out;
+  char d[C_OPERAND_SIZE], a[C_OPERAND_SIZE];
+
+  fprintf(out, "static int tac_run(void) {\n  int status = 0;\n");
+  emit_locals(e);
+
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    switch (inst->op) {
+    case TAC_OP_ASSIGN:
+      fprintf(out, "  %s = %s;\n", format_operand(e, inst->result, d),
+              format_operand(e, inst->arg1, a));
+      break;
+    case TAC_OP_ADD:
+    case TAC_OP_SUB:
+    case TAC_OP_MUL:
+      emit_arith(e, inst);
+      break;
+    case TAC_OP_DIV:
+      emit_div(e, inst);
+      break;
+    case TAC_OP_NEG:
+    case TAC_OP_SHL:
+    case TAC_OP_SHR:
+      emit_unary_shift(e, inst);
+      break;
+    case TAC_OP_EQ:
+    case TAC_OP_NE:
+    case TAC_OP_LT:
+    case TAC_OP_LE:
+    case TAC_OP_GT:
+    case TAC_OP_GE:
+      emit_cond_jump(e, inst);
+      break;
+    case TAC_OP_GOTO:
+      fprintf(out, "  goto L%d;\n", inst->result.id);
+      break;
+    case TAC_OP_LABEL:
+      if (e->label_used[inst->result.id]) {
+        fprintf(out, "L%d:;\n", inst->result.id);
+      }
+      break;
+    case TAC_OP_RETURN:
+      fprintf(out, "  goto tac_exit;\n");
+      break;
+    default:
+      DEBUG_PRINT("C backend cannot translate %s",
+                  tac_op_type_to_string(inst->op));
+      return false;
+    }
+  }
+
+  fprintf(out, "tac_exit:\n");
+  for (int v = 0; v < program->var_count; v++) {
+    fprintf(out, "  tac_vars[%d] = %s;\n", v,
+            format_operand(e, tac_var(v), d));
+  }
+  fprintf(out, "  return status;\ntac_divzero:\n  status = 1;\n"
+               "  goto tac_exit;\n}\n\n");
+  return true;
+}
+
+/**
+ * @brief Emit the prologue: headers, variable storage and helpers
+ */
+static void emit_prologue(const CEmitter *e) {
+  const TACProgram *program = e->program;
+  FILE *out = e->out;
+  int vars = program->var_count > 0 ? program->var_count : 1;
+
+  fprintf(out, "/* Generated by the TAC C backend */\n"
+               "#define _POSIX_C_SOURCE 199309L\n"
+               "#include <stdint.h>\n#include <stdio.h>\n#include <time.h>\n\n");
+  fprintf(out, "#define TAC_VAR_COUNT %d\n\n", program->var_count);
+  fprintf(out, "static const char *const tac_var_names[%d] = {\n", vars);
+  for (int v = 0; v < program->var_count; v++) {
+    /* Identifiers need no escaping */
+    fprintf(out, "    \"%s\",\n", tac_program_var_name(program, v));
+  }
+  fprintf(out, "};\nstatic int32_t tac_vars[%d];\n\n", vars);
+  fprintf(out, "/* Quotient of a nonzero divisor; INT32_MIN / -1 wraps */\n"
+               "static int32_t tac_div(int32_t a, int32_t b) {\n"
+               "  return b == -1 ? (int32_t)(0u - (uint32_t)a) : a / b;\n"
+               "}\n\n");
+  fprintf(out, "/* a / 2^b with a shift: negative dividends are biased */\n"
+               "static int32_t tac_shr(int32_t a, int32_t b) {\n"
+               "  uint32_t k = (uint32_t)b & 31;\n"
+               "  uint32_t bias = a < 0 ? (1u << k) - 1u : 0u;\n"
+               "  return (int32_t)((uint32_t)a + bias) >> k;\n"
+               "}\n\n");
+}
+
+/**
+ * @brief Emit main(), which times tac_run() and prints the variables
+ */
+static void emit_main(const CEmitter *e) {
+  fprintf(e->out,
+          "int main(void) {\n"
+          "  struct timespec begin, end;\n"
+          "  clock_gettime(CLOCK_MONOTONIC, &begin);\n"
+          "  int status = tac_run();\n"
+          "  clock_gettime(CLOCK_MONOTONIC, &end);\n"
+          "  fprintf(stderr, \"Native run %%.3f ms\\n\",\n"
+          "          (end.tv_sec - begin.tv_sec) * 1e3 +\n"
+          "              (end.tv_nsec - begin.tv_nsec) / 1e6);\n"
+          "  if (status) {\n"
+          "    fputs(\"Runtime error: Division by zero\\n\", stderr);\n"
+          "  }\n"
+          "  for (int v = 0; v < TAC_VAR_COUNT; v++) {\n"
+          "    printf(\"  %%s = %%d\\n\", tac_var_names[v], (int)tac_vars[v]);\n"
+          "  }\n"
+          "  return status;\n"
+          "}\n");
+}
+
+/**
+ * @brief Write a program as a C translation unit
+ */
+bool c_emit_program(const TACProgram *program, FILE *out) {
+  if (!program || !out) {
+    return false;
+  }
+
+  CEmitter e = {program, out, NULL};
+  e.label_used = (bool *)safe_malloc(
+      ((size_t)program->label_count + 1) * sizeof(bool));
+  memset(e.label_used, 0, ((size_t)program->label_count + 1) * sizeof(bool));
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_GOTO || tac_op_is_cond_jump(inst->op)) {
+      e.label_used[inst->result.id] = true;
+    }
+  }
+
+  emit_prologue(&e);
+  bool ok = emit_function(&e);
+  if (ok) {
+    emit_main(&e);
+  }
+  free(e.label_used);
+  return ok;
+}
+
+/**
+ * @brief Write a program as C source to a file
+ */
+bool c_write_program(const TACProgram *program, const char *filename) {
+  if (!program || !filename) {
+    return false;
+  }
+
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    return false;
+  }
+  bool ok = c_emit_program(program, file);
+  if (fclose(file) != 0) {
+    ok = false;
+  }
+  return ok;
+}
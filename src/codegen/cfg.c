@@ -0,0 +1,566 @@
+/**
+ * @file codegen/cfg.c
+ * @brief Control-flow graph construction and analysis
+ */
+
+#include "codegen/cfg.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Check whether instruction i starts a basic block
+ */
+static bool is_leader(const TACInst *code, int i) {
+  if (i == 0) {
+    return true;
+  }
+  if (tac_op_is_jump(code[i - 1].op)) {
+    return true;
+  }
+  /* A run of consecutive labels shares one block */
+  return code[i].op == TAC_OP_LABEL && code[i - 1].op != TAC_OP_LABEL;
+}
+
+/**
+ * @brief Partition the program into blocks and record label owners
+ */
+static bool build_blocks(CFG *cfg, const TACProgram *program) {
+  const TACInst *code = program->instructions;
+  int n = program->count;
+
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    if (is_leader(code, i)) {
+      count++;
+    }
+  }
+
+  cfg->block_count = count;
+  cfg->block_start = alloc_ints(count + 1);
+  cfg->label_block = alloc_ints(program->label_count);
+  if (!cfg->block_start || !cfg->label_block) {
+    return false;
+  }
+
+  int b = -1;
+  for (int i = 0; i < n; i++) {
+    if (is_leader(code, i)) {
+      cfg->block_start[++b] = i;
+    }
+    if (code[i].op == TAC_OP_LABEL && code[i].result.kind == TAC_OPND_LABEL &&
+        code[i].result.id < program->label_count) {
+      cfg->label_block[code[i].result.id] = b;
+    }
+  }
+  cfg->block_start[count] = n;
+  return true;
+}
+
+/**
+ * @brief Build successor and predecessor lists in CSR form
+ */
+static bool build_edges(CFG *cfg, const TACProgram *program) {
+  const TACInst *code = program->instructions;
+  int count = cfg->block_count;
+
+  /* Every block has at most two successors: a jump target and fallthrough */
+  cfg->succ_offset = alloc_ints(count + 1);
+  cfg->succ = alloc_ints(2 * count);
+  cfg->pred_offset = alloc_ints(count + 1);
+  if (!cfg->succ_offset || !cfg->succ || !cfg->pred_offset) {
+    return false;
+  }
+
+  int edges = 0;
+  for (int b = 0; b < count; b++) {
+    const TACInst *last = &code[cfg->block_start[b + 1] - 1];
+    int target = -1;
+    int fall = (b + 1 < count) ? b + 1 : -1;
+
+    cfg->succ_offset[b] = edges;
+    if (tac_op_is_jump(last->op)) {
+      if (last->result.kind == TAC_OPND_LABEL &&
+          last->result.id >= 0 && last->result.id < program->label_count) {
+        target = cfg->label_block[last->result.id];
+      }
+      if (target < 0) {
+        DEBUG_PRINT("Jump at instruction %d targets an undefined label",
+                    cfg->block_start[b + 1] - 1);
+        return false;
+      }
+      cfg->succ[edges++] = target;
+      if (last->op == TAC_OP_GOTO) {
+        fall = -1;
+      }
+    }
+    if (fall >= 0 && fall != target) {
+      cfg->succ[edges++] = fall;
+    }
+  }
+  cfg->succ_offset[count] = edges;
+
+  /* Predecessors: count in-degrees, prefix-sum, then scatter */
+  cfg->pred = alloc_ints(edges);
+  int *cursor = alloc_ints(count + 1);
+  if (!cfg->pred || !cursor) {
+    free(cursor);
+    return false;
+  }
+  memset(cfg->pred_offset, 0, ((size_t)count + 2) * sizeof(int));
+  for (int e = 0; e < edges; e++) {
+    cfg->pred_offset[cfg->succ[e] + 1]++;
+  }
+  for (int b = 0; b < count; b++) {
+    cfg->pred_offset[b + 1] += cfg->pred_offset[b];
+  }
+  memcpy(cursor, cfg->pred_offset, ((size_t)count + 1) * sizeof(int));
+  for (int b = 0; b < count; b++) {
+    for (int e = cfg->succ_offset[b]; e < cfg->succ_offset[b + 1]; e++) {
+      cfg->pred[cursor[cfg->succ[e]]++] = b;
+    }
+  }
+
+  free(cursor);
+  return true;
+}
+
+/**
+ * @brief Order the reachable blocks in reverse postorder
+ */
+static bool build_rpo(CFG *cfg) {
+  int count = cfg->block_count;
+  cfg->rpo = alloc_ints(count);
+  cfg->rpo_index = alloc_ints(count);
+  int *stack = alloc_ints(count);
+  int *next_edge = alloc_ints(count);
+  if (!cfg->rpo || !cfg->rpo_index || !stack || !next_edge) {
+    free(stack);
+    free(next_edge);
+    return false;
+  }
+
+  /* Iterative depth-first search; rpo_index doubles as the visited mark */
+  int post = count;
+  int depth = 0;
+  if (count > 0) {
+    stack[depth++] = 0;
+    next_edge[0] = cfg->succ_offset[0];
+    cfg->rpo_index[0] = 0;
+  }
+  while (depth > 0) {
+    int b = stack[depth - 1];
+    if (next_edge[b] < cfg->succ_offset[b + 1]) {
+      int s = cfg->succ[next_edge[b]++];
+      if (cfg->rpo_index[s] < 0) {
+        cfg->rpo_index[s] = 0;
+        next_edge[s] = cfg->succ_offset[s];
+        stack[depth++] = s;
+      }
+    } else {
+      cfg->rpo[--post] = b;
+      depth--;
+    }
+  }
+
+  /* Postorder was filled from the back; shift it to the front */
+  cfg->rpo_count = count - post;
+  memmove(cfg->rpo, cfg->rpo + post, (size_t)cfg->rpo_count * sizeof(int));
+  for (int i = 0; i < cfg->rpo_count; i++) {
+    cfg->rpo_index[cfg->rpo[i]] = i;
+  }
+
+  free(stack);
+  free(next_edge);
+  return true;
+}
+
+/**
+ * @brief Walk two blocks up the dominator tree to their common ancestor
+ */
+static int intersect(const CFG *cfg, int a, int b) {
+  while (a != b) {
+    while (cfg->rpo_index[a] > cfg->rpo_index[b]) {
+      a = cfg->idom[a];
+    }
+    while (cfg->rpo_index[b] > cfg->rpo_index[a]) {
+      b = cfg->idom[b];
+    }
+  }
+  return a;
+}
+
+/**
+ * @brief Compute immediate dominators and dominator tree numbering
+ *
+ * Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm": iterate
+ * over blocks in reverse postorder, setting each block's idom to the
+ * intersection of its processed predecessors' dominators, until stable.
+ */
+static bool build_dominators(CFG *cfg) {
+  int count = cfg->block_count;
+  cfg->idom = alloc_ints(count);
+  cfg->dom_pre = alloc_ints(count);
+  cfg->dom_post = alloc_ints(count);
+  if (!cfg->idom || !cfg->dom_pre || !cfg->dom_post) {
+    return false;
+  }
+  if (cfg->rpo_count == 0) {
+    return true;
+  }
+
+  cfg->idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 1; i < cfg->rpo_count; i++) {
+      int b = cfg->rpo[i];
+      int new_idom = -1;
+      for (int e = cfg->pred_offset[b]; e < cfg->pred_offset[b + 1]; e++) {
+        int p = cfg->pred[e];
+        if (cfg->idom[p] < 0) {
+          continue;
+        }
+        new_idom = (new_idom < 0) ? p : intersect(cfg, p, new_idom);
+      }
+      if (cfg->idom[b] != new_idom) {
+        cfg->idom[b] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  /* Number the dominator tree so dominance checks are constant time */
+  int *child_offset = alloc_ints(count + 1);
+  int *children = alloc_ints(count);
+  int *stack = alloc_ints(count);
+  int *next_child = alloc_ints(count);
+  if (!child_offset || !children || !stack || !next_child) {
+    free(child_offset);
+    free(children);
+    free(stack);
+    free(next_child);
+    return false;
+  }
+  memset(child_offset, 0, ((size_t)count + 2) * sizeof(int));
+  for (int b = 1; b < count; b++) {
+    if (cfg->idom[b] >= 0) {
+      child_offset[cfg->idom[b] + 1]++;
+    }
+  }
+  for (int b = 0; b < count; b++) {
+    child_offset[b + 1] += child_offset[b];
+  }
+  memcpy(next_child, child_offset, (size_t)count * sizeof(int));
+  for (int b = 1; b < count; b++) {
+    if (cfg->idom[b] >= 0) {
+      children[next_child[cfg->idom[b]]++] = b;
+    }
+  }
+  memcpy(next_child, child_offset, (size_t)count * sizeof(int));
+
+  int pre = 0, post = 0, depth = 0;
+  stack[depth++] = 0;
+  cfg->dom_pre[0] = pre++;
+  while (depth > 0) {
+    int b = stack[depth - 1];
+    if (next_child[b] < child_offset[b + 1]) {
+      int c = children[next_child[b]++];
+      cfg->dom_pre[c] = pre++;
+      stack[depth++] = c;
+    } else {
+      cfg->dom_post[b] = post++;
+      depth--;
+    }
+  }
+
+  free(child_offset);
+  free(children);
+  free(stack);
+  free(next_child);
+  return true;
+}
+
+/**
+ * @brief Loop index with its body size, for ordering outer loops first
+ */
+typedef struct LoopSize {
+  int size;
+  int loop;
+} LoopSize;
+
+static int compare_loop_size(const void *a, const void *b) {
+  const LoopSize *x = (const LoopSize *)a;
+  const LoopSize *y = (const LoopSize *)b;
+  if (x->size != y->size) {
+    return y->size - x->size;
+  }
+  return x->loop - y->loop;
+}
+
+/**
+ * @brief Find natural loops and their nesting
+ *
+ * An edge p -> h is a back edge when h dominates p. The loop of header h
+ * is h plus every block that reaches a back-edge source without passing
+ * through h, found by walking predecessors backwards.
+ */
+static bool build_loops(CFG *cfg) {
+  int count = cfg->block_count;
+  int *mark = alloc_ints(count);
+  int *stack = alloc_ints(count);
+  int capacity = 16;
+  int body_capacity = 64;
+  int body_count = 0;
+  cfg->loop_header = alloc_ints(capacity);
+  cfg->loop_offset = alloc_ints(capacity + 1);
+  cfg->loop_blocks = alloc_ints(body_capacity);
+  cfg->block_loop = alloc_ints(count);
+  if (!mark || !stack || !cfg->loop_header || !cfg->loop_offset ||
+      !cfg->loop_blocks || !cfg->block_loop) {
+    free(mark);
+    free(stack);
+    return false;
+  }
+
+  cfg->loop_count = 0;
+  cfg->loop_offset[0] = 0;
+  for (int i = 0; i < cfg->rpo_count; i++) {
+    int h = cfg->rpo[i];
+    int loop = cfg->loop_count;
+    int start = body_count;
+    int depth = 0;
+
+    for (int e = cfg->pred_offset[h]; e < cfg->pred_offset[h + 1]; e++) {
+      int p = cfg->pred[e];
+      if (!cfg_dominates(cfg, h, p)) {
+        continue;
+      }
+      if (body_count == start) {
+        mark[h] = loop;
+        body_count++; /* Reserve the header's slot */
+      }
+      if (mark[p] != loop) {
+        mark[p] = loop;
+        stack[depth++] = p;
+      }
+    }
+    if (body_count == start) {
+      continue; /* Not a loop header */
+    }
+
+    /* The stack holds at most count blocks, the body list grows as needed */
+    for (;;) {
+      if (body_count + depth + 1 > body_capacity) {
+        while (body_count + depth + 1 > body_capacity) {
+          body_capacity *= 2;
+        }
+        int *blocks = (int *)safe_realloc(
+            cfg->loop_blocks, (size_t)body_capacity * sizeof(int));
+        if (!blocks) {
+          free(mark);
+          free(stack);
+          return false;
+        }
+        cfg->loop_blocks = blocks;
+      }
+      if (depth == 0) {
+        break;
+      }
+      int x = stack[--depth];
+      cfg->loop_blocks[body_count++] = x;
+      for (int e = cfg->pred_offset[x]; e < cfg->pred_offset[x + 1]; e++) {
+        int q = cfg->pred[e];
+        if (cfg->rpo_index[q] >= 0 && mark[q] != loop) {
+          mark[q] = loop;
+          stack[depth++] = q;
+        }
+      }
+    }
+    cfg->loop_blocks[start] = h;
+
+    if (loop + 1 >= capacity) {
+      capacity *= 2;
+      int *headers = (int *)safe_realloc(cfg->loop_header,
+                                         (size_t)capacity * sizeof(int));
+      int *offsets = headers ? (int *)safe_realloc(cfg->loop_offset,
+                                                   ((size_t)capacity + 1) *
+                                                       sizeof(int))
+                             : NULL;
+      if (headers) {
+        cfg->loop_header = headers;
+      }
+      if (!offsets) {
+        free(mark);
+        free(stack);
+        return false;
+      }
+      cfg->loop_offset = offsets;
+    }
+    cfg->loop_header[loop] = h;
+    cfg->loop_offset[loop + 1] = body_count;
+    cfg->loop_count++;
+  }
+
+  /* Visit loops outermost first so inner loops overwrite block_loop */
+  int loops = cfg->loop_count;
+  LoopSize *order = (LoopSize *)safe_malloc(((size_t)loops + 1) *
+                                            sizeof(LoopSize));
+  cfg->loop_parent = alloc_ints(loops);
+  if (!order || !cfg->loop_parent) {
+    free(order);
+    free(mark);
+    free(stack);
+    return false;
+  }
+  for (int l = 0; l < loops; l++) {
+    order[l].size = cfg->loop_offset[l + 1] - cfg->loop_offset[l];
+    order[l].loop = l;
+  }
+  qsort(order, loops, sizeof(LoopSize), compare_loop_size);
+  for (int i = 0; i < loops; i++) {
+    int l = order[i].loop;
+    cfg->loop_parent[l] = cfg->block_loop[cfg->loop_header[l]];
+    for (int k = cfg->loop_offset[l]; k < cfg->loop_offset[l + 1]; k++) {
+      cfg->block_loop[cfg->loop_blocks[k]] = l;
+    }
+  }
+
+  free(order);
+  free(mark);
+  free(stack);
+  return true;
+}
+
+/**
+ * @brief Build the control-flow graph of a program
+ */
+CFG *cfg_build(const TACProgram *program) {
+  if (!program) {
+    return NULL;
+  }
+
+  CFG *cfg = (CFG *)safe_malloc(sizeof(CFG));
+  if (!cfg) {
+    return NULL;
+  }
+  memset(cfg, 0, sizeof(CFG));
+
+  if (!build_blocks(cfg, program) || !build_edges(cfg, program) ||
+      !build_rpo(cfg) || !build_dominators(cfg) || !build_loops(cfg)) {
+    cfg_destroy(cfg);
+    return NULL;
+  }
+
+  DEBUG_PRINT("Built CFG: %d blocks, %d edges, %d loops", cfg->block_count,
+              cfg->succ_offset[cfg->block_count], cfg->loop_count);
+  return cfg;
+}
+
+/**
+ * @brief Find the block containing an instruction
+ */
+int cfg_block_of(const CFG *cfg, int inst) {
+  if (!cfg || cfg->block_count == 0 || inst < 0 ||
+      inst >= cfg->block_start[cfg->block_count]) {
+    return -1;
+  }
+
+  /* Last block whose start is <= inst */
+  int lo = 0, hi = cfg->block_count - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (cfg->block_start[mid] <= inst) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+/**
+ * @brief Check whether block a dominates block b
+ */
+bool cfg_dominates(const CFG *cfg, int a, int b) {
+  if (!cfg || cfg->idom[a] < 0 || cfg->idom[b] < 0) {
+    return false;
+  }
+  return cfg->dom_pre[a] <= cfg->dom_pre[b] &&
+         cfg->dom_post[b] <= cfg->dom_post[a];
+}
+
+/**
+ * @brief Print a list of block indices
+ */
+static void print_blocks(const int *blocks, int from, int to) {
+  if (from == to) {
+    printf(" -");
+  }
+  for (int i = from; i < to; i++) {
+    printf(" B%d", blocks[i]);
+  }
+}
+
+/**
+ * @brief Print blocks, edges, dominators and loops to stdout
+ */
+void cfg_print(const CFG *cfg) {
+  if (!cfg) {
+    return;
+  }
+
+  printf("Control-Flow Graph (%d blocks, %d loops):\n", cfg->block_count,
+         cfg->loop_count);
+  printf("--------------------------------------------\n");
+  for (int b = 0; b < cfg->block_count; b++) {
+    printf("B%d [%d, %d)", b, cfg->block_start[b], cfg->block_start[b + 1]);
+    printf(" succ:");
+    print_blocks(cfg->succ, cfg->succ_offset[b], cfg->succ_offset[b + 1]);
+    printf(" pred:");
+    print_blocks(cfg->pred, cfg->pred_offset[b], cfg->pred_offset[b + 1]);
+    if (cfg->idom[b] >= 0) {
+      printf(" idom: B%d\n", cfg->idom[b]);
+    } else {
+      printf(" unreachable\n");
+    }
+  }
+  for (int l = 0; l < cfg->loop_count; l++) {
+    printf("Loop %d: header B%d", l, cfg->loop_header[l]);
+    if (cfg->loop_parent[l] >= 0) {
+      printf(", in loop %d", cfg->loop_parent[l]);
+    }
+    printf(", blocks:");
+    print_blocks(cfg->loop_blocks, cfg->loop_offset[l], cfg->loop_offset[l + 1]);
+    printf("\n");
+  }
+  printf("--------------------------------------------\n");
+}
+
+/**
+ * @brief Free control-flow graph resources
+ */
+void cfg_destroy(CFG *cfg) {
+  if (!cfg) {
+    return;
+  }
+
+  free(cfg->block_start);
+  free(cfg->label_block);
+  free(cfg->succ_offset);
+  free(cfg->succ);
+  free(cfg->pred_offset);
+  free(cfg->pred);
+  free(cfg->rpo);
+  free(cfg->rpo_index);
+  free(cfg->idom);
+  free(cfg->dom_pre);
+  free(cfg->dom_post);
+  free(cfg->loop_header);
+  free(cfg->loop_parent);
+  free(cfg->loop_offset);
+  free(cfg->loop_blocks);
+  free(cfg->block_loop);
+  free(cfg);
+}
@@ -0,0 +1,797 @@
+/**
+ * @file codegen/dataflow.c
+ * @brief Bit-vector dataflow solver and standard analyses
+ */
+
+#include "codegen/dataflow.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Allocate rows sets of words each, cleared
+ */
+static BitWord *alloc_sets(int rows, int words) {
+  size_t size = ((size_t)rows * words + 1) * sizeof(BitWord);
+  BitWord *sets = (BitWord *)safe_malloc(size);
+  memset(sets, 0, size);
+  return sets;
+}
+
+/**
+ * @brief Set every bit of the universe, leaving bits past its end clear
+ */
+static void fill_set(BitWord *set, int words, int bits) {
+  memset(set, 0xff, (size_t)words * sizeof(BitWord));
+  if (bits % BITWORD_BITS) {
+    set[words - 1] = ((BitWord)1 << (bits % BITWORD_BITS)) - 1;
+  }
+}
+
+/**
+ * @brief Clear the bits [first, end)
+ */
+static void clear_range(BitWord *set, int first, int end) {
+  while (first < end && first % BITWORD_BITS) {
+    bitset_reset(set, first++);
+  }
+  while (first + BITWORD_BITS <= end) {
+    set[first / BITWORD_BITS] = 0;
+    first += BITWORD_BITS;
+  }
+  while (first < end) {
+    bitset_reset(set, first++);
+  }
+}
+
+/**
+ * @brief Meet the sets leaving the neighbours a block's facts come from
+ */
+static void meet_entering(const DataflowResult *result, int block,
+                          BitWord *set) {
+  const CFG *cfg = result->cfg;
+  bool forward = result->direction == DATAFLOW_FORWARD;
+  bool intersect = result->meet == DATAFLOW_INTERSECT;
+  const int *source_offset = forward ? cfg->pred_offset : cfg->succ_offset;
+  const int *source = forward ? cfg->pred : cfg->succ;
+  int words = result->words;
+
+  if (intersect) {
+    fill_set(set, words, result->bits);
+  } else {
+    memset(set, 0, (size_t)words * sizeof(BitWord));
+  }
+
+  /* The boundary enters at the entry block, or at blocks without successors */
+  bool boundary = forward ? block == 0
+                          : source_offset[block] == source_offset[block + 1];
+  if (boundary) {
+    for (int w = 0; w < words; w++) {
+      set[w] = intersect ? set[w] & result->boundary[w]
+                         : set[w] | result->boundary[w];
+    }
+  }
+
+  for (int k = source_offset[block]; k < source_offset[block + 1]; k++) {
+    if (cfg->rpo_index[source[k]] < 0) {
+      continue;
+    }
+    const BitWord *from = result->leaving + (size_t)source[k] * words;
+    if (intersect) {
+      for (int w = 0; w < words; w++) {
+        set[w] &= from[w];
+      }
+    } else {
+      for (int w = 0; w < words; w++) {
+        set[w] |= from[w];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Solve a dataflow problem to its maximal fixpoint
+ */
+DataflowResult *dataflow_solve(const CFG *cfg, const DataflowProblem *problem) {
+  if (!cfg || !problem || !problem->transfer || problem->bits < 0) {
+    return NULL;
+  }
+
+  DataflowResult *result = (DataflowResult *)safe_malloc(sizeof(DataflowResult));
+  memset(result, 0, sizeof(DataflowResult));
+  int blocks = cfg->block_count;
+  int bits = problem->bits;
+  int words = bitset_words(bits);
+  result->cfg = cfg;
+  result->direction = problem->direction;
+  result->meet = problem->meet;
+  result->block_count = blocks;
+  result->bits = bits;
+  result->words = words;
+  result->leaving = alloc_sets(blocks, words);
+  result->boundary = alloc_sets(1, words);
+  if (problem->boundary) {
+    memcpy(result->boundary, problem->boundary,
+           (size_t)words * sizeof(BitWord));
+  }
+
+  bool forward = problem->direction == DATAFLOW_FORWARD;
+  if (problem->meet == DATAFLOW_INTERSECT) {
+    for (int b = 0; b < blocks; b++) {
+      fill_set(result->leaving + (size_t)b * words, words, bits);
+    }
+  }
+  const int *sink_offset = forward ? cfg->succ_offset : cfg->pred_offset;
+  const int *sink = forward ? cfg->succ : cfg->pred;
+
+  /* Pending blocks by position in (reverse) postorder */
+  int n = cfg->rpo_count;
+  BitWord *pending = alloc_sets(1, bitset_words(n));
+  fill_set(pending, bitset_words(n), n);
+  BitWord *enter = alloc_sets(1, words);
+  BitWord *leave = alloc_sets(1, words);
+
+  int pos = bitset_next(pending, 0, n);
+  while (pos >= 0) {
+    bitset_reset(pending, pos);
+    int b = forward ? cfg->rpo[pos] : cfg->rpo[n - 1 - pos];
+
+    meet_entering(result, b, enter);
+    problem->transfer(problem->context, b, enter, leave, words);
+    result->visits++;
+
+    BitWord *stored = result->leaving + (size_t)b * words;
+    if (memcmp(leave, stored, (size_t)words * sizeof(BitWord)) != 0) {
+      memcpy(stored, leave, (size_t)words * sizeof(BitWord));
+      for (int k = sink_offset[b]; k < sink_offset[b + 1]; k++) {
+        int index = cfg->rpo_index[sink[k]];
+        if (index >= 0) {
+          bitset_set(pending, forward ? index : n - 1 - index);
+        }
+      }
+    }
+
+    int next = bitset_next(pending, pos + 1, n);
+    pos = next >= 0 ? next : bitset_next(pending, 0, n);
+  }
+
+  free(pending);
+  free(enter);
+  free(leave);
+  DEBUG_PRINT("Dataflow: %d bits over %d blocks, %d visits", bits, blocks,
+              result->visits);
+  return result;
+}
+
+/**
+ * @brief Facts at the entry of a block
+ */
+void dataflow_in(const DataflowResult *result, int block, BitWord *set) {
+  if (result->direction == DATAFLOW_FORWARD) {
+    meet_entering(result, block, set);
+  } else {
+    memcpy(set, result->leaving + (size_t)block * result->words,
+           (size_t)result->words * sizeof(BitWord));
+  }
+}
+
+/**
+ * @brief Facts at the exit of a block
+ */
+void dataflow_out(const DataflowResult *result, int block, BitWord *set) {
+  if (result->direction == DATAFLOW_BACKWARD) {
+    meet_entering(result, block, set);
+  } else {
+    memcpy(set, result->leaving + (size_t)block * result->words,
+           (size_t)result->words * sizeof(BitWord));
+  }
+}
+
+/**
+ * @brief Free a dataflow solution
+ */
+void dataflow_result_destroy(DataflowResult *result) {
+  if (!result) {
+    return;
+  }
+  free(result->leaving);
+  free(result->boundary);
+  free(result->item_bit);
+  free(result->bit_item);
+  free(result->location_offset);
+  free(result);
+}
+
+/**
+ * @brief Start empty gen and kill sets
+ */
+void dataflow_gen_kill_init(DataflowGenKill *sets, int blocks) {
+  memset(sets, 0, sizeof(DataflowGenKill));
+  sets->gen_offset = alloc_ints(blocks + 1);
+  sets->kill_offset = alloc_ints(blocks + 1);
+  sets->gen_offset[0] = 0;
+  sets->kill_offset[0] = 0;
+}
+
+/**
+ * @brief Add a bit to the gen set of the current block
+ */
+void dataflow_gen_kill_add_gen(DataflowGenKill *sets, int bit) {
+  if (sets->gen_count == sets->gen_capacity) {
+    sets->gen_capacity = sets->gen_capacity ? sets->gen_capacity * 2 : 64;
+    sets->gen = (int *)safe_realloc(sets->gen, (size_t)sets->gen_capacity *
+                                                   sizeof(int));
+  }
+  sets->gen[sets->gen_count++] = bit;
+}
+
+/**
+ * @brief Add the bits [first, end) to the kill set of the current block
+ */
+void dataflow_gen_kill_add_kill(DataflowGenKill *sets, int first, int end) {
+  if (sets->kill_count == sets->kill_capacity) {
+    sets->kill_capacity = sets->kill_capacity ? sets->kill_capacity * 2 : 64;
+    sets->kill = (int *)safe_realloc(sets->kill, (size_t)sets->kill_capacity *
+                                                     2 * sizeof(int));
+  }
+  sets->kill[2 * sets->kill_count] = first;
+  sets->kill[2 * sets->kill_count + 1] = end;
+  sets->kill_count++;
+}
+
+/**
+ * @brief Close the current block and start the next one
+ */
+void dataflow_gen_kill_end_block(DataflowGenKill *sets) {
+  sets->block_count++;
+  sets->gen_offset[sets->block_count] = sets->gen_count;
+  sets->kill_offset[sets->block_count] = sets->kill_count;
+}
+
+/**
+ * @brief Release gen and kill sets
+ */
+void dataflow_gen_kill_free(DataflowGenKill *sets) {
+  free(sets->gen_offset);
+  free(sets->gen);
+  free(sets->kill_offset);
+  free(sets->kill);
+  memset(sets, 0, sizeof(DataflowGenKill));
+}
+
+/**
+ * @brief Transfer function leaving = gen | (entering & ~kill)
+ */
+void dataflow_gen_kill_transfer(const void *context, int block,
+                                const BitWord *entering, BitWord *leaving,
+                                int words) {
+  const DataflowGenKill *sets = (const DataflowGenKill *)context;
+  memcpy(leaving, entering, (size_t)words * sizeof(BitWord));
+  for (int k = sets->kill_offset[block]; k < sets->kill_offset[block + 1];
+       k++) {
+    clear_range(leaving, sets->kill[2 * k], sets->kill[2 * k + 1]);
+  }
+  for (int k = sets->gen_offset[block]; k < sets->gen_offset[block + 1]; k++) {
+    bitset_set(leaving, sets->gen[k]);
+  }
+}
+
+/**
+ * @brief Collect the locations an instruction reads
+ *
+ * @param reads Output: up to three locations, in operand order
+ * @return int Number of locations read
+ */
+static int read_locations(const TACProgram *program, const TACInst *inst,
+                          int reads[3]) {
+  int count = 0;
+  int loc = dataflow_location(program, inst->arg1);
+  if (loc >= 0) {
+    reads[count++] = loc;
+  }
+  loc = dataflow_location(program, inst->arg2);
+  if (loc >= 0) {
+    reads[count++] = loc;
+  }
+  if (!tac_op_writes_result(inst->op)) {
+    loc = dataflow_location(program, inst->result);
+    if (loc >= 0) {
+      reads[count++] = loc;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Location an instruction writes, or -1
+ */
+static int written_location(const TACProgram *program, const TACInst *inst) {
+  return tac_op_writes_result(inst->op)
+             ? dataflow_location(program, inst->result)
+             : -1;
+}
+
+/**
+ * @brief Mark the locations read in some block before being written there
+ *
+ * @return char* Flag per location
+ */
+static char *find_exposed(const TACProgram *program, const CFG *cfg) {
+  int locations = dataflow_location_count(program);
+  char *exposed = (char *)safe_malloc((size_t)locations + 1);
+  int *written = alloc_ints(locations);
+  memset(exposed, 0, (size_t)locations + 1);
+
+  for (int b = 0; b < cfg->block_count; b++) {
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      const TACInst *inst = &program->instructions[i];
+      int reads[3];
+      int count = read_locations(program, inst, reads);
+      for (int k = 0; k < count; k++) {
+        if (written[reads[k]] != b) {
+          exposed[reads[k]] = 1;
+        }
+      }
+      int loc = written_location(program, inst);
+      if (loc >= 0) {
+        written[loc] = b;
+      }
+    }
+  }
+
+  free(written);
+  return exposed;
+}
+
+/**
+ * @brief Build the inverse of an item-to-bit map
+ */
+static int *invert_map(const int *item_bit, int items, int bits) {
+  int *bit_item = alloc_ints(bits);
+  for (int i = 0; i < items; i++) {
+    if (item_bit[i] >= 0) {
+      bit_item[item_bit[i]] = i;
+    }
+  }
+  return bit_item;
+}
+
+/**
+ * @brief Live variables and temporaries
+ */
+DataflowResult *dataflow_liveness(const TACProgram *program, const CFG *cfg,
+                                  bool results_live) {
+  if (!program || !cfg) {
+    return NULL;
+  }
+
+  int locations = dataflow_location_count(program);
+  char *exposed = find_exposed(program, cfg);
+  int *item_bit = alloc_ints(locations);
+  int bits = 0;
+  for (int l = 0; l < locations; l++) {
+    if (exposed[l]) {
+      item_bit[l] = bits++;
+    }
+  }
+  free(exposed);
+
+  /* gen: upward-exposed reads, kill: writes */
+  DataflowGenKill sets;
+  dataflow_gen_kill_init(&sets, cfg->block_count);
+  int *written = alloc_ints(locations);
+  int *listed = alloc_ints(locations);
+  for (int b = 0; b < cfg->block_count; b++) {
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      const TACInst *inst = &program->instructions[i];
+      int reads[3];
+      int count = read_locations(program, inst, reads);
+      for (int k = 0; k < count; k++) {
+        int l = reads[k];
+        if (written[l] != b && listed[l] != b && item_bit[l] >= 0) {
+          listed[l] = b;
+          dataflow_gen_kill_add_gen(&sets, item_bit[l]);
+        }
+      }
+      int l = written_location(program, inst);
+      if (l >= 0 && written[l] != b) {
+        written[l] = b;
+        if (item_bit[l] >= 0) {
+          dataflow_gen_kill_add_kill(&sets, item_bit[l], item_bit[l] + 1);
+        }
+      }
+    }
+    dataflow_gen_kill_end_block(&sets);
+  }
+  free(written);
+  free(listed);
+
+  /* Variables are the program's results, so they are live at exit */
+  BitWord *boundary = alloc_sets(1, bitset_words(bits));
+  for (int v = 0; results_live && v < program->var_count; v++) {
+    if (item_bit[v] >= 0) {
+      bitset_set(boundary, item_bit[v]);
+    }
+  }
+
+  DataflowProblem problem = {DATAFLOW_BACKWARD, DATAFLOW_UNION, bits,
+                             boundary, dataflow_gen_kill_transfer, &sets};
+  DataflowResult *result = dataflow_solve(cfg, &problem);
+  dataflow_gen_kill_free(&sets);
+  free(boundary);
+  if (!result) {
+    free(item_bit);
+    return NULL;
+  }
+
+  result->item_count = locations;
+  result->item_bit = item_bit;
+  result->bit_item = invert_map(item_bit, locations, bits);
+  return result;
+}
+
+/**
+ * @brief Reaching definitions
+ */
+DataflowResult *dataflow_reaching_definitions(const TACProgram *program,
+                                              const CFG *cfg,
+                                              const bool *track) {
+  if (!program || !cfg) {
+    return NULL;
+  }
+
+  int locations = dataflow_location_count(program);
+  int n = program->count;
+  char *exposed = find_exposed(program, cfg);
+  if (track) {
+    for (int l = 0; l < locations; l++) {
+      exposed[l] = exposed[l] && track[l];
+    }
+  }
+
+  /* Lay out each tracked location as its entry bit, then its writes */
+  int *offset = alloc_ints(locations + 1);
+  int *cursor = alloc_ints(locations);
+  int *size = alloc_ints(locations);
+  for (int l = 0; l < locations; l++) {
+    size[l] = exposed[l] ? 1 : 0;
+  }
+  for (int i = 0; i < n; i++) {
+    int l = written_location(program, &program->instructions[i]);
+    if (l >= 0 && exposed[l]) {
+      size[l]++;
+    }
+  }
+  int bits = 0;
+  for (int l = 0; l < locations; l++) {
+    offset[l] = bits;
+    cursor[l] = bits + 1;
+    bits += size[l];
+  }
+  offset[locations] = bits;
+  free(size);
+  free(exposed);
+
+  int *item_bit = alloc_ints(n);
+  for (int i = 0; i < n; i++) {
+    int l = written_location(program, &program->instructions[i]);
+    if (l >= 0 && offset[l + 1] > offset[l]) {
+      item_bit[i] = cursor[l]++;
+    }
+  }
+  free(cursor);
+
+  /* gen: last write of each location, kill: all its definitions */
+  DataflowGenKill sets;
+  dataflow_gen_kill_init(&sets, cfg->block_count);
+  int *last = alloc_ints(locations);
+  int *stamp = alloc_ints(locations);
+  int *defined = alloc_ints(locations);
+  for (int b = 0; b < cfg->block_count; b++) {
+    int count = 0;
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      if (item_bit[i] < 0) {
+        continue;
+      }
+      int l = written_location(program, &program->instructions[i]);
+      if (stamp[l] != b) {
+        stamp[l] = b;
+        defined[count++] = l;
+      }
+      last[l] = i;
+    }
+    for (int k = 0; k < count; k++) {
+      int l = defined[k];
+      dataflow_gen_kill_add_kill(&sets, offset[l], offset[l + 1]);
+      dataflow_gen_kill_add_gen(&sets, item_bit[last[l]]);
+    }
+    dataflow_gen_kill_end_block(&sets);
+  }
+  free(last);
+  free(stamp);
+  free(defined);
+
+  BitWord *boundary = alloc_sets(1, bitset_words(bits));
+  for (int l = 0; l < locations; l++) {
+    if (offset[l + 1] > offset[l]) {
+      bitset_set(boundary, offset[l]);
+    }
+  }
+
+  DataflowProblem problem = {DATAFLOW_FORWARD, DATAFLOW_UNION, bits,
+                             boundary, dataflow_gen_kill_transfer, &sets};
+  DataflowResult *result = dataflow_solve(cfg, &problem);
+  dataflow_gen_kill_free(&sets);
+  free(boundary);
+  if (!result) {
+    free(item_bit);
+    free(offset);
+    return NULL;
+  }
+
+  result->item_count = n;
+  result->item_bit = item_bit;
+  result->bit_item = invert_map(item_bit, n, bits);
+  result->location_offset = offset;
+  return result;
+}
+
+/**
+ * @brief Order two operands, for canonical commutative expressions
+ */
+static bool operand_less(TACOperand a, TACOperand b) {
+  return a.kind != b.kind ? a.kind < b.kind : a.id < b.id;
+}
+
+static unsigned hash_expression(const TACInst *inst) {
+  unsigned h = 2166136261u;
+  int parts[5] = {inst->op, inst->arg1.kind, inst->arg1.id, inst->arg2.kind,
+                  inst->arg2.id};
+  for (int k = 0; k < 5; k++) {
+    h = (h ^ (unsigned)parts[k]) * 16777619u;
+  }
+  return h;
+}
+
+static bool same_expression(const TACInst *a, const TACInst *b) {
+  return a->op == b->op && tac_operand_equals(a->arg1, b->arg1) &&
+         tac_operand_equals(a->arg2, b->arg2);
+}
+
+/**
+ * @brief Grouping key of an expression: one past its highest operand
+ * location, or 0 if it reads only constants
+ */
+static int expression_key(const TACProgram *program, const TACInst *key) {
+  int a = dataflow_location(program, key->arg1);
+  int b = dataflow_location(program, key->arg2);
+  return (a > b ? a : b) + 1;
+}
+
+/**
+ * @brief Number every arithmetic instruction by the expression it computes
+ *
+ * @param keys Output: instructions with commutative arguments ordered
+ * @return int* Expression class per instruction, or -1
+ */
+static int *number_expressions(const TACProgram *program, TACInst *keys,
+                               int *classes) {
+  int n = program->count;
+  int capacity = 16;
+  while (capacity < 2 * n) {
+    capacity *= 2;
+  }
+  int *table = alloc_ints(capacity);
+  int *class_of = alloc_ints(n);
+  *classes = 0;
+
+  for (int i = 0; i < n; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op < TAC_OP_ADD || inst->op > TAC_OP_SHR) {
+      continue;
+    }
+    keys[i] = *inst;
+    if ((inst->op == TAC_OP_ADD || inst->op == TAC_OP_MUL) &&
+        operand_less(inst->arg2, inst->arg1)) {
+      keys[i].arg1 = inst->arg2;
+      keys[i].arg2 = inst->arg1;
+    }
+
+    unsigned slot = hash_expression(&keys[i]) & (unsigned)(capacity - 1);
+    while (table[slot] >= 0 && !same_expression(&keys[table[slot]], &keys[i])) {
+      slot = (slot + 1) & (unsigned)(capacity - 1);
+    }
+    if (table[slot] < 0) {
+      table[slot] = i;
+      class_of[i] = (*classes)++;
+    } else {
+      class_of[i] = class_of[table[slot]];
+    }
+  }
+
+  free(table);
+  return class_of;
+}
+
+/**
+ * @brief Available expressions
+ */
+DataflowResult *dataflow_available_expressions(const TACProgram *program,
+                                               const CFG *cfg) {
+  if (!program || !cfg) {
+    return NULL;
+  }
+
+  int n = program->count;
+  int locations = dataflow_location_count(program);
+  TACInst *keys = (TACInst *)safe_malloc(((size_t)n + 1) * sizeof(TACInst));
+  int classes;
+  int *class_of = number_expressions(program, keys, &classes);
+
+  /* Track expressions computed in at least two blocks */
+  int *seen_in = alloc_ints(classes);
+  int *blocks = (int *)safe_malloc(((size_t)classes + 1) * sizeof(int));
+  memset(blocks, 0, ((size_t)classes + 1) * sizeof(int));
+  for (int b = 0; b < cfg->block_count; b++) {
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      int c = class_of[i];
+      if (c >= 0 && seen_in[c] != b) {
+        seen_in[c] = b;
+        blocks[c]++;
+      }
+    }
+  }
+
+  /* Number tracked expressions grouped by their highest operand location,
+   * so writing a location kills mostly contiguous bit ranges */
+  int *first_at = alloc_ints(classes);
+  int *bucket = (int *)safe_malloc(((size_t)locations + 2) * sizeof(int));
+  memset(bucket, 0, ((size_t)locations + 2) * sizeof(int));
+  for (int i = n - 1; i >= 0; i--) {
+    int c = class_of[i];
+    if (c >= 0 && blocks[c] >= 2) {
+      first_at[c] = i;
+    }
+  }
+  for (int c = 0; c < classes; c++) {
+    if (first_at[c] >= 0) {
+      bucket[expression_key(program, &keys[first_at[c]]) + 1]++;
+    }
+  }
+  for (int k = 0; k <= locations; k++) {
+    bucket[k + 1] += bucket[k];
+  }
+  int bits = bucket[locations + 1];
+  int *class_bit = alloc_ints(classes);
+  int *bit_item = alloc_ints(bits);
+  for (int i = 0; i < n; i++) {
+    int c = class_of[i];
+    if (c >= 0 && first_at[c] == i) {
+      int bit = bucket[expression_key(program, &keys[i])]++;
+      bit_item[bit] = i;
+      class_bit[c] = bit;
+    }
+  }
+  free(first_at);
+  free(bucket);
+  int *item_bit = alloc_ints(n);
+  for (int i = 0; i < n; i++) {
+    item_bit[i] = class_of[i] >= 0 ? class_bit[class_of[i]] : -1;
+  }
+  free(seen_in);
+  free(blocks);
+  free(class_bit);
+  free(class_of);
+
+  /* Expressions reading each location, in CSR form */
+  int *use_offset = (int *)safe_malloc(((size_t)locations + 2) * sizeof(int));
+  memset(use_offset, 0, ((size_t)locations + 2) * sizeof(int));
+  for (int e = 0; e < bits; e++) {
+    const TACInst *key = &keys[bit_item[e]];
+    int a = dataflow_location(program, key->arg1);
+    int b = dataflow_location(program, key->arg2);
+    if (a >= 0) {
+      use_offset[a + 1]++;
+    }
+    if (b >= 0 && b != a) {
+      use_offset[b + 1]++;
+    }
+  }
+  for (int l = 0; l < locations; l++) {
+    use_offset[l + 1] += use_offset[l];
+  }
+  int *uses = alloc_ints(use_offset[locations]);
+  int *fill = alloc_ints(locations);
+  memcpy(fill, use_offset, (size_t)locations * sizeof(int));
+  for (int e = 0; e < bits; e++) {
+    const TACInst *key = &keys[bit_item[e]];
+    int a = dataflow_location(program, key->arg1);
+    int b = dataflow_location(program, key->arg2);
+    if (a >= 0) {
+      uses[fill[a]++] = e;
+    }
+    if (b >= 0 && b != a) {
+      uses[fill[b]++] = e;
+    }
+  }
+  free(fill);
+  free(keys);
+
+  /* gen: computed after the last write of its operands in the block,
+   * kill: everything reading a location written in the block */
+  DataflowGenKill sets;
+  dataflow_gen_kill_init(&sets, cfg->block_count);
+  int *computed_at = alloc_ints(bits);
+  int *computed = alloc_ints(bits);
+  int *written_at = alloc_ints(locations);
+  int *written = alloc_ints(locations);
+  int *stamp = alloc_ints(locations);
+  for (int b = 0; b < cfg->block_count; b++) {
+    int first = cfg->block_start[b];
+    int computed_count = 0;
+    int written_count = 0;
+    for (int i = first; i < cfg->block_start[b + 1]; i++) {
+      int e = item_bit[i];
+      if (e >= 0) {
+        if (computed_at[e] < first) {
+          computed[computed_count++] = e;
+        }
+        computed_at[e] = i;
+      }
+      int l = written_location(program, &program->instructions[i]);
+      if (l >= 0) {
+        if (stamp[l] != b) {
+          stamp[l] = b;
+          written[written_count++] = l;
+        }
+        written_at[l] = i;
+      }
+    }
+
+    for (int k = 0; k < written_count; k++) {
+      int l = written[k];
+      for (int u = use_offset[l]; u < use_offset[l + 1]; u++) {
+        /* Uses are in bit order, so runs of bits become one range */
+        int end = u + 1;
+        while (end < use_offset[l + 1] && uses[end] == uses[end - 1] + 1) {
+          end++;
+        }
+        dataflow_gen_kill_add_kill(&sets, uses[u], uses[end - 1] + 1);
+        u = end - 1;
+      }
+    }
+    for (int k = 0; k < computed_count; k++) {
+      int e = computed[k];
+      const TACInst *inst = &program->instructions[computed_at[e]];
+      int a = dataflow_location(program, inst->arg1);
+      int c = dataflow_location(program, inst->arg2);
+      if ((a < 0 || stamp[a] != b || written_at[a] < computed_at[e]) &&
+          (c < 0 || stamp[c] != b || written_at[c] < computed_at[e])) {
+        dataflow_gen_kill_add_gen(&sets, e);
+      }
+    }
+    dataflow_gen_kill_end_block(&sets);
+  }
+  free(computed_at);
+  free(computed);
+  free(written_at);
+  free(written);
+  free(stamp);
+  free(use_offset);
+  free(uses);
+
+  DataflowProblem problem = {DATAFLOW_FORWARD, DATAFLOW_INTERSECT, bits, NULL,
+                             dataflow_gen_kill_transfer, &sets};
+  DataflowResult *result = dataflow_solve(cfg, &problem);
+  dataflow_gen_kill_free(&sets);
+  if (!result) {
+    free(item_bit);
+    free(bit_item);
+    return NULL;
+  }
+
+  result->item_count = n;
+  result->item_bit = item_bit;
+  result->bit_item = bit_item;
+  return result;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file codegen/native.c
+ * @brief Building and running generated programs with the host compiler
+ */
+
+#include "codegen/native.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+/* Longest command line built for the compiler or the program */
+#define NATIVE_COMMAND_SIZE 4096
+
+/**
+ * @brief Compile and link a generated source file with gcc
+ */
+bool native_build(const char *source, const char *executable,
+                  const char *flags, NativeResult *result) {
+  if (!source || !executable || !result) {
+    return false;
+  }
+
+  char command[NATIVE_COMMAND_SIZE];
+  int length = snprintf(command, sizeof(command), "gcc %s -o '%s' '%s'",
+                        flags ? flags : "", executable, source);
+  if (length < 0 || length >= (int)sizeof(command)) {
+    return false;
+  }
+
+  double t_begin = now_seconds();
+  int status = system(command);
+  result->build_seconds = now_seconds() - t_begin;
+  if (status != 0) {
+    DEBUG_PRINT("Native build failed: %s", command);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Run a generated executable and collect its results
+ */
+bool native_run(const char *executable, int var_count, NativeResult *result) {
+  if (!executable || !result || var_count < 0) {
+    return false;
+  }
+
+  char command[NATIVE_COMMAND_SIZE];
+  int length =
+      snprintf(command, sizeof(command), "'%s' 2>&1", executable);
+  if (length < 0 || length >= (int)sizeof(command)) {
+    return false;
+  }
+
+  FILE *pipe = popen(command, "r");
+  if (!pipe) {
+    return false;
+  }
+
+  result->values = (int *)safe_malloc(((size_t)var_count + 1) * sizeof(int));
+  result->value_count = 0;
+  result->run_seconds = 0;
+
+  char line[1024];
+  while (fgets(line, sizeof(line), pipe)) {
+    double ms;
+    int value;
+    if (sscanf(line, "Native run %lf ms", &ms) == 1) {
+      result->run_seconds = ms / 1e3;
+    } else if (sscanf(line, " %*s = %d", &value) == 1 &&
+               result->value_count < var_count) {
+      result->values[result->value_count++] = value;
+    } else {
+      fputs(line, stderr); /* Runtime errors */
+    }
+  }
+
+  int status = pclose(pipe);
+  result->status =
+      status >= 0 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  return result->value_count == var_count && result->status >= 0;
+}
+
+/**
+ * @brief Release the values of a native run
+ */
+void native_result_free(NativeResult *result) {
+  if (!result) {
+    return;
+  }
+  free(result->values);
+  result->values = NULL;
+  result->value_count = 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file codegen/opt/const_fold.c
+ * @brief Local constant folding and propagation
+ */
+
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Constants known for variables and temporaries in the current block
+ *
+ * A value is valid only while its stamp equals the current block number, so
+ * starting a new block forgets everything without clearing the arrays.
+ */
+typedef struct ConstMap {
+  int *var_value;  /* Known value per variable id */
+  int *var_stamp;  /* Block number the value was recorded in */
+  int *temp_value; /* Known value per temporary id */
+  int *temp_stamp; /* Block number the value was recorded in */
+  int block;       /* Current block number (stamps start at 0) */
+} ConstMap;
+
+static bool const_lookup(const ConstMap *map, TACOperand operand, int *value) {
+  if (operand.kind == TAC_OPND_VAR &&
+      map->var_stamp[operand.id] == map->block) {
+    *value = map->var_value[operand.id];
+    return true;
+  }
+  if (operand.kind == TAC_OPND_TEMP &&
+      map->temp_stamp[operand.id] == map->block) {
+    *value = map->temp_value[operand.id];
+    return true;
+  }
+  return false;
+}
+
+static void const_record(ConstMap *map, TACOperand operand, bool known,
+                         int value) {
+  int stamp = known ? map->block : -1;
+  if (operand.kind == TAC_OPND_VAR) {
+    map->var_value[operand.id] = value;
+    map->var_stamp[operand.id] = stamp;
+  } else if (operand.kind == TAC_OPND_TEMP) {
+    map->temp_value[operand.id] = value;
+    map->temp_stamp[operand.id] = stamp;
+  }
+}
+
+/**
+ * @brief Replace a variable or temporary operand by its known constant
+ */
+static bool propagate(const ConstMap *map, TACOperand *operand) {
+  int value;
+  if (!const_lookup(map, *operand, &value)) {
+    return false;
+  }
+  *operand = tac_const(value);
+  return true;
+}
+
+/**
+ * @brief Fold constant arithmetic and branches within basic blocks
+ */
+int tac_opt_fold_constants(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  ConstMap map;
+  map.var_value = (int *)safe_malloc((program->var_count + 1) * sizeof(int));
+  map.var_stamp = (int *)safe_malloc((program->var_count + 1) * sizeof(int));
+  map.temp_value = (int *)safe_malloc((program->temp_count + 1) * sizeof(int));
+  map.temp_stamp = (int *)safe_malloc((program->temp_count + 1) * sizeof(int));
+  map.block = 0;
+  for (int i = 0; i < program->var_count; i++) {
+    map.var_stamp[i] = -1;
+  }
+  for (int i = 0; i < program->temp_count; i++) {
+    map.temp_stamp[i] = -1;
+  }
+
+  /* Reads of each temporary left after folding */
+  int *temp_reads = (int *)safe_malloc((program->temp_count + 1) * sizeof(int));
+  memset(temp_reads, 0, (program->temp_count + 1) * sizeof(int));
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  int changes = 0;
+
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+
+    /* A label starts a new block: values may arrive from other paths */
+    if (inst->op == TAC_OP_LABEL) {
+      map.block++;
+      continue;
+    }
+
+    bool changed = propagate(&map, &inst->arg1);
+    changed |= propagate(&map, &inst->arg2);
+    if (!tac_op_writes_result(inst->op) &&
+        inst->result.kind != TAC_OPND_LABEL) {
+      changed |= propagate(&map, &inst->result);
+    }
+
+    if (tac_op_writes_result(inst->op)) {
+      int value;
+      if (inst->op != TAC_OP_ASSIGN && inst->arg1.kind == TAC_OPND_CONST &&
+          (inst->arg2.kind == TAC_OPND_CONST || tac_op_is_unary(inst->op)) &&
+          tac_eval_arith(inst->op, inst->arg1.value, inst->arg2.value,
+                         &value)) {
+        inst->op = TAC_OP_ASSIGN;
+        inst->arg1 = tac_const(value);
+        inst->arg2 = tac_none();
+        changed = true;
+      }
+      const_record(&map, inst->result,
+                   inst->op == TAC_OP_ASSIGN &&
+                       inst->arg1.kind == TAC_OPND_CONST,
+                   inst->arg1.value);
+    } else if (tac_op_is_cond_jump(inst->op) &&
+               inst->arg1.kind == TAC_OPND_CONST &&
+               inst->arg2.kind == TAC_OPND_CONST) {
+      if (tac_eval_relop(inst->op, inst->arg1.value, inst->arg2.value)) {
+        inst->op = TAC_OP_GOTO;
+        inst->arg1 = tac_none();
+        inst->arg2 = tac_none();
+      } else {
+        tac_edit_remove(&edits, i);
+      }
+      changed = true;
+    }
+
+    if (inst->arg1.kind == TAC_OPND_TEMP) {
+      temp_reads[inst->arg1.id]++;
+    }
+    if (inst->arg2.kind == TAC_OPND_TEMP) {
+      temp_reads[inst->arg2.id]++;
+    }
+    if (!tac_op_writes_result(inst->op) &&
+        inst->result.kind == TAC_OPND_TEMP) {
+      temp_reads[inst->result.id]++;
+    }
+
+    /* A jump ends the block */
+    if (tac_op_is_jump(inst->op)) {
+      map.block++;
+    }
+
+    if (changed) {
+      changes++;
+    }
+  }
+
+  /* Constants copied into their only readers leave dead temporaries */
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_ASSIGN && inst->result.kind == TAC_OPND_TEMP &&
+        inst->arg1.kind == TAC_OPND_CONST &&
+        temp_reads[inst->result.id] == 0) {
+      tac_edit_remove(&edits, i);
+      changes++;
+    }
+  }
+
+  bool ok = tac_program_apply_edits(program, &edits);
+
+  DEBUG_PRINT("Constant folding changed %d instructions", changes);
+
+  tac_edit_list_free(&edits);
+  free(map.var_value);
+  free(map.var_stamp);
+  free(map.temp_value);
+  free(map.temp_stamp);
+  free(temp_reads);
+  return ok ? changes : -1;
+}
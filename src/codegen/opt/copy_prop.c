@@ -0,0 +1,366 @@
+/**
+ * @file codegen/opt/copy_prop.c
+ * @brief Copy coalescing and copy propagation
+ */
+
+#include "codegen/cfg.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Per-location definition and use summary
+ *
+ * Variables and temporaries share one dense index space: variable v is
+ * location v, temporary t is location var_count + t.
+ */
+typedef struct CopyInfo {
+  int var_count; /* Offset of temporaries in the location space */
+  int *defs;     /* Number of writes per location */
+  int *def_at;   /* Instruction of the last write per location */
+  int *reads;    /* Number of reads per location */
+  int *read_at;  /* Instruction of the last read per location */
+  int *block;    /* Basic block number per instruction */
+} CopyInfo;
+
+static int location(const CopyInfo *info, TACOperand operand) {
+  if (operand.kind == TAC_OPND_VAR) {
+    return operand.id;
+  }
+  if (operand.kind == TAC_OPND_TEMP) {
+    return info->var_count + operand.id;
+  }
+  return -1;
+}
+
+static void note_read(CopyInfo *info, TACOperand operand, int i) {
+  int loc = location(info, operand);
+  if (loc >= 0) {
+    info->reads[loc]++;
+    info->read_at[loc] = i;
+  }
+}
+
+/**
+ * @brief Count definitions and reads of every location
+ */
+static void collect_info(CopyInfo *info, const TACProgram *program) {
+  int locations = program->var_count + program->temp_count;
+  size_t size = ((size_t)locations + 1) * sizeof(int);
+  info->var_count = program->var_count;
+  info->defs = (int *)safe_malloc(size);
+  info->def_at = (int *)safe_malloc(size);
+  info->reads = (int *)safe_malloc(size);
+  info->read_at = (int *)safe_malloc(size);
+  info->block = (int *)safe_malloc(((size_t)program->count + 1) * sizeof(int));
+  memset(info->defs, 0, size);
+  memset(info->reads, 0, size);
+
+  int block = 0;
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_LABEL && i > 0 &&
+        program->instructions[i - 1].op != TAC_OP_LABEL) {
+      block++;
+    }
+    info->block[i] = block;
+    note_read(info, inst->arg1, i);
+    note_read(info, inst->arg2, i);
+    if (tac_op_writes_result(inst->op)) {
+      int loc = location(info, inst->result);
+      info->defs[loc]++;
+      info->def_at[loc] = i;
+    } else {
+      note_read(info, inst->result, i);
+    }
+    if (tac_op_is_jump(inst->op)) {
+      block++;
+    }
+  }
+}
+
+static void free_info(CopyInfo *info) {
+  free(info->defs);
+  free(info->def_at);
+  free(info->reads);
+  free(info->read_at);
+  free(info->block);
+}
+
+/**
+ * @brief Check whether an instruction reads or writes a location
+ */
+static bool touches(const CopyInfo *info, const TACInst *inst, int loc) {
+  return location(info, inst->arg1) == loc ||
+         location(info, inst->arg2) == loc ||
+         location(info, inst->result) == loc;
+}
+
+/**
+ * @brief Make "t := a op b; ...; x := t" compute into x directly
+ *
+ * Applies when t is written once and read once, by the copy, in the same
+ * block, and x is neither read nor written in between.
+ */
+static int coalesce(TACProgram *program, const CopyInfo *info) {
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  /* Instruction now writing the result of each removed copy, so a chain
+   * t1 := a op b; t2 := t1; x := t2 coalesces into its first link */
+  int *moved_to = (int *)safe_malloc(((size_t)program->count + 1) *
+                                     sizeof(int));
+  memset(moved_to, 0xff, ((size_t)program->count + 1) * sizeof(int));
+
+  for (int j = 0; j < program->count; j++) {
+    TACInst *copy = &program->instructions[j];
+    if (copy->op != TAC_OP_ASSIGN || copy->arg1.kind != TAC_OPND_TEMP ||
+        tac_operand_equals(copy->result, copy->arg1)) {
+      continue;
+    }
+    int t = location(info, copy->arg1);
+    if (info->defs[t] != 1 || info->reads[t] != 1) {
+      continue;
+    }
+    int i = info->def_at[t];
+    while (i >= 0 && i < j && moved_to[i] >= 0) {
+      i = moved_to[i];
+    }
+    if (i >= j || info->block[i] != info->block[j]) {
+      continue;
+    }
+
+    int x = location(info, copy->result);
+    bool clear = true;
+    for (int k = i + 1; k < j && clear; k++) {
+      clear = !touches(info, &program->instructions[k], x);
+    }
+    if (!clear) {
+      continue;
+    }
+
+    program->instructions[i].result = copy->result;
+    tac_edit_remove(&edits, j);
+    moved_to[j] = i;
+  }
+
+  int changes = edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(moved_to);
+  return changes;
+}
+
+/**
+ * @brief Check whether the write at def reaches the instruction at use on
+ * every path, i.e. it dominates the use
+ */
+static bool def_dominates(const CFG *cfg, int def, int use) {
+  int a = cfg_block_of(cfg, def);
+  int b = cfg_block_of(cfg, use);
+  if (a == b) {
+    return def < use;
+  }
+  return cfg_dominates(cfg, a, b);
+}
+
+/**
+ * @brief Find copies whose source is fixed wherever the copy is read
+ *
+ * For a location d written exactly once, by "d := s", whose write
+ * dominates all of its reads, every read of d can read s instead when s is
+ * a constant, or when s is written once, outside any loop, at a point
+ * dominating the copy: s then never changes after the copy executes.
+ *
+ * @param replace Output: replacement operand per location, or NONE
+ */
+static void find_global_copies(const TACProgram *program,
+                               const CopyInfo *info, const CFG *cfg,
+                               TACOperand *replace) {
+  int locations = program->var_count + program->temp_count;
+  for (int d = 0; d < locations; d++) {
+    replace[d] = tac_none();
+    if (info->defs[d] != 1 || info->reads[d] == 0) {
+      continue;
+    }
+    const TACInst *inst = &program->instructions[info->def_at[d]];
+    if (inst->op != TAC_OP_ASSIGN) {
+      continue;
+    }
+    int s = location(info, inst->arg1);
+    if (s == d) {
+      continue;
+    }
+    if (s >= 0) {
+      if (info->defs[s] != 1) {
+        continue;
+      }
+      int s_def = info->def_at[s];
+      if (cfg->block_loop[cfg_block_of(cfg, s_def)] >= 0 ||
+          !def_dominates(cfg, s_def, info->def_at[d])) {
+        continue;
+      }
+    }
+    replace[d] = inst->arg1;
+  }
+
+  /* Every read of d must be dominated by its write */
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    const TACOperand *reads[3] = {&inst->arg1, &inst->arg2, NULL};
+    if (!tac_op_writes_result(inst->op)) {
+      reads[2] = &inst->result;
+    }
+    for (int k = 0; k < 3; k++) {
+      int d = reads[k] ? location(info, *reads[k]) : -1;
+      if (d >= 0 && replace[d].kind != TAC_OPND_NONE &&
+          !def_dominates(cfg, info->def_at[d], i)) {
+        replace[d] = tac_none();
+      }
+    }
+  }
+
+  /* Resolve chains d := s, s := r so reads of d go straight to r */
+  for (int d = 0; d < locations; d++) {
+    int hops = 0;
+    while (replace[d].kind != TAC_OPND_NONE && hops++ < locations) {
+      int s = location(info, replace[d]);
+      if (s < 0 || replace[s].kind == TAC_OPND_NONE) {
+        break;
+      }
+      replace[d] = replace[s];
+    }
+  }
+}
+
+/**
+ * @brief Local copy table
+ *
+ * Each location records the source it was last copied from within the
+ * current block, with the source's write version at copy time. Writing
+ * a location bumps its version, which silently invalidates every copy
+ * taken from it.
+ */
+typedef struct CopyTable {
+  TACOperand *source; /* Copied-from operand per location */
+  int *stamp;         /* Block the copy was recorded in, or -1 */
+  int *source_version; /* Version of the source when copied */
+  int *version;       /* Write count per location */
+  int block;          /* Current block number */
+} CopyTable;
+
+/**
+ * @brief Rewrite a read through the local copy table or global copies
+ */
+static bool propagate(const CopyInfo *info, const CopyTable *table,
+                      const TACOperand *replace, TACOperand *operand) {
+  int loc = location(info, *operand);
+  if (loc < 0) {
+    return false;
+  }
+  if (replace && replace[loc].kind != TAC_OPND_NONE) {
+    *operand = replace[loc];
+    return true;
+  }
+  if (table->stamp[loc] != table->block) {
+    return false;
+  }
+  int src = location(info, table->source[loc]);
+  if (src >= 0 && table->version[src] != table->source_version[loc]) {
+    return false;
+  }
+  *operand = table->source[loc];
+  return true;
+}
+
+/**
+ * @brief Propagate copies within and across basic blocks
+ */
+int tac_opt_copy_propagation(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  CopyInfo info;
+  collect_info(&info, program);
+  int changes = coalesce(program, &info);
+  free_info(&info);
+
+  collect_info(&info, program);
+  int locations = program->var_count + program->temp_count;
+  TACOperand *replace = NULL;
+  CFG *cfg = cfg_build(program);
+  if (cfg) {
+    replace = (TACOperand *)safe_malloc(((size_t)locations + 1) *
+                                        sizeof(TACOperand));
+    find_global_copies(program, &info, cfg, replace);
+    cfg_destroy(cfg);
+  }
+
+  CopyTable table;
+  size_t size = ((size_t)locations + 1) * sizeof(int);
+  table.source = (TACOperand *)safe_malloc(((size_t)locations + 1) *
+                                           sizeof(TACOperand));
+  table.stamp = (int *)safe_malloc(size);
+  table.source_version = (int *)safe_malloc(size);
+  table.version = (int *)safe_malloc(size);
+  table.block = 0;
+  memset(table.stamp, 0xff, size);
+  memset(table.version, 0, size);
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_LABEL) {
+      table.block++;
+      continue;
+    }
+
+    bool changed = propagate(&info, &table, replace, &inst->arg1);
+    changed |= propagate(&info, &table, replace, &inst->arg2);
+    if (!tac_op_writes_result(inst->op)) {
+      changed |= propagate(&info, &table, replace, &inst->result);
+    }
+
+    if (tac_op_writes_result(inst->op)) {
+      int d = location(&info, inst->result);
+      table.version[d]++;
+      table.stamp[d] = -1;
+      if (inst->op == TAC_OP_ASSIGN) {
+        int s = location(&info, inst->arg1);
+        if (s == d) {
+          tac_edit_remove(&edits, i); /* x := x */
+          continue;
+        }
+        if (s >= 0) {
+          table.source[d] = inst->arg1;
+          table.stamp[d] = table.block;
+          table.source_version[d] = table.version[s];
+        }
+      }
+    }
+
+    if (tac_op_is_jump(inst->op)) {
+      table.block++;
+    }
+    if (changed) {
+      changes++;
+    }
+  }
+
+  changes += edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+
+  DEBUG_PRINT("Copy propagation made %d changes", changes);
+
+  free(replace);
+  free(table.source);
+  free(table.stamp);
+  free(table.source_version);
+  free(table.version);
+  free_info(&info);
+  return changes;
+}
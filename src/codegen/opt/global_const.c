@@ -0,0 +1,168 @@
+/**
+ * @file codegen/opt/global_const.c
+ * @brief Global constant propagation over reaching definitions
+ */
+
+#include "codegen/dataflow.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Largest reaching-definitions solution, in bits, the pass will build;
+ * larger programs are left to the local passes */
+#define GLOBAL_CONST_MAX_BITS ((size_t)1 << 30)
+
+/* Lookup results cached per block */
+#define VALUE_CONST 0
+#define VALUE_VARYING 1
+
+/**
+ * @brief Value of a location on entry to a block, if the same constant
+ * reaches it along every path
+ */
+static bool entry_constant(const TACProgram *program,
+                           const DataflowResult *defs, const BitWord *in,
+                           int loc, int *value) {
+  int end = defs->location_offset[loc + 1];
+  bool found = false;
+  for (int bit = bitset_next(in, defs->location_offset[loc], end); bit >= 0;
+       bit = bitset_next(in, bit + 1, end)) {
+    int item = defs->bit_item[bit];
+    int v = 0; /* Entry definition: locations start at zero */
+    if (item >= 0) {
+      const TACInst *def = &program->instructions[item];
+      if (def->op != TAC_OP_ASSIGN || def->arg1.kind != TAC_OPND_CONST) {
+        return false;
+      }
+      v = def->arg1.value;
+    }
+    if (found && v != *value) {
+      return false;
+    }
+    *value = v;
+    found = true;
+  }
+  return found;
+}
+
+/**
+ * @brief Replace reads of locations holding the same constant on every path
+ */
+int tac_opt_global_constants(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    return 0;
+  }
+
+  /* Only locations with some constant write can be constant on entry;
+   * variables never written are zero everywhere */
+  int locations = dataflow_location_count(program);
+  bool *track = (bool *)safe_malloc((size_t)locations + 1);
+  int *writes = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  memset(track, 0, (size_t)locations + 1);
+  memset(writes, 0, ((size_t)locations + 1) * sizeof(int));
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (tac_op_writes_result(inst->op)) {
+      int loc = dataflow_location(program, inst->result);
+      writes[loc]++;
+      if (inst->op == TAC_OP_ASSIGN && inst->arg1.kind == TAC_OPND_CONST) {
+        track[loc] = true;
+      }
+    }
+  }
+
+  size_t bits = 0;
+  for (int loc = 0; loc < locations; loc++) {
+    if (track[loc]) {
+      bits += 1 + (size_t)writes[loc];
+    }
+  }
+  DataflowResult *defs = NULL;
+  if (bits * (size_t)cfg->block_count <= GLOBAL_CONST_MAX_BITS) {
+    defs = dataflow_reaching_definitions(program, cfg, track);
+    if (!defs) {
+      free(track);
+      free(writes);
+      cfg_destroy(cfg);
+      return -1;
+    }
+  } else {
+    DEBUG_PRINT("Reaching definitions skipped: %zu bits x %d blocks", bits,
+                cfg->block_count);
+  }
+  free(track);
+
+  int *written = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  int *stamp = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  int *state = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  int *value = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  memset(written, 0xff, ((size_t)locations + 1) * sizeof(int));
+  memset(stamp, 0xff, ((size_t)locations + 1) * sizeof(int));
+  BitWord *in = defs ? (BitWord *)safe_malloc(((size_t)defs->words + 1) *
+                                              sizeof(BitWord))
+                     : NULL;
+
+  int changes = 0;
+  for (int b = 0; b < cfg->block_count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue;
+    }
+    if (defs) {
+      dataflow_in(defs, b, in);
+    }
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      TACInst *inst = &program->instructions[i];
+      TACOperand *reads[3] = {&inst->arg1, &inst->arg2, NULL};
+      if (!tac_op_writes_result(inst->op)) {
+        reads[2] = &inst->result;
+      }
+
+      for (int k = 0; k < 3; k++) {
+        int loc = reads[k] ? dataflow_location(program, *reads[k]) : -1;
+        if (loc < 0 || written[loc] == b) {
+          continue; /* Reads after a local write are left to local folding */
+        }
+        if (stamp[loc] != b) {
+          stamp[loc] = b;
+          if (writes[loc] == 0 && loc < program->var_count) {
+            state[loc] = VALUE_CONST;
+            value[loc] = 0;
+          } else if (defs &&
+                     defs->location_offset[loc + 1] >
+                         defs->location_offset[loc] &&
+                     entry_constant(program, defs, in, loc, &value[loc])) {
+            state[loc] = VALUE_CONST;
+          } else {
+            state[loc] = VALUE_VARYING;
+          }
+        }
+        if (state[loc] == VALUE_CONST) {
+          *reads[k] = tac_const(value[loc]);
+          changes++;
+        }
+      }
+
+      if (tac_op_writes_result(inst->op)) {
+        written[dataflow_location(program, inst->result)] = b;
+      }
+    }
+  }
+
+  DEBUG_PRINT("Global constant propagation replaced %d reads", changes);
+
+  free(written);
+  free(stamp);
+  free(state);
+  free(value);
+  free(writes);
+  free(in);
+  dataflow_result_destroy(defs);
+  cfg_destroy(cfg);
+  return changes;
+}
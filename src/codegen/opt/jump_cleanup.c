@@ -0,0 +1,379 @@
+/**
+ * @file codegen/opt/jump_cleanup.c
+ * @brief Jump threading, unreachable code and dead store removal
+ */
+
+#include "codegen/dataflow.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Label resolution states while threading */
+#define THREAD_UNSEEN 0
+#define THREAD_ACTIVE 1
+#define THREAD_DONE 2
+
+/**
+ * @brief Map each label id to the index of its LABEL instruction (or -1)
+ */
+static int *label_positions(const TACProgram *program) {
+  int *pos = (int *)safe_malloc(((size_t)program->label_count + 1) *
+                                sizeof(int));
+  memset(pos, 0xff, ((size_t)program->label_count + 1) * sizeof(int));
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_LABEL && inst->result.kind == TAC_OPND_LABEL) {
+      pos[inst->result.id] = i;
+    }
+  }
+  return pos;
+}
+
+/**
+ * @brief Check whether a label is defined right after instruction i
+ *
+ * Only labels directly following i (before any other instruction) count:
+ * jumping there is the same as falling through.
+ */
+static bool label_follows(const TACProgram *program, int i, int label) {
+  for (int j = i + 1; j < program->count; j++) {
+    const TACInst *inst = &program->instructions[j];
+    if (inst->op != TAC_OP_LABEL) {
+      return false;
+    }
+    if (inst->result.id == label) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Retarget jumps past labels that only lead to another goto
+ *
+ * Each label resolves to the first label of the run it sits in, or, if
+ * the first instruction after that run is a goto, to where that goto
+ * resolves. Chains are followed iteratively with memoization, so every
+ * label is resolved once; a cycle of gotos resolves to itself.
+ */
+static int thread_jumps(TACProgram *program) {
+  const TACInst *code = program->instructions;
+  int labels = program->label_count;
+  int *pos = label_positions(program);
+  int *dest = (int *)safe_malloc(((size_t)labels + 1) * sizeof(int));
+  char *state = (char *)safe_malloc((size_t)labels + 1);
+  int *path = (int *)safe_malloc(((size_t)labels + 1) * sizeof(int));
+  memset(state, THREAD_UNSEEN, (size_t)labels + 1);
+
+  for (int start = 0; start < labels; start++) {
+    int depth = 0;
+    int label = start;
+
+    /* Walk the goto chain until a resolved or active label */
+    while (label >= 0 && state[label] == THREAD_UNSEEN && pos[label] >= 0) {
+      state[label] = THREAD_ACTIVE;
+      path[depth++] = label;
+
+      int j = pos[label];
+      while (j > 0 && code[j - 1].op == TAC_OP_LABEL) {
+        j--; /* First label of the run */
+      }
+      dest[label] = code[j].result.id;
+      while (j < program->count && code[j].op == TAC_OP_LABEL) {
+        j++;
+      }
+      label = (j < program->count && code[j].op == TAC_OP_GOTO)
+                  ? code[j].result.id
+                  : -1;
+    }
+
+    /* Everything on the path jumps where the chain ended */
+    int final = -1;
+    if (label >= 0 && state[label] == THREAD_DONE) {
+      final = dest[label];
+    }
+    while (depth > 0) {
+      int l = path[--depth];
+      if (final >= 0) {
+        dest[l] = final;
+      } else {
+        final = dest[l];
+      }
+      state[l] = THREAD_DONE;
+    }
+  }
+
+  int changes = 0;
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+    if (!tac_op_is_jump(inst->op) || inst->result.kind != TAC_OPND_LABEL) {
+      continue;
+    }
+    int label = inst->result.id;
+    if (pos[label] >= 0 && dest[label] != label) {
+      inst->result.id = dest[label];
+      changes++;
+    }
+  }
+
+  free(pos);
+  free(dest);
+  free(state);
+  free(path);
+  return changes;
+}
+
+/**
+ * @brief Remove instructions no path from the entry reaches
+ */
+static int remove_unreachable(TACProgram *program) {
+  const TACInst *code = program->instructions;
+  int n = program->count;
+  int *pos = label_positions(program);
+  char *reached = (char *)safe_malloc((size_t)n + 1);
+  int *stack = (int *)safe_malloc(((size_t)n + 1) * sizeof(int));
+  memset(reached, 0, (size_t)n + 1);
+
+  int depth = 0;
+  if (n > 0) {
+    reached[0] = 1;
+    stack[depth++] = 0;
+  }
+  while (depth > 0) {
+    int i = stack[--depth];
+    int next[2];
+    int count = 0;
+    if (code[i].op != TAC_OP_GOTO && i + 1 < n) {
+      next[count++] = i + 1;
+    }
+    if (tac_op_is_jump(code[i].op) && pos[code[i].result.id] >= 0) {
+      next[count++] = pos[code[i].result.id];
+    }
+    for (int k = 0; k < count; k++) {
+      if (!reached[next[k]]) {
+        reached[next[k]] = 1;
+        stack[depth++] = next[k];
+      }
+    }
+  }
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  for (int i = 0; i < n; i++) {
+    if (!reached[i]) {
+      tac_edit_remove(&edits, i);
+    }
+  }
+  int changes = edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+
+  free(pos);
+  free(reached);
+  free(stack);
+  return changes;
+}
+
+/**
+ * @brief Drop jumps to the next instruction and invert branches over gotos
+ *
+ * "if c goto L1; goto L2; L1:" becomes "if !c goto L2; L1:".
+ */
+static int simplify_fallthrough(TACProgram *program) {
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+    if (!tac_op_is_jump(inst->op)) {
+      continue;
+    }
+
+    if (label_follows(program, i, inst->result.id)) {
+      /* Either way control reaches the next instruction */
+      tac_edit_remove(&edits, i);
+      continue;
+    }
+
+    TACInst *next = (i + 1 < program->count) ? inst + 1 : NULL;
+    if (tac_op_is_cond_jump(inst->op) && next && next->op == TAC_OP_GOTO &&
+        label_follows(program, i + 1, inst->result.id)) {
+      inst->op = tac_op_negate_relop(inst->op);
+      inst->result = next->result;
+      tac_edit_remove(&edits, i + 1);
+      i++;
+    }
+  }
+
+  int changes = edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  return changes;
+}
+
+/**
+ * @brief Remove labels that no jump refers to
+ */
+static int remove_unused_labels(TACProgram *program) {
+  char *used = (char *)safe_malloc((size_t)program->label_count + 1);
+  memset(used, 0, (size_t)program->label_count + 1);
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (tac_op_is_jump(inst->op) && inst->result.kind == TAC_OPND_LABEL) {
+      used[inst->result.id] = 1;
+    }
+  }
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_LABEL && !used[inst->result.id]) {
+      tac_edit_remove(&edits, i);
+    }
+  }
+
+  int changes = edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(used);
+  return changes;
+}
+
+static void count_read(int *reads, TACOperand operand, int delta) {
+  if (operand.kind == TAC_OPND_TEMP) {
+    reads[operand.id] += delta;
+  }
+}
+
+/**
+ * @brief Remove writes to temporaries that are never read
+ *
+ * Sweeps backwards so that removing a write also releases the reads of
+ * its operands before their own definitions are visited. A division is
+ * kept unless its divisor is a non-zero constant, since it may trap.
+ */
+static int remove_dead_temps(TACProgram *program) {
+  int *reads = (int *)safe_malloc(((size_t)program->temp_count + 1) *
+                                  sizeof(int));
+  memset(reads, 0, ((size_t)program->temp_count + 1) * sizeof(int));
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    count_read(reads, inst->arg1, 1);
+    count_read(reads, inst->arg2, 1);
+    if (!tac_op_writes_result(inst->op)) {
+      count_read(reads, inst->result, 1);
+    }
+  }
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  for (int i = program->count - 1; i >= 0; i--) {
+    const TACInst *inst = &program->instructions[i];
+    if (!tac_op_writes_result(inst->op) ||
+        inst->result.kind != TAC_OPND_TEMP || reads[inst->result.id] > 0) {
+      continue;
+    }
+    if (inst->op == TAC_OP_DIV &&
+        (inst->arg2.kind != TAC_OPND_CONST || inst->arg2.value == 0)) {
+      continue;
+    }
+    count_read(reads, inst->arg1, -1);
+    count_read(reads, inst->arg2, -1);
+    tac_edit_remove(&edits, i);
+  }
+
+  int changes = edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(reads);
+  return changes;
+}
+
+/**
+ * @brief Whether an instruction may stop the program with an error
+ */
+static bool may_trap(const TACInst *inst) {
+  return inst->op == TAC_OP_DIV &&
+         (inst->arg2.kind != TAC_OPND_CONST || inst->arg2.value == 0);
+}
+
+/**
+ * @brief Remove stores overwritten later in the same block before any read
+ *
+ * Sweeps each block backwards, recording which locations are written
+ * further down with no read in between. A division that may trap ends the
+ * sweep like a block boundary: the variables are observed when it does.
+ */
+static int remove_overwritten_stores(TACProgram *program) {
+  int locations = dataflow_location_count(program);
+  int *dead = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  memset(dead, 0xff, ((size_t)locations + 1) * sizeof(int));
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  int block = 0;
+  for (int i = program->count - 1; i >= 0; i--) {
+    const TACInst *inst = &program->instructions[i];
+    if (!tac_op_writes_result(inst->op)) {
+      /* Labels, jumps, params and returns end the sweep over a block */
+      block++;
+      int loc = dataflow_location(program, inst->result);
+      if (loc >= 0) {
+        dead[loc] = -1;
+      }
+    } else {
+      int loc = dataflow_location(program, inst->result);
+      if (dead[loc] == block && !may_trap(inst)) {
+        tac_edit_remove(&edits, i);
+        continue;
+      }
+      if (may_trap(inst)) {
+        block++;
+      } else {
+        dead[loc] = block;
+      }
+    }
+    int arg1 = dataflow_location(program, inst->arg1);
+    int arg2 = dataflow_location(program, inst->arg2);
+    if (arg1 >= 0) {
+      dead[arg1] = -1;
+    }
+    if (arg2 >= 0) {
+      dead[arg2] = -1;
+    }
+  }
+
+  int changes = edits.count;
+  tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(dead);
+  return changes;
+}
+
+/**
+ * @brief Clean up jumps, labels and dead code
+ */
+int tac_opt_cleanup(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  int total = 0;
+  for (;;) {
+    int changes = thread_jumps(program);
+    changes += remove_unreachable(program);
+    changes += simplify_fallthrough(program);
+    changes += remove_unused_labels(program);
+    changes += remove_dead_temps(program);
+    changes += remove_overwritten_stores(program);
+    if (changes == 0) {
+      break;
+    }
+    total += changes;
+  }
+
+  DEBUG_PRINT("Cleanup made %d changes", total);
+  return total;
+}
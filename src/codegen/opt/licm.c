@@ -0,0 +1,331 @@
+/**
+ * @file codegen/opt/licm.c
+ * @brief Loop-invariant code motion
+ */
+
+#include "codegen/cfg.h"
+#include "codegen/dataflow.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Per-program state shared by all loops
+ */
+typedef struct LICMState {
+  TACProgram *program;
+  const CFG *cfg;
+  int *def_count;    /* Writes per location in the whole program */
+  int *def_at;       /* Instruction of the last write per location */
+  int *read_count;   /* Reads per location in the whole program */
+  int *loop_reads;   /* Reads per location inside the current loop */
+  int *read_stamp;   /* Loop loop_reads was counted for */
+  int *write_stamp;  /* Loop the location was last seen written in */
+  int *bad_stamp;    /* Loop in which a read is not dominated by the def */
+  int *block_stamp;  /* Loop the block was last seen in */
+  bool *hoisted;     /* Instruction already moved out of some loop */
+  int *order;        /* Instructions hoisted out of the current loop */
+} LICMState;
+
+/**
+ * @brief Whether an instruction computes a value without side effects
+ *
+ * Division is only safe by a nonzero constant: hoisting a trapping
+ * division in front of a loop that runs zero times would raise an error
+ * the original program never reaches.
+ */
+static bool is_movable(const TACInst *inst) {
+  switch (inst->op) {
+  case TAC_OP_ASSIGN:
+  case TAC_OP_ADD:
+  case TAC_OP_SUB:
+  case TAC_OP_MUL:
+  case TAC_OP_NEG:
+  case TAC_OP_SHL:
+  case TAC_OP_SHR:
+    return true;
+  case TAC_OP_DIV:
+    return inst->arg2.kind == TAC_OPND_CONST && inst->arg2.value != 0;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Whether an operand holds the same value throughout loop l
+ */
+static bool is_invariant(const LICMState *s, int l, TACOperand operand) {
+  int loc = dataflow_location(s->program, operand);
+  if (loc < 0 || s->write_stamp[loc] != l) {
+    return true;
+  }
+  /* Written in the loop only by an instruction already hoisted */
+  return s->def_count[loc] == 1 && s->hoisted[s->def_at[loc]];
+}
+
+/**
+ * @brief Record the reads of an operand at instruction i of block b
+ */
+static void count_read(LICMState *s, int l, int b, int i, TACOperand operand) {
+  int loc = dataflow_location(s->program, operand);
+  if (loc < 0) {
+    return;
+  }
+  if (s->read_stamp[loc] != l) {
+    s->read_stamp[loc] = l;
+    s->loop_reads[loc] = 0;
+  }
+  s->loop_reads[loc]++;
+
+  /* A read the single definition does not dominate could see the
+   * location's previous value, which hoisting would change */
+  if (s->def_count[loc] == 1) {
+    int def = s->def_at[loc];
+    int def_block = cfg_block_of(s->cfg, def);
+    if (def_block == b ? def >= i : !cfg_dominates(s->cfg, def_block, b)) {
+      s->bad_stamp[loc] = l;
+    }
+  }
+}
+
+/**
+ * @brief Whether instruction i of loop l can move to the preheader
+ *
+ * The result must be a temporary written only here and read only inside
+ * the loop, so computing it when the loop runs zero times is unobservable.
+ */
+static bool can_hoist(const LICMState *s, int l, int i) {
+  const TACInst *inst = &s->program->instructions[i];
+  if (s->hoisted[i] || !is_movable(inst) ||
+      inst->result.kind != TAC_OPND_TEMP) {
+    return false;
+  }
+  int loc = dataflow_location(s->program, inst->result);
+  int reads = s->read_stamp[loc] == l ? s->loop_reads[loc] : 0;
+  return s->def_count[loc] == 1 && reads == s->read_count[loc] &&
+         s->bad_stamp[loc] != l && is_invariant(s, l, inst->arg1) &&
+         is_invariant(s, l, inst->arg2);
+}
+
+/**
+ * @brief Select the instructions of loop l to hoist
+ *
+ * @return int Number selected, stored in s->order in dependency order
+ */
+static int select_invariants(LICMState *s, int l) {
+  const CFG *cfg = s->cfg;
+  const TACProgram *program = s->program;
+  int first = cfg->loop_offset[l];
+  int last = cfg->loop_offset[l + 1];
+
+  for (int k = first; k < last; k++) {
+    int b = cfg->loop_blocks[k];
+    s->block_stamp[b] = l;
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      const TACInst *inst = &program->instructions[i];
+      if (s->hoisted[i]) {
+        continue;
+      }
+      if (tac_op_writes_result(inst->op)) {
+        s->write_stamp[dataflow_location(program, inst->result)] = l;
+      }
+      count_read(s, l, b, i, inst->arg1);
+      count_read(s, l, b, i, inst->arg2);
+      if (inst->op == TAC_OP_PARAM || inst->op == TAC_OP_RETURN) {
+        count_read(s, l, b, i, inst->result);
+      }
+    }
+  }
+
+  /* An instruction becomes invariant once the definitions of its
+   * operands are hoisted, so repeat until nothing more moves */
+  int count = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int k = first; k < last; k++) {
+      int b = cfg->loop_blocks[k];
+      for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+        if (can_hoist(s, l, i)) {
+          s->hoisted[i] = true;
+          s->order[count++] = i;
+          changed = true;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Whether loop l can be given a preheader in front of its header
+ *
+ * The preheader is placed right before the header's labels, where the
+ * block that falls into the header enters it. That block must lie outside
+ * the loop, or the back edge would run the preheader too.
+ */
+static bool has_preheader_slot(const LICMState *s, int l) {
+  const CFG *cfg = s->cfg;
+  int h = cfg->loop_header[l];
+  if (h == 0) {
+    return true;
+  }
+  const TACInst *prev = &s->program->instructions[cfg->block_start[h] - 1];
+  bool falls_through =
+      prev->op != TAC_OP_GOTO && prev->op != TAC_OP_RETURN;
+  return !falls_through || s->block_stamp[h - 1] != l;
+}
+
+/**
+ * @brief Send the jumps that enter loop l from outside to its preheader
+ */
+static void retarget_entries(LICMState *s, int l, TACOperand preheader) {
+  const CFG *cfg = s->cfg;
+  int h = cfg->loop_header[l];
+  for (int k = cfg->pred_offset[h]; k < cfg->pred_offset[h + 1]; k++) {
+    int p = cfg->pred[k];
+    if (s->block_stamp[p] == l) {
+      continue;
+    }
+    TACInst *last = &s->program->instructions[cfg->block_start[p + 1] - 1];
+    bool jumps = last->op == TAC_OP_GOTO || tac_op_is_cond_jump(last->op);
+    if (jumps && cfg->label_block[last->result.id] == h) {
+      last->result = preheader;
+    }
+  }
+}
+
+/**
+ * @brief Hoist loop-invariant computations into loop preheaders
+ */
+int tac_opt_licm(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    return 0;
+  }
+  if (cfg->loop_count == 0) {
+    cfg_destroy(cfg);
+    return 0;
+  }
+
+  int locations = dataflow_location_count(program);
+  size_t loc_size = ((size_t)locations + 1) * sizeof(int);
+  size_t block_size = ((size_t)cfg->block_count + 1) * sizeof(int);
+  size_t inst_size = ((size_t)program->count + 1) * sizeof(int);
+  LICMState s;
+  s.program = program;
+  s.cfg = cfg;
+  s.def_count = (int *)safe_malloc(loc_size);
+  s.def_at = (int *)safe_malloc(loc_size);
+  s.read_count = (int *)safe_malloc(loc_size);
+  s.loop_reads = (int *)safe_malloc(loc_size);
+  s.read_stamp = (int *)safe_malloc(loc_size);
+  s.write_stamp = (int *)safe_malloc(loc_size);
+  s.bad_stamp = (int *)safe_malloc(loc_size);
+  s.block_stamp = (int *)safe_malloc(block_size);
+  s.hoisted = (bool *)safe_malloc((size_t)program->count + 1);
+  s.order = (int *)safe_malloc(inst_size);
+  memset(s.def_count, 0, loc_size);
+  memset(s.read_count, 0, loc_size);
+  memset(s.read_stamp, 0xff, loc_size);
+  memset(s.write_stamp, 0xff, loc_size);
+  memset(s.bad_stamp, 0xff, loc_size);
+  memset(s.block_stamp, 0xff, block_size);
+  memset(s.hoisted, 0, (size_t)program->count + 1);
+
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (tac_op_writes_result(inst->op)) {
+      int loc = dataflow_location(program, inst->result);
+      s.def_count[loc]++;
+      s.def_at[loc] = i;
+    }
+    const TACOperand reads[] = {inst->arg1, inst->arg2, inst->result};
+    int n = inst->op == TAC_OP_PARAM || inst->op == TAC_OP_RETURN ? 3 : 2;
+    for (int k = 0; k < n; k++) {
+      int loc = dataflow_location(program, reads[k]);
+      if (loc >= 0) {
+        s.read_count[loc]++;
+      }
+    }
+  }
+
+  /* Outer loops first, so a computation invariant in several nested
+   * loops leaves all of them at once */
+  int *depth = (int *)safe_malloc(((size_t)cfg->loop_count + 1) * sizeof(int));
+  int *by_depth =
+      (int *)safe_malloc(((size_t)cfg->loop_count + 1) * sizeof(int));
+  int max_depth = 0;
+  for (int l = 0; l < cfg->loop_count; l++) {
+    depth[l] = 0;
+    for (int p = cfg->loop_parent[l]; p >= 0; p = cfg->loop_parent[p]) {
+      depth[l]++;
+    }
+    if (depth[l] > max_depth) {
+      max_depth = depth[l];
+    }
+  }
+  int sorted = 0;
+  for (int d = 0; d <= max_depth; d++) {
+    for (int l = 0; l < cfg->loop_count; l++) {
+      if (depth[l] == d) {
+        by_depth[sorted++] = l;
+      }
+    }
+  }
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  int moved = 0;
+  int loops = 0;
+  for (int k = 0; k < cfg->loop_count; k++) {
+    int l = by_depth[k];
+    int count = select_invariants(&s, l);
+    if (count == 0) {
+      continue;
+    }
+    if (!has_preheader_slot(&s, l)) {
+      for (int j = 0; j < count; j++) {
+        s.hoisted[s.order[j]] = false;
+      }
+      continue;
+    }
+
+    TACOperand preheader = tac_program_new_label(program);
+    int at = cfg->block_start[cfg->loop_header[l]];
+    TACInst label = {TAC_OP_LABEL, preheader, tac_none(), tac_none(),
+                     program->instructions[at].lineno};
+    tac_edit_insert(&edits, at, label);
+    for (int j = 0; j < count; j++) {
+      tac_edit_insert(&edits, at, program->instructions[s.order[j]]);
+      tac_edit_remove(&edits, s.order[j]);
+    }
+    retarget_entries(&s, l, preheader);
+    moved += count;
+    loops++;
+  }
+
+  DEBUG_PRINT("LICM hoisted %d instructions out of %d loops", moved, loops);
+
+  bool ok = tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(depth);
+  free(by_depth);
+  free(s.def_count);
+  free(s.def_at);
+  free(s.read_count);
+  free(s.loop_reads);
+  free(s.read_stamp);
+  free(s.write_stamp);
+  free(s.bad_stamp);
+  free(s.block_stamp);
+  free(s.hoisted);
+  free(s.order);
+  cfg_destroy(cfg);
+  return ok ? moved : -1;
+}
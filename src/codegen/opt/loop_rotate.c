@@ -0,0 +1,175 @@
+/**
+ * @file codegen/opt/loop_rotate.c
+ * @brief Loop rotation: bottom-tested loops behind a guard
+ */
+
+#include "codegen/cfg.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Largest header, in instructions, copied to each back edge; like GCC's
+ * max-loop-header-insns it bounds code growth */
+#define ROTATE_MAX_HEADER 8
+
+/**
+ * @brief How one loop is rotated
+ */
+typedef struct RotatePlan {
+  int header_first; /* First non-label instruction of the header */
+  int branch;       /* The header's closing conditional jump */
+  TACOpType op;     /* Condition of the copied test, jumping into the body */
+  TACOperand body;  /* Where the copied test continues the loop */
+  TACOperand exit;  /* Where the copied test leaves the loop */
+} RotatePlan;
+
+/**
+ * @brief Label starting a block, recording an insertion if it has none
+ */
+static TACOperand block_label(TACProgram *program, const CFG *cfg, int b,
+                              TACEditList *edits) {
+  const TACInst *first = &program->instructions[cfg->block_start[b]];
+  if (first->op == TAC_OP_LABEL) {
+    return first->result;
+  }
+  TACOperand label = tac_program_new_label(program);
+  TACInst inst = {TAC_OP_LABEL, label, tac_none(), tac_none(), first->lineno};
+  tac_edit_insert(edits, cfg->block_start[b], inst);
+  return label;
+}
+
+/**
+ * @brief Work out how to rotate loop l, whose blocks carry stamp l
+ *
+ * The header must end in a conditional jump with one way into the loop
+ * and the other out of it, and be small enough to copy.
+ */
+static bool plan_rotation(TACProgram *program, const CFG *cfg,
+                          const int *stamp, int l, TACEditList *edits,
+                          RotatePlan *plan) {
+  int h = cfg->loop_header[l];
+  int first = cfg->block_start[h];
+  int last = cfg->block_start[h + 1] - 1;
+  while (first <= last && program->instructions[first].op == TAC_OP_LABEL) {
+    first++;
+  }
+  const TACInst *branch = &program->instructions[last];
+  if (first > last || !tac_op_is_cond_jump(branch->op) ||
+      last - first + 1 > ROTATE_MAX_HEADER || h + 1 >= cfg->block_count) {
+    return false;
+  }
+
+  int taken = cfg->label_block[branch->result.id];
+  int fall = h + 1;
+  bool taken_inside = stamp[taken] == l;
+  bool fall_inside = stamp[fall] == l;
+  if (taken_inside == fall_inside) {
+    return false;
+  }
+
+  plan->header_first = first;
+  plan->branch = last;
+  if (fall_inside) {
+    /* Lh: X; if c goto Lexit  ->  X; if !c goto Lbody; goto Lexit */
+    plan->op = tac_op_negate_relop(branch->op);
+    plan->body = block_label(program, cfg, fall, edits);
+    plan->exit = branch->result;
+  } else {
+    /* Lh: X; if c goto Lbody; goto Lexit: the exit is already a jump */
+    plan->op = branch->op;
+    plan->body = branch->result;
+    const TACInst *next = &program->instructions[cfg->block_start[fall]];
+    plan->exit = next->op == TAC_OP_GOTO ? next->result
+                                         : block_label(program, cfg, fall,
+                                                       edits);
+  }
+  return true;
+}
+
+/**
+ * @brief Replace the goto at index g by a copy of the header's test
+ */
+static void rotate_back_edge(const TACProgram *program, const RotatePlan *plan,
+                             int g, TACEditList *edits) {
+  int lineno = program->instructions[g].lineno;
+  for (int i = plan->header_first; i < plan->branch; i++) {
+    tac_edit_insert(edits, g, program->instructions[i]);
+  }
+  const TACInst *branch = &program->instructions[plan->branch];
+  TACInst test = {plan->op, plan->body, branch->arg1, branch->arg2,
+                  branch->lineno};
+  TACInst leave = {TAC_OP_GOTO, plan->exit, tac_none(), tac_none(), lineno};
+  tac_edit_insert(edits, g, test);
+  tac_edit_insert(edits, g, leave);
+  tac_edit_remove(edits, g);
+}
+
+/**
+ * @brief Turn top-tested loops into a guard and bottom tests
+ */
+int tac_opt_rotate_loops(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    return 0;
+  }
+  if (cfg->loop_count == 0) {
+    cfg_destroy(cfg);
+    return 0;
+  }
+
+  int *stamp = (int *)safe_malloc(((size_t)cfg->block_count + 1) * sizeof(int));
+  RotatePlan *plans = (RotatePlan *)safe_malloc(
+      ((size_t)cfg->loop_count + 1) * sizeof(RotatePlan));
+  bool *planned = (bool *)safe_malloc((size_t)cfg->loop_count + 1);
+  memset(stamp, 0xff, ((size_t)cfg->block_count + 1) * sizeof(int));
+
+  /* Labels come first, so a label added at a block start stays ahead of
+   * a back edge rewritten at the same index */
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  for (int l = 0; l < cfg->loop_count; l++) {
+    for (int k = cfg->loop_offset[l]; k < cfg->loop_offset[l + 1]; k++) {
+      stamp[cfg->loop_blocks[k]] = l;
+    }
+    planned[l] = plan_rotation(program, cfg, stamp, l, &edits, &plans[l]);
+  }
+
+  int rotated = 0;
+  int edges = 0;
+  for (int l = 0; l < cfg->loop_count; l++) {
+    if (!planned[l]) {
+      continue;
+    }
+    int h = cfg->loop_header[l];
+    bool any = false;
+    for (int k = cfg->pred_offset[h]; k < cfg->pred_offset[h + 1]; k++) {
+      int p = cfg->pred[k];
+      int g = cfg->block_start[p + 1] - 1;
+      const TACInst *jump = &program->instructions[g];
+      /* Conditional back edges are left alone */
+      if (!cfg_dominates(cfg, h, p) || jump->op != TAC_OP_GOTO ||
+          cfg->label_block[jump->result.id] != h) {
+        continue;
+      }
+      rotate_back_edge(program, &plans[l], g, &edits);
+      edges++;
+      any = true;
+    }
+    rotated += any;
+  }
+
+  DEBUG_PRINT("Rotated %d loops, %d back edges", rotated, edges);
+
+  bool ok = tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(stamp);
+  free(plans);
+  free(planned);
+  cfg_destroy(cfg);
+  return ok ? edges : -1;
+}
@@ -0,0 +1,360 @@
+/**
+ * @file codegen/opt/peephole.c
+ * @brief Peephole simplification and strength reduction
+ */
+
+#include "codegen/dataflow.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* How far back a rule may look for the definition of an operand */
+#define PEEPHOLE_WINDOW 8
+
+/* Rewrites applied to one instruction before moving on */
+#define PEEPHOLE_MAX_STEPS 8
+
+/**
+ * @brief Window over the current basic block
+ *
+ * Records where each location was last written; a record is valid only
+ * while its stamp equals the current block number.
+ */
+typedef struct PeepholeWindow {
+  TACProgram *program;
+  int *def_at;    /* Instruction that last wrote each location */
+  int *def_stamp; /* Block number def_at was recorded in */
+  int block;      /* Current block number */
+  int index;      /* Instruction being rewritten */
+} PeepholeWindow;
+
+/**
+ * @brief Rewrite rule: returns true if it changed the instruction
+ */
+typedef bool (*PeepholeApply)(const PeepholeWindow *w, TACInst *inst);
+
+typedef struct PeepholeRule {
+  const char *name;
+  PeepholeApply apply;
+} PeepholeRule;
+
+/**
+ * @brief Index of the last write of a location in the block, or -1
+ */
+static int last_write(const PeepholeWindow *w, TACOperand operand) {
+  int loc = dataflow_location(w->program, operand);
+  if (loc < 0 || w->def_stamp[loc] != w->block) {
+    return -1;
+  }
+  return w->def_at[loc];
+}
+
+/**
+ * @brief Definition of an operand inside the window whose arguments still
+ * hold the values it was computed from, or NULL
+ */
+static const TACInst *window_def(const PeepholeWindow *w, TACOperand operand) {
+  int at = last_write(w, operand);
+  if (at < 0 || w->index - at > PEEPHOLE_WINDOW) {
+    return NULL;
+  }
+  const TACInst *def = &w->program->instructions[at];
+  if (last_write(w, def->arg1) >= at || last_write(w, def->arg2) >= at) {
+    return NULL;
+  }
+  return def;
+}
+
+static bool is_const(TACOperand operand, int value) {
+  return operand.kind == TAC_OPND_CONST && operand.value == value;
+}
+
+/**
+ * @brief Exponent of a power of two in 2..2^30, or 0
+ */
+static int power_of_two(TACOperand operand) {
+  if (operand.kind != TAC_OPND_CONST || operand.value < 2 ||
+      (operand.value & (operand.value - 1)) != 0) {
+    return 0;
+  }
+  int k = 0;
+  while ((1 << k) != operand.value) {
+    k++;
+  }
+  return k;
+}
+
+static void set_copy(TACInst *inst, TACOperand value) {
+  inst->op = TAC_OP_ASSIGN;
+  inst->arg1 = value;
+  inst->arg2 = tac_none();
+}
+
+static void set_op(TACInst *inst, TACOpType op, TACOperand a, TACOperand b) {
+  inst->op = op;
+  inst->arg1 = a;
+  inst->arg2 = tac_op_is_unary(op) ? tac_none() : b;
+}
+
+/**
+ * @brief a + c, written as a - (-c) when c is negative
+ */
+static void set_add_const(TACInst *inst, TACOperand a, int c) {
+  if (c < 0 && c != INT_MIN) {
+    set_op(inst, TAC_OP_SUB, a, tac_const(-c));
+  } else {
+    set_op(inst, TAC_OP_ADD, a, tac_const(c));
+  }
+}
+
+/**
+ * @brief (a + c1) + c2 -> a + (c1 + c2), likewise for -, * and <<
+ */
+static bool rule_reassociate(const PeepholeWindow *w, TACInst *inst) {
+  if (inst->arg2.kind != TAC_OPND_CONST) {
+    return false;
+  }
+  const TACInst *def = window_def(w, inst->arg1);
+  if (!def || def->arg1.kind == TAC_OPND_CONST ||
+      def->arg2.kind != TAC_OPND_CONST) {
+    return false;
+  }
+  unsigned int c1 = (unsigned int)def->arg2.value;
+  unsigned int c2 = (unsigned int)inst->arg2.value;
+
+  bool additive = inst->op == TAC_OP_ADD || inst->op == TAC_OP_SUB;
+  if (additive && (def->op == TAC_OP_ADD || def->op == TAC_OP_SUB)) {
+    unsigned int sum = (def->op == TAC_OP_ADD ? c1 : 0u - c1) +
+                       (inst->op == TAC_OP_ADD ? c2 : 0u - c2);
+    set_add_const(inst, def->arg1, (int)sum);
+    return true;
+  }
+  if (inst->op == TAC_OP_MUL && def->op == TAC_OP_MUL) {
+    set_op(inst, TAC_OP_MUL, def->arg1, tac_const((int)(c1 * c2)));
+    return true;
+  }
+  if (inst->op == TAC_OP_SHL && def->op == TAC_OP_SHL && c1 + c2 <= 31) {
+    set_op(inst, TAC_OP_SHL, def->arg1, tac_const((int)(c1 + c2)));
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief -(-a) -> a
+ */
+static bool rule_double_negation(const PeepholeWindow *w, TACInst *inst) {
+  if (inst->op != TAC_OP_NEG) {
+    return false;
+  }
+  const TACInst *def = window_def(w, inst->arg1);
+  if (!def || def->op != TAC_OP_NEG) {
+    return false;
+  }
+  set_copy(inst, def->arg1);
+  return true;
+}
+
+/**
+ * @brief a + 0, a - 0, a * 1, a / 1, a << 0, a >> 0 -> a
+ */
+static bool rule_identity(const PeepholeWindow *w, TACInst *inst) {
+  (void)w;
+  int neutral;
+  switch (inst->op) {
+  case TAC_OP_ADD:
+  case TAC_OP_SUB:
+  case TAC_OP_SHL:
+  case TAC_OP_SHR:
+    neutral = 0;
+    break;
+  case TAC_OP_MUL:
+  case TAC_OP_DIV:
+    neutral = 1;
+    break;
+  default:
+    return false;
+  }
+  if (!is_const(inst->arg2, neutral)) {
+    return false;
+  }
+  set_copy(inst, inst->arg1);
+  return true;
+}
+
+/**
+ * @brief a * 0 -> 0, a - a -> 0
+ */
+static bool rule_zero(const PeepholeWindow *w, TACInst *inst) {
+  (void)w;
+  bool self = inst->op == TAC_OP_SUB && inst->arg1.kind != TAC_OPND_CONST &&
+              tac_operand_equals(inst->arg1, inst->arg2);
+  if (!self && !(inst->op == TAC_OP_MUL && is_const(inst->arg2, 0))) {
+    return false;
+  }
+  set_copy(inst, tac_const(0));
+  return true;
+}
+
+/**
+ * @brief 0 - a, a * -1, a / -1 -> -a
+ */
+static bool rule_negate(const PeepholeWindow *w, TACInst *inst) {
+  (void)w;
+  if (inst->op == TAC_OP_SUB && is_const(inst->arg1, 0) &&
+      inst->arg2.kind != TAC_OPND_CONST) {
+    set_op(inst, TAC_OP_NEG, inst->arg2, tac_none());
+    return true;
+  }
+  if ((inst->op == TAC_OP_MUL || inst->op == TAC_OP_DIV) &&
+      is_const(inst->arg2, -1)) {
+    set_op(inst, TAC_OP_NEG, inst->arg1, tac_none());
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief a * 2^k -> a << k
+ */
+static bool rule_multiply_to_shift(const PeepholeWindow *w, TACInst *inst) {
+  (void)w;
+  int k = power_of_two(inst->arg2);
+  if (inst->op != TAC_OP_MUL || k == 0) {
+    return false;
+  }
+  set_op(inst, TAC_OP_SHL, inst->arg1, tac_const(k));
+  return true;
+}
+
+/**
+ * @brief a / 2^k -> a >> k, which rounds toward zero like the division
+ */
+static bool rule_divide_to_shift(const PeepholeWindow *w, TACInst *inst) {
+  (void)w;
+  int k = power_of_two(inst->arg2);
+  if (inst->op != TAC_OP_DIV || k == 0) {
+    return false;
+  }
+  set_op(inst, TAC_OP_SHR, inst->arg1, tac_const(k));
+  return true;
+}
+
+/* Pattern table, tried in order; indexed by TACPeepholeRule */
+static const PeepholeRule rules[TAC_PEEPHOLE_RULE_COUNT] = {
+    {"reassociate", rule_reassociate},
+    {"double negation", rule_double_negation},
+    {"identity", rule_identity},
+    {"zero", rule_zero},
+    {"negate", rule_negate},
+    {"multiply to shift", rule_multiply_to_shift},
+    {"divide to shift", rule_divide_to_shift},
+};
+
+/**
+ * @brief Get the name of a peephole rule
+ */
+const char *tac_opt_peephole_rule_name(TACPeepholeRule rule) {
+  return rule >= 0 && rule < TAC_PEEPHOLE_RULE_COUNT ? rules[rule].name
+                                                     : "unknown";
+}
+
+/**
+ * @brief Put the constant operand of + and * second
+ */
+static void canonicalize(TACInst *inst) {
+  if ((inst->op == TAC_OP_ADD || inst->op == TAC_OP_MUL) &&
+      inst->arg1.kind == TAC_OPND_CONST && inst->arg2.kind != TAC_OPND_CONST) {
+    TACOperand swap = inst->arg1;
+    inst->arg1 = inst->arg2;
+    inst->arg2 = swap;
+  }
+}
+
+/**
+ * @brief Simplify arithmetic through a pattern table over a sliding window
+ */
+int tac_opt_peephole(TACProgram *program, TACPeepholeStats *stats) {
+  if (!program) {
+    return -1;
+  }
+
+  int locations = dataflow_location_count(program);
+  PeepholeWindow w;
+  w.program = program;
+  w.def_at = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  w.def_stamp = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  memset(w.def_stamp, 0xff, ((size_t)locations + 1) * sizeof(int));
+  w.block = 0;
+
+  int counts[TAC_PEEPHOLE_RULE_COUNT] = {0};
+  int changes = 0;
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+
+    /* A label starts a new block: values may arrive from other paths */
+    if (inst->op == TAC_OP_LABEL) {
+      w.block++;
+      continue;
+    }
+
+    if (tac_op_writes_result(inst->op) && inst->op != TAC_OP_ASSIGN) {
+      w.index = i;
+      bool changed = false;
+      for (int step = 0; step < PEEPHOLE_MAX_STEPS; step++) {
+        canonicalize(inst);
+        int r = 0;
+        while (r < TAC_PEEPHOLE_RULE_COUNT && !rules[r].apply(&w, inst)) {
+          r++;
+        }
+        if (r == TAC_PEEPHOLE_RULE_COUNT) {
+          break;
+        }
+        counts[r]++;
+        changed = true;
+        if (inst->op == TAC_OP_ASSIGN) {
+          break;
+        }
+      }
+      changes += changed;
+      /* a := a * 1 and the like leave a self-copy */
+      if (inst->op == TAC_OP_ASSIGN &&
+          tac_operand_equals(inst->result, inst->arg1)) {
+        tac_edit_remove(&edits, i);
+      }
+    }
+
+    if (tac_op_writes_result(inst->op)) {
+      int loc = dataflow_location(program, inst->result);
+      w.def_at[loc] = i;
+      w.def_stamp[loc] = w.block;
+    }
+
+    /* A jump ends the block */
+    if (tac_op_is_jump(inst->op)) {
+      w.block++;
+    }
+  }
+
+  for (int r = 0; r < TAC_PEEPHOLE_RULE_COUNT; r++) {
+    if (counts[r] > 0) {
+      DEBUG_PRINT("Peephole rule '%s' rewrote %d instructions", rules[r].name,
+                  counts[r]);
+    }
+    if (stats) {
+      stats->rewrites[r] = counts[r];
+    }
+  }
+  DEBUG_PRINT("Peephole pass changed %d instructions", changes);
+
+  bool ok = tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  free(w.def_at);
+  free(w.def_stamp);
+  return ok ? changes : -1;
+}
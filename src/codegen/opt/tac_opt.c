@@ -0,0 +1,47 @@
+/**
+ * @file codegen/opt/tac_opt.c
+ * @brief Optimization pass pipeline
+ */
+
+#include "codegen/tac_opt.h"
+#include "common.h"
+#include "utils.h"
+
+/**
+ * @brief Run the optimization passes enabled at a level
+ */
+bool tac_optimize(TACProgram *program, int level, TACPeepholeStats *stats) {
+  if (!program) {
+    return false;
+  }
+
+  TACPeepholeStats early = {{0}};
+  TACPeepholeStats late = {{0}};
+  if (level >= 1) {
+    if (tac_opt_fold_constants(program) < 0 ||
+        tac_opt_peephole(program, &early) < 0 ||
+        tac_opt_value_numbering(program) < 0 ||
+        tac_opt_copy_propagation(program) < 0 ||
+        tac_opt_rotate_loops(program) < 0 ||
+        tac_opt_licm(program) < 0 ||
+        tac_opt_global_constants(program) < 0 ||
+        tac_opt_fold_constants(program) < 0 ||
+        tac_opt_unroll_loops(program, CONFIG_UNROLL_FACTOR) < 0 ||
+        tac_opt_fold_constants(program) < 0 ||
+        tac_opt_global_constants(program) < 0 ||
+        tac_opt_fold_constants(program) < 0 ||
+        tac_opt_peephole(program, &late) < 0 ||
+        tac_opt_cleanup(program) < 0) {
+      return false;
+    }
+  }
+
+  if (stats) {
+    for (int r = 0; r < TAC_PEEPHOLE_RULE_COUNT; r++) {
+      stats->rewrites[r] = early.rewrites[r] + late.rewrites[r];
+    }
+  }
+
+  DEBUG_PRINT("Optimized at level %d: %d instructions", level, program->count);
+  return true;
+}
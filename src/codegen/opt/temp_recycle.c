@@ -0,0 +1,364 @@
+/**
+ * @file codegen/opt/temp_recycle.c
+ * @brief Temporary renumbering by live interval
+ */
+
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+
+/**
+ * @brief A loop back edge: a jump at or after the label it targets
+ */
+typedef struct BackEdge {
+  int header; /* Position of the target label */
+  int jump;   /* Position of the jump */
+} BackEdge;
+
+/**
+ * @brief Binary min-heap of ids ordered by a key array
+ */
+typedef struct IdHeap {
+  int *ids;       /* Heap storage */
+  int count;      /* Number of ids in the heap */
+  const int *key; /* Key per id, or NULL to order by id */
+} IdHeap;
+
+static int heap_key(const IdHeap *heap, int id) {
+  return heap->key ? heap->key[id] : id;
+}
+
+static void heap_push(IdHeap *heap, int id) {
+  int i = heap->count++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (heap_key(heap, heap->ids[parent]) <= heap_key(heap, id)) {
+      break;
+    }
+    heap->ids[i] = heap->ids[parent];
+    i = parent;
+  }
+  heap->ids[i] = id;
+}
+
+static int heap_pop(IdHeap *heap) {
+  int top = heap->ids[0];
+  int last = heap->ids[--heap->count];
+  int i = 0;
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= heap->count) {
+      break;
+    }
+    if (child + 1 < heap->count &&
+        heap_key(heap, heap->ids[child + 1]) < heap_key(heap, heap->ids[child])) {
+      child++;
+    }
+    if (heap_key(heap, last) <= heap_key(heap, heap->ids[child])) {
+      break;
+    }
+    heap->ids[i] = heap->ids[child];
+    i = child;
+  }
+  heap->ids[i] = last;
+  return top;
+}
+
+static int compare_back_edges(const void *a, const void *b) {
+  const BackEdge *x = (const BackEdge *)a;
+  const BackEdge *y = (const BackEdge *)b;
+  return x->header - y->header;
+}
+
+/**
+ * @brief Record one occurrence of a temporary at position pos
+ */
+static void touch(TACOperand operand, int pos, bool is_use, int *start,
+                  int *end, bool *upward) {
+  if (operand.kind != TAC_OPND_TEMP) {
+    return;
+  }
+  int t = operand.id;
+  if (start[t] < 0) {
+    start[t] = pos;
+    upward[t] = is_use;
+  }
+  end[t] = pos;
+}
+
+/**
+ * @brief Collect back edges sorted by header position
+ */
+static BackEdge *collect_back_edges(const TACProgram *program, int *count) {
+  int *label_pos =
+      (int *)safe_malloc((program->label_count + 1) * sizeof(int));
+  BackEdge *edges = NULL;
+  int edge_count = 0;
+  int edge_capacity = 0;
+
+  for (int i = 0; i < program->label_count; i++) {
+    label_pos[i] = -1;
+  }
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_LABEL && inst->result.kind == TAC_OPND_LABEL) {
+      label_pos[inst->result.id] = i;
+    }
+  }
+
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (!tac_op_is_jump(inst->op) || inst->result.kind != TAC_OPND_LABEL) {
+      continue;
+    }
+    int header = label_pos[inst->result.id];
+    if (header < 0 || header > i) {
+      continue;
+    }
+    if (edge_count >= edge_capacity) {
+      edge_capacity = edge_capacity ? edge_capacity * 2 : 16;
+      edges = (BackEdge *)safe_realloc(edges, edge_capacity * sizeof(BackEdge));
+    }
+    edges[edge_count].header = header;
+    edges[edge_count].jump = i;
+    edge_count++;
+  }
+
+  free(label_pos);
+  if (edge_count > 1) {
+    qsort(edges, edge_count, sizeof(BackEdge), compare_back_edges);
+  }
+  *count = edge_count;
+  return edges;
+}
+
+/**
+ * @brief Widen live intervals across loops
+ *
+ * A temporary live into a loop header (defined before it, read after it)
+ * stays live until the loop's back edge. A temporary whose first occurrence
+ * is a read takes its value around a back edge, so it is live over every
+ * loop containing that read. Back edges are sorted by header, so both cases
+ * are binary searches: a running maximum of the jumps finds the outermost
+ * loop around a read, and a sparse table answers "furthest back edge among
+ * headers in (s, e]". Each widening step is a logarithmic query; steps
+ * repeat until nested loops stop extending the interval.
+ */
+static void widen_intervals(const BackEdge *edges, int edge_count,
+                            int temp_count, int *start, int *end,
+                            const bool *upward) {
+  if (edge_count == 0) {
+    return;
+  }
+
+  int levels = 1;
+  while ((1 << levels) <= edge_count) {
+    levels++;
+  }
+  int **table = (int **)safe_malloc(levels * sizeof(int *));
+  table[0] = (int *)safe_malloc(edge_count * sizeof(int));
+  for (int i = 0; i < edge_count; i++) {
+    table[0][i] = edges[i].jump;
+  }
+  /* reach[i]: furthest jump among the first i + 1 edges */
+  int *reach = (int *)safe_malloc(edge_count * sizeof(int));
+  for (int i = 0; i < edge_count; i++) {
+    reach[i] = i > 0 && reach[i - 1] > edges[i].jump ? reach[i - 1]
+                                                     : edges[i].jump;
+  }
+  for (int k = 1; k < levels; k++) {
+    int span = 1 << k;
+    table[k] = (int *)safe_malloc(edge_count * sizeof(int));
+    for (int i = 0; i + span <= edge_count; i++) {
+      int a = table[k - 1][i];
+      int b = table[k - 1][i + span / 2];
+      table[k][i] = a > b ? a : b;
+    }
+  }
+
+  for (int t = 0; t < temp_count; t++) {
+    if (start[t] < 0) {
+      continue;
+    }
+
+    if (upward[t]) {
+      /* Loops around the read: headers at or before it, jumps at or after */
+      int lo = 0, hi = edge_count;
+      while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (edges[mid].header <= start[t]) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      int around = lo;
+      if (around > 0 && reach[around - 1] >= start[t]) {
+        /* The first edge reaching the read has the outermost header */
+        lo = 0;
+        hi = around - 1;
+        while (lo < hi) {
+          int mid = (lo + hi) / 2;
+          if (reach[mid] >= start[t]) {
+            hi = mid;
+          } else {
+            lo = mid + 1;
+          }
+        }
+        start[t] = edges[lo].header;
+        if (reach[around - 1] > end[t]) {
+          end[t] = reach[around - 1];
+        }
+      }
+    }
+
+    for (;;) {
+      /* First edge with header > start, one past last with header <= end */
+      int lo = 0, hi = edge_count;
+      while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (edges[mid].header <= start[t]) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      int first = lo;
+      hi = edge_count;
+      while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (edges[mid].header <= end[t]) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      if (first >= lo) {
+        break;
+      }
+
+      int k = 0;
+      while ((2 << k) <= lo - first) {
+        k++;
+      }
+      int a = table[k][first];
+      int b = table[k][lo - (1 << k)];
+      int furthest = a > b ? a : b;
+      if (furthest <= end[t]) {
+        break;
+      }
+      end[t] = furthest;
+    }
+  }
+
+  for (int k = 0; k < levels; k++) {
+    free(table[k]);
+  }
+  free(table);
+  free(reach);
+}
+
+/**
+ * @brief Renumber temporaries so that ones with disjoint lifetimes share ids
+ */
+int tac_opt_recycle_temps(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  int temp_count = program->temp_count;
+  if (temp_count == 0) {
+    return 0;
+  }
+
+  int *start = (int *)safe_malloc(temp_count * sizeof(int));
+  int *end = (int *)safe_malloc(temp_count * sizeof(int));
+  bool *upward = (bool *)safe_malloc(temp_count * sizeof(bool));
+  for (int t = 0; t < temp_count; t++) {
+    start[t] = -1;
+    end[t] = -1;
+    upward[t] = false;
+  }
+
+  /* Live intervals over the instruction order; reads come before the write */
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    touch(inst->arg1, i, true, start, end, upward);
+    touch(inst->arg2, i, true, start, end, upward);
+    touch(inst->result, i, !tac_op_writes_result(inst->op), start, end,
+          upward);
+  }
+
+  int edge_count = 0;
+  BackEdge *edges = collect_back_edges(program, &edge_count);
+  widen_intervals(edges, edge_count, temp_count, start, end, upward);
+  free(edges);
+
+  /* Bucket temporaries by interval start (stable in original id order) */
+  int *bucket = (int *)safe_malloc((program->count + 1) * sizeof(int));
+  int *order = (int *)safe_malloc(temp_count * sizeof(int));
+  for (int i = 0; i <= program->count; i++) {
+    bucket[i] = 0;
+  }
+  for (int t = 0; t < temp_count; t++) {
+    if (start[t] >= 0) {
+      bucket[start[t] + 1]++;
+    }
+  }
+  for (int i = 0; i < program->count; i++) {
+    bucket[i + 1] += bucket[i];
+  }
+  int live_count = bucket[program->count];
+  for (int t = 0; t < temp_count; t++) {
+    if (start[t] >= 0) {
+      order[bucket[start[t]]++] = t;
+    }
+  }
+  free(bucket);
+
+  /* Greedy interval colouring: expire finished intervals, reuse lowest id */
+  int *new_id = (int *)safe_malloc(temp_count * sizeof(int));
+  IdHeap active = {(int *)safe_malloc(temp_count * sizeof(int)), 0, end};
+  IdHeap free_ids = {(int *)safe_malloc(temp_count * sizeof(int)), 0, NULL};
+  int next_id = 0;
+
+  for (int i = 0; i < live_count; i++) {
+    int t = order[i];
+    while (active.count > 0) {
+      int done = active.ids[0];
+      /* An operand read by the instruction that writes t may share its id */
+      if (end[done] > start[t] || (end[done] == start[t] && upward[t])) {
+        break;
+      }
+      heap_pop(&active);
+      heap_push(&free_ids, new_id[done]);
+    }
+    new_id[t] = free_ids.count > 0 ? heap_pop(&free_ids) : next_id++;
+    heap_push(&active, t);
+  }
+
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+    if (inst->result.kind == TAC_OPND_TEMP) {
+      inst->result.id = new_id[inst->result.id];
+    }
+    if (inst->arg1.kind == TAC_OPND_TEMP) {
+      inst->arg1.id = new_id[inst->arg1.id];
+    }
+    if (inst->arg2.kind == TAC_OPND_TEMP) {
+      inst->arg2.id = new_id[inst->arg2.id];
+    }
+  }
+  program->temp_count = next_id;
+
+  DEBUG_PRINT("Recycled %d temporaries into %d", temp_count, next_id);
+
+  free(start);
+  free(end);
+  free(upward);
+  free(order);
+  free(new_id);
+  free(active.ids);
+  free(free_ids.ids);
+  return next_id;
+}
@@ -0,0 +1,454 @@
+/**
+ * @file codegen/opt/unroll.c
+ * @brief Unrolling of counted loops
+ */
+
+#include "codegen/cfg.h"
+#include "codegen/dataflow.h"
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Like GCC's max-completely-peel-times and max-completely-peeled-insns:
+ * the longest and the largest loop unrolled completely */
+#define UNROLL_MAX_PEEL_TIMES 16
+#define UNROLL_MAX_PEELED_INSNS 200
+
+/* Like GCC's max-unrolled-insns: the largest body after partial unrolling */
+#define UNROLL_MAX_UNROLLED_INSNS 200
+
+/* Growth of the whole program allowed, in percent of its size (and at
+ * least UNROLL_MAX_PEELED_INSNS instructions) */
+#define UNROLL_MAX_GROWTH 50
+
+/* Tests, labels and bound computation added around the copies */
+#define UNROLL_PARTIAL_OVERHEAD 7
+
+/* Blocks followed back from a loop looking for the entry value */
+#define UNROLL_MAX_INIT_BLOCKS 8
+
+/**
+ * @brief Loop of one block counting an induction variable toward a bound
+ *
+ * The block is "Lh: body; if iv op bound goto Lh", where the body writes
+ * iv once, as iv := iv + step. The body runs at least once per entry, as
+ * in a loop rotated by tac_opt_rotate_loops().
+ */
+typedef struct CountedLoop {
+  int header;       /* The loop's only block */
+  int first;        /* First instruction of the body, after the labels */
+  int branch;       /* Closing conditional jump back to the header */
+  TACOperand iv;    /* Induction variable */
+  int step;         /* Added to iv once per iteration */
+  int step_at;      /* The instruction adding it */
+  bool step_alone;  /* Nothing else in the body reads iv or may trap, so
+                       the steps of several copies can be added at once */
+  TACOpType op;     /* The loop continues while iv op bound */
+  TACOperand bound; /* Constant, or a location the body does not write */
+  bool init_known;  /* iv holds init whenever the loop is entered */
+  int init;
+} CountedLoop;
+
+/**
+ * @brief Relation with its operands swapped: a op b iff b swapped a
+ */
+static TACOpType swap_relop(TACOpType op) {
+  switch (op) {
+  case TAC_OP_LT:
+    return TAC_OP_GT;
+  case TAC_OP_GT:
+    return TAC_OP_LT;
+  case TAC_OP_LE:
+    return TAC_OP_GE;
+  case TAC_OP_GE:
+    return TAC_OP_LE;
+  default:
+    return op;
+  }
+}
+
+/**
+ * @brief Whether instructions first .. last - 1 write an operand
+ */
+static bool body_writes(const TACProgram *program, int first, int last,
+                        TACOperand operand) {
+  for (int i = first; i < last; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (tac_op_writes_result(inst->op) &&
+        tac_operand_equals(inst->result, operand)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Whether an instruction may stop the program with an error
+ */
+static bool may_trap(const TACInst *inst) {
+  return inst->op == TAC_OP_DIV &&
+         (inst->arg2.kind != TAC_OPND_CONST || inst->arg2.value == 0);
+}
+
+/**
+ * @brief Step of iv in the body, or 0 unless iv is written exactly once,
+ * by iv := iv + c or iv := iv - c at *at
+ */
+static int body_step(const TACProgram *program, int first, int last,
+                     TACOperand iv, int *at) {
+  int step = 0;
+  int writes = 0;
+  for (int i = first; i < last; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (!tac_op_writes_result(inst->op) ||
+        !tac_operand_equals(inst->result, iv)) {
+      continue;
+    }
+    writes++;
+    *at = i;
+    TACOperand other = tac_none();
+    if (tac_operand_equals(inst->arg1, iv)) {
+      other = inst->arg2;
+    } else if (inst->op == TAC_OP_ADD && tac_operand_equals(inst->arg2, iv)) {
+      other = inst->arg1;
+    }
+    if (other.kind != TAC_OPND_CONST) {
+      return 0;
+    }
+    if (inst->op == TAC_OP_ADD) {
+      step = other.value;
+    } else if (inst->op == TAC_OP_SUB && other.value != INT_MIN) {
+      step = -other.value;
+    } else {
+      return 0;
+    }
+  }
+  return writes == 1 ? step : 0;
+}
+
+/**
+ * @brief Value iv has on entry, when the loop is entered from one block
+ * and following single predecessors back from there leads to a constant
+ * assignment (or to the start of the program, where it is zero)
+ */
+static void find_init(const TACProgram *program, const CFG *cfg,
+                      CountedLoop *loop) {
+  int h = loop->header;
+  loop->init_known = false;
+  int b = -1;
+  for (int k = cfg->pred_offset[h]; k < cfg->pred_offset[h + 1]; k++) {
+    if (cfg->pred[k] != h) {
+      if (b >= 0) {
+        return;
+      }
+      b = cfg->pred[k];
+    }
+  }
+
+  for (int steps = 0; b >= 0 && steps < UNROLL_MAX_INIT_BLOCKS; steps++) {
+    for (int i = cfg->block_start[b + 1] - 1; i >= cfg->block_start[b]; i--) {
+      const TACInst *inst = &program->instructions[i];
+      if (tac_op_writes_result(inst->op) &&
+          tac_operand_equals(inst->result, loop->iv)) {
+        if (inst->op == TAC_OP_ASSIGN && inst->arg1.kind == TAC_OPND_CONST) {
+          loop->init_known = true;
+          loop->init = inst->arg1.value;
+        }
+        return;
+      }
+    }
+    int preds = cfg->pred_offset[b + 1] - cfg->pred_offset[b];
+    if (b == 0 && preds == 0) {
+      loop->init_known = true;
+      loop->init = 0;
+      return;
+    }
+    b = preds == 1 ? cfg->pred[cfg->pred_offset[b]] : -1;
+  }
+}
+
+/**
+ * @brief Recognize loop l as a counted loop
+ */
+static bool find_counted_loop(const TACProgram *program, const CFG *cfg,
+                              int l, CountedLoop *loop) {
+  if (cfg->loop_offset[l + 1] - cfg->loop_offset[l] != 1) {
+    return false;
+  }
+  int h = cfg->loop_header[l];
+  int first = cfg->block_start[h];
+  int last = cfg->block_start[h + 1] - 1;
+  while (first < last && program->instructions[first].op == TAC_OP_LABEL) {
+    first++;
+  }
+  const TACInst *branch = &program->instructions[last];
+  if (first >= last || last - first > UNROLL_MAX_UNROLLED_INSNS / 2 ||
+      !tac_op_is_cond_jump(branch->op) ||
+      cfg->label_block[branch->result.id] != h) {
+    return false;
+  }
+  for (int i = first; i < last; i++) {
+    if (!tac_op_writes_result(program->instructions[i].op)) {
+      return false;
+    }
+  }
+
+  /* Put the induction variable first in the test */
+  bool first_written =
+      dataflow_location(program, branch->arg1) >= 0 &&
+      body_writes(program, first, last, branch->arg1);
+  loop->iv = first_written ? branch->arg1 : branch->arg2;
+  loop->bound = first_written ? branch->arg2 : branch->arg1;
+  loop->op = first_written ? branch->op : swap_relop(branch->op);
+  if (dataflow_location(program, loop->iv) < 0 ||
+      (loop->bound.kind != TAC_OPND_CONST &&
+       body_writes(program, first, last, loop->bound))) {
+    return false;
+  }
+  loop->step = body_step(program, first, last, loop->iv, &loop->step_at);
+  if (loop->step == 0) {
+    return false;
+  }
+  loop->step_alone = true;
+  for (int i = first; i < last; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (i != loop->step_at && (may_trap(inst) ||
+                               tac_operand_equals(inst->arg1, loop->iv) ||
+                               tac_operand_equals(inst->arg2, loop->iv))) {
+      loop->step_alone = false;
+    }
+  }
+
+  loop->header = h;
+  loop->first = first;
+  loop->branch = last;
+  find_init(program, cfg, loop);
+  return true;
+}
+
+/**
+ * @brief Iterations of a loop with known entry value and constant bound,
+ * or -1 if there are more than limit
+ */
+static int trip_count(const CountedLoop *loop, int limit) {
+  unsigned int value = (unsigned int)loop->init;
+  for (int trips = 1; trips <= limit; trips++) {
+    value += (unsigned int)loop->step;
+    if (!tac_eval_relop(loop->op, (int)value, loop->bound.value)) {
+      return trips;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Whether iv moves monotonically toward the bound, so that when
+ * iv op (bound - (factor - 1) * step) the next factor tests all pass
+ */
+static bool is_monotonic(const CountedLoop *loop) {
+  if (loop->step > 0) {
+    return loop->op == TAC_OP_LT || loop->op == TAC_OP_LE;
+  }
+  return loop->op == TAC_OP_GT || loop->op == TAC_OP_GE;
+}
+
+/**
+ * @brief Label starting block b, or at the end of the program when b is
+ * past the last block, recording an insertion if there is none
+ */
+static TACOperand block_label(TACProgram *program, const CFG *cfg, int b,
+                              TACEditList *edits) {
+  int at = b < cfg->block_count ? cfg->block_start[b] : program->count;
+  if (at < program->count && program->instructions[at].op == TAC_OP_LABEL) {
+    return program->instructions[at].result;
+  }
+  TACOperand label = tac_program_new_label(program);
+  int lineno = program->instructions[at - 1].lineno;
+  TACInst inst = {TAC_OP_LABEL, label, tac_none(), tac_none(), lineno};
+  tac_edit_insert(edits, at, inst);
+  return label;
+}
+
+static void insert_inst(TACEditList *edits, int at, TACOpType op,
+                        TACOperand result, TACOperand arg1, TACOperand arg2,
+                        int lineno) {
+  TACInst inst = {op, result, arg1, arg2, lineno};
+  tac_edit_insert(edits, at, inst);
+}
+
+/**
+ * @brief Insert copies of the body at its start
+ *
+ * When the step can be taken at once, the copies leave out their
+ * increments and one iv := iv + copies * step follows them; wrapping
+ * arithmetic makes this exact.
+ */
+static void insert_body(const TACProgram *program, const CountedLoop *loop,
+                        int copies, TACEditList *edits) {
+  bool merge = loop->step_alone && copies > 1;
+  for (int c = 0; c < copies; c++) {
+    for (int i = loop->first; i < loop->branch; i++) {
+      if (!merge || i != loop->step_at) {
+        tac_edit_insert(edits, loop->first, program->instructions[i]);
+      }
+    }
+  }
+  if (merge) {
+    unsigned int total = (unsigned int)copies * (unsigned int)loop->step;
+    insert_inst(edits, loop->first, TAC_OP_ADD, loop->iv, loop->iv,
+                tac_const((int)total),
+                program->instructions[loop->step_at].lineno);
+  }
+}
+
+/**
+ * @brief Replace the loop by trips copies of its body
+ *
+ * The copies start by restating the known entry value, so that local
+ * constant folding can run through them.
+ */
+static void unroll_completely(const TACProgram *program,
+                              const CountedLoop *loop, int trips,
+                              TACEditList *edits) {
+  insert_inst(edits, loop->first, TAC_OP_ASSIGN, loop->iv,
+              tac_const(loop->init), tac_none(),
+              program->instructions[loop->first].lineno);
+  insert_body(program, loop, trips, edits);
+  for (int i = loop->first; i <= loop->branch; i++) {
+    tac_edit_remove(edits, i);
+  }
+}
+
+/**
+ * @brief Unroll the loop by factor, leaving the original as remainder loop
+ *
+ *     Lh: if !(iv op M) goto Lrem      M = bound - (factor - 1) * step
+ *     Lu: body x factor
+ *         if iv op M goto Lu
+ *         if !(iv op bound) goto Lexit
+ *   Lrem: body
+ *         if iv op bound goto Lrem
+ *  Lexit:
+ *
+ * A chunk only starts while iv op M, which guarantees that the tests it
+ * drops would all have continued the loop. A bound held in a location
+ * gets M computed on entry, after checking it cannot overflow.
+ *
+ * @return bool false if M does not fit in an int
+ */
+static bool unroll_partially(TACProgram *program, const CFG *cfg,
+                             const CountedLoop *loop, int factor,
+                             TACEditList *edits) {
+  long long distance = (long long)(factor - 1) * loop->step;
+  if (distance > INT_MAX || distance < -(long long)INT_MAX) {
+    return false;
+  }
+  int at = loop->first;
+  int lineno = program->instructions[loop->branch].lineno;
+  TACOpType stop = tac_op_negate_relop(loop->op);
+  TACOperand remainder = tac_program_new_label(program);
+  TACOperand chunk = tac_program_new_label(program);
+  TACOperand limit;
+
+  if (loop->bound.kind == TAC_OPND_CONST) {
+    long long m = (long long)loop->bound.value - distance;
+    if (m < INT_MIN || m > INT_MAX) {
+      return false;
+    }
+    limit = tac_const((int)m);
+  } else {
+    /* bound - distance must not wrap around */
+    long long edge = loop->step > 0 ? INT_MIN + distance : INT_MAX + distance;
+    insert_inst(edits, at, loop->step > 0 ? TAC_OP_LT : TAC_OP_GT, remainder,
+                loop->bound, tac_const((int)edge), lineno);
+    limit = tac_program_new_temp(program);
+    insert_inst(edits, at, TAC_OP_SUB, limit, loop->bound,
+                tac_const((int)distance), lineno);
+  }
+
+  TACOperand exit = block_label(program, cfg, loop->header + 1, edits);
+  insert_inst(edits, at, stop, remainder, loop->iv, limit, lineno);
+  insert_inst(edits, at, TAC_OP_LABEL, chunk, tac_none(), tac_none(), lineno);
+  insert_body(program, loop, factor, edits);
+  insert_inst(edits, at, loop->op, chunk, loop->iv, limit, lineno);
+  insert_inst(edits, at, stop, exit, loop->iv, loop->bound, lineno);
+  insert_inst(edits, at, TAC_OP_LABEL, remainder, tac_none(), tac_none(),
+              lineno);
+  insert_body(program, loop, 1, edits);
+  insert_inst(edits, at, loop->op, remainder, loop->iv, loop->bound, lineno);
+  for (int i = loop->first; i <= loop->branch; i++) {
+    tac_edit_remove(edits, i);
+  }
+  return true;
+}
+
+/**
+ * @brief Unroll counted loops completely or by a factor
+ */
+int tac_opt_unroll_loops(TACProgram *program, int factor) {
+  if (!program) {
+    return -1;
+  }
+
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    return 0;
+  }
+
+  int budget = program->count / 100 * UNROLL_MAX_GROWTH;
+  if (budget < UNROLL_MAX_PEELED_INSNS) {
+    budget = UNROLL_MAX_PEELED_INSNS;
+  }
+  int complete = 0;
+  int partial = 0;
+  int growth = 0;
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+
+  for (int l = 0; l < cfg->loop_count; l++) {
+    CountedLoop loop;
+    if (!find_counted_loop(program, cfg, l, &loop)) {
+      continue;
+    }
+    int size = loop.branch - loop.first;
+    int trips = -1;
+    if (loop.init_known && loop.bound.kind == TAC_OPND_CONST) {
+      trips = trip_count(&loop, UNROLL_MAX_PEEL_TIMES);
+    }
+
+    if (trips > 0 && trips * size <= UNROLL_MAX_PEELED_INSNS &&
+        growth + (trips - 1) * size <= budget) {
+      unroll_completely(program, &loop, trips, &edits);
+      growth += (trips - 1) * size;
+      complete++;
+      continue;
+    }
+
+    int f = factor;
+    if (f * size > UNROLL_MAX_UNROLLED_INSNS) {
+      f = UNROLL_MAX_UNROLLED_INSNS / size;
+    }
+    /* A loop with a small known trip count that was too large to unroll
+     * completely would rarely run a whole chunk */
+    int added = f * size + UNROLL_PARTIAL_OVERHEAD;
+    if (f < 2 || trips > 0 || !is_monotonic(&loop) ||
+        growth + added > budget) {
+      continue;
+    }
+    if (unroll_partially(program, cfg, &loop, f, &edits)) {
+      growth += added;
+      partial++;
+    }
+  }
+
+  DEBUG_PRINT("Unrolled %d loops completely and %d by up to %d (%d "
+              "instructions added)",
+              complete, partial, factor, growth);
+
+  bool ok = tac_program_apply_edits(program, &edits);
+  tac_edit_list_free(&edits);
+  cfg_destroy(cfg);
+  return ok ? complete + partial : -1;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file codegen/opt/value_numbering.c
+ * @brief Local value numbering
+ */
+
+#include "codegen/tac_opt.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Pseudo-operation keying constants in the expression table */
+#define VN_CONST_KEY (-1)
+
+/**
+ * @brief Expression table slot: (op, vn1, vn2) -> vn
+ */
+typedef struct VNSlot {
+  int stamp; /* Block number the slot was filled in, or -1 */
+  int op;    /* Operation, or VN_CONST_KEY for a constant */
+  int arg1;  /* Value number of the first argument, or the constant */
+  int arg2;  /* Value number of the second argument */
+  int vn;    /* Value number of the expression */
+} VNSlot;
+
+/**
+ * @brief Value numbering state for the current basic block
+ *
+ * Every table is stamped with the block it was written in, so moving to
+ * the next block forgets all values without clearing anything.
+ */
+typedef struct VNState {
+  VNSlot *slots;   /* Open-addressing expression table */
+  unsigned int mask;
+  int *var_vn;     /* Value number held by each variable */
+  int *var_stamp;  /* Block the variable's number was assigned in */
+  int *temp_vn;    /* Value number held by each temporary */
+  int *temp_stamp; /* Block the temporary's number was assigned in */
+  TACOperand *home; /* A location that held each value when it was made */
+  int next_vn;     /* Next unused value number */
+  int block;       /* Current block number */
+} VNState;
+
+static unsigned int hash_key(int op, int arg1, int arg2) {
+  unsigned int h = (unsigned int)op * 0x9e3779b1u;
+  h ^= (unsigned int)arg1 + 0x7f4a7c15u + (h << 6) + (h >> 2);
+  h ^= (unsigned int)arg2 + 0x7f4a7c15u + (h << 6) + (h >> 2);
+  return h;
+}
+
+/**
+ * @brief Find the value number of a key, or enter a fresh one
+ *
+ * @param found Set to whether the key was already in the table
+ */
+static int lookup_key(VNState *state, int op, int arg1, int arg2,
+                      bool *found) {
+  unsigned int slot = hash_key(op, arg1, arg2) & state->mask;
+  for (;; slot = (slot + 1) & state->mask) {
+    VNSlot *entry = &state->slots[slot];
+    if (entry->stamp != state->block) {
+      entry->stamp = state->block;
+      entry->op = op;
+      entry->arg1 = arg1;
+      entry->arg2 = arg2;
+      entry->vn = state->next_vn++;
+      *found = false;
+      return entry->vn;
+    }
+    if (entry->op == op && entry->arg1 == arg1 && entry->arg2 == arg2) {
+      *found = true;
+      return entry->vn;
+    }
+  }
+}
+
+static int *vn_slot(VNState *state, TACOperand operand, int **stamp) {
+  if (operand.kind == TAC_OPND_VAR) {
+    *stamp = &state->var_stamp[operand.id];
+    return &state->var_vn[operand.id];
+  }
+  *stamp = &state->temp_stamp[operand.id];
+  return &state->temp_vn[operand.id];
+}
+
+/**
+ * @brief Value number of an operand, numbering it on first sight
+ */
+static int operand_vn(VNState *state, TACOperand operand) {
+  if (operand.kind == TAC_OPND_CONST) {
+    bool found;
+    int vn = lookup_key(state, VN_CONST_KEY, operand.value, 0, &found);
+    state->home[vn] = operand;
+    return vn;
+  }
+
+  int *stamp;
+  int *vn = vn_slot(state, operand, &stamp);
+  if (*stamp != state->block) {
+    *stamp = state->block;
+    *vn = state->next_vn++;
+    state->home[*vn] = operand;
+  }
+  return *vn;
+}
+
+/**
+ * @brief Bind a written location to a value number
+ */
+static void assign_vn(VNState *state, TACOperand operand, int vn) {
+  int *stamp;
+  int *slot = vn_slot(state, operand, &stamp);
+  *stamp = state->block;
+  *slot = vn;
+}
+
+/**
+ * @brief Check whether the recorded home of a value still holds it
+ */
+static bool home_valid(VNState *state, int vn) {
+  TACOperand home = state->home[vn];
+  if (home.kind == TAC_OPND_CONST) {
+    return true;
+  }
+  if (home.kind != TAC_OPND_VAR && home.kind != TAC_OPND_TEMP) {
+    return false;
+  }
+  int *stamp;
+  int *slot = vn_slot(state, home, &stamp);
+  return *stamp == state->block && *slot == vn;
+}
+
+/**
+ * @brief Replace recomputed expressions within basic blocks by copies
+ */
+int tac_opt_value_numbering(TACProgram *program) {
+  if (!program) {
+    return -1;
+  }
+
+  /* Size the expression table for the longest block */
+  int longest = 0;
+  int length = 0;
+  for (int i = 0; i < program->count; i++) {
+    TACOpType op = program->instructions[i].op;
+    if (op == TAC_OP_LABEL) {
+      length = 0;
+    } else if (++length > longest) {
+      longest = length;
+    }
+    if (tac_op_is_jump(op)) {
+      length = 0;
+    }
+  }
+
+  /* Each instruction numbers at most three new values */
+  unsigned int slot_count = 16;
+  while (slot_count < (unsigned int)longest * 6) {
+    slot_count *= 2;
+  }
+
+  VNState state;
+  state.slots = (VNSlot *)safe_malloc(slot_count * sizeof(VNSlot));
+  state.mask = slot_count - 1;
+  state.var_vn = (int *)safe_malloc((program->var_count + 1) * sizeof(int));
+  state.var_stamp = (int *)safe_malloc((program->var_count + 1) * sizeof(int));
+  state.temp_vn = (int *)safe_malloc((program->temp_count + 1) * sizeof(int));
+  state.temp_stamp =
+      (int *)safe_malloc((program->temp_count + 1) * sizeof(int));
+  state.home =
+      (TACOperand *)safe_malloc(((size_t)longest * 3 + 1) * sizeof(TACOperand));
+  state.next_vn = 0;
+  state.block = 0;
+  for (unsigned int i = 0; i < slot_count; i++) {
+    state.slots[i].stamp = -1;
+  }
+  memset(state.var_stamp, 0xff, (program->var_count + 1) * sizeof(int));
+  memset(state.temp_stamp, 0xff, (program->temp_count + 1) * sizeof(int));
+
+  int changes = 0;
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+
+    if (inst->op == TAC_OP_LABEL || tac_op_is_jump(inst->op)) {
+      /* Blocks end at jumps and start at labels */
+      state.block++;
+      /* Numbers are only compared within a block, so recycle them */
+      state.next_vn = 0;
+      continue;
+    }
+    if (!tac_op_writes_result(inst->op)) {
+      continue;
+    }
+
+    if (inst->op == TAC_OP_ASSIGN) {
+      int vn = operand_vn(&state, inst->arg1);
+      assign_vn(&state, inst->result, vn);
+      continue;
+    }
+
+    int vn1 = operand_vn(&state, inst->arg1);
+    int vn2 = tac_op_is_unary(inst->op) ? -1 : operand_vn(&state, inst->arg2);
+    if ((inst->op == TAC_OP_ADD || inst->op == TAC_OP_MUL) && vn1 > vn2) {
+      int swap = vn1;
+      vn1 = vn2;
+      vn2 = swap;
+    }
+
+    bool found;
+    int vn = lookup_key(&state, inst->op, vn1, vn2, &found);
+    if (found && home_valid(&state, vn)) {
+      inst->op = TAC_OP_ASSIGN;
+      inst->arg1 = state.home[vn];
+      inst->arg2 = tac_none();
+      changes++;
+    } else {
+      state.home[vn] = inst->result;
+    }
+
+    /* Writing the result kills whatever value it held before */
+    assign_vn(&state, inst->result, vn);
+  }
+
+  DEBUG_PRINT("Value numbering replaced %d expressions", changes);
+
+  free(state.slots);
+  free(state.var_vn);
+  free(state.var_stamp);
+  free(state.temp_vn);
+  free(state.temp_stamp);
+  free(state.home);
+  return changes;
+}
@@ -0,0 +1,466 @@
+/**
+ * @file codegen/regalloc.c
+ * @brief Linear-scan register allocation over TAC locations
+ */
+
+#include "codegen/regalloc.h"
+#include "codegen/dataflow.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Largest liveness solution, in bits, solved for the intervals; larger
+ * programs get conservative intervals from the loop structure */
+#define REGALLOC_MAX_BITS ((size_t)1 << 30)
+
+/**
+ * @brief Grow the interval of a location to cover a position
+ */
+static void extend(RegAllocation *alloc, int loc, int position) {
+  if (alloc->start[loc] < 0 || position < alloc->start[loc]) {
+    alloc->start[loc] = position;
+  }
+  if (position > alloc->end[loc]) {
+    alloc->end[loc] = position;
+  }
+}
+
+/**
+ * @brief Extend intervals over every location live on a block boundary
+ */
+static void extend_live(RegAllocation *alloc, const DataflowResult *live,
+                        const BitWord *set, int position) {
+  for (int bit = bitset_next(set, 0, live->bits); bit >= 0;
+       bit = bitset_next(set, bit + 1, live->bits)) {
+    extend(alloc, live->bit_item[bit], position);
+  }
+}
+
+/**
+ * @brief Collect the locations an instruction reads
+ */
+static int read_locations(const TACProgram *program, const TACInst *inst,
+                          int *reads) {
+  int count = 0;
+  int loc = dataflow_location(program, inst->arg1);
+  if (loc >= 0) {
+    reads[count++] = loc;
+  }
+  loc = dataflow_location(program, inst->arg2);
+  if (loc >= 0) {
+    reads[count++] = loc;
+  }
+  loc = dataflow_location(program, inst->result);
+  if (loc >= 0 && !tac_op_writes_result(inst->op)) {
+    reads[count++] = loc;
+  }
+  return count;
+}
+
+/**
+ * @brief Location an instruction writes, or -1
+ */
+static int written_location(const TACProgram *program, const TACInst *inst) {
+  return tac_op_writes_result(inst->op)
+             ? dataflow_location(program, inst->result)
+             : -1;
+}
+
+/**
+ * @brief Cover every read and write in reachable code, and mark the
+ * locations read in some block before being written there
+ *
+ * Only marked locations can be live across a block boundary; the interval
+ * of any other location is exactly the span of its occurrences.
+ *
+ * @return int Number of marked locations
+ */
+static int cover_occurrences(RegAllocation *alloc, const TACProgram *program,
+                             const CFG *cfg, char *exposed) {
+  int *written = (int *)safe_malloc(((size_t)alloc->location_count + 1) *
+                                    sizeof(int));
+  memset(written, 0xff, ((size_t)alloc->location_count + 1) * sizeof(int));
+  int count = 0;
+
+  for (int b = 0; b < cfg->block_count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue; /* Unreachable code never runs, its operands need no home */
+    }
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      const TACInst *inst = &program->instructions[i];
+      int reads[3];
+      int n = read_locations(program, inst, reads);
+      for (int k = 0; k < n; k++) {
+        extend(alloc, reads[k], 2 * i);
+        if (written[reads[k]] != b && !exposed[reads[k]]) {
+          exposed[reads[k]] = 1;
+          count++;
+        }
+      }
+      int loc = written_location(program, inst);
+      if (loc >= 0) {
+        extend(alloc, loc, 2 * i + 1);
+        written[loc] = b;
+      }
+    }
+  }
+
+  free(written);
+  return count;
+}
+
+/**
+ * @brief Extend intervals over the blocks where locations are live
+ */
+static bool liveness_intervals(RegAllocation *alloc, const TACProgram *program,
+                               const CFG *cfg) {
+  DataflowResult *live = dataflow_liveness(program, cfg, false);
+  if (!live) {
+    return false;
+  }
+
+  BitWord *set =
+      (BitWord *)safe_malloc(((size_t)live->words + 1) * sizeof(BitWord));
+  for (int b = 0; b < cfg->block_count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue;
+    }
+    dataflow_in(live, b, set);
+    extend_live(alloc, live, set, 2 * cfg->block_start[b]);
+    dataflow_out(live, b, set);
+    extend_live(alloc, live, set, 2 * cfg->block_start[b + 1] - 1);
+  }
+
+  free(set);
+  dataflow_result_destroy(live);
+  return true;
+}
+
+/**
+ * @brief Check that every jump to an earlier or the same block is a loop
+ * back edge
+ *
+ * Then a location live somewhere outside the span of its occurrences can
+ * only be carried there around a loop, which structural_intervals() relies
+ * on. Code generated from structured statements always qualifies.
+ */
+static bool backward_jumps_are_loops(const CFG *cfg) {
+  for (int b = 0; b < cfg->block_count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue;
+    }
+    for (int k = cfg->succ_offset[b]; k < cfg->succ_offset[b + 1]; k++) {
+      int s = cfg->succ[k];
+      if (s <= b && !cfg_dominates(cfg, s, b)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Order [first, last] pairs by first position
+ */
+static int compare_spans(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Merge the position spans of all loops into disjoint components
+ *
+ * @return int Number of components, stored as [first, last] pairs
+ */
+static int loop_components(const CFG *cfg, int *span) {
+  int count = 0;
+  for (int l = 0; l < cfg->loop_count; l++) {
+    int first = -1;
+    int last = -1;
+    for (int k = cfg->loop_offset[l]; k < cfg->loop_offset[l + 1]; k++) {
+      int b = cfg->loop_blocks[k];
+      if (first < 0 || 2 * cfg->block_start[b] < first) {
+        first = 2 * cfg->block_start[b];
+      }
+      if (2 * cfg->block_start[b + 1] - 1 > last) {
+        last = 2 * cfg->block_start[b + 1] - 1;
+      }
+    }
+    span[2 * count] = first;
+    span[2 * count + 1] = last;
+    count++;
+  }
+
+  qsort(span, (size_t)count, 2 * sizeof(int), compare_spans);
+
+  int merged = 0;
+  for (int i = 0; i < count; i++) {
+    if (merged > 0 && span[2 * i] <= span[2 * merged - 1]) {
+      if (span[2 * i + 1] > span[2 * merged - 1]) {
+        span[2 * merged - 1] = span[2 * i + 1];
+      }
+    } else {
+      span[2 * merged] = span[2 * i];
+      span[2 * merged + 1] = span[2 * i + 1];
+      merged++;
+    }
+  }
+  return merged;
+}
+
+/**
+ * @brief Find the component containing a position
+ *
+ * @return int Component index, or -1
+ */
+static int find_component(const int *span, int count, int position) {
+  int lo = 0;
+  int hi = count - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (position < span[2 * mid]) {
+      hi = mid - 1;
+    } else if (position > span[2 * mid + 1]) {
+      lo = mid + 1;
+    } else {
+      return mid;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Mark the locations some read may see before any write
+ *
+ * A read is covered when the first write in program order precedes it in
+ * the same block or dominates its block; other reads may see the initial
+ * zero.
+ */
+static char *find_read_at_entry(const TACProgram *program, const CFG *cfg,
+                                int locations) {
+  int *first_write = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  int *first_block = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  memset(first_write, 0xff, ((size_t)locations + 1) * sizeof(int));
+  for (int b = 0; b < cfg->block_count; b++) {
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      int loc = written_location(program, &program->instructions[i]);
+      if (loc >= 0 && first_write[loc] < 0) {
+        first_write[loc] = i;
+        first_block[loc] = b;
+      }
+    }
+  }
+
+  char *entry = (char *)safe_malloc((size_t)locations + 1);
+  memset(entry, 0, (size_t)locations + 1);
+  for (int b = 0; b < cfg->block_count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue;
+    }
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      int reads[3];
+      int n = read_locations(program, &program->instructions[i], reads);
+      for (int k = 0; k < n; k++) {
+        int loc = reads[k];
+        int w = first_write[loc];
+        bool covered = w >= 0 && (first_block[loc] == b
+                                      ? w < i
+                                      : cfg_dominates(cfg, first_block[loc],
+                                                      b));
+        if (!covered) {
+          entry[loc] = 1;
+        }
+      }
+    }
+  }
+
+  free(first_write);
+  free(first_block);
+  return entry;
+}
+
+/**
+ * @brief Conservative intervals for locations live across blocks, without
+ * solving liveness
+ *
+ * A location live outside the span of its occurrences is carried there
+ * around loops, so the span is widened over every group of overlapping loop
+ * spans it touches, and back to the entry if a read may see the initial
+ * zero. If the layout does not allow this reasoning, such locations are
+ * left in memory.
+ */
+static void structural_intervals(RegAllocation *alloc,
+                                 const TACProgram *program, const CFG *cfg,
+                                 const char *exposed) {
+  int locations = alloc->location_count;
+  if (!backward_jumps_are_loops(cfg)) {
+    for (int l = 0; l < locations; l++) {
+      if (exposed[l]) {
+        alloc->start[l] = alloc->end[l] = -1;
+      }
+    }
+    return;
+  }
+
+  int *span = (int *)safe_malloc(((size_t)cfg->loop_count + 1) * 2 *
+                                 sizeof(int));
+  int components = loop_components(cfg, span);
+  char *entry = find_read_at_entry(program, cfg, locations);
+  for (int l = 0; l < locations; l++) {
+    if (!exposed[l] || alloc->start[l] < 0) {
+      continue;
+    }
+    if (entry[l]) {
+      alloc->start[l] = 0;
+    }
+    int c = find_component(span, components, alloc->start[l]);
+    if (c >= 0) {
+      alloc->start[l] = span[2 * c];
+    }
+    c = find_component(span, components, alloc->end[l]);
+    if (c >= 0) {
+      alloc->end[l] = span[2 * c + 1];
+    }
+  }
+  free(span);
+  free(entry);
+}
+
+/**
+ * @brief Compute the live interval of every location
+ *
+ * Liveness is solved as a dense bit-vector problem when its solution fits
+ * the budget; larger programs use structural_intervals().
+ */
+static bool build_intervals(RegAllocation *alloc, const TACProgram *program,
+                            const CFG *cfg) {
+  char *exposed = (char *)safe_malloc((size_t)alloc->location_count + 1);
+  memset(exposed, 0, (size_t)alloc->location_count + 1);
+  int tracked = cover_occurrences(alloc, program, cfg, exposed);
+
+  bool ok = true;
+  if ((size_t)tracked * (size_t)cfg->block_count <= REGALLOC_MAX_BITS) {
+    ok = liveness_intervals(alloc, program, cfg);
+  } else {
+    DEBUG_PRINT("Liveness skipped: %d locations x %d blocks", tracked,
+                cfg->block_count);
+    structural_intervals(alloc, program, cfg, exposed);
+  }
+  free(exposed);
+  return ok;
+}
+
+/**
+ * @brief Assign registers by linear scan
+ */
+RegAllocation *regalloc_linear_scan(const TACProgram *program, const CFG *cfg,
+                                    int registers) {
+  if (!program || !cfg || registers < 0) {
+    return NULL;
+  }
+
+  RegAllocation *alloc = (RegAllocation *)safe_malloc(sizeof(RegAllocation));
+  memset(alloc, 0, sizeof(*alloc));
+  int locations = dataflow_location_count(program);
+  alloc->location_count = locations;
+  alloc->register_count = registers;
+  alloc->reg = alloc_ints(locations);
+  alloc->start = alloc_ints(locations);
+  alloc->end = alloc_ints(locations);
+  if (!build_intervals(alloc, program, cfg)) {
+    regalloc_destroy(alloc);
+    return NULL;
+  }
+
+  /* Counting sort of the intervals by start position */
+  int positions = 2 * program->count + 1;
+  int *offset = (int *)safe_malloc(((size_t)positions + 1) * sizeof(int));
+  memset(offset, 0, ((size_t)positions + 1) * sizeof(int));
+  for (int l = 0; l < locations; l++) {
+    if (alloc->start[l] >= 0) {
+      offset[alloc->start[l] + 1]++;
+      alloc->intervals++;
+    }
+  }
+  for (int p = 0; p < positions; p++) {
+    offset[p + 1] += offset[p];
+  }
+  int *order = alloc_ints(alloc->intervals);
+  for (int l = 0; l < locations; l++) {
+    if (alloc->start[l] >= 0) {
+      order[offset[alloc->start[l]]++] = l;
+    }
+  }
+  free(offset);
+
+  /* Active intervals, one per busy register */
+  int *active = alloc_ints(registers);
+  bool *used = (bool *)safe_malloc((size_t)registers + 1);
+  memset(used, 0, (size_t)registers + 1);
+
+  for (int k = 0; k < alloc->intervals; k++) {
+    int l = order[k];
+    int free_reg = -1;
+    int furthest = -1;
+    for (int r = 0; r < registers; r++) {
+      if (active[r] >= 0 && alloc->end[active[r]] < alloc->start[l]) {
+        active[r] = -1; /* Expired */
+      }
+      if (active[r] < 0) {
+        if (free_reg < 0) {
+          free_reg = r;
+        }
+      } else if (furthest < 0 || alloc->end[active[r]] >
+                                     alloc->end[active[furthest]]) {
+        furthest = r;
+      }
+    }
+
+    if (free_reg < 0 && furthest >= 0 &&
+        alloc->end[active[furthest]] > alloc->end[l]) {
+      alloc->reg[active[furthest]] = -1;
+      alloc->spilled++;
+      free_reg = furthest;
+    }
+    if (free_reg < 0) {
+      alloc->spilled++;
+      continue;
+    }
+    active[free_reg] = l;
+    alloc->reg[l] = free_reg;
+    if (!used[free_reg]) {
+      used[free_reg] = true;
+      alloc->registers_used++;
+    }
+  }
+
+  DEBUG_PRINT("Linear scan: %d intervals, %d spilled, %d registers",
+              alloc->intervals, alloc->spilled, alloc->registers_used);
+  free(order);
+  free(active);
+  free(used);
+  return alloc;
+}
+
+/**
+ * @brief Get the register of an operand
+ */
+int regalloc_register(const RegAllocation *alloc, const TACProgram *program,
+                      TACOperand operand) {
+  int loc = dataflow_location(program, operand);
+  return loc >= 0 ? alloc->reg[loc] : -1;
+}
+
+/**
+ * @brief Free a register assignment
+ */
+void regalloc_destroy(RegAllocation *alloc) {
+  if (!alloc) {
+    return;
+  }
+  free(alloc->reg);
+  free(alloc->start);
+  free(alloc->end);
+  free(alloc);
+}
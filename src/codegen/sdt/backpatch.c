@@ -0,0 +1,84 @@
+/**
+ * @file codegen/sdt/backpatch.c
+ * @brief Implementation of the lists of jumps whose targets are filled in
+ * later
+ */
+
+#include "backpatch.h"
+#include "utils.h"
+#include <stdlib.h>
+
+/**
+ * @brief Create an empty pool of jump lists
+ */
+JumpLists *jump_lists_create(void) {
+  JumpLists *lists = (JumpLists *)safe_malloc(sizeof(JumpLists));
+  lists->capacity = 64;
+  lists->count = 0;
+  lists->inst = (int *)safe_malloc(lists->capacity * sizeof(int));
+  lists->next = (int *)safe_malloc(lists->capacity * sizeof(int));
+  lists->tail = (int *)safe_malloc(lists->capacity * sizeof(int));
+  return lists;
+}
+
+/**
+ * @brief Free a pool of jump lists
+ */
+void jump_lists_destroy(JumpLists *lists) {
+  if (!lists) {
+    return;
+  }
+
+  free(lists->inst);
+  free(lists->next);
+  free(lists->tail);
+  free(lists);
+}
+
+/**
+ * @brief Make a list holding one jump
+ */
+int jump_list_make(JumpLists *lists, int inst) {
+  if (lists->count == lists->capacity) {
+    lists->capacity *= 2;
+    lists->inst =
+        (int *)safe_realloc(lists->inst, lists->capacity * sizeof(int));
+    lists->next =
+        (int *)safe_realloc(lists->next, lists->capacity * sizeof(int));
+    lists->tail =
+        (int *)safe_realloc(lists->tail, lists->capacity * sizeof(int));
+  }
+
+  int entry = lists->count++;
+  lists->inst[entry] = inst;
+  lists->next[entry] = JUMP_LIST_EMPTY;
+  lists->tail[entry] = entry;
+  return entry;
+}
+
+/**
+ * @brief Concatenate two lists in constant time
+ */
+int jump_list_merge(JumpLists *lists, int a, int b) {
+  if (a == JUMP_LIST_EMPTY) {
+    return b;
+  }
+  if (b == JUMP_LIST_EMPTY) {
+    return a;
+  }
+
+  lists->next[lists->tail[a]] = b;
+  lists->tail[a] = lists->tail[b];
+  return a;
+}
+
+/**
+ * @brief Set the target of every jump of a list
+ */
+void jump_list_backpatch(const JumpLists *lists, TACProgram *program,
+                         int list, int label) {
+  for (int entry = list; entry != JUMP_LIST_EMPTY;
+       entry = lists->next[entry]) {
+    program->instructions[lists->inst[entry]].result = tac_label(label);
+  }
+}
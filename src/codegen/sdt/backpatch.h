@@ -0,0 +1,73 @@
+/**
+ * @file codegen/sdt/backpatch.h
+ * @brief Lists of jumps whose targets are filled in later (internal)
+ */
+
+#ifndef BACKPATCH_H
+#define BACKPATCH_H
+
+#include "codegen/tac.h"
+
+/* Handle of the empty jump list */
+#define JUMP_LIST_EMPTY (-1)
+
+/**
+ * @brief Pool of jump list entries
+ *
+ * A list is the handle of its first entry. Entries are instruction
+ * indices, chained through a parallel array, and never freed one by one:
+ * the whole pool is dropped when code generation is done.
+ */
+typedef struct JumpLists {
+  int *inst;    /* Index of the jump instruction of each entry */
+  int *next;    /* Next entry of the same list, JUMP_LIST_EMPTY at the end */
+  int *tail;    /* Last entry of the list, valid on its first entry */
+  int count;    /* Number of entries in use */
+  int capacity; /* Number of entries allocated */
+} JumpLists;
+
+/**
+ * @brief Create an empty pool of jump lists
+ *
+ * @return JumpLists* Created pool, or NULL on failure
+ */
+JumpLists *jump_lists_create(void);
+
+/**
+ * @brief Free a pool of jump lists
+ *
+ * @param lists Pool to destroy
+ */
+void jump_lists_destroy(JumpLists *lists);
+
+/**
+ * @brief Make a list holding one jump
+ *
+ * @param lists Pool
+ * @param inst Index of the jump instruction
+ * @return int The new list
+ */
+int jump_list_make(JumpLists *lists, int inst);
+
+/**
+ * @brief Concatenate two lists in constant time
+ *
+ * @param lists Pool
+ * @param a First list, which is consumed
+ * @param b Second list, which is consumed
+ * @return int The merged list
+ */
+int jump_list_merge(JumpLists *lists, int a, int b);
+
+/**
+ * @brief Set the target of every jump of a list
+ *
+ * @param lists Pool
+ * @param program Program holding the jumps
+ * @param list List to patch
+ * @param label Target label id
+ */
+void jump_list_backpatch(const JumpLists *lists, TACProgram *program,
+                         int list, int label);
+
+#endif /* BACKPATCH_H */
@@ -27,16 +27,13 @@ LabelManager *label_manager_create(void) {
 /**
  * @brief Generate a new label
  */
-char *label_manager_new_label(LabelManager *manager) {
+int label_manager_new_label(LabelManager *manager) {
   if (!manager) {
-    return NULL;
+    return -1;
   }
 
-  char label_name[32];
-  snprintf(label_name, sizeof(label_name), "L%d", manager->label_counter++);
-
-  DEBUG_PRINT("Generated label '%s'", label_name);
-  return safe_strdup(label_name);
+  DEBUG_PRINT("Generated label L%d", manager->label_counter);
+  return manager->label_counter++;
 }
 
 /**
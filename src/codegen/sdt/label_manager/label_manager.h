@@ -12,7 +12,7 @@
  * @brief Label manager structure
  */
 typedef struct LabelManager {
-  int label_counter; /* Counter for generating unique label names */
+  int label_counter; /* Counter for generating unique label ids */
 } LabelManager;
 
 /**
@@ -26,9 +26,9 @@ LabelManager *label_manager_create(void);
  * @brief Generate a new label
  *
  * @param manager Label manager
- * @return char* Generated label name, or NULL on failure
+ * @return int Generated label id, or -1 on failure
  */
-char *label_manager_new_label(LabelManager *manager);
+int label_manager_new_label(LabelManager *manager);
 
 /**
  * @brief Free label manager resources
@@ -3,218 +3,256 @@
  * @brief Implementation of semantic actions for syntax-directed translation
  */
 #include "sdt_actions.h"
+#include "backpatch.h"
 #include "codegen/sdt_codegen.h"
 #include "codegen/tac.h"
-#include "label_manager/label_manager.h"
 #include "parser/grammar.h"
 #include "parser/syntax_tree.h"
 #include "sdt_attributes.h"
-#include "symbol_table/symbol_table.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 
-/* Forward declarations for all semantic actions */
-static bool action_P_L_T(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_T_P_T(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_T_EPS(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_L_S_SEMI(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_S_ASSIGN(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_S_IF(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_S_WHILE(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_S_BEGIN(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_N_ELSE(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_N_EPS(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_C_E_O(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_O_RELOP(SDTCodeGen *, SyntaxTreeNode *, TACOpType);
-static bool action_C_PAREN(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_E_R_X(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_X_PLUS(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_X_MINUS(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_X_EPS(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_R_F_Y(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_Y_MUL(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_Y_DIV(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_Y_EPS(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_F_PAREN(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_F_ID(SDTCodeGen *, SyntaxTreeNode *);
-static bool action_F_INT(SDTCodeGen *, SyntaxTreeNode *);
-
-/* Helper functions for common operations */
-static bool ensure_attributes(SyntaxTreeNode *node);
-static bool is_control_structure(SyntaxTreeNode *node);
-static SyntaxTreeNode *find_child_by_name(SyntaxTreeNode *node,
-                                          const char *name, NodeType node_type);
+/* Action results other than a child position to visit */
+#define SDT_DONE (-1) /* The action has finished */
+#define SDT_FAIL (-2) /* The node cannot be translated */
+
+/* Flag on a child position: visit it, then finish without resuming */
+#define SDT_TAIL 0x100
 
 /**
- * @brief Execute the semantic actions for a node based on its production ID
+ * @brief A node being translated, on the traversal's work stack
  */
-bool sdt_execute_action(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  if (!gen || !node)
-    return false;
+typedef struct SDTFrame {
+  SyntaxTreeNode *node; /* Node being translated */
+  int step;             /* Times the action has been resumed */
+  int saved;            /* Value the action keeps between steps */
+} SDTFrame;
 
-  /* Ensure node has attributes */
-  if (!ensure_attributes(node)) {
-    return false;
-  }
-
-  /* Dispatch to appropriate action based on production ID */
-  switch (node->production_id) {
-  case PROD_P_LT:
-    return action_P_L_T(gen, node);
-  case PROD_T_PT:
-    return action_T_P_T(gen, node);
-  case PROD_T_EPSILON:
-    return action_T_EPS(gen, node);
-  case PROD_L_S_SEMI:
-    return action_L_S_SEMI(gen, node);
-  case PROD_S_ASSIGN:
-    return action_S_ASSIGN(gen, node);
-  case PROD_S_IF_C_THEN_S_N:
-    return action_S_IF(gen, node);
-  case PROD_S_WHILE_C_DO_S:
-    return action_S_WHILE(gen, node);
-  case PROD_S_BEGIN_L_END:
-    return action_S_BEGIN(gen, node);
-  case PROD_N_ELSE_S:
-    return action_N_ELSE(gen, node);
-  case PROD_N_EPSILON:
-    return action_N_EPS(gen, node);
-  case PROD_C_E_O:
-    return action_C_E_O(gen, node);
-  case PROD_C_PAREN:
-    return action_C_PAREN(gen, node);
-  case PROD_O_GT:
-    return action_O_RELOP(gen, node, TAC_OP_GT);
-  case PROD_O_LT:
-    return action_O_RELOP(gen, node, TAC_OP_LT);
-  case PROD_O_EQ:
-    return action_O_RELOP(gen, node, TAC_OP_EQ);
-  case PROD_O_GE:
-    return action_O_RELOP(gen, node, TAC_OP_GE);
-  case PROD_O_LE:
-    return action_O_RELOP(gen, node, TAC_OP_LE);
-  case PROD_O_NE:
-    return action_O_RELOP(gen, node, TAC_OP_NE);
-  case PROD_E_R_X:
-    return action_E_R_X(gen, node);
-  case PROD_X_PLUS_R_X:
-    return action_X_PLUS(gen, node);
-  case PROD_X_MINUS_R_X:
-    return action_X_MINUS(gen, node);
-  case PROD_X_EPSILON:
-    return action_X_EPS(gen, node);
-  case PROD_R_F_Y:
-    return action_R_F_Y(gen, node);
-  case PROD_Y_MUL_F_Y:
-    return action_Y_MUL(gen, node);
-  case PROD_Y_DIV_F_Y:
-    return action_Y_DIV(gen, node);
-  case PROD_Y_EPSILON:
-    return action_Y_EPS(gen, node);
-  case PROD_F_PAREN:
-    return action_F_PAREN(gen, node);
-  case PROD_F_ID:
-    return action_F_ID(gen, node);
-  case PROD_F_INT8:
-  case PROD_F_INT10:
-  case PROD_F_INT16:
-    return action_F_INT(gen, node);
-  default:
-    return true;
-  }
-}
+/**
+ * @brief Semantic action, run as a sequence of steps
+ *
+ * Step 0 is the pre-visit, computing the inherited attributes of the
+ * first child to translate; each later step runs when the child requested
+ * by the previous one is done, reading its synthesized attributes. A step
+ * returns the position of the next child to visit (with SDT_TAIL if
+ * nothing remains to do after it), SDT_DONE or SDT_FAIL.
+ */
+typedef int (*SDTAction)(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                         TACOpType);
 
 /**
- * @brief Ensures a node has attributes, creates them if needed
- * @return true if successful, false on allocation failure
+ * @brief What to do when a node was built by a production
+ *
+ * The children of a node are the symbols of its production's right-hand
+ * side in order, an epsilon production having a single epsilon child, so
+ * actions reach each operand by its position.
  */
-static bool ensure_attributes(SyntaxTreeNode *node) {
-  if (!node->attributes) {
-    node->attributes = sdt_attributes_create();
-    if (!node->attributes) {
-      return false;
-    }
-  }
-  return true;
-}
+typedef struct SDTRule {
+  SDTAction action; /* Semantic action, NULL if it generates nothing */
+  int arity;        /* Number of children of the node */
+  TACOpType op;     /* Operator the action emits, if any */
+} SDTRule;
+
+/* Forward declarations for all semantic actions */
+static int action_SEQ(SDTCodeGen *, SDTFrame *, SDTAttributes *, TACOpType);
+static int action_L_S_SEMI(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                           TACOpType);
+static int action_S_ASSIGN(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                           TACOpType);
+static int action_S_IF(SDTCodeGen *, SDTFrame *, SDTAttributes *, TACOpType);
+static int action_S_WHILE(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                          TACOpType);
+static int action_S_BEGIN(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                          TACOpType);
+static int action_N_ELSE(SDTCodeGen *, SDTFrame *, SDTAttributes *, TACOpType);
+static int action_C_E_O(SDTCodeGen *, SDTFrame *, SDTAttributes *, TACOpType);
+static int action_O_RELOP(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                          TACOpType);
+static int action_C_PAREN(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                          TACOpType);
+static int action_HEAD_TAIL(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                            TACOpType);
+static int action_TAIL_OP(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                          TACOpType);
+static int action_F_PAREN(SDTCodeGen *, SDTFrame *, SDTAttributes *,
+                          TACOpType);
+static int action_F_ID(SDTCodeGen *, SDTFrame *, SDTAttributes *, TACOpType);
+static int action_F_INT(SDTCodeGen *, SDTFrame *, SDTAttributes *, TACOpType);
+
+/* Semantic actions indexed by production ID */
+static const SDTRule sdt_rules[PROD_UNVALID] = {
+    [PROD_P_LT] = {action_SEQ, 2},
+    [PROD_T_PT] = {action_SEQ, 2},
+    [PROD_T_EPSILON] = {NULL, 1},
+    [PROD_L_S_SEMI] = {action_L_S_SEMI, 2},
+    [PROD_S_ASSIGN] = {action_S_ASSIGN, 3, TAC_OP_ASSIGN},
+    [PROD_S_IF_C_THEN_S_N] = {action_S_IF, 5},
+    [PROD_S_WHILE_C_DO_S] = {action_S_WHILE, 4},
+    [PROD_S_BEGIN_L_END] = {action_S_BEGIN, 3},
+    [PROD_N_ELSE_S] = {action_N_ELSE, 2},
+    [PROD_N_EPSILON] = {NULL, 1},
+    [PROD_C_E_O] = {action_C_E_O, 2},
+    [PROD_C_PAREN] = {action_C_PAREN, 3},
+    [PROD_O_GT] = {action_O_RELOP, 2, TAC_OP_GT},
+    [PROD_O_LT] = {action_O_RELOP, 2, TAC_OP_LT},
+    [PROD_O_EQ] = {action_O_RELOP, 2, TAC_OP_EQ},
+    [PROD_O_GE] = {action_O_RELOP, 2, TAC_OP_GE},
+    [PROD_O_LE] = {action_O_RELOP, 2, TAC_OP_LE},
+    [PROD_O_NE] = {action_O_RELOP, 2, TAC_OP_NE},
+    [PROD_E_R_X] = {action_HEAD_TAIL, 2},
+    [PROD_X_PLUS_R_X] = {action_TAIL_OP, 3, TAC_OP_ADD},
+    [PROD_X_MINUS_R_X] = {action_TAIL_OP, 3, TAC_OP_SUB},
+    [PROD_X_EPSILON] = {NULL, 1},
+    [PROD_R_F_Y] = {action_HEAD_TAIL, 2},
+    [PROD_Y_MUL_F_Y] = {action_TAIL_OP, 3, TAC_OP_MUL},
+    [PROD_Y_DIV_F_Y] = {action_TAIL_OP, 3, TAC_OP_DIV},
+    [PROD_Y_EPSILON] = {NULL, 1},
+    [PROD_F_PAREN] = {action_F_PAREN, 3},
+    [PROD_F_ID] = {action_F_ID, 1},
+    [PROD_F_INT8] = {action_F_INT, 1},
+    [PROD_F_INT10] = {action_F_INT, 1},
+    [PROD_F_INT16] = {action_F_INT, 1},
+};
 
 /**
- * @brief Check if a node represents a control structure (if, while, block)
- * @return true if node is a control structure, false otherwise
+ * @brief Attributes of a non-terminal node
  */
-static bool is_control_structure(SyntaxTreeNode *node) {
-  return (node->production_id == PROD_S_WHILE_C_DO_S ||
-          node->production_id == PROD_S_IF_C_THEN_S_N ||
-          node->production_id == PROD_S_BEGIN_L_END);
+static inline SDTAttributes *attr_of(SDTCodeGen *gen, SyntaxTreeNode *node) {
+  return &gen->attributes[node->id];
 }
 
 /**
- * @brief Find a child node by its symbol name and type
- * @return The matching child node, or NULL if not found
+ * @brief Execute the semantic actions for a subtree
+ *
+ * The traversal keeps its own stack of frames instead of recursing, so
+ * its depth is not limited by the C stack. A child visited last with
+ * nothing left to do replaces its parent's frame, which keeps the
+ * right-recursive statement spine T → P T at a constant depth.
  */
-static SyntaxTreeNode *
-find_child_by_name(SyntaxTreeNode *node, const char *name, NodeType node_type) {
-  if (!node || !name)
-    return NULL;
-
-  for (int i = 0; i < node->children_count; i++) {
-    if (node->children[i]->type == node_type &&
-        strcmp(node->children[i]->symbol_name, name) == 0) {
-      return node->children[i];
+bool sdt_execute_action(SDTCodeGen *gen, SyntaxTreeNode *node) {
+  if (!gen || !node)
+    return false;
+
+  int capacity = 64;
+  SDTFrame *stack = (SDTFrame *)safe_malloc(capacity * sizeof(SDTFrame));
+  int depth = 0;
+  bool ok = true;
+
+  SyntaxTreeNode *visit = node;
+  for (;;) {
+    /* Pre-visit: push a frame for a node that has an action. Terminals
+     * and epsilon nodes carry no production */
+    if (visit) {
+      int production = visit->production_id;
+      if (production >= 0 && production < PROD_UNVALID) {
+        const SDTRule *rule = &sdt_rules[production];
+        if (visit->children_count != rule->arity || visit->id < 0 ||
+            visit->id >= gen->node_count) {
+          DEBUG_PRINT("ERROR: Malformed node for production %d", production);
+          ok = false;
+          break;
+        }
+        if (rule->action) {
+          if (depth == capacity) {
+            capacity *= 2;
+            stack = (SDTFrame *)safe_realloc(stack,
+                                             capacity * sizeof(SDTFrame));
+          }
+          stack[depth++] = (SDTFrame){visit, 0, 0};
+        }
+      }
+      visit = NULL;
+    }
+    if (depth == 0) {
+      break;
+    }
+
+    /* Run the next step of the innermost unfinished action */
+    SDTFrame *frame = &stack[depth - 1];
+    const SDTRule *rule = &sdt_rules[frame->node->production_id];
+    int next = rule->action(gen, frame, attr_of(gen, frame->node), rule->op);
+    if (next == SDT_FAIL) {
+      ok = false;
+      break;
+    }
+    if (next == SDT_DONE) {
+      depth--;
+      continue;
+    }
+    visit = frame->node->children[next & ~SDT_TAIL];
+    if (next & SDT_TAIL) {
+      depth--;
+    } else {
+      frame->step++;
     }
   }
-  return NULL;
+
+  free(stack);
+  return ok;
 }
 
 /**
- * @brief Semantic action for P → L T
+ * @brief Check if a statement is a while loop
  *
- * P.code = L.code || T.code
+ * A loop emits its own entry label (so the jumps into it can target that
+ * label) and is only ever left through its nextlist. An if or a begin
+ * block may fall through, so neither property holds for them.
+ *
+ * @return true if node is a while statement, false otherwise
  */
-static bool action_P_L_T(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Process children: [0]=L, [1]=T */
-  sdt_codegen_generate(gen, node->children[0]);
-  sdt_codegen_generate(gen, node->children[1]);
-  DEBUG_PRINT("Executed P → L T action");
-  return true;
+static bool is_loop_statement(SyntaxTreeNode *node) {
+  return node->production_id == PROD_S_WHILE_C_DO_S;
 }
 
 /**
- * @brief Semantic action for T → P T
+ * @brief Send a condition's true jumps to the body it guards
  *
- * T.code = P.code || T.code
+ * A body that is a loop takes them as the jumps to its entry label;
+ * otherwise a label is emitted for them here.
  */
-static bool action_T_P_T(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Process children: [0]=P, [1]=T */
-  sdt_codegen_generate(gen, node->children[0]);
-  sdt_codegen_generate(gen, node->children[1]);
-  DEBUG_PRINT("Executed T → P T action");
-  return true;
+static void enter_body(SDTCodeGen *gen, SDTAttributes *C_attrs,
+                       SyntaxTreeNode *body) {
+  if (is_loop_statement(body)) {
+    attr_of(gen, body)->truelist = C_attrs->truelist;
+  } else {
+    sdt_emit_target(gen, C_attrs->truelist);
+  }
+  C_attrs->truelist = JUMP_LIST_EMPTY;
 }
 
 /**
- * @brief Semantic action for T → ε
+ * @brief Semantic action for P → L T and T → P T
  *
- * T.code = ''
+ * P.code = L.code || T.code
+ * T.code = P.code || T.code
  */
-static bool action_T_EPS(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* No code to generate for epsilon */
-  DEBUG_PRINT("Executed T → ε action");
-  return true;
+static int action_SEQ(SDTCodeGen *gen, SDTFrame *frame, SDTAttributes *attrs,
+                      TACOpType op) {
+  (void)gen;
+  (void)attrs;
+  (void)op;
+  /* Process children: [0]=head, [1]=T */
+  return frame->step == 0 ? 0 : 1 | SDT_TAIL;
 }
 
 /**
  * @brief Semantic action for L → S ;
  *
- * L.code = S.code
+ * L.code = S.code || label(S.nextlist)
  */
-static bool action_L_S_SEMI(SDTCodeGen *gen, SyntaxTreeNode *node) {
+static int action_L_S_SEMI(SDTCodeGen *gen, SDTFrame *frame,
+                           SDTAttributes *attrs, TACOpType op) {
+  (void)attrs;
+  (void)op;
   /* Process statement: [0]=S */
-  sdt_codegen_generate(gen, node->children[0]);
-  DEBUG_PRINT("Executed L → S ; action");
-  return true;
+  if (frame->step == 0) {
+    return 0;
+  }
+
+  /* The next statement starts here */
+  sdt_emit_target(gen, attr_of(gen, frame->node->children[0])->nextlist);
+  return SDT_DONE;
 }
 
 /**
@@ -222,228 +260,153 @@ static bool action_L_S_SEMI(SDTCodeGen *gen, SyntaxTreeNode *node) {
  *
  * S.code = E.code || gen(id.place ':=' E.place)
  */
-static bool action_S_ASSIGN(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Find id and E nodes */
-  SyntaxTreeNode *id_node = find_child_by_name(node, "id", NODE_TERMINAL);
-  SyntaxTreeNode *E_node = find_child_by_name(node, "E", NODE_NONTERMINAL);
-
-  if (!id_node || !E_node) {
-    DEBUG_PRINT("ERROR: Missing identifier or expression node");
-    return false;
-  }
+static int action_S_ASSIGN(SDTCodeGen *gen, SDTFrame *frame,
+                           SDTAttributes *attrs, TACOpType op) {
+  (void)attrs;
+  /* Children: [0]=id, [1]='=', [2]=E */
+  SyntaxTreeNode *id_node = frame->node->children[0];
+  SyntaxTreeNode *E_node = frame->node->children[2];
 
   /* Generate code for the expression */
-  sdt_codegen_generate(gen, E_node);
+  if (frame->step == 0) {
+    return 2;
+  }
 
   /* Generate assignment instruction */
-  tac_program_add_inst(gen->program, TAC_OP_ASSIGN,
-                       id_node->token.str_val,    /* destination */
-                       E_node->attributes->place, /* source */
-                       NULL, 0);
-
-  DEBUG_PRINT("Generated assignment: %s := %s", id_node->token.str_val,
-              E_node->attributes->place);
+  tac_program_add_inst(gen->program, op,
+                       sdt_variable(gen, id_node->token.str_val), /* dest */
+                       attr_of(gen, E_node)->place,              /* source */
+                       tac_none(), 0);
 
-  return true;
+  DEBUG_PRINT("Generated assignment: %s := <place>", id_node->token.str_val);
+  return SDT_DONE;
 }
 
 /**
  * @brief Semantic action for S → if C then S1 N
+ *
+ * The false jumps of C go to the else branch if there is one, and
+ * otherwise leave the statement with S1.nextlist and N.nextlist.
  */
-static bool action_S_IF(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  if (!node || node->children_count < 5)
-    return false;
-  SyntaxTreeNode *C_node = node->children[1];  /* Condition */
-  SyntaxTreeNode *S1_node = node->children[3]; /* Then branch */
-  SyntaxTreeNode *N_node = node->children[4];  /* Else branch */
-
-  /* Ensure attribute structures exist */
-  if (!ensure_attributes(node) || !ensure_attributes(C_node)) {
-    return false;
-  }
-
-  /* Check if next_label is inherited from parent node */
-  bool inherited = (node->attributes->next_label != NULL);
-
-  /* 1. Generate or reuse next_label */
-  char *next_label = inherited ? safe_strdup(node->attributes->next_label)
-                               : label_manager_new_label(gen->label_manager);
-  node->attributes->next_label = safe_strdup(next_label);
-
-  /* 2. Generate true_label and false_label */
-  char *true_label = label_manager_new_label(gen->label_manager);
-  bool has_else = (N_node->production_id == PROD_N_ELSE_S);
-  char *false_label = has_else ? label_manager_new_label(gen->label_manager)
-                               : safe_strdup(next_label);
-
-  /* 3. Pass labels to condition node */
-  C_node->attributes->true_label = safe_strdup(true_label);
-  C_node->attributes->false_label = safe_strdup(false_label);
-
-  /* 4. Generate condition code */
-  sdt_codegen_generate(gen, C_node);
-
-  /* 5. If 'then' is not a control structure, add true_label */
-  bool is_ctrl = is_control_structure(S1_node);
-  if (!is_ctrl) {
-    tac_program_add_inst(gen->program, TAC_OP_LABEL, true_label, NULL, NULL, 0);
-  }
-
-  /* 6. If it's a control structure, pass true_label to reuse it */
-  if (is_ctrl) {
-    if (!ensure_attributes(S1_node))
-      return false;
-    S1_node->attributes->true_label = safe_strdup(true_label);
-  }
-
-  /* 7. Generate code for 'then' branch */
-  if (!ensure_attributes(S1_node))
-    return false;
-  S1_node->attributes->next_label = safe_strdup(next_label);
-  sdt_codegen_generate(gen, S1_node);
-
-  /* 8. Handle 'else' branch (if exists) */
-  if (has_else) {
-    if (!is_ctrl) {
-      tac_program_add_inst(gen->program, TAC_OP_GOTO, next_label, NULL, NULL,
-                           0);
-    }
-    /* Output else label */
-    tac_program_add_inst(gen->program, TAC_OP_LABEL, false_label, NULL, NULL,
-                         0);
-    /* Generate code for else branch */
-    if (N_node->children_count > 1) {
-      SyntaxTreeNode *else_stmt = N_node->children[1];
-      if (!ensure_attributes(else_stmt))
-        return false;
-      else_stmt->attributes->next_label = safe_strdup(next_label);
-      sdt_codegen_generate(gen, else_stmt);
+static int action_S_IF(SDTCodeGen *gen, SDTFrame *frame, SDTAttributes *attrs,
+                       TACOpType op) {
+  (void)op;
+  SyntaxTreeNode *C_node = frame->node->children[1];  /* Condition */
+  SyntaxTreeNode *S1_node = frame->node->children[3]; /* Then branch */
+  SyntaxTreeNode *N_node = frame->node->children[4];  /* Else branch */
+  SDTAttributes *C_attrs = attr_of(gen, C_node);
+
+  switch (frame->step) {
+  case 0:
+    /* 1. Generate condition code */
+    return 1;
+
+  case 1:
+    /* 2. Generate code for 'then' branch */
+    enter_body(gen, C_attrs, S1_node);
+    return 3;
+
+  case 2:
+    /* 3. Handle 'else' branch (if exists): leave the 'then' branch
+     *    unless it never falls through, and start the else branch */
+    if (N_node->production_id == PROD_N_ELSE_S) {
+      if (!is_loop_statement(S1_node)) {
+        attrs->nextlist =
+            sdt_emit_jump(gen, TAC_OP_GOTO, tac_none(), tac_none());
+      }
+      sdt_emit_target(gen, C_attrs->falselist);
+      C_attrs->falselist = JUMP_LIST_EMPTY;
+      return 4;
     }
-  }
+    /* fall through */
 
-  /* 9. Output next_label (only if newly generated by this node) */
-  if (!inherited) {
-    tac_program_add_inst(gen->program, TAC_OP_LABEL, next_label, NULL, NULL, 0);
-  }
+  default:
+    /* 4. Everything else continues after the statement */
+    attrs->nextlist = jump_list_merge(
+        gen->jump_lists,
+        jump_list_merge(gen->jump_lists, attr_of(gen, S1_node)->nextlist,
+                        attrs->nextlist),
+        jump_list_merge(gen->jump_lists, attr_of(gen, N_node)->nextlist,
+                        C_attrs->falselist));
 
-  DEBUG_PRINT("Generated if: true=%s false=%s next=%s", true_label, false_label,
-              next_label);
-  return true;
+    DEBUG_PRINT("Generated if");
+    return SDT_DONE;
+  }
 }
 
 /**
  * @brief Semantic action for S → while C do S1
+ *
+ * The loop's entry label is kept in frame->saved; the jumps that enter
+ * the loop from an enclosing if or while arrive in its truelist.
  */
-static bool action_S_WHILE(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  if (!node || node->children_count < 4)
-    return false;
-  SyntaxTreeNode *C_node = node->children[1];  /* Condition */
-  SyntaxTreeNode *S1_node = node->children[3]; /* Loop body */
+static int action_S_WHILE(SDTCodeGen *gen, SDTFrame *frame,
+                          SDTAttributes *attrs, TACOpType op) {
+  (void)op;
+  SyntaxTreeNode *C_node = frame->node->children[1];  /* Condition */
+  SyntaxTreeNode *S1_node = frame->node->children[3]; /* Loop body */
+  SDTAttributes *C_attrs = attr_of(gen, C_node);
+
+  switch (frame->step) {
+  case 0:
+    /* 1. Output loop entry point */
+    frame->saved = sdt_emit_label(gen, attrs->truelist);
+    attrs->truelist = JUMP_LIST_EMPTY;
+
+    /* 2. Generate condition code */
+    return 1;
+
+  case 1:
+    /* 3. Generate loop body code */
+    enter_body(gen, C_attrs, S1_node);
+    return 3;
 
-  /* Ensure attribute structures */
-  if (!ensure_attributes(node) || !ensure_attributes(C_node)) {
-    return false;
-  }
-
-  /* Check if next_label is inherited */
-  bool inherited = (node->attributes->next_label != NULL);
-
-  /* 1. Generate or reuse next_label */
-  char *next_label = inherited ? safe_strdup(node->attributes->next_label)
-                               : label_manager_new_label(gen->label_manager);
-  node->attributes->next_label = safe_strdup(next_label);
-
-  /* 2. Generate loop entry begin_label */
-  char *begin_label;
-  if (node->attributes->true_label) {
-    /* If outer if already passed a true_label, reuse it */
-    begin_label = safe_strdup(node->attributes->true_label);
-  } else {
-    /* Otherwise create a new one */
-    begin_label = label_manager_new_label(gen->label_manager);
-  }
-
-  /* 3. Generate true/false labels for condition */
-  char *true_label = label_manager_new_label(gen->label_manager);
-  C_node->attributes->true_label = safe_strdup(true_label);
-  C_node->attributes->false_label = safe_strdup(next_label);
-
-  /* 4. Output loop entry point */
-  tac_program_add_inst(gen->program, TAC_OP_LABEL, begin_label, NULL, NULL, 0);
-
-  /* 5. Generate condition code */
-  sdt_codegen_generate(gen, C_node);
-
-  /* 6. When condition is true, add true_label */
-  tac_program_add_inst(gen->program, TAC_OP_LABEL, true_label, NULL, NULL, 0);
-
-  /* 7. Generate loop body code */
-  if (!ensure_attributes(S1_node))
-    return false;
-  S1_node->attributes->next_label = safe_strdup(begin_label);
-  sdt_codegen_generate(gen, S1_node);
+  default:
+    /* 4. The body continues at the loop entry */
+    jump_list_backpatch(gen->jump_lists, gen->program,
+                        attr_of(gen, S1_node)->nextlist, frame->saved);
+    tac_program_add_inst(gen->program, TAC_OP_GOTO, tac_label(frame->saved),
+                         tac_none(), tac_none(), 0);
 
-  /* 8. Jump back to loop entry */
-  tac_program_add_inst(gen->program, TAC_OP_GOTO, begin_label, NULL, NULL, 0);
+    /* 5. The loop is left when the condition fails */
+    attrs->nextlist = C_attrs->falselist;
 
-  /* 9. Output exit label next_label (only if newly generated by this node) */
-  if (!inherited) {
-    tac_program_add_inst(gen->program, TAC_OP_LABEL, next_label, NULL, NULL, 0);
+    DEBUG_PRINT("Generated while: begin=L%d", frame->saved);
+    return SDT_DONE;
   }
-
-  DEBUG_PRINT("Generated while: begin=%s true=%s next=%s", begin_label,
-              true_label, next_label);
-  return true;
 }
 
 /**
  * @brief Semantic action for S → begin L end
  *
- * S.code = L.code
+ * S.code = L.code; every statement of L is backpatched by L itself, so
+ * S.nextlist stays empty
  */
-static bool action_S_BEGIN(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get list of statements: [1]=L */
-  SyntaxTreeNode *L_node = node->children[1];
-
-  /* Pass next_label down to statement list */
-  if (!ensure_attributes(L_node)) {
-    return false;
-  }
-
-  if (node->attributes && node->attributes->next_label) {
-    L_node->attributes->next_label = safe_strdup(node->attributes->next_label);
-  }
-
-  /* Generate code for statement list */
-  sdt_codegen_generate(gen, L_node);
-
-  DEBUG_PRINT("Executed S → begin L end action");
-  return true;
+static int action_S_BEGIN(SDTCodeGen *gen, SDTFrame *frame,
+                          SDTAttributes *attrs, TACOpType op) {
+  (void)gen;
+  (void)frame;
+  (void)attrs;
+  (void)op;
+  /* Process statement list: [1]=L */
+  return 1 | SDT_TAIL;
 }
 
 /**
  * @brief Semantic action for N → else S
  *
- * N.isEpsilon = false;
- * N.code = S.code;
- * N.stmt = S;
+ * N.code = S.code; N.nextlist = S.nextlist
  */
-static bool action_N_ELSE(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* This is handled in the if-statement action */
-  DEBUG_PRINT("Executed N → else S action");
-  return true;
-}
+static int action_N_ELSE(SDTCodeGen *gen, SDTFrame *frame,
+                         SDTAttributes *attrs, TACOpType op) {
+  (void)op;
+  /* The if emitted the else label: [1]=S */
+  if (frame->step == 0) {
+    return 1;
+  }
 
-/**
- * @brief Semantic action for N → ε
- *
- * N.isEpsilon = true;
- * N.code = '';
- */
-static bool action_N_EPS(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* No code to generate for epsilon */
-  DEBUG_PRINT("Executed N → ε action");
-  return true;
+  attrs->nextlist = attr_of(gen, frame->node->children[1])->nextlist;
+  return SDT_DONE;
 }
 
 /**
@@ -451,466 +414,160 @@ static bool action_N_EPS(SDTCodeGen *gen, SyntaxTreeNode *node) {
  *
  * C.code = E.code || O.code
  * E.place is passed to O.inherited
- * O.true = C.true
- * O.false = C.false
+ * C.truelist = O.truelist; C.falselist = O.falselist
  */
-static bool action_C_E_O(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  if (!node || node->children_count < 2) {
-    DEBUG_PRINT("ERROR: Missing E or O node in C → E O");
-    return false;
-  }
-
-  SyntaxTreeNode *E_node = node->children[0]; /* Expression */
-  SyntaxTreeNode *O_node =
-      node->children[1]; /* Operator and right expression */
+static int action_C_E_O(SDTCodeGen *gen, SDTFrame *frame,
+                        SDTAttributes *attrs, TACOpType op) {
+  (void)op;
+  SDTAttributes *O_attrs = attr_of(gen, frame->node->children[1]);
 
-  /* Ensure attribute structures exist */
-  if (!ensure_attributes(node) || !ensure_attributes(E_node) ||
-      !ensure_attributes(O_node)) {
-    return false;
-  }
+  switch (frame->step) {
+  case 0:
+    /* 1. Generate code for left expression: [0]=E */
+    return 0;
 
-  /* 1. Generate code for left expression */
-  sdt_codegen_generate(gen, E_node);
+  case 1:
+    /* 2. Pass the left expression's place to the operator node: [1]=O */
+    O_attrs->place = attr_of(gen, frame->node->children[0])->place;
+    return 1;
 
-  /* 2. Pass the left expression's place to the operator node O */
-  O_node->attributes->place = safe_strdup(E_node->attributes->place);
-
-  /* 3. Pass true_label and false_label to O node */
-  if (node->attributes->true_label) {
-    O_node->attributes->true_label = safe_strdup(node->attributes->true_label);
-  } else {
-    node->attributes->true_label = label_manager_new_label(gen->label_manager);
-    O_node->attributes->true_label = safe_strdup(node->attributes->true_label);
-  }
+  default:
+    /* 3. Take over the jumps of the comparison */
+    attrs->truelist = O_attrs->truelist;
+    attrs->falselist = O_attrs->falselist;
 
-  if (node->attributes->false_label) {
-    O_node->attributes->false_label =
-        safe_strdup(node->attributes->false_label);
-  } else {
-    node->attributes->false_label = label_manager_new_label(gen->label_manager);
-    O_node->attributes->false_label =
-        safe_strdup(node->attributes->false_label);
+    DEBUG_PRINT("Executed C → E O action");
+    return SDT_DONE;
   }
-
-  /* 4. Generate code for operator and right expression */
-  sdt_codegen_generate(gen, O_node);
-
-  DEBUG_PRINT("Executed C → E O action");
-  return true;
 }
 
 /**
  * @brief Semantic action for O → relop E
  *
- * O.code = E.code || gen('if' O.inherited 'relop' E.place 'goto' O.true) ||
- * gen('goto' O.false)
+ * O.code = E.code || gen('if' O.inherited 'relop' E.place 'goto' _) ||
+ * gen('goto' _)
+ * O.truelist and O.falselist hold the two jumps
  */
-static bool action_O_RELOP(SDTCodeGen *gen, SyntaxTreeNode *node,
-                           TACOpType op) {
-  if (!node || node->children_count < 2) {
-    DEBUG_PRINT("ERROR: Missing E node in O → relop E");
-    return false;
+static int action_O_RELOP(SDTCodeGen *gen, SDTFrame *frame,
+                          SDTAttributes *attrs, TACOpType op) {
+  /* 1. Generate code for right expression: [0]=relop, [1]=E */
+  if (frame->step == 0) {
+    return 1;
   }
 
-  /* Get the right expression node */
-  SyntaxTreeNode *relop_node = node->children[0]; /* Relational operator */
-  SyntaxTreeNode *E_node = node->children[1];     /* Right expression */
-
-  /* 1. Generate code for right expression */
-  sdt_codegen_generate(gen, E_node);
-
-  /* 2. Ensure attributes exist */
-  if (!ensure_attributes(node)) {
-    return false;
-  }
-
-  /* 3. Use existing or create new true/false labels */
-  if (!node->attributes->true_label) {
-    node->attributes->true_label = label_manager_new_label(gen->label_manager);
-  }
-
-  if (!node->attributes->false_label) {
-    node->attributes->false_label = label_manager_new_label(gen->label_manager);
-  }
-
-  char *t = node->attributes->true_label;
-  char *f = node->attributes->false_label;
-
-  /* 4. Generate conditional jump and default jump */
-  tac_program_add_inst(gen->program, op, t,
-                       node->attributes->place,   /* Left operand (inherited) */
-                       E_node->attributes->place, /* Right operand */
-                       0);
-  tac_program_add_inst(gen->program, TAC_OP_GOTO, f, NULL, NULL, 0);
+  /* 2. Generate conditional jump and default jump */
+  attrs->truelist =
+      sdt_emit_jump(gen, op, attrs->place, /* Left operand (inherited) */
+                    attr_of(gen, frame->node->children[1])->place);
+  attrs->falselist = sdt_emit_jump(gen, TAC_OP_GOTO, tac_none(), tac_none());
 
   DEBUG_PRINT("Generated condition with relational operator: %s",
               tac_op_type_to_string(op));
-
-  return true;
+  return SDT_DONE;
 }
 
 /**
  * @brief Semantic action for C → ( C1 )
  *
  * C.code = C1.code;
- * C1.true = C.true;
- * C1.false = C.false;
+ * C.truelist = C1.truelist;
+ * C.falselist = C1.falselist;
  */
-static bool action_C_PAREN(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  if (!node || node->children_count < 3) {
-    DEBUG_PRINT("ERROR: Invalid parenthesized condition");
-    return false;
-  }
-
-  /* Find inner condition node */
-  SyntaxTreeNode *C1_node = find_child_by_name(node, "C", NODE_NONTERMINAL);
-
-  if (!C1_node) {
-    DEBUG_PRINT("ERROR: Missing inner condition in parentheses");
-    return false;
-  }
-
-  /* Ensure inner condition has attributes */
-  if (!ensure_attributes(C1_node)) {
-    return false;
-  }
-
-  /* Pass down true/false labels if present */
-  if (node->attributes && node->attributes->true_label) {
-    C1_node->attributes->true_label = safe_strdup(node->attributes->true_label);
-  }
-
-  if (node->attributes && node->attributes->false_label) {
-    C1_node->attributes->false_label =
-        safe_strdup(node->attributes->false_label);
-  }
-
-  /* Generate inner condition code */
-  sdt_codegen_generate(gen, C1_node);
-
-  /* Inherit labels back if needed */
-  if (!ensure_attributes(node)) {
-    return false;
-  }
-
-  if (!node->attributes->true_label && C1_node->attributes->true_label) {
-    node->attributes->true_label = safe_strdup(C1_node->attributes->true_label);
+static int action_C_PAREN(SDTCodeGen *gen, SDTFrame *frame,
+                          SDTAttributes *attrs, TACOpType op) {
+  (void)op;
+  /* Children: [0]='(', [1]=C1, [2]=')' */
+  if (frame->step == 0) {
+    /* Generate inner condition code */
+    return 1;
   }
 
-  if (!node->attributes->false_label && C1_node->attributes->false_label) {
-    node->attributes->false_label =
-        safe_strdup(C1_node->attributes->false_label);
-  }
+  SDTAttributes *C1_attrs = attr_of(gen, frame->node->children[1]);
+  attrs->truelist = C1_attrs->truelist;
+  attrs->falselist = C1_attrs->falselist;
 
   DEBUG_PRINT("Executed C → ( C1 ) action");
-  return true;
+  return SDT_DONE;
 }
 
 /**
- * @brief Semantic action for E → R X
+ * @brief Semantic action for E → R X and R → F Y
  *
  * E.place = X.synthesized;
  * E.code = R.code || X.code;
  * X.inherited = R.place;
  */
-static bool action_E_R_X(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get children: [0]=R, [1]=X */
-  SyntaxTreeNode *R_node = node->children[0];
-  SyntaxTreeNode *X_node = node->children[1];
-
-  /* Generate code for term */
-  sdt_codegen_generate(gen, R_node);
-
-  /* Pass R.place to X as inherited attribute */
-  if (!ensure_attributes(X_node)) {
-    return false;
-  }
-
-  X_node->attributes->place = safe_strdup(R_node->attributes->place);
-
-  /* Generate code for expression tail */
-  sdt_codegen_generate(gen, X_node);
-
-  /* Inherit synthesized place from X */
-  node->attributes->place = safe_strdup(X_node->attributes->place);
-
-  DEBUG_PRINT("Executed E → R X action: place = %s", node->attributes->place);
-  return true;
-}
-
-/**
- * @brief Semantic action for X → + R X1
- *
- * X.synthesized = newtemp;
- * X.code = R.code || gen(X.synthesized ':=' X.inherited '+' R.place) ||
- * X1.code; X1.inherited = X.synthesized;
- */
-static bool action_X_PLUS(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get children: [0]='+', [1]=R, [2]=X1 */
-  SyntaxTreeNode *R_node = node->children[1];
-  SyntaxTreeNode *X1_node = node->children[2];
+static int action_HEAD_TAIL(SDTCodeGen *gen, SDTFrame *frame,
+                            SDTAttributes *attrs, TACOpType op) {
+  (void)op;
+  /* Children: [0]=head, [1]=tail */
+  SyntaxTreeNode *head = frame->node->children[0];
+  SyntaxTreeNode *tail = frame->node->children[1];
+
+  switch (frame->step) {
+  case 0:
+    /* Generate code for the head */
+    return 0;
+
+  case 1:
+    /* Pass the head's place to the tail as inherited attribute */
+    attr_of(gen, tail)->place = attr_of(gen, head)->place;
+    return 1;
 
-  /* 1. Generate code for right operand */
-  sdt_codegen_generate(gen, R_node);
-
-  /* 2. Allocate temporary variable */
-  char *temp = symbol_table_new_temp(gen->symbol_table);
-  if (!temp)
-    return false;
-
-  /* 3. Check operands */
-  if (!node->attributes->place || !R_node->attributes->place) {
-    DEBUG_PRINT("ERROR: Missing operands for addition");
-    free(temp);
-    return false;
-  }
-
-  /* 4. Generate addition instruction */
-  tac_program_add_inst(gen->program, TAC_OP_ADD, temp, /* result */
-                       node->attributes->place,   /* left operand (inherited) */
-                       R_node->attributes->place, /* right operand */
-                       0);
-
-  /* 5. Pass inherited attribute to X1 */
-  if (!ensure_attributes(X1_node)) {
-    free(temp);
-    return false;
+  default:
+    /* Inherit the synthesized place back */
+    attrs->place = attr_of(gen, tail)->place;
+    DEBUG_PRINT("Executed %s → head tail action", frame->node->symbol_name);
+    return SDT_DONE;
   }
-
-  X1_node->attributes->place = safe_strdup(temp);
-
-  /* 6. Generate X1 code */
-  sdt_codegen_generate(gen, X1_node);
-
-  /* 7. Inherit synthesized place */
-  if (X1_node->attributes->place)
-    node->attributes->place = safe_strdup(X1_node->attributes->place);
-
-  DEBUG_PRINT("Generated addition: %s := %s + %s", temp,
-              node->attributes->place, R_node->attributes->place);
-
-  /* 8. Clean up temporary string */
-  free(temp);
-  return true;
 }
 
 /**
- * @brief Semantic action for X → - R X1
+ * @brief Semantic action for X → + R X1, X → - R X1, Y → * F Y1 and
+ * Y → / F Y1
  *
  * X.synthesized = newtemp;
- * X.code = R.code || gen(X.synthesized ':=' X.inherited '-' R.place) ||
+ * X.code = R.code || gen(X.synthesized ':=' X.inherited 'op' R.place) ||
  * X1.code; X1.inherited = X.synthesized;
  */
-static bool action_X_MINUS(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get children: [0]='-', [1]=R, [2]=X1 */
-  SyntaxTreeNode *R_node = node->children[1];
-  SyntaxTreeNode *X1_node = node->children[2];
-
-  /* Generate code for right operand */
-  sdt_codegen_generate(gen, R_node);
-
-  /* Allocate temporary variable */
-  char *temp = symbol_table_new_temp(gen->symbol_table);
-  if (!temp)
-    return false;
-
-  /* Check operands */
-  if (!node->attributes->place || !R_node->attributes->place) {
-    DEBUG_PRINT("ERROR: Missing operands for subtraction");
-    free(temp);
-    return false;
-  }
-
-  /* Generate subtraction instruction */
-  tac_program_add_inst(gen->program, TAC_OP_SUB, temp, node->attributes->place,
-                       R_node->attributes->place, 0);
-
-  /* Pass inherited attribute to X1 */
-  if (!ensure_attributes(X1_node)) {
-    free(temp);
-    return false;
-  }
-
-  X1_node->attributes->place = safe_strdup(temp);
-
-  /* Generate X1 code */
-  sdt_codegen_generate(gen, X1_node);
-
-  /* Inherit synthesized place */
-  if (X1_node->attributes->place)
-    node->attributes->place = safe_strdup(X1_node->attributes->place);
-
-  DEBUG_PRINT("Generated subtraction: %s := %s - %s", temp,
-              node->attributes->place, R_node->attributes->place);
-
-  /* Clean up */
-  free(temp);
-  return true;
-}
-
-/**
- * @brief Semantic action for X → ε
- *
- * X.synthesized = X.inherited;
- * X.code = '';
- */
-static bool action_X_EPS(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* X.synthesized = X.inherited (place already inherited) */
-  DEBUG_PRINT("Executed X → ε action: place = %s", node->attributes->place);
-  return true;
-}
-
-/**
- * @brief Semantic action for R → F Y
- *
- * R.place = Y.synthesized;
- * R.code = F.code || Y.code;
- * Y.inherited = F.place;
- */
-static bool action_R_F_Y(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get children: [0]=F, [1]=Y */
-  SyntaxTreeNode *F_node = node->children[0];
-  SyntaxTreeNode *Y_node = node->children[1];
-
-  /* Generate code for factor */
-  sdt_codegen_generate(gen, F_node);
-
-  /* Pass F.place to Y as inherited attribute */
-  if (!ensure_attributes(Y_node)) {
-    return false;
-  }
-
-  Y_node->attributes->place = safe_strdup(F_node->attributes->place);
-
-  /* Generate code for term tail */
-  sdt_codegen_generate(gen, Y_node);
-
-  /* Inherit synthesized place from Y */
-  node->attributes->place = safe_strdup(Y_node->attributes->place);
-
-  DEBUG_PRINT("Executed R → F Y action: place = %s", node->attributes->place);
-  return true;
-}
-
-/**
- * @brief Semantic action for Y → * F Y1
- *
- * Y.synthesized = newtemp;
- * Y.code = F.code || gen(Y.synthesized ':=' Y.inherited '*' F.place) ||
- * Y1.code; Y1.inherited = Y.synthesized;
- */
-static bool action_Y_MUL(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get children: [0]='*', [1]=F, [2]=Y1 */
-  SyntaxTreeNode *F_node = node->children[1];
-  SyntaxTreeNode *Y1_node = node->children[2];
-
-  /* Generate code for factor */
-  sdt_codegen_generate(gen, F_node);
-
-  /* Allocate temporary variable */
-  char *temp = symbol_table_new_temp(gen->symbol_table);
-  if (!temp)
-    return false;
-
-  /* Check operands */
-  if (!node->attributes->place || !F_node->attributes->place) {
-    DEBUG_PRINT("ERROR: Missing operands for multiplication");
-    free(temp);
-    return false;
-  }
-
-  /* Generate multiplication instruction */
-  tac_program_add_inst(gen->program, TAC_OP_MUL, temp, node->attributes->place,
-                       F_node->attributes->place, 0);
-
-  /* Pass inherited attribute to Y1 */
-  if (!ensure_attributes(Y1_node)) {
-    free(temp);
-    return false;
-  }
-
-  Y1_node->attributes->place = safe_strdup(temp);
-
-  /* Generate Y1 code */
-  sdt_codegen_generate(gen, Y1_node);
-
-  /* Inherit synthesized place */
-  if (Y1_node->attributes->place)
-    node->attributes->place = safe_strdup(Y1_node->attributes->place);
-
-  DEBUG_PRINT("Generated multiplication: %s := %s * %s", temp,
-              node->attributes->place, F_node->attributes->place);
-
-  /* Clean up */
-  free(temp);
-  return true;
-}
-
-/**
- * @brief Semantic action for Y → / F Y1
- *
- * Y.synthesized = newtemp;
- * Y.code = F.code || gen(Y.synthesized ':=' Y.inherited '/' F.place) ||
- * Y1.code; Y1.inherited = Y.synthesized;
- */
-static bool action_Y_DIV(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Get children: [0]='/', [1]=F, [2]=Y1 */
-  SyntaxTreeNode *F_node = node->children[1];
-  SyntaxTreeNode *Y1_node = node->children[2];
-
-  /* Generate code for factor */
-  sdt_codegen_generate(gen, F_node);
+static int action_TAIL_OP(SDTCodeGen *gen, SDTFrame *frame,
+                          SDTAttributes *attrs, TACOpType op) {
+  /* Children: [0]=operator, [1]=operand, [2]=rest of the tail */
+  SDTAttributes *rest_attrs = attr_of(gen, frame->node->children[2]);
+
+  switch (frame->step) {
+  case 0:
+    /* 1. Generate code for right operand */
+    return 1;
+
+  case 1: {
+    /* 2. Allocate temporary variable */
+    TACOperand temp = sdt_new_temp(gen);
+    if (temp.kind == TAC_OPND_NONE)
+      return SDT_FAIL;
+
+    /* 3. Check operands */
+    TACOperand right = attr_of(gen, frame->node->children[1])->place;
+    if (attrs->place.kind == TAC_OPND_NONE || right.kind == TAC_OPND_NONE) {
+      DEBUG_PRINT("ERROR: Missing operands for %s", tac_op_type_to_string(op));
+      return SDT_FAIL;
+    }
 
-  /* Allocate temporary variable */
-  char *temp = symbol_table_new_temp(gen->symbol_table);
-  if (!temp)
-    return false;
+    /* 4. Generate the operation on the inherited left operand */
+    tac_program_add_inst(gen->program, op, temp, attrs->place, right, 0);
 
-  /* Check operands */
-  if (!node->attributes->place || !F_node->attributes->place) {
-    DEBUG_PRINT("ERROR: Missing operands for division");
-    free(temp);
-    return false;
+    /* 5. Pass the result to the rest of the tail */
+    rest_attrs->place = temp;
+    DEBUG_PRINT("Generated %s: t%d", tac_op_type_to_string(op), temp.id);
+    return 2;
   }
 
-  /* Generate division instruction */
-  tac_program_add_inst(gen->program, TAC_OP_DIV, temp, node->attributes->place,
-                       F_node->attributes->place, 0);
-
-  /* Pass inherited attribute to Y1 */
-  if (!ensure_attributes(Y1_node)) {
-    free(temp);
-    return false;
+  default:
+    /* 6. Inherit the synthesized place */
+    if (rest_attrs->place.kind != TAC_OPND_NONE)
+      attrs->place = rest_attrs->place;
+    return SDT_DONE;
   }
-
-  Y1_node->attributes->place = safe_strdup(temp);
-
-  /* Generate Y1 code */
-  sdt_codegen_generate(gen, Y1_node);
-
-  /* Inherit synthesized place */
-  if (Y1_node->attributes->place)
-    node->attributes->place = safe_strdup(Y1_node->attributes->place);
-
-  DEBUG_PRINT("Generated division: %s := %s / %s", temp,
-              node->attributes->place, F_node->attributes->place);
-
-  /* Clean up */
-  free(temp);
-  return true;
-}
-
-/**
- * @brief Semantic action for Y → ε
- *
- * Y.synthesized = Y.inherited;
- * Y.code = '';
- */
-static bool action_Y_EPS(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Y.synthesized = Y.inherited (place already inherited) */
-  DEBUG_PRINT("Executed Y → ε action: place = %s", node->attributes->place);
-  return true;
 }
 
 /**
@@ -919,70 +576,36 @@ static bool action_Y_EPS(SDTCodeGen *gen, SyntaxTreeNode *node) {
  * F.place = E.place;
  * F.code = E.code;
  */
-static bool action_F_PAREN(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Find expression node (should be between parentheses) */
-  SyntaxTreeNode *E_node = find_child_by_name(node, "E", NODE_NONTERMINAL);
-
-  if (!E_node) {
-    DEBUG_PRINT("ERROR: Expression node not found in parenthesized expression");
-    return false;
+static int action_F_PAREN(SDTCodeGen *gen, SDTFrame *frame,
+                          SDTAttributes *attrs, TACOpType op) {
+  (void)op;
+  /* Generate code for expression: [0]='(', [1]=E, [2]=')' */
+  if (frame->step == 0) {
+    return 1;
   }
 
-  /* Generate code for expression */
-  sdt_codegen_generate(gen, E_node);
-
   /* Inherit place from expression */
-  if (!ensure_attributes(node)) {
-    return false;
-  }
+  attrs->place = attr_of(gen, frame->node->children[1])->place;
 
-  if (E_node->attributes && E_node->attributes->place) {
-    node->attributes->place = safe_strdup(E_node->attributes->place);
-    DEBUG_PRINT("Executed F → ( E ) action: place = %s",
-                node->attributes->place);
-  } else {
-    DEBUG_PRINT("WARNING: Expression in parentheses has no place attribute");
-    node->attributes->place = safe_strdup("unknown");
-  }
-
-  return true;
+  DEBUG_PRINT("Executed F → ( E ) action");
+  return SDT_DONE;
 }
 
 /**
  * @brief Semantic action for F → id
  *
- * F.place = id.lexeme;
+ * F.place = lookup(id.lexeme);
  * F.code = '';
  */
-static bool action_F_ID(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  /* Check node validity */
-  if (!node || node->type != NODE_NONTERMINAL || !ensure_attributes(node)) {
-    DEBUG_PRINT("ERROR: Invalid node for F_ID");
-    return false;
-  }
-
-  /* Find the identifier terminal node */
-  SyntaxTreeNode *id_node = find_child_by_name(node, "id", NODE_TERMINAL);
-  if (!id_node) {
-    DEBUG_PRINT("ERROR: Identifier terminal node not found");
-    /* Use a placeholder */
-    static int id_counter = 0;
-    char placeholder[32];
-    snprintf(placeholder, sizeof(placeholder), "id_%d", id_counter++);
-    node->attributes->place = safe_strdup(placeholder);
-    return true;
-  }
-
-  /* Get token string representation (simplified with improved token_to_string)
-   */
-  char token_str[128];
-  token_to_string(&id_node->token, token_str, sizeof(token_str));
-
-  /* Set place to the identifier name */
-  node->attributes->place = safe_strdup(token_str);
-  DEBUG_PRINT("Factor place set to identifier: %s", node->attributes->place);
-
-  return true;
+static int action_F_ID(SDTCodeGen *gen, SDTFrame *frame, SDTAttributes *attrs,
+                       TACOpType op) {
+  (void)op;
+  /* Set place to the interned identifier: [0]=id */
+  SyntaxTreeNode *id_node = frame->node->children[0];
+  attrs->place = sdt_variable(gen, id_node->token.str_val);
+
+  DEBUG_PRINT("Factor place set to identifier: %s", id_node->token.str_val);
+  return SDT_DONE;
 }
 
 /**
@@ -991,35 +614,14 @@ static bool action_F_ID(SDTCodeGen *gen, SyntaxTreeNode *node) {
  * F.place = int.value;
  * F.code = '';
  */
-static bool action_F_INT(SDTCodeGen *gen, SyntaxTreeNode *node) {
-  if (!gen || !node || node->children_count < 1) {
-    return false;
-  }
-
-  SyntaxTreeNode *int_node = node->children[0];
-  if (!int_node || int_node->type != NODE_TERMINAL) {
-    return false;
-  }
-
-  /* Ensure node has attribute structure */
-  if (!ensure_attributes(node)) {
-    return false;
-  }
-
-  /* Get integer value from token's num_value */
-  char num_str[32]; /* Sufficient to store string representation of an int */
-  snprintf(num_str, sizeof(num_str), "%d", int_node->token.num_val);
-
-  /* Set place to the integer value string */
-  if (node->attributes->place) {
-    free(node->attributes->place);
-  }
-  node->attributes->place = safe_strdup(num_str);
-
-  if (!node->attributes->place) {
-    return false;
-  }
-
-  DEBUG_PRINT("Factor place set to integer: %s", node->attributes->place);
-  return true;
+static int action_F_INT(SDTCodeGen *gen, SDTFrame *frame, SDTAttributes *attrs,
+                        TACOpType op) {
+  (void)gen;
+  (void)op;
+  /* Set place to the integer value carried by the token: [0]=int */
+  SyntaxTreeNode *int_node = frame->node->children[0];
+  attrs->place = tac_const(int_node->token.num_val);
+
+  DEBUG_PRINT("Factor place set to integer: %d", int_node->token.num_val);
+  return SDT_DONE;
 }
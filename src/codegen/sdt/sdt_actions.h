@@ -12,10 +12,13 @@
 struct SDTCodeGen; /* Forward declaration */
 
 /**
- * @brief Execute the semantic actions for a node based on its production ID
+ * @brief Execute the semantic actions for a subtree
+ *
+ * Runs the action of each node's production in a depth-first traversal
+ * driven by an explicit work stack, so any depth of nesting is handled.
  *
  * @param gen Code generator
- * @param node Syntax tree node
+ * @param node Root of the subtree
  * @return bool Success status
  */
 bool sdt_execute_action(struct SDTCodeGen *gen, SyntaxTreeNode *node);
@@ -6,51 +6,43 @@
 #ifndef SDT_ATTRIBUTES_H
 #define SDT_ATTRIBUTES_H
 
+#include "backpatch.h"
+#include "codegen/tac.h"
+
+/* Label attribute value meaning "not assigned" */
+#define SDT_NO_LABEL (-1)
+
 /**
  * @brief Attributes for syntax-directed translation
  *
- * Stores both synthesized and inherited attributes for grammar symbols
+ * Stores both synthesized and inherited attributes for grammar symbols.
+ * Attributes are not owned by the syntax tree: the code generator keeps
+ * one array of them, indexed by the id it gives each non-terminal node.
+ * Jump targets are not attributes: jumps are emitted with no target and
+ * collected in lists, which are backpatched when the code they jump to is
+ * reached.
  */
 typedef struct SDTAttributes {
-  char *code;        /* Generated code */
-  char *place;       /* Storage location (variable or temporary) */
-  char *true_label;  /* Label to jump to if condition is true */
-  char *false_label; /* Label to jump to if condition is false */
-  char *next_label;  /* Label for the next statement */
-  char *begin_label; /* Label for the beginning of a loop */
+  TACOperand place; /* Storage location (variable, temporary or constant) */
+  int truelist;     /* Jumps taken when a condition holds; for a while, the
+                       jumps to its entry (inherited) */
+  int falselist;    /* Jumps taken when a condition fails */
+  int nextlist;     /* Jumps to the statement after this one */
 } SDTAttributes;
 
-// typedef struct SDTAttributes SDTAttributes;
-
 /**
- * @brief Create a new attributes structure
+ * @brief Create an array of unassigned attributes
  *
- * @return SDTAttributes* Created attributes, or NULL on failure
+ * @param count Number of attribute records
+ * @return SDTAttributes* Created array, or NULL on failure
  */
-SDTAttributes *sdt_attributes_create(void);
+SDTAttributes *sdt_attributes_create(int count);
 
 /**
- * @brief Free attributes resources
+ * @brief Free an attribute array
  *
  * @param attrs Attributes to destroy
  */
 void sdt_attributes_destroy(SDTAttributes *attrs);
 
-/**
- * @brief Concatenate two code sequences
- *
- * @param code1 First code sequence (can be NULL)
- * @param code2 Second code sequence (can be NULL)
- * @return char* Concatenated code, or NULL on failure
- */
-char *sdt_code_concat(const char *code1, const char *code2);
-
-/**
- * @brief Make a copy of attributes
- *
- * @param attrs Attributes to copy
- * @return SDTAttributes* Copied attributes, or NULL on failure
- */
-SDTAttributes *sdt_attributes_copy(const SDTAttributes *attrs);
-
 #endif /* SDT_ATTRIBUTES_H */
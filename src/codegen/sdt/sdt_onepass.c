@@ -0,0 +1,269 @@
+/**
+ * @file codegen/sdt/sdt_onepass.c
+ * @brief Semantic actions run by an LR parser as it shifts and reduces
+ *
+ * Every symbol on the parser stack has a value at the same depth on the
+ * code generator's value stack. Synthesized attributes are computed when a
+ * production is reduced, from the values of its right-hand side. The only
+ * inherited attributes of the grammar are handled without a syntax tree:
+ *
+ *  - The left operand of X → + R X1 and Y → * F Y1 is the value of the
+ *    symbol just below the operator, so the operation is emitted as soon
+ *    as the right operand R or F is reduced, and the running result is
+ *    left in that operand's value.
+ *  - Jump targets are not known when the jumps are emitted; they are
+ *    collected in truelist, falselist and nextlist and backpatched once
+ *    the parser reaches the code they jump to.
+ *
+ * Labels are emitted in the same order as by the tree-walking actions, so
+ * both produce the same code.
+ */
+#include "backpatch.h"
+#include "codegen/sdt_codegen.h"
+#include "codegen/tac.h"
+#include "parser/grammar.h"
+#include "sdt_attributes.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Attributes of a symbol on the parser stack
+ */
+typedef struct SDTValue {
+  const Token *token; /* Shifted terminal, NULL for a non-terminal */
+  TACOperand place;   /* Value of an expression */
+  int truelist;       /* Jumps taken when a condition holds */
+  int falselist;      /* Jumps taken when a condition fails */
+  int nextlist;       /* Jumps to the statement after this one */
+  int label;          /* Entry label of a shifted while */
+  bool loop;          /* Statement is a while loop */
+} SDTValue;
+
+/**
+ * @brief Get the value at a stack depth, growing the value stack
+ */
+static SDTValue *value_at(SDTCodeGen *gen, int depth) {
+  if (depth >= gen->value_capacity) {
+    int capacity = gen->value_capacity ? gen->value_capacity : 128;
+    while (capacity <= depth) {
+      capacity *= 2;
+    }
+    gen->values =
+        (SDTValue *)safe_realloc(gen->values, capacity * sizeof(SDTValue));
+    memset(gen->values + gen->value_capacity, 0,
+           (capacity - gen->value_capacity) * sizeof(SDTValue));
+    gen->value_capacity = capacity;
+  }
+  return &gen->values[depth];
+}
+
+/**
+ * @brief Check the terminal shifted at a stack depth
+ */
+static bool token_is(SDTCodeGen *gen, int depth, TokenType type) {
+  return depth > 0 && gen->values[depth].token &&
+         gen->values[depth].token->type == type;
+}
+
+/**
+ * @brief Fold an operand into the running value of an operator tail
+ *
+ * When the symbol below an operand is one of the operators, the symbol
+ * below that holds the left operand: emit the operation and make its
+ * result the operand's place.
+ *
+ * @return bool false if a temporary cannot be allocated
+ */
+static bool fold_operand(SDTCodeGen *gen, int depth, SDTValue *value,
+                         TokenType add, TACOpType add_op, TokenType sub,
+                         TACOpType sub_op) {
+  TACOpType op;
+  if (token_is(gen, depth - 1, add)) {
+    op = add_op;
+  } else if (token_is(gen, depth - 1, sub)) {
+    op = sub_op;
+  } else {
+    return true;
+  }
+
+  TACOperand temp = sdt_new_temp(gen);
+  if (temp.kind == TAC_OPND_NONE) {
+    return false;
+  }
+  tac_program_add_inst(gen->program, op, temp, gen->values[depth - 2].place,
+                       value->place, 0);
+  value->place = temp;
+  return true;
+}
+
+/**
+ * @brief Run the action of a shifted terminal
+ */
+bool sdt_codegen_shift(SDTCodeGen *gen, int depth, const Token *token) {
+  if (!gen || depth <= 0) {
+    return false;
+  }
+
+  SDTValue *value = value_at(gen, depth);
+  *value = (SDTValue){token, tac_none(), JUMP_LIST_EMPTY, JUMP_LIST_EMPTY,
+                      JUMP_LIST_EMPTY, SDT_NO_LABEL, false};
+
+  /* The first token of the body of an if or a while: the condition's true
+   * jumps go here, or to the loop's entry if the body is a while */
+  int body = JUMP_LIST_EMPTY;
+  if (token_is(gen, depth - 1, TK_THEN) || token_is(gen, depth - 1, TK_DO)) {
+    body = gen->values[depth - 2].truelist;
+    gen->values[depth - 2].truelist = JUMP_LIST_EMPTY;
+  }
+
+  switch (token->type) {
+  case TK_WHILE:
+    /* The condition is about to be emitted: it starts the loop */
+    value->label = sdt_emit_label(gen, body);
+    break;
+
+  case TK_ELSE: {
+    /* Below: if C then S1. Leave the then branch, unless it is a loop
+     * that never falls through, and start the else branch */
+    SDTValue *C = &gen->values[depth - 3];
+    if (!gen->values[depth - 1].loop) {
+      value->nextlist =
+          sdt_emit_jump(gen, TAC_OP_GOTO, tac_none(), tac_none());
+    }
+    sdt_emit_target(gen, C->falselist);
+    C->falselist = JUMP_LIST_EMPTY;
+    break;
+  }
+
+  default:
+    sdt_emit_target(gen, body);
+    break;
+  }
+  return true;
+}
+
+/**
+ * @brief Run the action of a reduced production
+ */
+bool sdt_codegen_reduce(SDTCodeGen *gen, int depth, int production_id,
+                        int length) {
+  if (!gen || depth <= 0) {
+    return false;
+  }
+
+  /* The right-hand side is at depth .. depth + length - 1 */
+  value_at(gen, depth + length);
+  SDTValue *rhs = &gen->values[depth];
+  SDTValue *below = &gen->values[depth - 1];
+  SDTValue lhs = {NULL, tac_none(), JUMP_LIST_EMPTY, JUMP_LIST_EMPTY,
+                  JUMP_LIST_EMPTY, SDT_NO_LABEL, false};
+
+  switch (production_id) {
+  case PROD_L_S_SEMI:
+    /* The next statement starts here */
+    sdt_emit_target(gen, rhs[0].nextlist);
+    break;
+
+  case PROD_S_ASSIGN:
+    tac_program_add_inst(gen->program, TAC_OP_ASSIGN,
+                         sdt_variable(gen, rhs[0].token->str_val),
+                         rhs[2].place, tac_none(), 0);
+    break;
+
+  case PROD_S_IF_C_THEN_S_N:
+    /* Without an else, the false jumps leave the statement too */
+    lhs.nextlist = jump_list_merge(
+        gen->jump_lists,
+        jump_list_merge(gen->jump_lists, rhs[3].nextlist, rhs[4].nextlist),
+        rhs[1].falselist);
+    break;
+
+  case PROD_S_WHILE_C_DO_S:
+    jump_list_backpatch(gen->jump_lists, gen->program, rhs[3].nextlist,
+                        rhs[0].label);
+    tac_program_add_inst(gen->program, TAC_OP_GOTO, tac_label(rhs[0].label),
+                         tac_none(), tac_none(), 0);
+    lhs.nextlist = rhs[1].falselist;
+    lhs.loop = true;
+    break;
+
+  case PROD_S_BEGIN_L_END:
+    lhs.nextlist = rhs[1].nextlist;
+    break;
+
+  case PROD_N_ELSE_S:
+    lhs.nextlist =
+        jump_list_merge(gen->jump_lists, rhs[0].nextlist, rhs[1].nextlist);
+    break;
+
+  case PROD_C_E_O:
+  case PROD_C_PAREN:
+    lhs.truelist = rhs[1].truelist;
+    lhs.falselist = rhs[1].falselist;
+    break;
+
+  case PROD_O_GT:
+  case PROD_O_LT:
+  case PROD_O_EQ:
+  case PROD_O_GE:
+  case PROD_O_LE:
+  case PROD_O_NE: {
+    static const TACOpType relops[] = {TAC_OP_GT, TAC_OP_LT, TAC_OP_EQ,
+                                       TAC_OP_GE, TAC_OP_LE, TAC_OP_NE};
+    /* The left operand is the E below O */
+    lhs.truelist = sdt_emit_jump(gen, relops[production_id - PROD_O_GT],
+                                 below->place, rhs[1].place);
+    lhs.falselist = sdt_emit_jump(gen, TAC_OP_GOTO, tac_none(), tac_none());
+    break;
+  }
+
+  case PROD_E_R_X:
+  case PROD_R_F_Y:
+    lhs.place = rhs[1].place;
+    if (production_id == PROD_R_F_Y &&
+        !fold_operand(gen, depth, &lhs, TK_ADD, TAC_OP_ADD, TK_SUB,
+                      TAC_OP_SUB)) {
+      return false;
+    }
+    break;
+
+  case PROD_X_PLUS_R_X:
+  case PROD_X_MINUS_R_X:
+  case PROD_Y_MUL_F_Y:
+  case PROD_Y_DIV_F_Y:
+    lhs.place = rhs[2].place;
+    break;
+
+  case PROD_X_EPSILON:
+  case PROD_Y_EPSILON:
+    /* The tail ends: its value is the running one, below it */
+    lhs.place = below->place;
+    break;
+
+  case PROD_F_PAREN:
+  case PROD_F_ID:
+  case PROD_F_INT8:
+  case PROD_F_INT10:
+  case PROD_F_INT16:
+    if (production_id == PROD_F_PAREN) {
+      lhs.place = rhs[1].place;
+    } else if (production_id == PROD_F_ID) {
+      lhs.place = sdt_variable(gen, rhs[0].token->str_val);
+    } else {
+      lhs.place = tac_const(rhs[0].token->num_val);
+    }
+    if (!fold_operand(gen, depth, &lhs, TK_MUL, TAC_OP_MUL, TK_DIV,
+                      TAC_OP_DIV)) {
+      return false;
+    }
+    break;
+
+  default:
+    /* P → L T, T → P T and the empty tails generate nothing */
+    break;
+  }
+
+  *rhs = lhs;
+  return true;
+}
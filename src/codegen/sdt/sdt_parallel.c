@@ -0,0 +1,235 @@
+/**
+ * @file codegen/sdt/sdt_parallel.c
+ * @brief Parallel code generation for the top-level statements
+ *
+ * A top-level statement only shares temporary, label and variable
+ * numbering with the rest of the program: every jump it emits targets a
+ * label of its own. The statements on the P → L T spine are split into
+ * contiguous ranges, each translated by a thread into a fragment with its
+ * own counters, and the fragments are then appended in order, renumbering
+ * their temporaries and labels by the counts of the fragments before them
+ * and their variables in order of first use. Temporaries and labels are
+ * numbered in emission order, so the result is the serial output.
+ */
+#include "codegen/sdt_codegen.h"
+#include "codegen/tac.h"
+#include "label_manager/label_manager.h"
+#include "parser/grammar.h"
+#include "parser/syntax_tree.h"
+#include "sdt_actions.h"
+#include "sdt_attributes.h"
+#include "symbol_table/symbol_table.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * @brief A range of top-level statements and the fragment translating them
+ */
+typedef struct SDTFragment {
+  SyntaxTreeNode **statements; /* First L node of the range */
+  int count;                   /* Number of statements */
+  SDTCodeGen *gen;             /* Code generator owning the fragment */
+  bool ok;                     /* The statements were translated */
+} SDTFragment;
+
+/**
+ * @brief Collect the L nodes of the P → L T spine
+ *
+ * @return SyntaxTreeNode** Statements in source order, or NULL if the tree
+ * does not have the shape of a program
+ */
+static SyntaxTreeNode **collect_statements(SyntaxTreeNode *root, int *count) {
+  int capacity = 1024;
+  SyntaxTreeNode **statements =
+      (SyntaxTreeNode **)safe_malloc(capacity * sizeof(SyntaxTreeNode *));
+  *count = 0;
+
+  SyntaxTreeNode *P = root;
+  for (;;) {
+    if (P->production_id != PROD_P_LT || P->children_count != 2) {
+      free(statements);
+      return NULL;
+    }
+    if (*count == capacity) {
+      capacity *= 2;
+      statements = (SyntaxTreeNode **)safe_realloc(
+          statements, capacity * sizeof(SyntaxTreeNode *));
+    }
+    statements[(*count)++] = P->children[0];
+
+    SyntaxTreeNode *T = P->children[1];
+    if (T->production_id != PROD_T_PT || T->children_count != 2) {
+      break;
+    }
+    P = T->children[0];
+  }
+  return statements;
+}
+
+/**
+ * @brief Thread body: translate a range of statements into its fragment
+ */
+static void *translate_fragment(void *arg) {
+  SDTFragment *fragment = (SDTFragment *)arg;
+  fragment->ok = true;
+  for (int i = 0; i < fragment->count && fragment->ok; i++) {
+    fragment->ok = sdt_execute_action(fragment->gen, fragment->statements[i]);
+  }
+  if (!fragment->ok && !fragment->gen->has_error) {
+    sdt_set_error(fragment->gen, "Malformed syntax tree");
+  }
+  return NULL;
+}
+
+/**
+ * @brief Move an operand of a fragment into the program's numbering
+ */
+static inline TACOperand rebase(TACOperand operand, const int *vars,
+                                int temp_base, int label_base) {
+  switch (operand.kind) {
+  case TAC_OPND_VAR:
+    operand.id = vars[operand.id];
+    break;
+  case TAC_OPND_TEMP:
+    operand.id += temp_base;
+    break;
+  case TAC_OPND_LABEL:
+    operand.id += label_base;
+    break;
+  default:
+    break;
+  }
+  return operand;
+}
+
+/**
+ * @brief Append a fragment to the program, renumbering its ids
+ */
+static bool append_fragment(SDTCodeGen *gen, const SDTCodeGen *part) {
+  const TACProgram *code = part->program;
+
+  /* Variables keep the order of their first use */
+  int *vars = (int *)safe_malloc(((size_t)code->var_count + 1) * sizeof(int));
+  for (int i = 0; i < code->var_count; i++) {
+    TACOperand var = sdt_variable(gen, code->var_names[i]);
+    if (var.kind == TAC_OPND_NONE) {
+      free(vars);
+      return false;
+    }
+    vars[i] = var.id;
+  }
+
+  /* Temporaries and labels follow those of the previous fragments */
+  int temp_base = gen->symbol_table->temp_count;
+  int label_base = gen->label_manager->label_counter;
+  for (int i = 0; i < part->symbol_table->temp_count; i++) {
+    symbol_table_new_temp(gen->symbol_table);
+  }
+  gen->label_manager->label_counter += part->label_manager->label_counter;
+
+  for (int i = 0; i < code->count; i++) {
+    const TACInst *inst = &code->instructions[i];
+    tac_program_add_inst(gen->program, inst->op,
+                         rebase(inst->result, vars, temp_base, label_base),
+                         rebase(inst->arg1, vars, temp_base, label_base),
+                         rebase(inst->arg2, vars, temp_base, label_base),
+                         inst->lineno);
+  }
+
+  free(vars);
+  return true;
+}
+
+/**
+ * @brief Generate three-address code for a syntax tree on several threads
+ */
+void sdt_codegen_generate_parallel(SDTCodeGen *gen, const SyntaxTree *tree,
+                                   int threads) {
+  if (!gen || !tree || !tree->root) {
+    return;
+  }
+
+  int count;
+  SyntaxTreeNode **statements = collect_statements(tree->root, &count);
+  if (!statements || threads <= 1 || count < threads) {
+    free(statements);
+    sdt_codegen_generate(gen, tree);
+    return;
+  }
+
+  /* The fragments share the attributes: statements own disjoint ids */
+  sdt_attributes_destroy(gen->attributes);
+  gen->attributes = sdt_attributes_create(tree->node_count);
+  gen->node_count = tree->node_count;
+  if (!gen->attributes) {
+    free(statements);
+    sdt_set_error(gen, "Failed to allocate attributes");
+    return;
+  }
+
+  /* Split the statements into ranges of about the same number of nodes,
+   * estimated from the ids the parser gave them in order */
+  SDTFragment *fragments =
+      (SDTFragment *)safe_malloc(threads * sizeof(SDTFragment));
+  pthread_t *workers = (pthread_t *)safe_malloc(threads * sizeof(pthread_t));
+  int first_id = statements[0]->id;
+  int span = statements[count - 1]->id - first_id + 1;
+  int begin = 0;
+  for (int t = 0; t < threads; t++) {
+    int end = begin;
+    long long limit = first_id + (long long)span * (t + 1) / threads;
+    while (end < count && (t == threads - 1 || statements[end]->id < limit)) {
+      end++;
+    }
+    fragments[t].statements = statements + begin;
+    fragments[t].count = end - begin;
+    fragments[t].gen = sdt_codegen_create();
+    fragments[t].ok = false;
+    if (fragments[t].gen) {
+      fragments[t].gen->attributes = gen->attributes;
+      fragments[t].gen->node_count = gen->node_count;
+    }
+    begin = end;
+  }
+
+  /* Translate, then append the fragments in statement order */
+  int started = 0;
+  for (; started < threads; started++) {
+    if (!fragments[started].gen) {
+      sdt_set_error(gen, "Failed to allocate code generator for thread %d",
+                    started);
+      break;
+    }
+    if (pthread_create(&workers[started], NULL, translate_fragment,
+                       &fragments[started]) != 0) {
+      sdt_set_error(gen, "Failed to create thread %d", started);
+      break;
+    }
+  }
+  bool ok = (started == threads);
+  for (int t = 0; t < started; t++) {
+    pthread_join(workers[t], NULL);
+    if (ok && !fragments[t].ok) {
+      sdt_set_error(gen, "%s", fragments[t].gen->error_message);
+      ok = false;
+    }
+  }
+  for (int t = 0; t < threads && ok; t++) {
+    ok = append_fragment(gen, fragments[t].gen);
+    if (!ok) {
+      sdt_set_error(gen, "Failed to allocate variables");
+    }
+  }
+
+  DEBUG_PRINT("Generated %d statements on %d threads", count, threads);
+  for (int t = 0; t < threads; t++) {
+    if (fragments[t].gen) {
+      fragments[t].gen->attributes = NULL;
+      sdt_codegen_destroy(fragments[t].gen);
+    }
+  }
+  free(workers);
+  free(fragments);
+  free(statements);
+}
@@ -12,6 +12,25 @@
 /* Initial capacity for the symbol table */
 #define INITIAL_CAPACITY 16
 
+/* Initial number of hash slots (power of two) */
+#define INITIAL_BUCKETS 32
+
+/* Bucket markers */
+#define BUCKET_EMPTY (-1)
+#define BUCKET_DELETED (-2)
+
+/**
+ * @brief FNV-1a hash of a symbol name
+ */
+static unsigned int hash_name(const char *name) {
+  unsigned int hash = 2166136261u;
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
 /**
  * @brief Create a new symbol table
  */
@@ -24,19 +43,102 @@ SymbolTable *symbol_table_create(void) {
   /* Initialize fields */
   table->entries = (SymbolTableEntry *)safe_malloc(INITIAL_CAPACITY *
                                                    sizeof(SymbolTableEntry));
-  if (!table->entries) {
+  table->buckets = (int *)safe_malloc(INITIAL_BUCKETS * sizeof(int));
+  table->scope_marks = (int *)safe_malloc(INITIAL_CAPACITY * sizeof(int));
+  table->temps = (SymbolTableTemp *)safe_malloc(INITIAL_CAPACITY *
+                                                sizeof(SymbolTableTemp));
+  if (!table->entries || !table->buckets || !table->scope_marks ||
+      !table->temps) {
+    free(table->entries);
+    free(table->buckets);
+    free(table->scope_marks);
+    free(table->temps);
     free(table);
     return NULL;
   }
 
   table->count = 0;
   table->capacity = INITIAL_CAPACITY;
+  for (int i = 0; i < INITIAL_BUCKETS; i++) {
+    table->buckets[i] = BUCKET_EMPTY;
+  }
+  table->bucket_count = INITIAL_BUCKETS;
+  table->bucket_filled = 0;
+  table->scope_depth = 0;
+  table->scope_capacity = INITIAL_CAPACITY;
   table->temp_count = 0;
+  table->temp_capacity = INITIAL_CAPACITY;
 
   DEBUG_PRINT("Created symbol table with capacity %d", table->capacity);
   return table;
 }
 
+/**
+ * @brief Find the slot holding the innermost entry for a name
+ *
+ * @return int Slot index, or -1 if the name is not present
+ */
+static int find_slot(const SymbolTable *table, const char *name,
+                     unsigned int hash) {
+  unsigned int mask = (unsigned int)table->bucket_count - 1;
+  for (unsigned int slot = hash & mask;; slot = (slot + 1) & mask) {
+    int index = table->buckets[slot];
+    if (index == BUCKET_EMPTY) {
+      return -1;
+    }
+    if (index != BUCKET_DELETED && table->entries[index].hash == hash &&
+        strcmp(table->entries[index].name, name) == 0) {
+      return (int)slot;
+    }
+  }
+}
+
+/**
+ * @brief Find a free slot for a name known to be absent
+ */
+static int free_slot(const SymbolTable *table, unsigned int hash) {
+  unsigned int mask = (unsigned int)table->bucket_count - 1;
+  unsigned int slot = hash & mask;
+  while (table->buckets[slot] >= 0) {
+    slot = (slot + 1) & mask;
+  }
+  return (int)slot;
+}
+
+/**
+ * @brief Rebuild the hash slots, growing when they fill up
+ *
+ * Entries are reinserted in declaration order so that the innermost
+ * declaration of a shadowed name ends up in the slot.
+ */
+static bool rehash(SymbolTable *table, int bucket_count) {
+  int *buckets = (int *)safe_malloc(bucket_count * sizeof(int));
+  if (!buckets) {
+    return false;
+  }
+
+  free(table->buckets);
+  table->buckets = buckets;
+  table->bucket_count = bucket_count;
+  table->bucket_filled = 0;
+  for (int i = 0; i < bucket_count; i++) {
+    buckets[i] = BUCKET_EMPTY;
+  }
+
+  for (int i = 0; i < table->count; i++) {
+    SymbolTableEntry *entry = &table->entries[i];
+    int slot = find_slot(table, entry->name, entry->hash);
+    if (slot < 0) {
+      slot = free_slot(table, entry->hash);
+      table->bucket_filled++;
+    }
+    buckets[slot] = i;
+  }
+
+  DEBUG_PRINT("Rehashed symbol table to %d slots", bucket_count);
+  return true;
+}
+
 /**
  * @brief Ensure the symbol table has enough capacity
  */
@@ -55,9 +157,62 @@ static bool ensure_capacity(SymbolTable *table) {
     DEBUG_PRINT("Expanded symbol table to capacity %d", table->capacity);
   }
 
+  /* Keep the load factor (including deleted slots) below 3/4 */
+  if ((table->bucket_filled + 1) * 4 >= table->bucket_count * 3) {
+    int bucket_count = table->bucket_count;
+    if ((table->count + 1) * 2 >= bucket_count) {
+      bucket_count *= 2;
+    }
+    return rehash(table, bucket_count);
+  }
+
   return true;
 }
 
+/**
+ * @brief Declare a named symbol in the current scope
+ *
+ * @return SymbolTableEntry* New entry, or NULL if the name already exists
+ * in this scope or on allocation failure
+ */
+static SymbolTableEntry *declare(SymbolTable *table, const char *name,
+                                 SymbolTableEntryType type) {
+  unsigned int hash = hash_name(name);
+  int slot = find_slot(table, name, hash);
+  if (slot >= 0 &&
+      table->entries[table->buckets[slot]].scope == table->scope_depth) {
+    return NULL; /* Already exists */
+  }
+
+  /* Ensure capacity (may rehash, so look the slot up again) */
+  if (!ensure_capacity(table)) {
+    return NULL;
+  }
+  slot = find_slot(table, name, hash);
+
+  int index = table->count++;
+  SymbolTableEntry *entry = &table->entries[index];
+  entry->name = safe_strdup(name);
+  entry->type = type;
+  entry->id = -1;
+  entry->value = 0;
+  entry->size = sizeof(int);
+  entry->offset = 0;
+  entry->initialized = false;
+  entry->hash = hash;
+  entry->scope = table->scope_depth;
+  entry->shadowed = slot >= 0 ? table->buckets[slot] : -1;
+
+  if (slot < 0) {
+    slot = free_slot(table, hash);
+    if (table->buckets[slot] == BUCKET_EMPTY) {
+      table->bucket_filled++;
+    }
+  }
+  table->buckets[slot] = index;
+  return entry;
+}
+
 /**
  * @brief Add a variable to the symbol table
  */
@@ -66,25 +221,13 @@ bool symbol_table_add_variable(SymbolTable *table, const char *name, int size) {
     return false;
   }
 
-  /* Check if variable already exists */
-  for (int i = 0; i < table->count; i++) {
-    if (strcmp(table->entries[i].name, name) == 0) {
-      return false; /* Already exists */
-    }
-  }
-
-  /* Ensure capacity */
-  if (!ensure_capacity(table)) {
+  SymbolTableEntry *entry = declare(table, name, SYM_VARIABLE);
+  if (!entry) {
     return false;
   }
 
-  /* Add the variable */
-  SymbolTableEntry *entry = &table->entries[table->count++];
-  entry->name = safe_strdup(name);
-  entry->type = SYM_VARIABLE;
   entry->size = size;
   entry->offset = 0; /* Will be computed later */
-  entry->initialized = false;
 
   DEBUG_PRINT("Added variable %s to symbol table", name);
   return true;
@@ -99,25 +242,12 @@ bool symbol_table_add_constant(SymbolTable *table, const char *name,
     return false;
   }
 
-  /* Check if constant already exists */
-  for (int i = 0; i < table->count; i++) {
-    if (strcmp(table->entries[i].name, name) == 0) {
-      return false; /* Already exists */
-    }
-  }
-
-  /* Ensure capacity */
-  if (!ensure_capacity(table)) {
+  SymbolTableEntry *entry = declare(table, name, SYM_CONSTANT);
+  if (!entry) {
     return false;
   }
 
-  /* Add the constant */
-  SymbolTableEntry *entry = &table->entries[table->count++];
-  entry->name = safe_strdup(name);
-  entry->type = SYM_CONSTANT;
   entry->value = value;
-  entry->size = sizeof(int);
-  entry->offset = 0; /* Constants don't have offsets */
   entry->initialized = true;
 
   DEBUG_PRINT("Added constant %s with value %d to symbol table", name, value);
@@ -127,30 +257,30 @@ bool symbol_table_add_constant(SymbolTable *table, const char *name,
 /**
  * @brief Generate a new temporary variable
  */
-char *symbol_table_new_temp(SymbolTable *table) {
+int symbol_table_new_temp(SymbolTable *table) {
   if (!table) {
-    return NULL;
+    return -1;
   }
 
-  /* Generate name */
-  char name[32];
-  snprintf(name, sizeof(name), "t%d", table->temp_count++);
+  if (table->temp_count >= table->temp_capacity) {
+    int new_capacity = table->temp_capacity * 2;
+    SymbolTableTemp *new_temps = (SymbolTableTemp *)safe_realloc(
+        table->temps, new_capacity * sizeof(SymbolTableTemp));
+    if (!new_temps) {
+      return -1;
+    }
 
-  /* Ensure capacity */
-  if (!ensure_capacity(table)) {
-    return NULL;
+    table->temps = new_temps;
+    table->temp_capacity = new_capacity;
   }
 
   /* Add the temporary */
-  SymbolTableEntry *entry = &table->entries[table->count++];
-  entry->name = safe_strdup(name);
-  entry->type = SYM_TEMPORARY;
-  entry->size = sizeof(int); /* Assume int for temporaries */
-  entry->offset = 0;         /* Will be computed later */
-  entry->initialized = false;
+  int id = table->temp_count++;
+  table->temps[id].size = sizeof(int); /* Assume int for temporaries */
+  table->temps[id].offset = 0;         /* Will be computed later */
 
-  DEBUG_PRINT("Added temporary %s to symbol table", name);
-  return safe_strdup(name);
+  DEBUG_PRINT("Added temporary t%d to symbol table", id);
+  return id;
 }
 
 /**
@@ -161,14 +291,61 @@ SymbolTableEntry *symbol_table_lookup(SymbolTable *table, const char *name) {
     return NULL;
   }
 
-  /* Linear search for the symbol */
-  for (int i = 0; i < table->count; i++) {
-    if (strcmp(table->entries[i].name, name) == 0) {
-      return &table->entries[i];
+  int slot = find_slot(table, name, hash_name(name));
+  if (slot < 0) {
+    return NULL; /* Not found */
+  }
+
+  return &table->entries[table->buckets[slot]];
+}
+
+/**
+ * @brief Enter a nested scope
+ */
+bool symbol_table_enter_scope(SymbolTable *table) {
+  if (!table) {
+    return false;
+  }
+
+  if (table->scope_depth >= table->scope_capacity) {
+    int new_capacity = table->scope_capacity * 2;
+    int *new_marks =
+        (int *)safe_realloc(table->scope_marks, new_capacity * sizeof(int));
+    if (!new_marks) {
+      return false;
     }
+
+    table->scope_marks = new_marks;
+    table->scope_capacity = new_capacity;
+  }
+
+  table->scope_marks[table->scope_depth++] = table->count;
+  DEBUG_PRINT("Entered scope %d", table->scope_depth);
+  return true;
+}
+
+/**
+ * @brief Exit the current scope, dropping the symbols declared in it
+ */
+bool symbol_table_exit_scope(SymbolTable *table) {
+  if (!table || table->scope_depth == 0) {
+    return false;
   }
 
-  return NULL; /* Not found */
+  int mark = table->scope_marks[--table->scope_depth];
+
+  /* Unwind in reverse so each slot falls back to the entry it shadowed */
+  for (int i = table->count - 1; i >= mark; i--) {
+    SymbolTableEntry *entry = &table->entries[i];
+    int slot = find_slot(table, entry->name, entry->hash);
+    table->buckets[slot] =
+        entry->shadowed >= 0 ? entry->shadowed : BUCKET_DELETED;
+    free(entry->name);
+  }
+  table->count = mark;
+
+  DEBUG_PRINT("Exited scope %d", table->scope_depth + 1);
+  return true;
 }
 
 /**
@@ -179,7 +356,7 @@ void symbol_table_print(const SymbolTable *table) {
     return;
   }
 
-  printf("Symbol Table (%d entries):\n", table->count);
+  printf("Symbol Table (%d entries):\n", table->count + table->temp_count);
   printf("-----------------------------\n");
   printf("%-10s %-10s %-8s %-8s %-8s\n", "Name", "Type", "Value", "Size",
          "Offset");
@@ -206,6 +383,13 @@ void symbol_table_print(const SymbolTable *table) {
 
     printf("%-8d %-8d\n", entry->size, entry->offset);
   }
+
+  for (int i = 0; i < table->temp_count; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "t%d", i);
+    printf("%-10s %-10s %-8s %-8d %-8d\n", name, "Temporary", "-",
+           table->temps[i].size, table->temps[i].offset);
+  }
   printf("-----------------------------\n");
 }
 
@@ -224,6 +408,9 @@ void symbol_table_destroy(SymbolTable *table) {
 
   /* Free the table itself */
   free(table->entries);
+  free(table->buckets);
+  free(table->scope_marks);
+  free(table->temps);
   free(table);
 
   DEBUG_PRINT("Destroyed symbol table");
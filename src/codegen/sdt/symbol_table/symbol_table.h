@@ -23,20 +23,50 @@ typedef enum SymbolTableEntryType {
 typedef struct SymbolTableEntry {
   char *name;                /* Symbol name */
   SymbolTableEntryType type; /* Symbol type */
+  int id;                    /* TAC operand id (variable or temporary) */
   int value;                 /* Value for constants */
   int size;                  /* Size in bytes */
   int offset;                /* Memory offset */
   bool initialized;          /* Initialization status */
+  unsigned int hash;         /* Precomputed hash of name */
+  int scope;                 /* Scope depth the symbol was declared in */
+  int shadowed;              /* Entry hidden by this one, or -1 */
 } SymbolTableEntry;
 
+/**
+ * @brief Compiler temporary, stored apart from named symbols
+ */
+typedef struct SymbolTableTemp {
+  int size;   /* Size in bytes */
+  int offset; /* Memory offset */
+} SymbolTableTemp;
+
 /**
  * @brief Symbol table structure
+ *
+ * Named symbols live in a dense entry array indexed through an
+ * open-addressing hash table (linear probing) keyed by precomputed name
+ * hashes, so lookups do not depend on the number of symbols. Scopes form a
+ * stack: a declaration in an inner scope shadows outer ones until the scope
+ * is exited. Temporaries are only ever created, never looked up by name, so
+ * they are kept in a separate dense array.
  */
 typedef struct SymbolTable {
-  SymbolTableEntry *entries; /* Array of symbols */
-  int count;                 /* Number of symbols */
+  SymbolTableEntry *entries; /* Array of named symbols */
+  int count;                 /* Number of named symbols */
   int capacity;              /* Capacity of the symbol array */
-  int temp_count;            /* Counter for generating temporaries */
+
+  int *buckets;      /* Entry index per slot, or an empty/deleted marker */
+  int bucket_count;  /* Number of slots (power of two) */
+  int bucket_filled; /* Slots holding an entry or a deleted marker */
+
+  int *scope_marks;   /* Entry count at each scope entry */
+  int scope_depth;    /* Current scope depth (0 = global) */
+  int scope_capacity; /* Capacity of scope_marks */
+
+  SymbolTableTemp *temps; /* Array of temporaries indexed by id */
+  int temp_count;         /* Counter for generating temporaries */
+  int temp_capacity;      /* Capacity of the temporaries array */
 } SymbolTable;
 
 /**
@@ -47,22 +77,22 @@ typedef struct SymbolTable {
 SymbolTable *symbol_table_create(void);
 
 /**
- * @brief Add a variable to the symbol table
+ * @brief Add a variable to the current scope
  *
  * @param table Symbol table
  * @param name Variable name
  * @param size Size in bytes
- * @return bool Success status
+ * @return bool Success status (false if the name exists in this scope)
  */
 bool symbol_table_add_variable(SymbolTable *table, const char *name, int size);
 
 /**
- * @brief Add a constant to the symbol table
+ * @brief Add a constant to the current scope
  *
  * @param table Symbol table
  * @param name Constant name
  * @param value Constant value
- * @return bool Success status
+ * @return bool Success status (false if the name exists in this scope)
  */
 bool symbol_table_add_constant(SymbolTable *table, const char *name, int value);
 
@@ -70,12 +100,14 @@ bool symbol_table_add_constant(SymbolTable *table, const char *name, int value);
  * @brief Generate a new temporary variable
  *
  * @param table Symbol table
- * @return char* Name of the temporary, or NULL on failure
+ * @return int Id of the temporary, or -1 on failure
  */
-char *symbol_table_new_temp(SymbolTable *table);
+int symbol_table_new_temp(SymbolTable *table);
 
 /**
- * @brief Look up a symbol by name
+ * @brief Look up a symbol by name, innermost scope first
+ *
+ * Entry pointers are invalidated by adding symbols or exiting scopes.
  *
  * @param table Symbol table
  * @param name Symbol name
@@ -83,6 +115,22 @@ char *symbol_table_new_temp(SymbolTable *table);
  */
 SymbolTableEntry *symbol_table_lookup(SymbolTable *table, const char *name);
 
+/**
+ * @brief Enter a nested scope
+ *
+ * @param table Symbol table
+ * @return bool Success status
+ */
+bool symbol_table_enter_scope(SymbolTable *table);
+
+/**
+ * @brief Exit the current scope, dropping the symbols declared in it
+ *
+ * @param table Symbol table
+ * @return bool Success status (false at global scope)
+ */
+bool symbol_table_exit_scope(SymbolTable *table);
+
 /**
  * @brief Print the symbol table contents
  *
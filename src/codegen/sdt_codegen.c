@@ -5,6 +5,7 @@
 
 #include "codegen/sdt_codegen.h"
 #include "parser/syntax_tree.h"
+#include "sdt/backpatch.h"
 #include "sdt/label_manager/label_manager.h"
 #include "sdt/sdt_actions.h"
 #include "sdt/sdt_attributes.h"
@@ -28,11 +29,16 @@ SDTCodeGen *sdt_codegen_create(void) {
   gen->program = tac_program_create();
   gen->symbol_table = symbol_table_create();
   gen->label_manager = label_manager_create();
-  gen->curr_attr = NULL;
+  gen->attributes = NULL;
+  gen->node_count = 0;
+  gen->jump_lists = jump_lists_create();
+  gen->values = NULL;
+  gen->value_capacity = 0;
   gen->has_error = false;
   memset(gen->error_message, 0, sizeof(gen->error_message));
 
-  if (!gen->program || !gen->symbol_table || !gen->label_manager) {
+  if (!gen->program || !gen->symbol_table || !gen->label_manager ||
+      !gen->jump_lists) {
     sdt_codegen_destroy(gen);
     return NULL;
   }
@@ -60,11 +66,23 @@ bool sdt_codegen_init(SDTCodeGen *gen) {
 /**
  * @brief Generate three-address code for a syntax tree
  */
-void sdt_codegen_generate(SDTCodeGen *gen, SyntaxTreeNode *node) {
+void sdt_codegen_generate(SDTCodeGen *gen, const SyntaxTree *tree) {
+  if (!gen || !tree || !tree->root) {
+    return;
+  }
 
-  if (!gen || !node)
+  /* The parser numbered the non-terminals as it built them */
+  sdt_attributes_destroy(gen->attributes);
+  gen->attributes = sdt_attributes_create(tree->node_count);
+  gen->node_count = tree->node_count;
+  if (!gen->attributes) {
+    sdt_set_error(gen, "Failed to allocate attributes");
     return;
-  sdt_execute_action(gen, node);
+  }
+
+  if (!sdt_execute_action(gen, tree->root)) {
+    sdt_set_error(gen, "Malformed syntax tree");
+  }
 }
 
 /**
@@ -81,30 +99,87 @@ const char *sdt_codegen_get_error(const SDTCodeGen *gen) {
 /**
  * @brief Generate a new temporary variable
  */
-char *sdt_new_temp(SDTCodeGen *gen) {
+TACOperand sdt_new_temp(SDTCodeGen *gen) {
   if (!gen || !gen->symbol_table) {
-    return NULL;
+    return tac_none();
   }
 
-  return symbol_table_new_temp(gen->symbol_table);
+  int id = symbol_table_new_temp(gen->symbol_table);
+  return id < 0 ? tac_none() : tac_temp(id);
 }
 
 /**
  * @brief Generate a new label
  */
-char *sdt_new_label(SDTCodeGen *gen) {
+int sdt_new_label(SDTCodeGen *gen) {
   if (!gen || !gen->label_manager) {
-    return NULL;
+    return -1;
   }
 
   return label_manager_new_label(gen->label_manager);
 }
 
+/**
+ * @brief Emit a jump whose target is backpatched later
+ */
+int sdt_emit_jump(SDTCodeGen *gen, TACOpType op, TACOperand arg1,
+                  TACOperand arg2) {
+  int index =
+      tac_program_add_inst(gen->program, op, tac_none(), arg1, arg2, 0);
+  return index < 0 ? JUMP_LIST_EMPTY : jump_list_make(gen->jump_lists, index);
+}
+
+/**
+ * @brief Emit a new label and backpatch a jump list to it
+ */
+int sdt_emit_label(SDTCodeGen *gen, int list) {
+  int label = sdt_new_label(gen);
+  if (label < 0) {
+    return -1;
+  }
+
+  tac_program_add_inst(gen->program, TAC_OP_LABEL, tac_label(label),
+                       tac_none(), tac_none(), 0);
+  jump_list_backpatch(gen->jump_lists, gen->program, list, label);
+  return label;
+}
+
+/**
+ * @brief Backpatch a jump list to the next instruction
+ */
+void sdt_emit_target(SDTCodeGen *gen, int list) {
+  if (list != JUMP_LIST_EMPTY) {
+    sdt_emit_label(gen, list);
+  }
+}
+
+/**
+ * @brief Intern a source variable and get its operand
+ */
+TACOperand sdt_variable(SDTCodeGen *gen, const char *name) {
+  if (!gen || !gen->symbol_table || !name) {
+    return tac_none();
+  }
+
+  SymbolTableEntry *entry = symbol_table_lookup(gen->symbol_table, name);
+  if (!entry) {
+    int id = tac_program_add_var(gen->program, name);
+    if (id < 0 ||
+        !symbol_table_add_variable(gen->symbol_table, name, sizeof(int))) {
+      return tac_none();
+    }
+    entry = symbol_table_lookup(gen->symbol_table, name);
+    entry->id = id;
+  }
+
+  return tac_var(entry->id);
+}
+
 /**
  * @brief Add instruction to the program
  */
-bool sdt_add_instruction(SDTCodeGen *gen, TACOpType op, const char *result,
-                         const char *arg1, const char *arg2, int lineno) {
+bool sdt_add_instruction(SDTCodeGen *gen, TACOpType op, TACOperand result,
+                         TACOperand arg1, TACOperand arg2, int lineno) {
   if (!gen || !gen->program) {
     return false;
   }
@@ -152,10 +227,13 @@ void sdt_codegen_destroy(SDTCodeGen *gen) {
     label_manager_destroy(gen->label_manager);
   }
 
-  if (gen->curr_attr) {
-    sdt_attributes_destroy(gen->curr_attr);
+  if (gen->attributes) {
+    sdt_attributes_destroy(gen->attributes);
   }
 
+  free(gen->values);
+  jump_lists_destroy(gen->jump_lists);
+
   /* Free the generator itself */
   free(gen);
 
@@ -0,0 +1,777 @@
+/**
+ * @file codegen/ssa.c
+ * @brief SSA construction (Cytron et al.) and out-of-SSA translation
+ */
+
+#include "codegen/ssa.h"
+#include "codegen/dataflow.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Position of each CFG edge in its target's predecessor list
+ *
+ * cfg_build() fills predecessors by scanning blocks and their successors
+ * in order; the same scan numbers the edges.
+ */
+static int *edge_positions(const CFG *cfg) {
+  int edges = cfg->succ_offset[cfg->block_count];
+  int *position = alloc_ints(edges);
+  int *cursor = (int *)safe_malloc(((size_t)cfg->block_count + 1) *
+                                   sizeof(int));
+  memset(cursor, 0, ((size_t)cfg->block_count + 1) * sizeof(int));
+  for (int b = 0; b < cfg->block_count; b++) {
+    for (int e = cfg->succ_offset[b]; e < cfg->succ_offset[b + 1]; e++) {
+      position[e] = cursor[cfg->succ[e]]++;
+    }
+  }
+  free(cursor);
+  return position;
+}
+
+/**
+ * @brief Number of arguments of the phis of a block
+ */
+static int phi_arity(const CFG *cfg, int b) {
+  return cfg->pred_offset[b + 1] - cfg->pred_offset[b] + (b == 0);
+}
+
+/**
+ * @brief Immediate dominator on the way up, treating the entry as
+ * dominated by a virtual start node (-1) that jumps to it
+ */
+static int dom_parent(const CFG *cfg, int b) {
+  return b == 0 ? -1 : cfg->idom[b];
+}
+
+/**
+ * @brief Dominance frontiers of all blocks, in CSR form
+ *
+ * For each join block, walks up from each predecessor until the join's
+ * immediate dominator, adding the join to the frontier of every block
+ * passed. The entry counts as having one more predecessor, so it is in
+ * its own frontier when something loops back to it. Runs twice: once to
+ * count, once to fill.
+ */
+static void build_frontiers(const CFG *cfg, int **offset_out,
+                            int **blocks_out) {
+  int count = cfg->block_count;
+  int *offset = (int *)safe_malloc(((size_t)count + 2) * sizeof(int));
+  int *last = alloc_ints(count);
+  int *blocks = NULL;
+  memset(offset, 0, ((size_t)count + 2) * sizeof(int));
+
+  for (int pass = 0; pass < 2; pass++) {
+    memset(last, 0xff, ((size_t)count + 1) * sizeof(int));
+    for (int b = 0; b < count; b++) {
+      if (cfg->rpo_index[b] < 0 || phi_arity(cfg, b) < 2) {
+        continue;
+      }
+      int stop = dom_parent(cfg, b);
+      for (int e = cfg->pred_offset[b]; e < cfg->pred_offset[b + 1]; e++) {
+        int runner = cfg->pred[e];
+        if (cfg->rpo_index[runner] < 0) {
+          continue;
+        }
+        while (runner != stop && last[runner] != b) {
+          last[runner] = b;
+          if (pass == 0) {
+            offset[runner + 1]++;
+          } else {
+            blocks[offset[runner]++] = b;
+          }
+          runner = dom_parent(cfg, runner);
+        }
+      }
+    }
+    if (pass == 0) {
+      for (int b = 0; b < count; b++) {
+        offset[b + 1] += offset[b];
+      }
+      blocks = alloc_ints(offset[count]);
+    } else {
+      /* The fill advanced each offset to the next block's start */
+      memmove(offset + 1, offset, (size_t)count * sizeof(int));
+      offset[0] = 0;
+    }
+  }
+
+  free(last);
+  *offset_out = offset;
+  *blocks_out = blocks;
+}
+
+/**
+ * @brief Phi placed during construction, before grouping by block
+ */
+typedef struct PhiSite {
+  int block;
+  int location;
+} PhiSite;
+
+/**
+ * @brief Place phis at iterated dominance frontiers
+ *
+ * Only locations read in some block before any write there need phis;
+ * temporaries used where they are computed never get one.
+ *
+ * @return int Number of phis placed, stored in *sites_out
+ */
+static int place_phis(const TACProgram *program, const CFG *cfg,
+                      int locations, PhiSite **sites_out) {
+  int count = cfg->block_count;
+  const TACInst *code = program->instructions;
+  int *df_offset, *df;
+  build_frontiers(cfg, &df_offset, &df);
+
+  /* Upward-exposed reads make a location global; count definition
+   * blocks at the same time */
+  bool *global = (bool *)safe_malloc((size_t)locations + 1);
+  int *stamp = alloc_ints(locations);
+  int *def_offset = (int *)safe_malloc(((size_t)locations + 2) * sizeof(int));
+  memset(global, 0, (size_t)locations + 1);
+  memset(def_offset, 0, ((size_t)locations + 2) * sizeof(int));
+  for (int b = 0; b < count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue;
+    }
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      int reads[] = {dataflow_location(program, code[i].arg1),
+                     dataflow_location(program, code[i].arg2)};
+      for (int k = 0; k < 2; k++) {
+        if (reads[k] >= 0 && stamp[reads[k]] != b) {
+          global[reads[k]] = true;
+        }
+      }
+      if (tac_op_writes_result(code[i].op)) {
+        int loc = dataflow_location(program, code[i].result);
+        if (stamp[loc] != b) {
+          stamp[loc] = b;
+          def_offset[loc + 1]++;
+        }
+      }
+    }
+  }
+  for (int loc = 0; loc < locations; loc++) {
+    def_offset[loc + 1] += def_offset[loc];
+  }
+  int *def_blocks = alloc_ints(def_offset[locations]);
+  int *cursor = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  memcpy(cursor, def_offset, ((size_t)locations + 1) * sizeof(int));
+  memset(stamp, 0xff, ((size_t)locations + 1) * sizeof(int));
+  for (int b = 0; b < count; b++) {
+    if (cfg->rpo_index[b] < 0) {
+      continue;
+    }
+    for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+      if (tac_op_writes_result(code[i].op)) {
+        int loc = dataflow_location(program, code[i].result);
+        if (stamp[loc] != b) {
+          stamp[loc] = b;
+          def_blocks[cursor[loc]++] = b;
+        }
+      }
+    }
+  }
+
+  /* Worklist per location; has_phi and queued are stamped with it */
+  int *has_phi = alloc_ints(count);
+  int *queued = alloc_ints(count);
+  int *work = alloc_ints(count);
+  int capacity = 64;
+  int placed = 0;
+  PhiSite *sites = (PhiSite *)safe_malloc((size_t)capacity * sizeof(PhiSite));
+  for (int loc = 0; loc < locations; loc++) {
+    if (!global[loc]) {
+      continue;
+    }
+    int depth = 0;
+    for (int k = def_offset[loc]; k < def_offset[loc + 1]; k++) {
+      queued[def_blocks[k]] = loc;
+      work[depth++] = def_blocks[k];
+    }
+    while (depth > 0) {
+      int x = work[--depth];
+      for (int k = df_offset[x]; k < df_offset[x + 1]; k++) {
+        int y = df[k];
+        if (has_phi[y] == loc) {
+          continue;
+        }
+        has_phi[y] = loc;
+        if (placed == capacity) {
+          capacity *= 2;
+          sites = (PhiSite *)safe_realloc(sites, (size_t)capacity *
+                                                     sizeof(PhiSite));
+        }
+        sites[placed].block = y;
+        sites[placed].location = loc;
+        placed++;
+        if (queued[y] != loc) {
+          queued[y] = loc;
+          work[depth++] = y;
+        }
+      }
+    }
+  }
+
+  free(df_offset);
+  free(df);
+  free(global);
+  free(stamp);
+  free(def_offset);
+  free(def_blocks);
+  free(cursor);
+  free(has_phi);
+  free(queued);
+  free(work);
+  *sites_out = sites;
+  return placed;
+}
+
+/**
+ * @brief Group placed phis by block and lay out their arguments
+ */
+static void store_phis(SSAForm *ssa, const PhiSite *sites, int placed) {
+  const CFG *cfg = ssa->cfg;
+  int count = cfg->block_count;
+  ssa->phi_count = placed;
+  ssa->phi_offset = (int *)safe_malloc(((size_t)count + 2) * sizeof(int));
+  ssa->phis = (SSAPhi *)safe_malloc(((size_t)placed + 1) * sizeof(SSAPhi));
+  memset(ssa->phi_offset, 0, ((size_t)count + 2) * sizeof(int));
+  for (int k = 0; k < placed; k++) {
+    ssa->phi_offset[sites[k].block + 1]++;
+  }
+  for (int b = 0; b < count; b++) {
+    ssa->phi_offset[b + 1] += ssa->phi_offset[b];
+  }
+
+  int *cursor = (int *)safe_malloc(((size_t)count + 1) * sizeof(int));
+  memcpy(cursor, ssa->phi_offset, ((size_t)count + 1) * sizeof(int));
+  int args = 0;
+  for (int k = 0; k < placed; k++) {
+    SSAPhi *phi = &ssa->phis[cursor[sites[k].block]++];
+    phi->value = -1;
+    phi->location = sites[k].location;
+    phi->args = args;
+    args += phi_arity(cfg, sites[k].block);
+  }
+  free(cursor);
+
+  ssa->phi_args = alloc_ints(args);
+  for (int p = ssa->phi_offset[0]; p < ssa->phi_offset[1]; p++) {
+    /* The entry block's extra argument is the value on entry */
+    ssa->phi_args[ssa->phis[p].args + phi_arity(cfg, 0) - 1] =
+        ssa->phis[p].location;
+  }
+}
+
+/**
+ * @brief Create a value
+ */
+static int new_value(SSAForm *ssa, int location, int def) {
+  int v = ssa->value_count++;
+  ssa->value_location[v] = location;
+  ssa->value_def[v] = def;
+  return v;
+}
+
+/**
+ * @brief Renaming state: the current value of every location, and a log
+ * of the values a block replaced, to restore when leaving it
+ */
+typedef struct Renamer {
+  int *current;
+  int *log_location;
+  int *log_value;
+  int log_count;
+} Renamer;
+
+static void define(Renamer *r, int location, int value) {
+  r->log_location[r->log_count] = location;
+  r->log_value[r->log_count] = r->current[location];
+  r->log_count++;
+  r->current[location] = value;
+}
+
+/**
+ * @brief Assign values to the phis and instructions of a block and fill
+ * its successors' phi arguments
+ */
+static void rename_block(SSAForm *ssa, Renamer *r, const int *edge_pos,
+                         int b) {
+  const CFG *cfg = ssa->cfg;
+  const TACProgram *program = ssa->program;
+  for (int p = ssa->phi_offset[b]; p < ssa->phi_offset[b + 1]; p++) {
+    SSAPhi *phi = &ssa->phis[p];
+    phi->value = new_value(ssa, phi->location, -2 - p);
+    define(r, phi->location, phi->value);
+  }
+
+  for (int i = cfg->block_start[b]; i < cfg->block_start[b + 1]; i++) {
+    const TACInst *inst = &program->instructions[i];
+    int reads[] = {dataflow_location(program, inst->arg1),
+                   dataflow_location(program, inst->arg2)};
+    for (int k = 0; k < 2; k++) {
+      ssa->inst_use[2 * i + k] = reads[k] >= 0 ? r->current[reads[k]] : -1;
+    }
+    if (tac_op_writes_result(inst->op)) {
+      int loc = dataflow_location(program, inst->result);
+      ssa->inst_def[i] = new_value(ssa, loc, i);
+      define(r, loc, ssa->inst_def[i]);
+    }
+  }
+
+  for (int e = cfg->succ_offset[b]; e < cfg->succ_offset[b + 1]; e++) {
+    int s = cfg->succ[e];
+    for (int p = ssa->phi_offset[s]; p < ssa->phi_offset[s + 1]; p++) {
+      const SSAPhi *phi = &ssa->phis[p];
+      ssa->phi_args[phi->args + edge_pos[e]] = r->current[phi->location];
+    }
+  }
+}
+
+/**
+ * @brief Rename along a preorder walk of the dominator tree
+ */
+static void rename_values(SSAForm *ssa, int defs) {
+  const CFG *cfg = ssa->cfg;
+  int count = cfg->block_count;
+  int locations = ssa->location_count;
+
+  /* Dominator tree children in CSR form */
+  int *child_offset = (int *)safe_malloc(((size_t)count + 2) * sizeof(int));
+  int *children = alloc_ints(count);
+  int *cursor = (int *)safe_malloc(((size_t)count + 1) * sizeof(int));
+  memset(child_offset, 0, ((size_t)count + 2) * sizeof(int));
+  for (int b = 1; b < count; b++) {
+    if (cfg->idom[b] >= 0) {
+      child_offset[cfg->idom[b] + 1]++;
+    }
+  }
+  for (int b = 0; b < count; b++) {
+    child_offset[b + 1] += child_offset[b];
+  }
+  memcpy(cursor, child_offset, ((size_t)count + 1) * sizeof(int));
+  for (int b = 1; b < count; b++) {
+    if (cfg->idom[b] >= 0) {
+      children[cursor[cfg->idom[b]]++] = b;
+    }
+  }
+  memcpy(cursor, child_offset, ((size_t)count + 1) * sizeof(int));
+
+  Renamer r;
+  r.current = (int *)safe_malloc(((size_t)locations + 1) * sizeof(int));
+  r.log_location = alloc_ints(defs + ssa->phi_count);
+  r.log_value = alloc_ints(defs + ssa->phi_count);
+  r.log_count = 0;
+  for (int loc = 0; loc < locations; loc++) {
+    r.current[loc] = loc;
+  }
+
+  int *edge_pos = edge_positions(cfg);
+  int *stack = alloc_ints(count);
+  int *mark = alloc_ints(count);
+  int depth = 0;
+  if (count > 0 && cfg->rpo_count > 0) {
+    mark[0] = r.log_count;
+    rename_block(ssa, &r, edge_pos, 0);
+    stack[depth++] = 0;
+  }
+  while (depth > 0) {
+    int b = stack[depth - 1];
+    if (cursor[b] < child_offset[b + 1]) {
+      int c = children[cursor[b]++];
+      mark[c] = r.log_count;
+      rename_block(ssa, &r, edge_pos, c);
+      stack[depth++] = c;
+    } else {
+      while (r.log_count > mark[b]) {
+        r.log_count--;
+        r.current[r.log_location[r.log_count]] = r.log_value[r.log_count];
+      }
+      depth--;
+    }
+  }
+
+  free(child_offset);
+  free(children);
+  free(cursor);
+  free(r.current);
+  free(r.log_location);
+  free(r.log_value);
+  free(edge_pos);
+  free(stack);
+  free(mark);
+}
+
+/**
+ * @brief Build the SSA form of a program
+ */
+SSAForm *ssa_build(const TACProgram *program, const CFG *cfg) {
+  if (!program || !cfg) {
+    return NULL;
+  }
+
+  SSAForm *ssa = (SSAForm *)safe_malloc(sizeof(SSAForm));
+  memset(ssa, 0, sizeof(SSAForm));
+  ssa->program = program;
+  ssa->cfg = cfg;
+  ssa->location_count = dataflow_location_count(program);
+
+  PhiSite *sites;
+  int placed = place_phis(program, cfg, ssa->location_count, &sites);
+  store_phis(ssa, sites, placed);
+  free(sites);
+
+  int defs = 0;
+  for (int i = 0; i < program->count; i++) {
+    defs += tac_op_writes_result(program->instructions[i].op);
+  }
+  int capacity = ssa->location_count + placed + defs;
+  ssa->value_location = alloc_ints(capacity);
+  ssa->value_def = alloc_ints(capacity);
+  ssa->inst_def = alloc_ints(program->count);
+  ssa->inst_use = alloc_ints(2 * program->count);
+  for (int loc = 0; loc < ssa->location_count; loc++) {
+    new_value(ssa, loc, -1);
+  }
+
+  rename_values(ssa, defs);
+
+  DEBUG_PRINT("Built SSA form: %d values, %d phis", ssa->value_count,
+              ssa->phi_count);
+  return ssa;
+}
+
+/**
+ * @brief Operand naming a location
+ */
+static TACOperand location_operand(const TACProgram *program, int location) {
+  return location < program->var_count
+             ? tac_var(location)
+             : tac_temp(location - program->var_count);
+}
+
+/**
+ * @brief Out-of-SSA state: the parallel copy being sequentialized
+ *
+ * Locations are indexed densely; index location_count stands for the
+ * temporary that breaks cycles. Per-copy arrays are valid where their
+ * stamp equals the current copy's number.
+ */
+typedef struct CopySequencer {
+  TACProgram *program;
+  int location_count;
+  TACOperand cycle_temp; /* Created on the first cycle */
+  bool has_cycle_temp;
+  int *dst;   /* Destination locations of the current copy */
+  int *src;   /* Source locations of the current copy */
+  int count;  /* Pairs in the current copy */
+  int id;     /* Number of the current copy */
+  int *held;  /* Where each source's original value now is */
+  int *held_stamp;
+  int *from;  /* Source of each destination */
+  int *from_stamp;
+  int *done_stamp; /* Destination already written */
+  int *ready;
+  int *todo;
+  int lineno;
+} CopySequencer;
+
+static TACOperand sequencer_operand(CopySequencer *q, int location) {
+  if (location == q->location_count) {
+    if (!q->has_cycle_temp) {
+      q->cycle_temp = tac_program_new_temp(q->program);
+      q->has_cycle_temp = true;
+    }
+    return q->cycle_temp;
+  }
+  return location_operand(q->program, location);
+}
+
+static void emit_copy(CopySequencer *q, TACEditList *edits, int at, int dst,
+                      int src) {
+  TACInst copy = {TAC_OP_ASSIGN, sequencer_operand(q, dst),
+                  sequencer_operand(q, src), tac_none(), q->lineno};
+  tac_edit_insert(edits, at, copy);
+}
+
+/**
+ * @brief Emit the pending parallel copy as sequential copies before at
+ *
+ * A destination is written once no pending copy still reads it: at first
+ * those that are no source at all, then each source whose value has just
+ * been copied out. What remains are cycles; each is opened by saving one
+ * destination in the cycle temporary.
+ */
+static void sequentialize(CopySequencer *q, TACEditList *edits, int at) {
+  int id = ++q->id;
+  int ready = 0;
+  int todo = 0;
+  for (int k = 0; k < q->count; k++) {
+    q->held[q->src[k]] = q->src[k];
+    q->held_stamp[q->src[k]] = id;
+    q->from[q->dst[k]] = q->src[k];
+    q->from_stamp[q->dst[k]] = id;
+  }
+  for (int k = 0; k < q->count; k++) {
+    q->todo[todo++] = q->dst[k];
+    if (q->held_stamp[q->dst[k]] != id) {
+      q->ready[ready++] = q->dst[k];
+    }
+  }
+
+  while (todo > 0) {
+    while (ready > 0) {
+      int b = q->ready[--ready];
+      int a = q->from[b];
+      int c = q->held[a];
+      emit_copy(q, edits, at, b, c);
+      q->done_stamp[b] = id;
+      q->held[a] = b;
+      if (a == c && q->from_stamp[a] == id) {
+        q->ready[ready++] = a;
+      }
+    }
+    int b = q->todo[--todo];
+    if (q->done_stamp[b] != id) {
+      int temp = q->location_count;
+      emit_copy(q, edits, at, temp, b);
+      q->held[b] = temp;
+      q->held_stamp[b] = id;
+      q->ready[ready++] = b;
+    }
+  }
+  q->count = 0;
+}
+
+/**
+ * @brief Collect the copies phis of block s need on the edge from its
+ * predecessor at position pos
+ *
+ * @return int Number of copies collected
+ */
+static int collect_copies(const SSAForm *ssa, CopySequencer *q, int s,
+                          int pos) {
+  q->count = 0;
+  for (int p = ssa->phi_offset[s]; p < ssa->phi_offset[s + 1]; p++) {
+    const SSAPhi *phi = &ssa->phis[p];
+    int arg = ssa->phi_args[phi->args + pos];
+    if (arg < 0) {
+      continue;
+    }
+    int dst = ssa->value_location[phi->value];
+    int src = ssa->value_location[arg];
+    if (dst != src) {
+      q->dst[q->count] = dst;
+      q->src[q->count] = src;
+      q->count++;
+    }
+  }
+  return q->count;
+}
+
+/**
+ * @brief Label starting block b, or a new one when it has none (or b is
+ * past the end); a new label is returned in *created for the caller to
+ * place
+ */
+static TACOperand start_label(TACProgram *program, const CFG *cfg, int b,
+                              bool *created) {
+  *created = b >= cfg->block_count ||
+             program->instructions[cfg->block_start[b]].op != TAC_OP_LABEL;
+  return *created ? tac_program_new_label(program)
+                  : program->instructions[cfg->block_start[b]].result;
+}
+
+/**
+ * @brief Place the copies on the outgoing edges of block b
+ */
+static void copy_out_of_block(const SSAForm *ssa, CopySequencer *q,
+                              TACProgram *program, const int *edge_pos, int b,
+                              TACEditList *edits) {
+  const CFG *cfg = ssa->cfg;
+  int last = cfg->block_start[b + 1] - 1;
+  TACInst *jump = &program->instructions[last];
+  q->lineno = jump->lineno;
+
+  if (!tac_op_is_cond_jump(jump->op)) {
+    /* One successor at most: copy before a goto, or after a fall-through */
+    int e = cfg->succ_offset[b];
+    if (e < cfg->succ_offset[b + 1] &&
+        collect_copies(ssa, q, cfg->succ[e], edge_pos[e]) > 0) {
+      sequentialize(q, edits, jump->op == TAC_OP_GOTO ? last : last + 1);
+    }
+    return;
+  }
+
+  /* The taken edge is listed first; a jump to the next block shares one
+   * edge with the fall-through */
+  int e = cfg->succ_offset[b];
+  int taken = cfg->succ[e];
+  int fall_edge = cfg->succ_offset[b + 1] > e + 1 ? e + 1 : e;
+  bool falls = b + 1 < cfg->block_count;
+
+  if (falls && collect_copies(ssa, q, cfg->succ[fall_edge],
+                              edge_pos[fall_edge]) > 0) {
+    sequentialize(q, edits, last + 1);
+  }
+  if (collect_copies(ssa, q, taken, edge_pos[e]) > 0) {
+    /* Split the edge: skip over a new block holding its copies */
+    bool created;
+    TACOperand next = start_label(program, cfg, b + 1, &created);
+    TACOperand split = tac_program_new_label(program);
+    TACInst skip = {TAC_OP_GOTO, next, tac_none(), tac_none(), q->lineno};
+    TACInst label = {TAC_OP_LABEL, split, tac_none(), tac_none(), q->lineno};
+    TACInst back = {TAC_OP_GOTO, jump->result, tac_none(), tac_none(),
+                    q->lineno};
+    tac_edit_insert(edits, last + 1, skip);
+    tac_edit_insert(edits, last + 1, label);
+    sequentialize(q, edits, last + 1);
+    tac_edit_insert(edits, last + 1, back);
+    if (created) {
+      TACInst next_label = {TAC_OP_LABEL, next, tac_none(), tac_none(),
+                            q->lineno};
+      tac_edit_insert(edits, last + 1, next_label);
+    }
+    jump->result = split;
+  }
+}
+
+/**
+ * @brief Translate out of SSA form, rewriting the program
+ */
+bool ssa_to_tac(const SSAForm *ssa, TACProgram *program) {
+  if (!ssa || !program || ssa->program != program) {
+    return false;
+  }
+  const CFG *cfg = ssa->cfg;
+  int locations = ssa->location_count;
+
+  /* Rename reads and writes back to locations */
+  for (int i = 0; i < program->count; i++) {
+    TACInst *inst = &program->instructions[i];
+    if (ssa->inst_def[i] >= 0) {
+      inst->result = location_operand(
+          program, ssa->value_location[ssa->inst_def[i]]);
+    }
+    if (ssa->inst_use[2 * i] >= 0) {
+      inst->arg1 = location_operand(
+          program, ssa->value_location[ssa->inst_use[2 * i]]);
+    }
+    if (ssa->inst_use[2 * i + 1] >= 0) {
+      inst->arg2 = location_operand(
+          program, ssa->value_location[ssa->inst_use[2 * i + 1]]);
+    }
+  }
+
+  CopySequencer q;
+  memset(&q, 0, sizeof(q));
+  q.program = program;
+  q.location_count = locations;
+  int max_phis = 0;
+  for (int b = 0; b < cfg->block_count; b++) {
+    int phis = ssa->phi_offset[b + 1] - ssa->phi_offset[b];
+    max_phis = phis > max_phis ? phis : max_phis;
+  }
+  q.dst = alloc_ints(max_phis);
+  q.src = alloc_ints(max_phis);
+  q.ready = alloc_ints(max_phis);
+  q.todo = alloc_ints(max_phis);
+  q.held = alloc_ints(locations + 1);
+  q.held_stamp = alloc_ints(locations + 1);
+  q.from = alloc_ints(locations + 1);
+  q.from_stamp = alloc_ints(locations + 1);
+  q.done_stamp = alloc_ints(locations + 1);
+
+  TACEditList edits;
+  tac_edit_list_init(&edits);
+  if (ssa->phi_offset[1] > 0 &&
+      collect_copies(ssa, &q, 0, phi_arity(cfg, 0) - 1) > 0) {
+    q.lineno = program->count > 0 ? program->instructions[0].lineno : 0;
+    sequentialize(&q, &edits, 0);
+  }
+  int *edge_pos = edge_positions(cfg);
+  for (int b = 0; b < cfg->block_count; b++) {
+    if (cfg->rpo_index[b] >= 0) {
+      copy_out_of_block(ssa, &q, program, edge_pos, b, &edits);
+    }
+  }
+
+  bool ok = tac_program_apply_edits(program, &edits);
+  DEBUG_PRINT("Translated out of SSA form: %d instructions", program->count);
+
+  tac_edit_list_free(&edits);
+  free(edge_pos);
+  free(q.dst);
+  free(q.src);
+  free(q.ready);
+  free(q.todo);
+  free(q.held);
+  free(q.held_stamp);
+  free(q.from);
+  free(q.from_stamp);
+  free(q.done_stamp);
+  return ok;
+}
+
+/**
+ * @brief Print a value as location.version
+ */
+static void print_value(const SSAForm *ssa, int v) {
+  if (v < 0) {
+    printf("_");
+    return;
+  }
+  const TACProgram *program = ssa->program;
+  int loc = ssa->value_location[v];
+  if (loc < program->var_count) {
+    printf("%s.%d", tac_program_var_name(program, loc), v);
+  } else {
+    printf("t%d.%d", loc - program->var_count, v);
+  }
+}
+
+/**
+ * @brief Print the phis of every block to stdout
+ */
+void ssa_print(const SSAForm *ssa) {
+  if (!ssa) {
+    return;
+  }
+  printf("SSA form (%d values, %d phis):\n", ssa->value_count,
+         ssa->phi_count);
+  for (int b = 0; b < ssa->cfg->block_count; b++) {
+    for (int p = ssa->phi_offset[b]; p < ssa->phi_offset[b + 1]; p++) {
+      const SSAPhi *phi = &ssa->phis[p];
+      printf("  B%d: ", b);
+      print_value(ssa, phi->value);
+      printf(" = phi(");
+      int arity = phi_arity(ssa->cfg, b);
+      for (int k = 0; k < arity; k++) {
+        printf(k > 0 ? ", " : "");
+        print_value(ssa, ssa->phi_args[phi->args + k]);
+      }
+      printf(")\n");
+    }
+  }
+}
+
+/**
+ * @brief Free SSA form resources
+ */
+void ssa_destroy(SSAForm *ssa) {
+  if (!ssa) {
+    return;
+  }
+  free(ssa->value_location);
+  free(ssa->value_def);
+  free(ssa->inst_def);
+  free(ssa->inst_use);
+  free(ssa->phi_offset);
+  free(ssa->phis);
+  free(ssa->phi_args);
+  free(ssa);
+}
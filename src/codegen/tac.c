@@ -10,6 +10,46 @@
 #include <string.h>
 
 #define INITIAL_CAPACITY 64
+#define INITIAL_VAR_CAPACITY 16
+#define STRING_CHUNK_SIZE 4096
+
+/**
+ * @brief Chunk of the program's string pool
+ */
+typedef struct TACStringChunk {
+  struct TACStringChunk *next; /* Previously filled chunk */
+  size_t used;                 /* Bytes used in data */
+  size_t size;                 /* Bytes available in data */
+  char data[];                 /* String storage */
+} TACStringChunk;
+
+/**
+ * @brief Copy a string into the program's string pool
+ */
+static const char *pool_strdup(TACProgram *program, const char *str) {
+  size_t len = strlen(str) + 1;
+  TACStringChunk *chunk = program->string_chunks;
+
+  if (!chunk || chunk->size - chunk->used < len) {
+    size_t size = len > STRING_CHUNK_SIZE ? len : STRING_CHUNK_SIZE;
+    TACStringChunk *new_chunk =
+        (TACStringChunk *)safe_malloc(sizeof(TACStringChunk) + size);
+    if (!new_chunk) {
+      return NULL;
+    }
+
+    new_chunk->next = chunk;
+    new_chunk->used = 0;
+    new_chunk->size = size;
+    program->string_chunks = new_chunk;
+    chunk = new_chunk;
+  }
+
+  char *copy = chunk->data + chunk->used;
+  memcpy(copy, str, len);
+  chunk->used += len;
+  return copy;
+}
 
 /**
  * @brief Create a new TAC program
@@ -21,63 +61,188 @@ TACProgram *tac_program_create(void) {
   }
 
   program->instructions =
-      (TACInst **)safe_malloc(INITIAL_CAPACITY * sizeof(TACInst *));
+      (TACInst *)safe_malloc(INITIAL_CAPACITY * sizeof(TACInst));
   if (!program->instructions) {
     free(program);
     return NULL;
   }
 
+  program->var_names =
+      (const char **)safe_malloc(INITIAL_VAR_CAPACITY * sizeof(char *));
+  if (!program->var_names) {
+    free(program->instructions);
+    free(program);
+    return NULL;
+  }
+
   program->count = 0;
   program->capacity = INITIAL_CAPACITY;
+  program->var_count = 0;
+  program->var_capacity = INITIAL_VAR_CAPACITY;
+  program->string_chunks = NULL;
+  program->temp_count = 0;
+  program->label_count = 0;
 
   DEBUG_PRINT("Created TAC program");
   return program;
 }
 
+/**
+ * @brief Grow the instruction array to hold at least min_capacity records
+ */
+static bool reserve_instructions(TACProgram *program, int min_capacity) {
+  if (min_capacity <= program->capacity) {
+    return true;
+  }
+
+  int new_capacity = program->capacity * 2;
+  if (new_capacity < min_capacity) {
+    new_capacity = min_capacity;
+  }
+
+  TACInst *new_instructions = (TACInst *)safe_realloc(
+      program->instructions, (size_t)new_capacity * sizeof(TACInst));
+  if (!new_instructions) {
+    return false;
+  }
+
+  program->instructions = new_instructions;
+  program->capacity = new_capacity;
+  return true;
+}
+
+/**
+ * @brief Keep the temporary and label id ranges in sync with an operand
+ */
+static void track_operand(TACProgram *program, TACOperand operand) {
+  if (operand.kind == TAC_OPND_TEMP && operand.id >= program->temp_count) {
+    program->temp_count = operand.id + 1;
+  } else if (operand.kind == TAC_OPND_LABEL &&
+             operand.id >= program->label_count) {
+    program->label_count = operand.id + 1;
+  }
+}
+
 /**
  * @brief Add an instruction to a TAC program
  */
-int tac_program_add_inst(TACProgram *program, TACOpType op, const char *result,
-                         const char *arg1, const char *arg2, int lineno) {
+int tac_program_add_inst(TACProgram *program, TACOpType op, TACOperand result,
+                         TACOperand arg1, TACOperand arg2, int lineno) {
   if (!program) {
     return -1;
   }
 
   /* Check if program needs to be resized */
-  if (program->count >= program->capacity) {
-    int new_capacity = program->capacity * 2;
-    TACInst **new_instructions = (TACInst **)safe_realloc(
-        program->instructions, new_capacity * sizeof(TACInst *));
-    if (!new_instructions) {
+  if (program->count >= program->capacity &&
+      !reserve_instructions(program, program->count + 1)) {
+    return -1;
+  }
+
+  /* Fill the next instruction record in place */
+  TACInst *inst = &program->instructions[program->count];
+  inst->op = op;
+  inst->lineno = lineno;
+  inst->result = result;
+  inst->arg1 = arg1;
+  inst->arg2 = arg2;
+
+  track_operand(program, result);
+  track_operand(program, arg1);
+  track_operand(program, arg2);
+
+  program->count++;
+
+  DEBUG_PRINT("Added TAC instruction: %s", tac_op_type_to_string(op));
+
+  return program->count - 1;
+}
+
+/**
+ * @brief Register a variable name with a TAC program
+ */
+int tac_program_add_var(TACProgram *program, const char *name) {
+  if (!program || !name) {
+    return -1;
+  }
+
+  if (program->var_count >= program->var_capacity) {
+    int new_capacity = program->var_capacity * 2;
+    const char **new_names = (const char **)safe_realloc(
+        program->var_names, new_capacity * sizeof(char *));
+    if (!new_names) {
       return -1;
     }
 
-    program->instructions = new_instructions;
-    program->capacity = new_capacity;
+    program->var_names = new_names;
+    program->var_capacity = new_capacity;
   }
 
-  /* Create new instruction */
-  TACInst *inst = (TACInst *)safe_malloc(sizeof(TACInst));
-  if (!inst) {
+  const char *copy = pool_strdup(program, name);
+  if (!copy) {
     return -1;
   }
 
-  inst->op = op;
-  inst->lineno = lineno;
+  program->var_names[program->var_count] = copy;
+  DEBUG_PRINT("Registered TAC variable %s as v%d", name, program->var_count);
+  return program->var_count++;
+}
 
-  /* Copy operands if provided */
-  inst->result = result ? safe_strdup(result) : NULL;
-  inst->arg1 = arg1 ? safe_strdup(arg1) : NULL;
-  inst->arg2 = arg2 ? safe_strdup(arg2) : NULL;
+/**
+ * @brief Get the name of a variable id
+ */
+const char *tac_program_var_name(const TACProgram *program, int id) {
+  if (!program || id < 0 || id >= program->var_count) {
+    return NULL;
+  }
 
-  /* Add instruction to program */
-  program->instructions[program->count] = inst;
-  program->count++;
+  return program->var_names[id];
+}
 
-  DEBUG_PRINT("Added TAC instruction: %s %s %s %s", tac_op_type_to_string(op),
-              result ? result : "", arg1 ? arg1 : "", arg2 ? arg2 : "");
+/**
+ * @brief Allocate a fresh temporary id not used by any instruction
+ */
+TACOperand tac_program_new_temp(TACProgram *program) {
+  return tac_temp(program->temp_count++);
+}
 
-  return program->count - 1;
+/**
+ * @brief Allocate a fresh label id not used by any instruction
+ */
+TACOperand tac_program_new_label(TACProgram *program) {
+  return tac_label(program->label_count++);
+}
+
+/**
+ * @brief Render an operand as text
+ */
+const char *tac_operand_to_string(const TACProgram *program, TACOperand operand,
+                                  char *buffer, size_t buffer_size) {
+  const char *name;
+
+  switch (operand.kind) {
+  case TAC_OPND_VAR:
+    name = tac_program_var_name(program, operand.id);
+    if (name) {
+      snprintf(buffer, buffer_size, "%s", name);
+    } else {
+      snprintf(buffer, buffer_size, "v%d", operand.id);
+    }
+    break;
+  case TAC_OPND_TEMP:
+    snprintf(buffer, buffer_size, "t%d", operand.id);
+    break;
+  case TAC_OPND_CONST:
+    snprintf(buffer, buffer_size, "%d", operand.value);
+    break;
+  case TAC_OPND_LABEL:
+    snprintf(buffer, buffer_size, "L%d", operand.id);
+    break;
+  default:
+    snprintf(buffer, buffer_size, "%s", "");
+    break;
+  }
+
+  return buffer;
 }
 
 /**
@@ -88,7 +253,248 @@ TACInst *tac_program_get_inst(TACProgram *program, int index) {
     return NULL;
   }
 
-  return program->instructions[index];
+  return &program->instructions[index];
+}
+
+/**
+ * @brief Initialize an empty edit list
+ */
+void tac_edit_list_init(TACEditList *edits) {
+  edits->edits = NULL;
+  edits->count = 0;
+  edits->capacity = 0;
+}
+
+/**
+ * @brief Release the storage of an edit list
+ */
+void tac_edit_list_free(TACEditList *edits) {
+  free(edits->edits);
+  tac_edit_list_init(edits);
+}
+
+/**
+ * @brief Append an edit record
+ */
+static bool push_edit(TACEditList *edits, int index, bool remove,
+                      const TACInst *inst) {
+  if (edits->count >= edits->capacity) {
+    int new_capacity = edits->capacity ? edits->capacity * 2 : 16;
+    TACEdit *new_edits = (TACEdit *)safe_realloc(
+        edits->edits, (size_t)new_capacity * sizeof(TACEdit));
+    if (!new_edits) {
+      return false;
+    }
+
+    edits->edits = new_edits;
+    edits->capacity = new_capacity;
+  }
+
+  TACEdit *edit = &edits->edits[edits->count];
+  edit->index = index;
+  edit->seq = edits->count;
+  edit->remove = remove;
+  if (inst) {
+    edit->inst = *inst;
+  } else {
+    memset(&edit->inst, 0, sizeof(TACInst));
+  }
+  edits->count++;
+  return true;
+}
+
+/**
+ * @brief Record removal of an instruction
+ */
+bool tac_edit_remove(TACEditList *edits, int index) {
+  return edits && push_edit(edits, index, true, NULL);
+}
+
+/**
+ * @brief Record insertion of an instruction
+ */
+bool tac_edit_insert(TACEditList *edits, int before, TACInst inst) {
+  return edits && push_edit(edits, before, false, &inst);
+}
+
+/**
+ * @brief Order edits by index, then by recording order
+ */
+static int compare_edits(const void *a, const void *b) {
+  const TACEdit *ea = (const TACEdit *)a;
+  const TACEdit *eb = (const TACEdit *)b;
+  if (ea->index != eb->index) {
+    return ea->index < eb->index ? -1 : 1;
+  }
+  return ea->seq < eb->seq ? -1 : (ea->seq > eb->seq);
+}
+
+/**
+ * @brief Apply and clear all recorded edits in one linear pass
+ */
+bool tac_program_apply_edits(TACProgram *program, TACEditList *edits) {
+  if (!program || !edits) {
+    return false;
+  }
+  if (edits->count == 0) {
+    return true;
+  }
+
+  /* Passes usually record edits in scan order; only sort when they did not */
+  bool sorted = true;
+  int inserts = 0;
+  for (int i = 0; i < edits->count; i++) {
+    if (i > 0 && edits->edits[i].index < edits->edits[i - 1].index) {
+      sorted = false;
+    }
+    if (!edits->edits[i].remove) {
+      inserts++;
+    }
+  }
+  if (!sorted) {
+    qsort(edits->edits, edits->count, sizeof(TACEdit), compare_edits);
+  }
+
+  int new_capacity = program->count + inserts;
+  if (new_capacity < INITIAL_CAPACITY) {
+    new_capacity = INITIAL_CAPACITY;
+  }
+  TACInst *merged =
+      (TACInst *)safe_malloc((size_t)new_capacity * sizeof(TACInst));
+  if (!merged) {
+    return false;
+  }
+
+  /* Merge the original array with the edits */
+  int out = 0;
+  int e = 0;
+  for (int i = 0; i <= program->count; i++) {
+    bool removed = false;
+    while (e < edits->count && edits->edits[e].index == i) {
+      TACEdit *edit = &edits->edits[e++];
+      if (edit->remove) {
+        removed = true;
+      } else {
+        merged[out++] = edit->inst;
+        track_operand(program, edit->inst.result);
+        track_operand(program, edit->inst.arg1);
+        track_operand(program, edit->inst.arg2);
+      }
+    }
+    if (i < program->count && !removed) {
+      merged[out++] = program->instructions[i];
+    }
+  }
+
+  free(program->instructions);
+  program->instructions = merged;
+  program->count = out;
+  program->capacity = new_capacity;
+  edits->count = 0;
+
+  DEBUG_PRINT("Applied TAC edits, %d instructions", out);
+  return true;
+}
+
+/**
+ * @brief Rebuild the instruction array in a new order
+ */
+bool tac_program_reorder(TACProgram *program, const int *order, int count) {
+  if (!program || (!order && count > 0) || count < 0) {
+    return false;
+  }
+
+  int new_capacity = count < INITIAL_CAPACITY ? INITIAL_CAPACITY : count;
+  TACInst *reordered =
+      (TACInst *)safe_malloc((size_t)new_capacity * sizeof(TACInst));
+  if (!reordered) {
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (order[i] < 0 || order[i] >= program->count) {
+      free(reordered);
+      return false;
+    }
+    reordered[i] = program->instructions[order[i]];
+  }
+
+  free(program->instructions);
+  program->instructions = reordered;
+  program->count = count;
+  program->capacity = new_capacity;
+  return true;
+}
+
+/**
+ * @brief Print the body of a non-label instruction followed by a newline
+ */
+static void print_inst(FILE *out, const TACProgram *program,
+                       const TACInst *inst) {
+  char r[64], a1[64], a2[64];
+  tac_operand_to_string(program, inst->result, r, sizeof(r));
+  tac_operand_to_string(program, inst->arg1, a1, sizeof(a1));
+  tac_operand_to_string(program, inst->arg2, a2, sizeof(a2));
+
+  switch (inst->op) {
+  case TAC_OP_ASSIGN:
+    fprintf(out, "%s := %s\n", r, a1);
+    break;
+  case TAC_OP_ADD:
+    fprintf(out, "%s := %s + %s\n", r, a1, a2);
+    break;
+  case TAC_OP_SUB:
+    fprintf(out, "%s := %s - %s\n", r, a1, a2);
+    break;
+  case TAC_OP_MUL:
+    fprintf(out, "%s := %s * %s\n", r, a1, a2);
+    break;
+  case TAC_OP_DIV:
+    fprintf(out, "%s := %s / %s\n", r, a1, a2);
+    break;
+  case TAC_OP_NEG:
+    fprintf(out, "%s := -%s\n", r, a1);
+    break;
+  case TAC_OP_SHL:
+    fprintf(out, "%s := %s << %s\n", r, a1, a2);
+    break;
+  case TAC_OP_SHR:
+    fprintf(out, "%s := %s >> %s\n", r, a1, a2);
+    break;
+  case TAC_OP_EQ:
+    fprintf(out, "if %s = %s goto %s\n", a1, a2, r);
+    break;
+  case TAC_OP_NE:
+    fprintf(out, "if %s != %s goto %s\n", a1, a2, r);
+    break;
+  case TAC_OP_LT:
+    fprintf(out, "if %s < %s goto %s\n", a1, a2, r);
+    break;
+  case TAC_OP_LE:
+    fprintf(out, "if %s <= %s goto %s\n", a1, a2, r);
+    break;
+  case TAC_OP_GT:
+    fprintf(out, "if %s > %s goto %s\n", a1, a2, r);
+    break;
+  case TAC_OP_GE:
+    fprintf(out, "if %s >= %s goto %s\n", a1, a2, r);
+    break;
+  case TAC_OP_GOTO:
+    fprintf(out, "goto %s\n", r);
+    break;
+  case TAC_OP_PARAM:
+    fprintf(out, "param %s\n", r);
+    break;
+  case TAC_OP_CALL:
+    fprintf(out, "call %s, %s\n", r, a1);
+    break;
+  case TAC_OP_RETURN:
+    fprintf(out, "return %s\n", r);
+    break;
+  default:
+    fprintf(out, "Unknown operation\n");
+    break;
+  }
 }
 
 /**
@@ -101,7 +507,7 @@ void tac_program_print(TACProgram *program) {
 
   int actual_instructions = 0;
   for (int i = 0; i < program->count; i++) {
-    TACInst *inst = program->instructions[i];
+    TACInst *inst = &program->instructions[i];
     if (inst->op != TAC_OP_LABEL) {
       actual_instructions++;
     }
@@ -115,26 +521,26 @@ void tac_program_print(TACProgram *program) {
   bool label_printed = false;
 
   for (int i = 0; i < program->count; i++) {
-    TACInst *inst = program->instructions[i];
+    TACInst *inst = &program->instructions[i];
 
     // 对于标签
     if (inst->op == TAC_OP_LABEL) {
       // 只有当标签有效时才打印
-      if (inst->result && inst->result[0] != '\0') {
+      if (inst->result.kind == TAC_OPND_LABEL) {
         // 如果当前行还没有内容，直接打印标签
         if (!label_printed) {
-          printf("%s: ", inst->result);
+          printf("L%d: ", inst->result.id);
           label_printed = true;
         } else {
           // 如果当前行已经有内容，先换行，再打印标签
-          printf("\n%s: ", inst->result);
+          printf("\nL%d: ", inst->result.id);
           label_printed = true;
         }
       }
 
       // 检查下一条指令是否也是标签
       if (i + 1 < program->count &&
-          program->instructions[i + 1]->op == TAC_OP_LABEL) {
+          program->instructions[i + 1].op == TAC_OP_LABEL) {
         continue; // 如果下一条也是标签，不打印换行
       }
 
@@ -153,56 +559,7 @@ void tac_program_print(TACProgram *program) {
     }
 
     // 打印指令
-    switch (inst->op) {
-    case TAC_OP_ASSIGN:
-      printf("%s := %s\n", inst->result, inst->arg1);
-      break;
-    case TAC_OP_ADD:
-      printf("%s := %s + %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_SUB:
-      printf("%s := %s - %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_MUL:
-      printf("%s := %s * %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_DIV:
-      printf("%s := %s / %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_EQ:
-      printf("if %s = %s goto %s\n", inst->arg1, inst->arg2, inst->result);
-      break;
-    case TAC_OP_NE:
-      printf("if %s != %s goto %s\n", inst->arg1, inst->arg2, inst->result);
-      break;
-    case TAC_OP_LT:
-      printf("if %s < %s goto %s\n", inst->arg1, inst->arg2, inst->result);
-      break;
-    case TAC_OP_LE:
-      printf("if %s <= %s goto %s\n", inst->arg1, inst->arg2, inst->result);
-      break;
-    case TAC_OP_GT:
-      printf("if %s > %s goto %s\n", inst->arg1, inst->arg2, inst->result);
-      break;
-    case TAC_OP_GE:
-      printf("if %s >= %s goto %s\n", inst->arg1, inst->arg2, inst->result);
-      break;
-    case TAC_OP_GOTO:
-      printf("goto %s\n", inst->result);
-      break;
-    case TAC_OP_PARAM:
-      printf("param %s\n", inst->result);
-      break;
-    case TAC_OP_CALL:
-      printf("call %s, %s\n", inst->result, inst->arg1);
-      break;
-    case TAC_OP_RETURN:
-      printf("return %s\n", inst->result);
-      break;
-    default:
-      printf("Unknown operation\n");
-      break;
-    }
+    print_inst(stdout, program, inst);
 
     label_printed = false; // 重置标志，准备下一行
   }
@@ -224,83 +581,28 @@ bool tac_program_write_to_file(TACProgram *program, const char *filename) {
   }
 
   for (int i = 0; i < program->count; i++) {
-    TACInst *inst = program->instructions[i];
+    TACInst *inst = &program->instructions[i];
 
     // If this is a label, print it without a newline
     if (inst->op == TAC_OP_LABEL) {
-      fprintf(file, "%s: ", inst->result);
+      fprintf(file, "L%d: ", inst->result.id);
 
       // If the next instruction is also a label or we're at the end,
       // print a newline
       if (i + 1 >= program->count ||
-          program->instructions[i + 1]->op == TAC_OP_LABEL) {
+          program->instructions[i + 1].op == TAC_OP_LABEL) {
         fprintf(file, "\n");
       }
       continue;
     }
 
     // For non-label instructions, print with indentation if no label precedes
-    if (i == 0 || program->instructions[i - 1]->op != TAC_OP_LABEL) {
+    if (i == 0 || program->instructions[i - 1].op != TAC_OP_LABEL) {
       fprintf(file, "    ");
     }
 
     // Print the instruction
-    switch (inst->op) {
-    case TAC_OP_ASSIGN:
-      fprintf(file, "%s := %s\n", inst->result, inst->arg1);
-      break;
-    case TAC_OP_ADD:
-      fprintf(file, "%s := %s + %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_SUB:
-      fprintf(file, "%s := %s - %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_MUL:
-      fprintf(file, "%s := %s * %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_DIV:
-      fprintf(file, "%s := %s / %s\n", inst->result, inst->arg1, inst->arg2);
-      break;
-    case TAC_OP_EQ:
-      fprintf(file, "if %s = %s goto %s\n", inst->arg1, inst->arg2,
-              inst->result);
-      break;
-    case TAC_OP_NE:
-      fprintf(file, "if %s != %s goto %s\n", inst->arg1, inst->arg2,
-              inst->result);
-      break;
-    case TAC_OP_LT:
-      fprintf(file, "if %s < %s goto %s\n", inst->arg1, inst->arg2,
-              inst->result);
-      break;
-    case TAC_OP_LE:
-      fprintf(file, "if %s <= %s goto %s\n", inst->arg1, inst->arg2,
-              inst->result);
-      break;
-    case TAC_OP_GT:
-      fprintf(file, "if %s > %s goto %s\n", inst->arg1, inst->arg2,
-              inst->result);
-      break;
-    case TAC_OP_GE:
-      fprintf(file, "if %s >= %s goto %s\n", inst->arg1, inst->arg2,
-              inst->result);
-      break;
-    case TAC_OP_GOTO:
-      fprintf(file, "goto %s\n", inst->result);
-      break;
-    case TAC_OP_PARAM:
-      fprintf(file, "param %s\n", inst->result);
-      break;
-    case TAC_OP_CALL:
-      fprintf(file, "call %s, %s\n", inst->result, inst->arg1);
-      break;
-    case TAC_OP_RETURN:
-      fprintf(file, "return %s\n", inst->result);
-      break;
-    default:
-      fprintf(file, "Unknown operation\n");
-      break;
-    }
+    print_inst(file, program, inst);
   }
 
   fclose(file);
@@ -315,28 +617,82 @@ void tac_program_destroy(TACProgram *program) {
     return;
   }
 
-  /* Free all instructions */
-  for (int i = 0; i < program->count; i++) {
-    TACInst *inst = program->instructions[i];
-
-    if (inst) {
-      if (inst->result)
-        free(inst->result);
-      if (inst->arg1)
-        free(inst->arg1);
-      if (inst->arg2)
-        free(inst->arg2);
-      free(inst);
-    }
+  /* Free the string pool */
+  TACStringChunk *chunk = program->string_chunks;
+  while (chunk) {
+    TACStringChunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
   }
 
-  /* Free instruction array and program */
+  /* Free instruction and name arrays and the program */
   free(program->instructions);
+  free(program->var_names);
   free(program);
 
   DEBUG_PRINT("Destroyed TAC program");
 }
 
+/**
+ * @brief Evaluate an arithmetic operation on constants
+ */
+bool tac_eval_arith(TACOpType op, int a, int b, int *result) {
+  /* Unsigned arithmetic gives two's complement wrapping without UB */
+  unsigned int x = (unsigned int)a;
+  unsigned int y = (unsigned int)b;
+
+  switch (op) {
+  case TAC_OP_ADD:
+    *result = (int)(x + y);
+    return true;
+  case TAC_OP_SUB:
+    *result = (int)(x - y);
+    return true;
+  case TAC_OP_MUL:
+    *result = (int)(x * y);
+    return true;
+  case TAC_OP_DIV:
+    if (b == 0) {
+      return false;
+    }
+    *result = (b == -1) ? (int)(0u - x) : a / b;
+    return true;
+  case TAC_OP_NEG:
+    *result = (int)(0u - x);
+    return true;
+  case TAC_OP_SHL:
+    *result = (int)(x << (y & 31));
+    return true;
+  case TAC_OP_SHR:
+    *result = tac_shift_right(a, b);
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Evaluate the condition of a conditional jump on constants
+ */
+bool tac_eval_relop(TACOpType op, int a, int b) {
+  switch (op) {
+  case TAC_OP_EQ:
+    return a == b;
+  case TAC_OP_NE:
+    return a != b;
+  case TAC_OP_LT:
+    return a < b;
+  case TAC_OP_LE:
+    return a <= b;
+  case TAC_OP_GT:
+    return a > b;
+  case TAC_OP_GE:
+    return a >= b;
+  default:
+    return false;
+  }
+}
+
 /**
  * @brief Create a string representation of a TAC operation type
  */
@@ -352,6 +708,12 @@ const char *tac_op_type_to_string(TACOpType op) {
     return "MUL";
   case TAC_OP_DIV:
     return "DIV";
+  case TAC_OP_NEG:
+    return "NEG";
+  case TAC_OP_SHL:
+    return "SHL";
+  case TAC_OP_SHR:
+    return "SHR";
   case TAC_OP_EQ:
     return "EQ";
   case TAC_OP_NE:
@@ -0,0 +1,442 @@
+/**
+ * @file codegen/tac_bytecode.c
+ * @brief Writing and mapping binary three-address code
+ */
+
+#include "codegen/tac_bytecode.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Initial number of constant pool hash slots (power of two) */
+#define CONST_POOL_SLOTS 1024
+
+/**
+ * @brief Distinct constants of a program, in order of first use
+ */
+typedef struct ConstPool {
+  int32_t *values;   /* Constants by pool index */
+  int count;         /* Number of constants */
+  int capacity;      /* Capacity of values array */
+  int *slots;        /* Open-addressing table of pool indices, -1 if empty */
+  unsigned int mask; /* Number of slots minus one */
+} ConstPool;
+
+/**
+ * @brief Output file and the offset written so far
+ */
+typedef struct BytecodeWriter {
+  FILE *file;      /* Output stream */
+  uint64_t offset; /* Bytes written */
+  bool ok;         /* No write has failed */
+} BytecodeWriter;
+
+static unsigned int hash_const(int32_t value) {
+  unsigned int h = (unsigned int)value * 0x9e3779b1u;
+  return h ^ (h >> 16);
+}
+
+/**
+ * @brief Get the pool index of a constant, adding it on first use
+ */
+static int const_index(ConstPool *pool, int32_t value) {
+  unsigned int slot = hash_const(value) & pool->mask;
+  for (; pool->slots[slot] >= 0; slot = (slot + 1) & pool->mask) {
+    if (pool->values[pool->slots[slot]] == value) {
+      return pool->slots[slot];
+    }
+  }
+
+  if (pool->count == pool->capacity) {
+    pool->capacity = pool->capacity ? pool->capacity * 2 : 64;
+    pool->values = (int32_t *)safe_realloc(pool->values,
+                                           pool->capacity * sizeof(int32_t));
+  }
+  int index = pool->count++;
+  pool->values[index] = value;
+  pool->slots[slot] = index;
+
+  /* Keep the table at most half full */
+  if ((unsigned int)pool->count * 2 > pool->mask) {
+    pool->mask = pool->mask * 2 + 1;
+    pool->slots = (int *)safe_realloc(pool->slots,
+                                      (pool->mask + 1) * sizeof(int));
+    memset(pool->slots, -1, (pool->mask + 1) * sizeof(int));
+    for (int i = 0; i < pool->count; i++) {
+      slot = hash_const(pool->values[i]) & pool->mask;
+      while (pool->slots[slot] >= 0) {
+        slot = (slot + 1) & pool->mask;
+      }
+      pool->slots[slot] = i;
+    }
+  }
+  return index;
+}
+
+/**
+ * @brief Round an offset up to the section alignment
+ */
+static uint64_t align_offset(uint64_t offset) {
+  return (offset + TAC_BYTECODE_ALIGN - 1) &
+         ~(uint64_t)(TAC_BYTECODE_ALIGN - 1);
+}
+
+static void write_bytes(BytecodeWriter *writer, const void *data,
+                        size_t size) {
+  if (size > 0 && fwrite(data, 1, size, writer->file) != size) {
+    writer->ok = false;
+  }
+  writer->offset += size;
+}
+
+/**
+ * @brief Pad with zeros up to the offset of the next section
+ */
+static void write_padding(BytecodeWriter *writer, uint64_t offset) {
+  static const char zeros[TAC_BYTECODE_ALIGN];
+  write_bytes(writer, zeros, offset - writer->offset);
+}
+
+/**
+ * @brief Check whether an operand is the label defined by its instruction
+ */
+static bool defines_label(const TACInst *inst, int slot) {
+  return slot == 0 && inst->op == TAC_OP_LABEL &&
+         inst->result.kind == TAC_OPND_LABEL;
+}
+
+/**
+ * @brief Write a program as bytecode
+ */
+bool tac_bytecode_write(const TACProgram *program, const char *filename) {
+  if (!program || !filename) {
+    return false;
+  }
+
+  /* Find the highest ids, which may exceed the program's counts */
+  int label_count = program->label_count;
+  int temp_count = program->temp_count;
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    const TACOperand operands[3] = {inst->result, inst->arg1, inst->arg2};
+    for (int k = 0; k < 3; k++) {
+      if (operands[k].kind == TAC_OPND_LABEL && operands[k].id >= label_count) {
+        label_count = operands[k].id + 1;
+      } else if (operands[k].kind == TAC_OPND_TEMP &&
+                 operands[k].id >= temp_count) {
+        temp_count = operands[k].id + 1;
+      }
+    }
+  }
+
+  int *label_record =
+      (int *)safe_malloc(((size_t)label_count + 1) * sizeof(int));
+  memset(label_record, -1, ((size_t)label_count + 1) * sizeof(int));
+  ConstPool pool = {NULL, 0, 0, NULL, CONST_POOL_SLOTS - 1};
+  pool.slots = (int *)safe_malloc(CONST_POOL_SLOTS * sizeof(int));
+  memset(pool.slots, -1, CONST_POOL_SLOTS * sizeof(int));
+
+  /* Find the record of each label and intern the constants */
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (defines_label(inst, 0) && label_record[inst->result.id] < 0) {
+      label_record[inst->result.id] = i;
+    }
+    const TACOperand operands[3] = {inst->result, inst->arg1, inst->arg2};
+    for (int k = 0; k < 3; k++) {
+      if (operands[k].kind == TAC_OPND_CONST) {
+        const_index(&pool, operands[k].value);
+      }
+    }
+  }
+
+  /* Lay out the sections */
+  uint64_t string_size = 0;
+  for (int i = 0; i < program->var_count; i++) {
+    string_size += strlen(program->var_names[i]) + 1;
+  }
+
+  TACBytecodeHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TAC_BYTECODE_MAGIC, sizeof(header.magic));
+  header.version = TAC_BYTECODE_VERSION;
+  header.byte_order = TAC_BYTECODE_BYTE_ORDER;
+  header.inst_size = sizeof(TACBytecodeInst);
+  header.inst_count = (uint32_t)program->count;
+  header.const_count = (uint32_t)pool.count;
+  header.var_count = (uint32_t)program->var_count;
+  header.temp_count = (uint32_t)temp_count;
+  header.label_count = (uint32_t)label_count;
+  header.string_size = string_size;
+  header.const_offset = align_offset(sizeof(header));
+  header.var_offset =
+      align_offset(header.const_offset + pool.count * sizeof(int32_t));
+  header.string_offset =
+      align_offset(header.var_offset + program->var_count * sizeof(uint32_t));
+  header.inst_offset = align_offset(header.string_offset + string_size);
+  header.file_size =
+      header.inst_offset + (uint64_t)program->count * sizeof(TACBytecodeInst);
+
+  /* Name offsets are 32-bit */
+  FILE *file = string_size <= UINT32_MAX ? fopen(filename, "wb") : NULL;
+  if (!file) {
+    fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+    free(label_record);
+    free(pool.values);
+    free(pool.slots);
+    return false;
+  }
+
+  /* Write every section in file order */
+  BytecodeWriter writer = {file, 0, true};
+  write_bytes(&writer, &header, sizeof(header));
+  write_padding(&writer, header.const_offset);
+  write_bytes(&writer, pool.values, pool.count * sizeof(int32_t));
+
+  write_padding(&writer, header.var_offset);
+  uint32_t name_offset = 0;
+  for (int i = 0; i < program->var_count; i++) {
+    write_bytes(&writer, &name_offset, sizeof(name_offset));
+    name_offset += (uint32_t)strlen(program->var_names[i]) + 1;
+  }
+  write_padding(&writer, header.string_offset);
+  for (int i = 0; i < program->var_count; i++) {
+    write_bytes(&writer, program->var_names[i],
+                strlen(program->var_names[i]) + 1);
+  }
+
+  write_padding(&writer, header.inst_offset);
+  TACBytecodeInst *batch = (TACBytecodeInst *)safe_malloc(
+      TAC_BYTECODE_BATCH * sizeof(TACBytecodeInst));
+  int staged = 0;
+  bool resolved = true;
+  for (int i = 0; i < program->count && resolved; i++) {
+    const TACInst *inst = &program->instructions[i];
+    const TACOperand operands[3] = {inst->result, inst->arg1, inst->arg2};
+    TACBytecodeInst *record = &batch[staged++];
+    record->op = (uint8_t)inst->op;
+    record->lineno = inst->lineno;
+    for (int k = 0; k < 3; k++) {
+      record->kind[k] = (uint8_t)operands[k].kind;
+      switch (operands[k].kind) {
+      case TAC_OPND_NONE:
+        record->operand[k] = 0;
+        break;
+      case TAC_OPND_CONST:
+        record->operand[k] = const_index(&pool, operands[k].value);
+        break;
+      case TAC_OPND_LABEL:
+        record->operand[k] = defines_label(inst, k)
+                                 ? operands[k].id
+                                 : label_record[operands[k].id];
+        if (record->operand[k] < 0) {
+          DEBUG_PRINT("Bytecode: jump to undefined label L%d",
+                      operands[k].id);
+          resolved = false;
+        }
+        break;
+      default:
+        record->operand[k] = operands[k].id;
+        break;
+      }
+    }
+
+    if (staged == TAC_BYTECODE_BATCH || i == program->count - 1) {
+      write_bytes(&writer, batch, staged * sizeof(TACBytecodeInst));
+      staged = 0;
+    }
+  }
+
+  free(batch);
+  free(label_record);
+  free(pool.values);
+  free(pool.slots);
+
+  if (fclose(file) != 0) {
+    writer.ok = false;
+  }
+  if (!writer.ok || !resolved) {
+    remove(filename);
+    return false;
+  }
+
+  DEBUG_PRINT("Wrote %d instructions, %d constants to %s", program->count,
+              header.const_count, filename);
+  return true;
+}
+
+/**
+ * @brief Check that a section of count elements lies inside the file
+ */
+static bool section_fits(uint64_t offset, uint64_t count, size_t size,
+                         uint64_t file_size) {
+  return offset % TAC_BYTECODE_ALIGN == 0 && offset <= file_size &&
+         count <= (file_size - offset) / size;
+}
+
+/**
+ * @brief Check the header of a mapped file
+ *
+ * @return const char* NULL if the header is valid, otherwise what is wrong
+ */
+static const char *check_header(const TACBytecodeHeader *header,
+                                size_t size) {
+  if (memcmp(header->magic, TAC_BYTECODE_MAGIC, sizeof(header->magic)) != 0) {
+    return "not a TAC bytecode file";
+  }
+  if (header->byte_order != TAC_BYTECODE_BYTE_ORDER) {
+    return "written with another byte order";
+  }
+  if (header->version != TAC_BYTECODE_VERSION ||
+      header->inst_size != sizeof(TACBytecodeInst) || header->reserved != 0) {
+    return "unsupported version";
+  }
+  if (header->file_size != size ||
+      !section_fits(header->const_offset, header->const_count,
+                    sizeof(int32_t), size) ||
+      !section_fits(header->var_offset, header->var_count, sizeof(uint32_t),
+                    size) ||
+      !section_fits(header->string_offset, header->string_size, 1, size) ||
+      !section_fits(header->inst_offset, header->inst_count,
+                    sizeof(TACBytecodeInst), size)) {
+    return "truncated or corrupt";
+  }
+  return NULL;
+}
+
+/**
+ * @brief Map a bytecode file
+ */
+TACBytecode *tac_bytecode_open(const char *filename) {
+  if (!filename) {
+    return NULL;
+  }
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Error: Could not open file %s for reading\n", filename);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TACBytecodeHeader)) {
+    fprintf(stderr, "Error: %s: not a TAC bytecode file\n", filename);
+    close(fd);
+    return NULL;
+  }
+
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Error: Could not map file %s\n", filename);
+    return NULL;
+  }
+
+  const TACBytecodeHeader *header = (const TACBytecodeHeader *)map;
+  const char *problem = check_header(header, size);
+  if (problem) {
+    fprintf(stderr, "Error: %s: %s\n", filename, problem);
+    munmap(map, size);
+    return NULL;
+  }
+
+  const char *base = (const char *)map;
+  TACBytecode *bytecode = (TACBytecode *)safe_malloc(sizeof(TACBytecode));
+  bytecode->header = header;
+  bytecode->constants = (const int32_t *)(base + header->const_offset);
+  bytecode->var_names = (const uint32_t *)(base + header->var_offset);
+  bytecode->strings = base + header->string_offset;
+  bytecode->instructions =
+      (const TACBytecodeInst *)(base + header->inst_offset);
+  bytecode->map = map;
+  bytecode->size = size;
+
+  DEBUG_PRINT("Mapped %u instructions from %s", header->inst_count, filename);
+  return bytecode;
+}
+
+/**
+ * @brief Check that every record and name is in range
+ */
+bool tac_bytecode_verify(const TACBytecode *bytecode) {
+  if (!bytecode) {
+    return false;
+  }
+
+  const TACBytecodeHeader *header = bytecode->header;
+  if (header->var_count > 0 &&
+      (header->string_size == 0 ||
+       bytecode->strings[header->string_size - 1] != '\0')) {
+    return false;
+  }
+  for (uint32_t i = 0; i < header->var_count; i++) {
+    if (bytecode->var_names[i] >= header->string_size) {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < header->inst_count; i++) {
+    const TACBytecodeInst *record = &bytecode->instructions[i];
+    if (record->op > TAC_OP_RETURN) {
+      DEBUG_PRINT("Bytecode: bad operation in record %u", i);
+      return false;
+    }
+    for (int k = 0; k < 3; k++) {
+      int32_t operand = record->operand[k];
+      bool jump = false;
+      uint32_t limit;
+      switch (record->kind[k]) {
+      case TAC_OPND_NONE:
+        continue;
+      case TAC_OPND_VAR:
+        limit = header->var_count;
+        break;
+      case TAC_OPND_TEMP:
+        limit = header->temp_count;
+        break;
+      case TAC_OPND_CONST:
+        limit = header->const_count;
+        break;
+      case TAC_OPND_LABEL:
+        jump = k != 0 || record->op != TAC_OP_LABEL;
+        limit = jump ? header->inst_count : header->label_count;
+        break;
+      default:
+        DEBUG_PRINT("Bytecode: bad operand kind in record %u", i);
+        return false;
+      }
+      if (operand < 0 || (uint32_t)operand >= limit) {
+        DEBUG_PRINT("Bytecode: operand out of range in record %u", i);
+        return false;
+      }
+
+      /* A jump must land on a label definition */
+      if (jump) {
+        const TACBytecodeInst *target = &bytecode->instructions[operand];
+        if (target->op != TAC_OP_LABEL || target->kind[0] != TAC_OPND_LABEL) {
+          DEBUG_PRINT("Bytecode: jump in record %u misses a label", i);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Unmap a bytecode file
+ */
+void tac_bytecode_close(TACBytecode *bytecode) {
+  if (!bytecode) {
+    return;
+  }
+
+  munmap(bytecode->map, bytecode->size);
+  free(bytecode);
+}
@@ -0,0 +1,703 @@
+/**
+ * @file codegen/tac_jit.c
+ * @brief In-process x86-64 compiler for three-address code
+ */
+
+#include "codegen/tac_jit.h"
+#include "codegen/cfg.h"
+#include "codegen/dataflow.h"
+#include "codegen/regalloc.h"
+#include "codegen/x86_64.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* rdi holds the slot array; rax, rdx and r11 are scratch */
+#define JIT_REGISTERS 10
+#define JIT_SLOTS X86_RDI
+
+/* Callee-saved registers among the allocatable ones */
+#define JIT_CALLEE_SAVED 5
+
+static const X86Register jit_allocatable[JIT_REGISTERS] = {
+    X86_RBX, X86_R12, X86_R13, X86_R14, X86_R15,
+    X86_RCX, X86_RSI, X86_R8,  X86_R9,  X86_R10};
+
+/* x86 condition codes, used as jcc = 0x0f 0x80+cc */
+#define CC_E 0x4
+#define CC_NE 0x5
+#define CC_L 0xc
+#define CC_GE 0xd
+#define CC_LE 0xe
+#define CC_G 0xf
+
+/* ALU opcodes: reg, r/m form and the /digit of the immediate form */
+#define ALU_ADD 0
+#define ALU_SUB 1
+#define ALU_CMP 2
+#define ALU_IMUL 3
+
+/**
+ * @brief Compiled entry point: returns 0, or 1 after a division by zero
+ */
+typedef int (*JITFunction)(int32_t *slots);
+
+/**
+ * @brief Operand of a machine instruction
+ */
+typedef struct JITOperand {
+  enum { JIT_REG, JIT_MEM, JIT_IMM } kind;
+  int value; /* Register, slot or immediate */
+} JITOperand;
+
+/**
+ * @brief Pending rel32 jump displacement
+ */
+typedef struct JITFixup {
+  size_t offset; /* Position of the displacement in the code */
+  int label;     /* Target label */
+} JITFixup;
+
+/**
+ * @brief Compilation state
+ */
+typedef struct JITCompiler {
+  const TACProgram *program;
+  const RegAllocation *alloc;
+  uint8_t *code;         /* Code being emitted */
+  size_t size;           /* Bytes emitted */
+  size_t capacity;       /* Capacity of code */
+  size_t *label_offset;  /* Code offset per label, SIZE_MAX until defined */
+  int label_exit;        /* Label of the epilogue */
+  int label_divzero;     /* Label of the division-by-zero exit */
+  JITFixup *fixups;      /* Label fixup table */
+  int fixup_count;       /* Number of fixups */
+  int fixup_capacity;    /* Capacity of fixups */
+} JITCompiler;
+
+static void emit_byte(JITCompiler *c, uint8_t byte) {
+  if (c->size == c->capacity) {
+    c->capacity = c->capacity ? 2 * c->capacity : 4096;
+    c->code = (uint8_t *)safe_realloc(c->code, c->capacity);
+  }
+  c->code[c->size++] = byte;
+}
+
+static void emit_u32(JITCompiler *c, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    emit_byte(c, (uint8_t)(value >> (8 * i)));
+  }
+}
+
+/**
+ * @brief Emit a rel32 placeholder and record it in the fixup table
+ */
+static void emit_fixup(JITCompiler *c, int label) {
+  if (c->fixup_count == c->fixup_capacity) {
+    c->fixup_capacity = c->fixup_capacity ? 2 * c->fixup_capacity : 256;
+    c->fixups = (JITFixup *)safe_realloc(
+        c->fixups, (size_t)c->fixup_capacity * sizeof(JITFixup));
+  }
+  c->fixups[c->fixup_count].offset = c->size;
+  c->fixups[c->fixup_count].label = label;
+  c->fixup_count++;
+  emit_u32(c, 0);
+}
+
+static void emit_jmp(JITCompiler *c, int label) {
+  emit_byte(c, 0xe9);
+  emit_fixup(c, label);
+}
+
+static void emit_jcc(JITCompiler *c, int cc, int label) {
+  emit_byte(c, 0x0f);
+  emit_byte(c, (uint8_t)(0x80 + cc));
+  emit_fixup(c, label);
+}
+
+/**
+ * @brief Emit an instruction with a ModRM byte
+ *
+ * @param opcode Opcode bytes (a 0x0f escape included)
+ * @param length Number of opcode bytes
+ * @param reg Register or opcode extension in ModRM.reg
+ * @param rm Register or slot addressed by ModRM.rm
+ */
+static void emit_modrm(JITCompiler *c, const uint8_t *opcode, int length,
+                       int reg, JITOperand rm) {
+  uint8_t rex = 0x40;
+  if (reg & 8) {
+    rex |= 0x04;
+  }
+  if (rm.kind == JIT_REG && (rm.value & 8)) {
+    rex |= 0x01;
+  }
+  if (rex != 0x40) {
+    emit_byte(c, rex);
+  }
+  for (int i = 0; i < length; i++) {
+    emit_byte(c, opcode[i]);
+  }
+  if (rm.kind == JIT_REG) {
+    emit_byte(c, (uint8_t)(0xc0 | (reg & 7) << 3 | (rm.value & 7)));
+  } else {
+    /* [rdi + disp32] */
+    emit_byte(c, (uint8_t)(0x80 | (reg & 7) << 3 | JIT_SLOTS));
+    emit_u32(c, (uint32_t)rm.value * 4);
+  }
+}
+
+static JITOperand jit_reg(int reg) {
+  JITOperand o = {JIT_REG, reg};
+  return o;
+}
+
+/**
+ * @brief Machine operand of a TAC operand
+ */
+static JITOperand jit_operand(const JITCompiler *c, TACOperand operand) {
+  JITOperand o = {JIT_IMM, 0};
+  int loc = dataflow_location(c->program, operand);
+  if (loc < 0) {
+    o.value = operand.kind == TAC_OPND_CONST ? operand.value : 0;
+  } else if (c->alloc->reg[loc] >= 0) {
+    o.kind = JIT_REG;
+    o.value = jit_allocatable[c->alloc->reg[loc]];
+  } else {
+    o.kind = JIT_MEM;
+    o.value = loc;
+  }
+  return o;
+}
+
+/**
+ * @brief reg := src
+ */
+static void emit_load(JITCompiler *c, int reg, JITOperand src) {
+  static const uint8_t mov_load[] = {0x8b};
+  if (src.kind == JIT_IMM) {
+    if (reg & 8) {
+      emit_byte(c, 0x41);
+    }
+    emit_byte(c, (uint8_t)(0xb8 + (reg & 7)));
+    emit_u32(c, (uint32_t)src.value);
+  } else if (src.kind != JIT_REG || src.value != reg) {
+    emit_modrm(c, mov_load, 1, reg, src);
+  }
+}
+
+/**
+ * @brief dst := reg, for a register or slot destination
+ */
+static void emit_store(JITCompiler *c, JITOperand dst, int reg) {
+  static const uint8_t mov_store[] = {0x89};
+  if (dst.kind != JIT_REG || dst.value != reg) {
+    emit_modrm(c, mov_store, 1, reg, dst);
+  }
+}
+
+/**
+ * @brief reg op= src for add, sub, cmp and imul
+ */
+static void emit_alu(JITCompiler *c, int op, int reg, JITOperand src) {
+  static const uint8_t reg_forms[][2] = {
+      {0x03, 0}, {0x2b, 0}, {0x3b, 0}, {0x0f, 0xaf}};
+  static const int digits[] = {0, 5, 7};
+  if (src.kind != JIT_IMM) {
+    emit_modrm(c, reg_forms[op], op == ALU_IMUL ? 2 : 1, reg, src);
+    return;
+  }
+  bool small = src.value >= -128 && src.value <= 127;
+  if (op == ALU_IMUL) {
+    uint8_t opcode = small ? 0x6b : 0x69;
+    emit_modrm(c, &opcode, 1, reg, jit_reg(reg));
+  } else {
+    uint8_t opcode = small ? 0x83 : 0x81;
+    emit_modrm(c, &opcode, 1, digits[op], jit_reg(reg));
+  }
+  if (small) {
+    emit_byte(c, (uint8_t)src.value);
+  } else {
+    emit_u32(c, (uint32_t)src.value);
+  }
+}
+
+/**
+ * @brief Store a variable held in a register to its slot
+ */
+static void write_through(JITCompiler *c, TACOperand dst) {
+  JITOperand d = jit_operand(c, dst);
+  if (dst.kind == TAC_OPND_VAR && d.kind == JIT_REG) {
+    JITOperand home = {JIT_MEM, dst.id};
+    emit_store(c, home, d.value);
+  }
+}
+
+/**
+ * @brief dst := src
+ */
+static void compile_assign(JITCompiler *c, const TACInst *inst) {
+  static const uint8_t mov_imm[] = {0xc7};
+  JITOperand d = jit_operand(c, inst->result);
+  JITOperand s = jit_operand(c, inst->arg1);
+  if (d.kind == JIT_REG) {
+    emit_load(c, d.value, s);
+  } else if (s.kind == JIT_REG) {
+    emit_store(c, d, s.value);
+  } else if (s.kind == JIT_IMM) {
+    emit_modrm(c, mov_imm, 1, 0, d);
+    emit_u32(c, (uint32_t)s.value);
+  } else {
+    emit_load(c, X86_RAX, s);
+    emit_store(c, d, X86_RAX);
+  }
+  write_through(c, inst->result);
+}
+
+/**
+ * @brief dst := a + b, a - b or a * b
+ */
+static void compile_arith(JITCompiler *c, const TACInst *inst) {
+  int op = inst->op == TAC_OP_ADD   ? ALU_ADD
+           : inst->op == TAC_OP_SUB ? ALU_SUB
+                                    : ALU_IMUL;
+  JITOperand d = jit_operand(c, inst->result);
+  JITOperand a = jit_operand(c, inst->arg1);
+  JITOperand b = jit_operand(c, inst->arg2);
+
+  if (d.kind != JIT_REG) {
+    emit_load(c, X86_RAX, a);
+    emit_alu(c, op, X86_RAX, b);
+    emit_store(c, d, X86_RAX);
+  } else if (b.kind == JIT_REG && b.value == d.value &&
+             !(a.kind == JIT_REG && a.value == d.value)) {
+    /* The destination already holds b */
+    if (op != ALU_SUB) {
+      emit_alu(c, op, d.value, a);
+    } else {
+      emit_load(c, X86_RAX, a);
+      emit_alu(c, op, X86_RAX, b);
+      emit_store(c, d, X86_RAX);
+    }
+  } else {
+    emit_load(c, d.value, a);
+    emit_alu(c, op, d.value, b);
+  }
+  write_through(c, inst->result);
+}
+
+/**
+ * @brief dst := a / b, trapping on zero and wrapping INT_MIN / -1
+ */
+static void compile_div(JITCompiler *c, const TACInst *inst) {
+  static const uint8_t group3[] = {0xf7};
+  emit_load(c, X86_RAX, jit_operand(c, inst->arg1));
+  JITOperand b = jit_operand(c, inst->arg2);
+
+  if (b.kind == JIT_IMM && b.value == 0) {
+    emit_jmp(c, c->label_divzero);
+    return;
+  }
+  if (b.kind == JIT_IMM && b.value == -1) {
+    emit_modrm(c, group3, 1, 3, jit_reg(X86_RAX)); /* neg eax */
+  } else if (b.kind == JIT_IMM) {
+    emit_load(c, X86_R11, b);
+    emit_byte(c, 0x99);                            /* cdq */
+    emit_modrm(c, group3, 1, 7, jit_reg(X86_R11)); /* idiv r11d */
+  } else {
+    static const uint8_t test[] = {0x85};
+    emit_load(c, X86_R11, b);
+    emit_modrm(c, test, 1, X86_R11, jit_reg(X86_R11));
+    emit_jcc(c, CC_E, c->label_divzero);
+    /* idiv faults on INT_MIN / -1, so -1 negates instead:
+     *   cmp r11d, -1; jne 1f; neg eax; jmp 2f; 1: cdq; idiv r11d; 2: */
+    static const uint8_t sequence[] = {0x41, 0x83, 0xfb, 0xff, 0x75, 0x04,
+                                       0xf7, 0xd8, 0xeb, 0x04, 0x99, 0x41,
+                                       0xf7, 0xfb};
+    for (size_t i = 0; i < sizeof(sequence); i++) {
+      emit_byte(c, sequence[i]);
+    }
+  }
+  emit_store(c, jit_operand(c, inst->result), X86_RAX);
+  write_through(c, inst->result);
+}
+
+/**
+ * @brief dst := -a or a << k, in the destination register when it has one
+ */
+static void compile_neg_shl(JITCompiler *c, const TACInst *inst) {
+  JITOperand d = jit_operand(c, inst->result);
+  int reg = d.kind == JIT_REG ? d.value : X86_RAX;
+  emit_load(c, reg, jit_operand(c, inst->arg1));
+  if (inst->op == TAC_OP_NEG) {
+    static const uint8_t group3[] = {0xf7};
+    emit_modrm(c, group3, 1, 3, jit_reg(reg)); /* neg */
+  } else {
+    static const uint8_t shift_imm[] = {0xc1};
+    emit_modrm(c, shift_imm, 1, 4, jit_reg(reg)); /* shl */
+    emit_byte(c, (uint8_t)(inst->arg2.value & 31));
+  }
+  emit_store(c, d, reg);
+  write_through(c, inst->result);
+}
+
+/**
+ * @brief dst := a >> k, rounding toward zero like a / 2^k
+ */
+static void compile_shr(JITCompiler *c, const TACInst *inst) {
+  int k = inst->arg2.value & 31;
+  emit_load(c, X86_RAX, jit_operand(c, inst->arg1));
+  if (k > 0) {
+    /* lea edx, [rax + 2^k - 1]; test eax, eax; cmovs eax, edx; sar eax, k */
+    static const uint8_t sequence[] = {0x85, 0xc0, 0x0f, 0x48, 0xc2,
+                                       0xc1, 0xf8};
+    emit_byte(c, 0x8d);
+    emit_byte(c, 0x90);
+    emit_u32(c, (1u << k) - 1u);
+    for (size_t i = 0; i < sizeof(sequence); i++) {
+      emit_byte(c, sequence[i]);
+    }
+    emit_byte(c, (uint8_t)k);
+  }
+  emit_store(c, jit_operand(c, inst->result), X86_RAX);
+  write_through(c, inst->result);
+}
+
+/**
+ * @brief Condition code of a relation, with its operands swapped if asked
+ */
+static int condition_code(TACOpType op, bool swapped) {
+  switch (op) {
+  case TAC_OP_EQ:
+    return CC_E;
+  case TAC_OP_NE:
+    return CC_NE;
+  case TAC_OP_LT:
+    return swapped ? CC_G : CC_L;
+  case TAC_OP_LE:
+    return swapped ? CC_GE : CC_LE;
+  case TAC_OP_GT:
+    return swapped ? CC_L : CC_G;
+  default:
+    return swapped ? CC_LE : CC_GE;
+  }
+}
+
+/**
+ * @brief if a relop b goto L
+ */
+static void compile_cond_jump(JITCompiler *c, const TACInst *inst) {
+  JITOperand a = jit_operand(c, inst->arg1);
+  JITOperand b = jit_operand(c, inst->arg2);
+  int label = inst->result.id;
+
+  if (a.kind == JIT_IMM && b.kind == JIT_IMM) {
+    if (tac_eval_relop(inst->op, a.value, b.value)) {
+      emit_jmp(c, label);
+    }
+    return;
+  }
+  bool swapped = false;
+  if (a.kind != JIT_REG && b.kind == JIT_REG) {
+    JITOperand t = a;
+    a = b;
+    b = t;
+    swapped = true;
+  }
+  if (a.kind != JIT_REG) {
+    emit_load(c, X86_RAX, a);
+    a = jit_reg(X86_RAX);
+  }
+  emit_alu(c, ALU_CMP, a.value, b);
+  emit_jcc(c, condition_code(inst->op, swapped), label);
+}
+
+/**
+ * @brief Check whether a label follows instruction i, possibly among others
+ */
+static bool label_follows(const TACProgram *program, int i, int label) {
+  for (int j = i + 1;
+       j < program->count && program->instructions[j].op == TAC_OP_LABEL;
+       j++) {
+    if (program->instructions[j].result.id == label) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void emit_push_pop(JITCompiler *c, X86Register reg, bool push) {
+  if (reg & 8) {
+    emit_byte(c, 0x41);
+  }
+  emit_byte(c, (uint8_t)((push ? 0x50 : 0x58) + (reg & 7)));
+}
+
+/**
+ * @brief Select instructions for the whole program
+ *
+ * @return bool false if the program uses an operation without a template
+ */
+static bool compile_program(JITCompiler *c) {
+  const TACProgram *program = c->program;
+
+  for (int r = 0; r < JIT_CALLEE_SAVED; r++) {
+    emit_push_pop(c, jit_allocatable[r], true);
+  }
+  /* Variables start at zero, in registers as in their slots */
+  static const uint8_t xor_op[] = {0x31};
+  for (int r = 0; r < JIT_REGISTERS; r++) {
+    emit_modrm(c, xor_op, 1, jit_allocatable[r], jit_reg(jit_allocatable[r]));
+  }
+
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    switch (inst->op) {
+    case TAC_OP_ASSIGN:
+      compile_assign(c, inst);
+      break;
+    case TAC_OP_ADD:
+    case TAC_OP_SUB:
+    case TAC_OP_MUL:
+      compile_arith(c, inst);
+      break;
+    case TAC_OP_DIV:
+      compile_div(c, inst);
+      break;
+    case TAC_OP_NEG:
+      compile_neg_shl(c, inst);
+      break;
+    case TAC_OP_SHL:
+    case TAC_OP_SHR:
+      if (inst->arg2.kind != TAC_OPND_CONST) {
+        DEBUG_PRINT("JIT needs a constant shift count");
+        return false;
+      }
+      if (inst->op == TAC_OP_SHL) {
+        compile_neg_shl(c, inst);
+      } else {
+        compile_shr(c, inst);
+      }
+      break;
+    case TAC_OP_EQ:
+    case TAC_OP_NE:
+    case TAC_OP_LT:
+    case TAC_OP_LE:
+    case TAC_OP_GT:
+    case TAC_OP_GE:
+      compile_cond_jump(c, inst);
+      break;
+    case TAC_OP_GOTO:
+      if (!label_follows(program, i, inst->result.id)) {
+        emit_jmp(c, inst->result.id);
+      }
+      break;
+    case TAC_OP_LABEL:
+      c->label_offset[inst->result.id] = c->size;
+      break;
+    case TAC_OP_RETURN:
+      emit_jmp(c, c->label_exit);
+      break;
+    default:
+      DEBUG_PRINT("JIT has no template for %s",
+                  tac_op_type_to_string(inst->op));
+      return false;
+    }
+  }
+
+  /* Epilogue: return 0, or 1 from the division-by-zero exit */
+  static const uint8_t xor_eax[] = {0x31, 0xc0};
+  c->label_offset[c->label_exit] = c->size;
+  emit_byte(c, xor_eax[0]);
+  emit_byte(c, xor_eax[1]);
+  size_t restore = c->size;
+  for (int r = JIT_CALLEE_SAVED - 1; r >= 0; r--) {
+    emit_push_pop(c, jit_allocatable[r], false);
+  }
+  emit_byte(c, 0xc3);
+  c->label_offset[c->label_divzero] = c->size;
+  emit_byte(c, 0xb8); /* mov eax, 1 */
+  emit_u32(c, 1);
+  emit_byte(c, 0xe9);
+  emit_u32(c, (uint32_t)(restore - (c->size + 4)));
+  return true;
+}
+
+/**
+ * @brief Patch every jump through the fixup table
+ */
+static bool apply_fixups(JITCompiler *c) {
+  for (int k = 0; k < c->fixup_count; k++) {
+    size_t target = c->label_offset[c->fixups[k].label];
+    if (target == SIZE_MAX) {
+      DEBUG_PRINT("JIT: jump to undefined label L%d", c->fixups[k].label);
+      return false;
+    }
+    size_t at = c->fixups[k].offset;
+    uint32_t rel = (uint32_t)(target - (at + 4));
+    memcpy(&c->code[at], &rel, sizeof(rel));
+  }
+  return true;
+}
+
+/**
+ * @brief Copy code into a fresh mapping and make it executable
+ */
+static void *map_code(const uint8_t *code, size_t size, size_t *mapped) {
+  long page = sysconf(_SC_PAGESIZE);
+  size_t length = (size + (size_t)page - 1) / (size_t)page * (size_t)page;
+  void *mem = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return NULL;
+  }
+  memcpy(mem, code, size);
+  if (mprotect(mem, length, PROT_READ | PROT_EXEC) != 0) {
+    munmap(mem, length);
+    return NULL;
+  }
+  *mapped = length;
+  return mem;
+}
+
+/**
+ * @brief Translate a program to machine code
+ *
+ * @return const char* NULL on success, otherwise why it falls back
+ */
+static const char *compile(TACJIT *jit, const TACProgram *program) {
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    return "control-flow graph failed";
+  }
+  RegAllocation *alloc = regalloc_linear_scan(program, cfg, JIT_REGISTERS);
+  cfg_destroy(cfg);
+  if (!alloc) {
+    return "register allocation failed";
+  }
+
+  JITCompiler c;
+  memset(&c, 0, sizeof(c));
+  c.program = program;
+  c.alloc = alloc;
+  c.label_exit = program->label_count;
+  c.label_divzero = program->label_count + 1;
+  c.label_offset = (size_t *)safe_malloc(((size_t)program->label_count + 2) *
+                                         sizeof(size_t));
+  for (int l = 0; l < program->label_count + 2; l++) {
+    c.label_offset[l] = SIZE_MAX;
+  }
+
+  const char *reason = NULL;
+  if (!compile_program(&c)) {
+    reason = "unsupported operation";
+  } else if (!apply_fixups(&c)) {
+    reason = "undefined label";
+  } else if (!(jit->code = map_code(c.code, c.size, &jit->mapped))) {
+    reason = "executable memory unavailable";
+  }
+
+  jit->stats.code_bytes = c.size;
+  jit->stats.fixups = c.fixup_count;
+  jit->stats.intervals = alloc->intervals;
+  jit->stats.spilled = alloc->spilled;
+  jit->stats.registers_used = alloc->registers_used;
+  free(c.code);
+  free(c.fixups);
+  free(c.label_offset);
+  regalloc_destroy(alloc);
+  return reason;
+}
+
+/**
+ * @brief Compile a program, falling back to the interpreter if needed
+ */
+TACJIT *tac_jit_create(const TACProgram *program) {
+  if (!program) {
+    return NULL;
+  }
+
+  double t_begin = now_seconds();
+  TACJIT *jit = (TACJIT *)safe_malloc(sizeof(TACJIT));
+  memset(jit, 0, sizeof(*jit));
+  jit->var_count = program->var_count;
+  jit->slot_count = dataflow_location_count(program);
+
+  jit->fallback_reason = compile(jit, program);
+  if (jit->fallback_reason) {
+    DEBUG_PRINT("JIT falls back to the interpreter: %s",
+                jit->fallback_reason);
+    jit->fallback = tac_vm_create(program);
+    if (!jit->fallback) {
+      free(jit);
+      return NULL;
+    }
+  } else {
+    jit->slots = (int32_t *)safe_malloc(((size_t)jit->slot_count + 1) *
+                                        sizeof(int32_t));
+  }
+  jit->stats.compile_seconds = now_seconds() - t_begin;
+  return jit;
+}
+
+/**
+ * @brief Check whether a program runs as machine code
+ */
+bool tac_jit_is_compiled(const TACJIT *jit) { return jit && jit->code; }
+
+/**
+ * @brief Run the program from the start with all variables zeroed
+ */
+bool tac_jit_run(TACJIT *jit) {
+  if (!jit) {
+    return false;
+  }
+  if (!jit->code) {
+    bool ok = tac_vm_run(jit->fallback);
+    jit->stats.run_seconds = jit->fallback->stats.run_seconds;
+    jit->error = tac_vm_error(jit->fallback);
+    return ok;
+  }
+
+  memset(jit->slots, 0, ((size_t)jit->slot_count + 1) * sizeof(int32_t));
+  JITFunction function;
+  memcpy(&function, &jit->code, sizeof(function));
+
+  double t_begin = now_seconds();
+  int status = function(jit->slots);
+  jit->stats.run_seconds = now_seconds() - t_begin;
+  jit->error = status ? "Division by zero" : NULL;
+  return status == 0;
+}
+
+/**
+ * @brief Get the value of a variable after a run
+ */
+int tac_jit_get_var(const TACJIT *jit, int id) {
+  if (!jit || id < 0 || id >= jit->var_count) {
+    return 0;
+  }
+  return jit->code ? jit->slots[id] : tac_vm_get_var(jit->fallback, id);
+}
+
+/**
+ * @brief Get the last runtime error message
+ */
+const char *tac_jit_error(const TACJIT *jit) { return jit ? jit->error : NULL; }
+
+/**
+ * @brief Unmap the code and free JIT resources
+ */
+void tac_jit_destroy(TACJIT *jit) {
+  if (!jit) {
+    return;
+  }
+  if (jit->code) {
+    munmap(jit->code, jit->mapped);
+  }
+  free(jit->slots);
+  tac_vm_destroy(jit->fallback);
+  free(jit);
+}
@@ -0,0 +1,634 @@
+/**
+ * @file codegen/tac_vm.c
+ * @brief Virtual machine executing three-address code
+ */
+
+#include "codegen/tac_vm.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Direct threading needs the labels-as-values extension */
+#if defined(__GNUC__)
+#define TAC_VM_THREADED 1
+#endif
+
+/* Longest goto chain followed when threading jumps at load time */
+#define TAC_VM_MAX_CHAIN 8
+
+/**
+ * @brief VM operations
+ *
+ * Arithmetic and relational groups keep the order of TAC_OP_ADD ..
+ * TAC_OP_SHR and TAC_OP_EQ .. TAC_OP_GE so they can be computed from the
+ * TAC operation by offset.
+ */
+typedef enum {
+  VM_OP_MOV,     /* dst := a */
+  VM_OP_ADD,     /* dst := a + b */
+  VM_OP_SUB,     /* dst := a - b */
+  VM_OP_MUL,     /* dst := a * b */
+  VM_OP_DIV,     /* dst := a / b */
+  VM_OP_NEG,     /* dst := -a */
+  VM_OP_SHL,     /* dst := a << b */
+  VM_OP_SHR,     /* dst := a >> b, rounding toward zero */
+  VM_OP_ADD_MOV, /* dst := a + b; dst2 := dst */
+  VM_OP_SUB_MOV, /* dst := a - b; dst2 := dst */
+  VM_OP_MUL_MOV, /* dst := a * b; dst2 := dst */
+  VM_OP_DIV_MOV, /* dst := a / b; dst2 := dst */
+  VM_OP_NEG_MOV, /* dst := -a; dst2 := dst */
+  VM_OP_SHL_MOV, /* dst := a << b; dst2 := dst */
+  VM_OP_SHR_MOV, /* dst := a >> b; dst2 := dst */
+  VM_OP_JEQ,     /* if a = b goto target */
+  VM_OP_JNE,
+  VM_OP_JLT,
+  VM_OP_JLE,
+  VM_OP_JGT,
+  VM_OP_JGE,
+  VM_OP_BEQ, /* if a = b goto target else goto alt */
+  VM_OP_BNE,
+  VM_OP_BLT,
+  VM_OP_BLE,
+  VM_OP_BGT,
+  VM_OP_BGE,
+  VM_OP_GOTO, /* goto target */
+  VM_OP_HALT, /* Stop */
+  VM_OP_COUNT
+} TACVMOp;
+
+/**
+ * @brief Translated instruction
+ *
+ * Every operand is a slot index and every jump a code index. Weight is the
+ * number of TAC instructions the instruction stands for; a two-way branch
+ * also executes its fused goto when it falls through. Gotos counts the
+ * unconditional jumps folded in ahead of it by jump threading.
+ */
+typedef struct TACVMCode {
+  const void *handler; /* Threaded dispatch address, set on the first run */
+  TACVMOp op;          /* Operation */
+  int dst;             /* Destination slot */
+  int dst2;            /* Second destination of fused copies */
+  int a;               /* First source slot */
+  int b;               /* Second source slot */
+  int target;          /* Jump target (label id until patched) */
+  int alt;             /* Fall-through target of two-way branches */
+  int weight;          /* TAC instructions executed */
+  int gotos;           /* TAC gotos among them, all taken */
+  int lineno;          /* Source line for runtime errors */
+} TACVMCode;
+
+/**
+ * @brief Open-addressing table giving each distinct constant one slot
+ */
+typedef struct ConstPool {
+  int *keys;    /* Constant values */
+  int *slots;   /* Slot of each constant, -1 for an empty entry */
+  int mask;     /* Table size minus one */
+  int count;    /* Constants stored */
+  int *values;  /* Values in slot order */
+} ConstPool;
+
+static void const_pool_init(ConstPool *pool, int expected) {
+  int size = 16;
+  while (size < 2 * expected) {
+    size *= 2;
+  }
+  pool->keys = (int *)safe_malloc((size_t)size * sizeof(int));
+  pool->slots = (int *)safe_malloc((size_t)size * sizeof(int));
+  pool->values = (int *)safe_malloc(((size_t)expected + 1) * sizeof(int));
+  memset(pool->slots, 0xff, (size_t)size * sizeof(int));
+  pool->mask = size - 1;
+  pool->count = 0;
+}
+
+static void const_pool_free(ConstPool *pool) {
+  free(pool->keys);
+  free(pool->slots);
+  free(pool->values);
+}
+
+/**
+ * @brief Get the index of a constant in the pool, adding it if new
+ */
+static int const_pool_intern(ConstPool *pool, int value) {
+  unsigned h = (unsigned)value * 2654435761u;
+  for (int i = (int)(h & (unsigned)pool->mask);; i = (i + 1) & pool->mask) {
+    if (pool->slots[i] < 0) {
+      pool->keys[i] = value;
+      pool->slots[i] = pool->count;
+      pool->values[pool->count] = value;
+      return pool->count++;
+    }
+    if (pool->keys[i] == value) {
+      return pool->slots[i];
+    }
+  }
+}
+
+/**
+ * @brief Translation state
+ */
+typedef struct VMLoader {
+  const TACProgram *program;
+  ConstPool pool;
+} VMLoader;
+
+/**
+ * @brief Slot of a source operand
+ *
+ * Constant slots are numbered from zero here and shifted past the
+ * temporaries once the pool is complete.
+ */
+static int operand_slot(VMLoader *loader, TACOperand operand, bool *constant) {
+  *constant = false;
+  switch (operand.kind) {
+  case TAC_OPND_VAR:
+    return operand.id;
+  case TAC_OPND_TEMP:
+    return loader->program->var_count + operand.id;
+  case TAC_OPND_CONST:
+    *constant = true;
+    return const_pool_intern(&loader->pool, operand.value);
+  default:
+    *constant = true;
+    return const_pool_intern(&loader->pool, 0);
+  }
+}
+
+/**
+ * @brief Fill the source slots of a translated instruction
+ *
+ * Constant operands are marked by negative slots until relocated.
+ */
+static void set_sources(VMLoader *loader, TACVMCode *code,
+                        const TACInst *inst) {
+  bool constant;
+  code->a = operand_slot(loader, inst->arg1, &constant);
+  if (constant) {
+    code->a = -1 - code->a;
+  }
+  code->b = operand_slot(loader, inst->arg2, &constant);
+  if (constant) {
+    code->b = -1 - code->b;
+  }
+}
+
+/**
+ * @brief Check whether inst copies the temporary written by prev to a
+ * location, so the two can be fused
+ */
+static bool is_result_copy(const TACInst *prev, const TACInst *inst) {
+  return inst->op == TAC_OP_ASSIGN && prev->result.kind == TAC_OPND_TEMP &&
+         tac_operand_equals(inst->arg1, prev->result);
+}
+
+/**
+ * @brief Translate the instruction stream, fusing adjacent pairs
+ *
+ * @return int Number of translated instructions, or -1 if the program uses
+ * an unsupported operation
+ */
+static int translate(VMLoader *loader, TACVMCode *code, int *label_code) {
+  const TACProgram *program = loader->program;
+  const TACInst *insts = program->instructions;
+  int n = program->count;
+  int count = 0;
+
+  for (int i = 0; i < n; i++) {
+    const TACInst *inst = &insts[i];
+    const TACInst *next = i + 1 < n ? &insts[i + 1] : NULL;
+    TACVMCode *c = &code[count];
+    memset(c, 0, sizeof(*c));
+    c->weight = 1;
+    c->lineno = inst->lineno;
+    bool constant;
+
+    switch (inst->op) {
+    case TAC_OP_LABEL:
+      label_code[inst->result.id] = count;
+      continue;
+    case TAC_OP_ASSIGN:
+      c->op = VM_OP_MOV;
+      c->dst = operand_slot(loader, inst->result, &constant);
+      set_sources(loader, c, inst);
+      break;
+    case TAC_OP_ADD:
+    case TAC_OP_SUB:
+    case TAC_OP_MUL:
+    case TAC_OP_DIV:
+    case TAC_OP_NEG:
+    case TAC_OP_SHL:
+    case TAC_OP_SHR:
+      c->op = VM_OP_ADD + (inst->op - TAC_OP_ADD);
+      c->dst = operand_slot(loader, inst->result, &constant);
+      set_sources(loader, c, inst);
+      if (next && is_result_copy(inst, next)) {
+        c->op += VM_OP_ADD_MOV - VM_OP_ADD;
+        c->dst2 = operand_slot(loader, next->result, &constant);
+        c->weight = 2;
+        i++;
+      }
+      break;
+    case TAC_OP_EQ:
+    case TAC_OP_NE:
+    case TAC_OP_LT:
+    case TAC_OP_LE:
+    case TAC_OP_GT:
+    case TAC_OP_GE:
+      set_sources(loader, c, inst);
+      c->target = inst->result.id;
+      if (next && next->op == TAC_OP_GOTO) {
+        c->op = VM_OP_BEQ + (inst->op - TAC_OP_EQ);
+        c->alt = next->result.id;
+        i++;
+      } else {
+        c->op = VM_OP_JEQ + (inst->op - TAC_OP_EQ);
+      }
+      break;
+    case TAC_OP_GOTO:
+      c->op = VM_OP_GOTO;
+      c->target = inst->result.id;
+      c->gotos = 1;
+      break;
+    case TAC_OP_RETURN:
+      c->op = VM_OP_HALT;
+      break;
+    default:
+      DEBUG_PRINT("VM cannot execute %s", tac_op_type_to_string(inst->op));
+      return -1;
+    }
+    count++;
+  }
+
+  /* Closing halt, not a TAC instruction */
+  memset(&code[count], 0, sizeof(code[count]));
+  code[count].op = VM_OP_HALT;
+  return count + 1;
+}
+
+/**
+ * @brief Check whether a translated instruction jumps through target
+ */
+static bool has_target(TACVMOp op) {
+  return op >= VM_OP_JEQ && op <= VM_OP_GOTO;
+}
+
+/**
+ * @brief Check whether a translated instruction is a two-way branch
+ */
+static bool is_two_way(TACVMOp op) {
+  return op >= VM_OP_BEQ && op <= VM_OP_BGE;
+}
+
+/**
+ * @brief Replace gotos leading to a goto or a two-way branch by their
+ * destination, so each costs one dispatch
+ */
+static void thread_jumps(TACVMCode *code, int count) {
+  for (int i = 0; i < count; i++) {
+    if (code[i].op != VM_OP_GOTO) {
+      continue;
+    }
+    int weight = code[i].weight;
+    int gotos = code[i].gotos;
+    int target = code[i].target;
+    for (int hops = 0;
+         hops < TAC_VM_MAX_CHAIN && code[target].op == VM_OP_GOTO &&
+         target != i;
+         hops++) {
+      weight += code[target].weight;
+      gotos += code[target].gotos;
+      target = code[target].target;
+    }
+    if (is_two_way(code[target].op)) {
+      int lineno = code[i].lineno;
+      code[i] = code[target];
+      code[i].weight += weight;
+      code[i].gotos += gotos;
+      code[i].lineno = lineno;
+    } else {
+      code[i].target = target;
+      code[i].weight = weight;
+      code[i].gotos = gotos;
+    }
+  }
+}
+
+/**
+ * @brief Translate a program for execution
+ */
+TACVM *tac_vm_create(const TACProgram *program) {
+  if (!program) {
+    return NULL;
+  }
+
+  double t_begin = now_seconds();
+  VMLoader loader = {program, {0}};
+  int constants = 1; /* Unused operands read as zero */
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    constants += (inst->arg1.kind == TAC_OPND_CONST) +
+                 (inst->arg2.kind == TAC_OPND_CONST);
+  }
+  const_pool_init(&loader.pool, constants);
+
+  TACVMCode *code =
+      (TACVMCode *)safe_malloc(((size_t)program->count + 1) * sizeof(TACVMCode));
+  int *label_code = (int *)safe_malloc(((size_t)program->label_count + 1) *
+                                       sizeof(int));
+  memset(label_code, 0xff, ((size_t)program->label_count + 1) * sizeof(int));
+
+  int count = translate(&loader, code, label_code);
+  if (count < 0) {
+    free(code);
+    free(label_code);
+    const_pool_free(&loader.pool);
+    return NULL;
+  }
+
+  /* Resolve labels and move constants past the temporaries */
+  int base = program->var_count + program->temp_count;
+  for (int i = 0; i < count; i++) {
+    TACVMCode *c = &code[i];
+    if (c->a < 0) {
+      c->a = base - 1 - c->a;
+    }
+    if (c->b < 0) {
+      c->b = base - 1 - c->b;
+    }
+    if (!has_target(c->op)) {
+      continue;
+    }
+    int target = label_code[c->target];
+    int alt = is_two_way(c->op) ? label_code[c->alt] : 0;
+    if (target < 0 || alt < 0) {
+      DEBUG_PRINT("VM: jump to undefined label at line %d", c->lineno);
+      free(code);
+      free(label_code);
+      const_pool_free(&loader.pool);
+      return NULL;
+    }
+    c->target = target;
+    c->alt = alt;
+  }
+  free(label_code);
+  thread_jumps(code, count);
+
+  TACVM *vm = (TACVM *)safe_malloc(sizeof(TACVM));
+  memset(vm, 0, sizeof(*vm));
+  vm->program = program;
+  vm->code = (TACVMCode *)safe_realloc(code, (size_t)count * sizeof(TACVMCode));
+  vm->code_count = count;
+  vm->var_count = program->var_count;
+  vm->const_base = base;
+  vm->slot_count = base + loader.pool.count;
+  vm->slots =
+      (int32_t *)safe_malloc(((size_t)vm->slot_count + 1) * sizeof(int32_t));
+  memset(vm->slots, 0, ((size_t)vm->slot_count + 1) * sizeof(int32_t));
+  for (int k = 0; k < loader.pool.count; k++) {
+    vm->slots[base + k] = loader.pool.values[k];
+  }
+  const_pool_free(&loader.pool);
+
+  vm->stats.load_seconds = now_seconds() - t_begin;
+  DEBUG_PRINT("VM loaded %d instructions into %d, %d slots", program->count,
+              count, vm->slot_count);
+  return vm;
+}
+
+/* Handler labels and dispatch; handlers end with VM_NEXT() or VM_JUMP(),
+ * which under the switch fallback must not be wrapped in do-while */
+#ifdef TAC_VM_THREADED
+#define VM_CASE(name) vm_op_##name:
+#define VM_DISPATCH() goto *pc->handler
+#else
+#define VM_CASE(name) case VM_OP_##name:
+#define VM_DISPATCH() continue
+#endif
+
+#define VM_NEXT()                                                              \
+  {                                                                            \
+    pc++;                                                                      \
+    dispatched++;                                                              \
+    VM_DISPATCH();                                                             \
+  }
+
+#define VM_JUMP(index)                                                         \
+  {                                                                            \
+    pc = code + (index);                                                       \
+    dispatched++;                                                              \
+    VM_DISPATCH();                                                             \
+  }
+
+/* Unsigned arithmetic wraps like the constant folder */
+#define VM_ARITH(name, expr)                                                   \
+  VM_CASE(name) {                                                              \
+    uint32_t x = (uint32_t)s[pc->a], y = (uint32_t)s[pc->b];                   \
+    (void)y; /* Unary operations ignore b */                                   \
+    s[pc->dst] = (int32_t)(expr);                                              \
+    executed += pc->weight;                                                    \
+    VM_NEXT();                                                                 \
+  }
+
+#define VM_ARITH_MOV(name, expr)                                               \
+  VM_CASE(name) {                                                              \
+    uint32_t x = (uint32_t)s[pc->a], y = (uint32_t)s[pc->b];                   \
+    (void)y; /* Unary operations ignore b */                                   \
+    s[pc->dst] = s[pc->dst2] = (int32_t)(expr);                                \
+    executed += pc->weight;                                                    \
+    VM_NEXT();                                                                 \
+  }
+
+#define VM_DIVIDE(name, store)                                                 \
+  VM_CASE(name) {                                                              \
+    int32_t x = s[pc->a], y = s[pc->b];                                        \
+    if (y == 0) {                                                              \
+      goto division_by_zero;                                                   \
+    }                                                                          \
+    store = y == -1 ? (int32_t)(0u - (uint32_t)x) : x / y;                     \
+    executed += pc->weight;                                                    \
+    VM_NEXT();                                                                 \
+  }
+
+#define VM_COND(name, rel)                                                     \
+  VM_CASE(name) {                                                              \
+    executed += pc->weight;                                                    \
+    jumps++;                                                                   \
+    if (s[pc->a] rel s[pc->b]) {                                               \
+      taken++;                                                                 \
+      VM_JUMP(pc->target);                                                     \
+    }                                                                          \
+    VM_NEXT();                                                                 \
+  }
+
+/* Either the branch or its fused goto is taken */
+#define VM_BRANCH(name, rel)                                                   \
+  VM_CASE(name) {                                                              \
+    jumps += pc->gotos + 1;                                                    \
+    taken += pc->gotos + 1;                                                    \
+    if (s[pc->a] rel s[pc->b]) {                                               \
+      executed += pc->weight;                                                  \
+      VM_JUMP(pc->target);                                                     \
+    }                                                                          \
+    executed += pc->weight + 1;                                                \
+    jumps++;                                                                   \
+    VM_JUMP(pc->alt);                                                          \
+  }
+
+/**
+ * @brief Run the program from the start with all variables zeroed
+ */
+bool tac_vm_run(TACVM *vm) {
+  if (!vm) {
+    return false;
+  }
+
+  TACVMCode *code = vm->code;
+#ifdef TAC_VM_THREADED
+  static const void *const handlers[VM_OP_COUNT] = {
+      &&vm_op_MOV,     &&vm_op_ADD,     &&vm_op_SUB,     &&vm_op_MUL,
+      &&vm_op_DIV,     &&vm_op_NEG,     &&vm_op_SHL,     &&vm_op_SHR,
+      &&vm_op_ADD_MOV, &&vm_op_SUB_MOV, &&vm_op_MUL_MOV, &&vm_op_DIV_MOV,
+      &&vm_op_NEG_MOV, &&vm_op_SHL_MOV, &&vm_op_SHR_MOV, &&vm_op_JEQ,
+      &&vm_op_JNE,     &&vm_op_JLT,     &&vm_op_JLE,     &&vm_op_JGT,
+      &&vm_op_JGE,     &&vm_op_BEQ,     &&vm_op_BNE,     &&vm_op_BLT,
+      &&vm_op_BLE,     &&vm_op_BGT,     &&vm_op_BGE,     &&vm_op_GOTO,
+      &&vm_op_HALT};
+  if (!code[0].handler) {
+    for (int i = 0; i < vm->code_count; i++) {
+      code[i].handler = handlers[code[i].op];
+    }
+  }
+#endif
+
+  memset(vm->slots, 0, (size_t)vm->const_base * sizeof(int32_t));
+  vm->error = NULL;
+  vm->error_line = 0;
+
+  int32_t *s = vm->slots;
+  const TACVMCode *pc = code;
+  uint64_t executed = 0;
+  uint64_t dispatched = 1;
+  uint64_t jumps = 0;
+  uint64_t taken = 0;
+  double t_begin = now_seconds();
+
+#ifdef TAC_VM_THREADED
+  VM_DISPATCH();
+#else
+  for (;;) {
+    switch (pc->op) {
+#endif
+  VM_CASE(MOV) {
+    s[pc->dst] = s[pc->a];
+    executed += pc->weight;
+    VM_NEXT();
+  }
+  VM_ARITH(ADD, x + y)
+  VM_ARITH(SUB, x - y)
+  VM_ARITH(MUL, x * y)
+  VM_DIVIDE(DIV, s[pc->dst])
+  VM_ARITH(NEG, 0u - x)
+  VM_ARITH(SHL, x << (y & 31))
+  VM_ARITH(SHR, tac_shift_right((int32_t)x, (int32_t)y))
+  VM_ARITH_MOV(ADD_MOV, x + y)
+  VM_ARITH_MOV(SUB_MOV, x - y)
+  VM_ARITH_MOV(MUL_MOV, x * y)
+  VM_DIVIDE(DIV_MOV, s[pc->dst] = s[pc->dst2])
+  VM_ARITH_MOV(NEG_MOV, 0u - x)
+  VM_ARITH_MOV(SHL_MOV, x << (y & 31))
+  VM_ARITH_MOV(SHR_MOV, tac_shift_right((int32_t)x, (int32_t)y))
+  VM_COND(JEQ, ==)
+  VM_COND(JNE, !=)
+  VM_COND(JLT, <)
+  VM_COND(JLE, <=)
+  VM_COND(JGT, >)
+  VM_COND(JGE, >=)
+  VM_BRANCH(BEQ, ==)
+  VM_BRANCH(BNE, !=)
+  VM_BRANCH(BLT, <)
+  VM_BRANCH(BLE, <=)
+  VM_BRANCH(BGT, >)
+  VM_BRANCH(BGE, >=)
+  VM_CASE(GOTO) {
+    executed += pc->weight;
+    jumps += pc->gotos;
+    taken += pc->gotos;
+    VM_JUMP(pc->target);
+  }
+  VM_CASE(HALT) {
+    executed += pc->weight;
+    goto halt;
+  }
+#ifndef TAC_VM_THREADED
+    default:
+      goto halt;
+    }
+  }
+#endif
+
+division_by_zero:
+  vm->error = "Division by zero";
+  vm->error_line = pc->lineno;
+
+halt:
+  vm->stats.executed = executed;
+  vm->stats.dispatched = dispatched;
+  vm->stats.jumps = jumps;
+  vm->stats.taken = taken;
+  vm->stats.run_seconds = now_seconds() - t_begin;
+  return vm->error == NULL;
+}
+
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_ARITH
+#undef VM_ARITH_MOV
+#undef VM_DIVIDE
+#undef VM_COND
+#undef VM_BRANCH
+
+/**
+ * @brief Get the value of a variable after a run
+ */
+int tac_vm_get_var(const TACVM *vm, int id) {
+  if (!vm || id < 0 || id >= vm->var_count) {
+    return 0;
+  }
+  return vm->slots[id];
+}
+
+/**
+ * @brief Get the last runtime error message
+ */
+const char *tac_vm_error(const TACVM *vm) {
+  return vm ? vm->error : NULL;
+}
+
+/**
+ * @brief Print each variable and its value to stdout
+ */
+void tac_vm_print_vars(const TACVM *vm) {
+  if (!vm) {
+    return;
+  }
+  for (int i = 0; i < vm->var_count; i++) {
+    printf("  %s = %d\n", tac_program_var_name(vm->program, i), vm->slots[i]);
+  }
+}
+
+/**
+ * @brief Free VM resources
+ */
+void tac_vm_destroy(TACVM *vm) {
+  if (!vm) {
+    return;
+  }
+  free(vm->code);
+  free(vm->slots);
+  free(vm);
+}
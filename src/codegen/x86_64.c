@@ -0,0 +1,545 @@
+/**
+ * @file codegen/x86_64.c
+ * @brief x86-64 code generation from three-address code
+ */
+
+#include "codegen/x86_64.h"
+#include "codegen/cfg.h"
+#include "codegen/dataflow.h"
+#include "codegen/regalloc.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest operand rendered by format_operand() */
+#define X86_OPERAND_SIZE 48
+
+const X86Register x86_allocatable[X86_ALLOCATABLE] = {
+    X86_RBX, X86_R12, X86_R13, X86_R14, X86_R15, X86_RCX,
+    X86_RSI, X86_RDI, X86_R8,  X86_R9,  X86_R10};
+
+/* Callee-saved registers among the allocatable ones, saved by tac_run() */
+#define X86_CALLEE_SAVED 5
+
+/**
+ * @brief Get the AT&T name of the low 32 bits of a register
+ */
+const char *x86_register_name32(X86Register reg) {
+  static const char *const names[] = {
+      "%eax", "%ecx", "%edx",  "%ebx",  "%esp",  "%ebp",  "%esi",  "%edi",
+      "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"};
+  return reg >= X86_RAX && reg <= X86_R15 ? names[reg] : "?";
+}
+
+/**
+ * @brief Get the AT&T name of a full register
+ */
+static const char *register_name64(X86Register reg) {
+  static const char *const names[] = {
+      "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+      "%r8",  "%r9",  "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"};
+  return names[reg];
+}
+
+/**
+ * @brief Translation state
+ */
+typedef struct X86Emitter {
+  const TACProgram *program;
+  const RegAllocation *alloc;
+  FILE *out;
+  int local_labels; /* Labels generated for division */
+} X86Emitter;
+
+/**
+ * @brief Machine register holding an operand, or -1
+ */
+static int machine_register(const X86Emitter *e, TACOperand operand) {
+  int r = regalloc_register(e->alloc, e->program, operand);
+  return r >= 0 ? (int)x86_allocatable[r] : -1;
+}
+
+/**
+ * @brief Check whether an operand is a location kept in memory
+ */
+static bool in_memory(const X86Emitter *e, TACOperand operand) {
+  return (operand.kind == TAC_OPND_VAR || operand.kind == TAC_OPND_TEMP) &&
+         machine_register(e, operand) < 0;
+}
+
+/**
+ * @brief Render an operand in AT&T syntax
+ */
+static const char *format_operand(const X86Emitter *e, TACOperand operand,
+                                  char *buf) {
+  int reg = machine_register(e, operand);
+  if (reg >= 0) {
+    snprintf(buf, X86_OPERAND_SIZE, "%s",
+             x86_register_name32((X86Register)reg));
+    return buf;
+  }
+  switch (operand.kind) {
+  case TAC_OPND_VAR:
+    snprintf(buf, X86_OPERAND_SIZE, "tac_vars+%d(%%rip)", 4 * operand.id);
+    break;
+  case TAC_OPND_TEMP:
+    snprintf(buf, X86_OPERAND_SIZE, "tac_temps+%d(%%rip)", 4 * operand.id);
+    break;
+  case TAC_OPND_CONST:
+    snprintf(buf, X86_OPERAND_SIZE, "$%d", operand.value);
+    break;
+  default:
+    snprintf(buf, X86_OPERAND_SIZE, "$0");
+    break;
+  }
+  return buf;
+}
+
+/**
+ * @brief Store a variable held in a register to its memory home
+ */
+static void store_home(X86Emitter *e, TACOperand dst) {
+  int reg = machine_register(e, dst);
+  if (dst.kind == TAC_OPND_VAR && reg >= 0) {
+    fprintf(e->out, "\tmovl\t%s, tac_vars+%d(%%rip)\n",
+            x86_register_name32((X86Register)reg), 4 * dst.id);
+  }
+}
+
+/**
+ * @brief Write the value in %eax to a location
+ */
+static void store_eax(X86Emitter *e, TACOperand dst) {
+  char d[X86_OPERAND_SIZE];
+  fprintf(e->out, "\tmovl\t%%eax, %s\n", format_operand(e, dst, d));
+  store_home(e, dst);
+}
+
+/**
+ * @brief dst := src
+ */
+static void emit_assign(X86Emitter *e, const TACInst *inst) {
+  char d[X86_OPERAND_SIZE], s[X86_OPERAND_SIZE];
+  int dst_reg = machine_register(e, inst->result);
+  if (dst_reg >= 0 && dst_reg == machine_register(e, inst->arg1)) {
+    store_home(e, inst->result); /* Register handed over */
+    return;
+  }
+  if (in_memory(e, inst->result) && in_memory(e, inst->arg1)) {
+    fprintf(e->out, "\tmovl\t%s, %%eax\n", format_operand(e, inst->arg1, s));
+    store_eax(e, inst->result);
+    return;
+  }
+  fprintf(e->out, "\tmovl\t%s, %s\n", format_operand(e, inst->arg1, s),
+          format_operand(e, inst->result, d));
+  store_home(e, inst->result);
+}
+
+/**
+ * @brief dst := a + b, a - b or a * b
+ */
+static void emit_arith(X86Emitter *e, const TACInst *inst) {
+  const char *mnemonic = inst->op == TAC_OP_ADD   ? "addl"
+                         : inst->op == TAC_OP_SUB ? "subl"
+                                                  : "imull";
+  bool commutative = inst->op != TAC_OP_SUB;
+  char d[X86_OPERAND_SIZE], a[X86_OPERAND_SIZE], b[X86_OPERAND_SIZE];
+  format_operand(e, inst->arg1, a);
+  format_operand(e, inst->arg2, b);
+  int dst_reg = machine_register(e, inst->result);
+  int a_reg = machine_register(e, inst->arg1);
+  int b_reg = machine_register(e, inst->arg2);
+
+  if (dst_reg < 0) {
+    fprintf(e->out, "\tmovl\t%s, %%eax\n\t%s\t%s, %%eax\n", a, mnemonic, b);
+    store_eax(e, inst->result);
+    return;
+  }
+
+  format_operand(e, inst->result, d);
+  if (b_reg == dst_reg && a_reg != dst_reg) {
+    /* The destination already holds b */
+    if (commutative) {
+      fprintf(e->out, "\t%s\t%s, %s\n", mnemonic, a, d);
+    } else {
+      fprintf(e->out, "\tmovl\t%s, %%eax\n\t%s\t%s, %%eax\n", a, mnemonic, b);
+      fprintf(e->out, "\tmovl\t%%eax, %s\n", d);
+    }
+  } else {
+    if (a_reg != dst_reg) {
+      fprintf(e->out, "\tmovl\t%s, %s\n", a, d);
+    }
+    fprintf(e->out, "\t%s\t%s, %s\n", mnemonic, b, d);
+  }
+  store_home(e, inst->result);
+}
+
+/**
+ * @brief dst := a / b, trapping on zero and wrapping INT_MIN / -1
+ */
+static void emit_div(X86Emitter *e, const TACInst *inst) {
+  char a[X86_OPERAND_SIZE], b[X86_OPERAND_SIZE];
+  fprintf(e->out, "\tmovl\t%s, %%eax\n", format_operand(e, inst->arg1, a));
+
+  if (inst->arg2.kind == TAC_OPND_CONST) {
+    int divisor = inst->arg2.value;
+    if (divisor == 0) {
+      fprintf(e->out, "\tjmp\t.Ldivzero\n");
+      return;
+    }
+    if (divisor == -1) {
+      fprintf(e->out, "\tnegl\t%%eax\n");
+    } else {
+      fprintf(e->out, "\tmovl\t$%d, %%r11d\n\tcltd\n\tidivl\t%%r11d\n",
+              divisor);
+    }
+  } else {
+    /* idiv faults on INT_MIN / -1, so -1 negates instead */
+    int k = e->local_labels++;
+    fprintf(e->out, "\tmovl\t%s, %%r11d\n", format_operand(e, inst->arg2, b));
+    fprintf(e->out, "\ttestl\t%%r11d, %%r11d\n\tje\t.Ldivzero\n");
+    fprintf(e->out, "\tcmpl\t$-1, %%r11d\n\tjne\t.Ldiv%d\n", k);
+    fprintf(e->out, "\tnegl\t%%eax\n\tjmp\t.Ldivdone%d\n", k);
+    fprintf(e->out, ".Ldiv%d:\n\tcltd\n\tidivl\t%%r11d\n.Ldivdone%d:\n", k,
+            k);
+  }
+  store_eax(e, inst->result);
+}
+
+/**
+ * @brief dst := -a or a << k, in the destination register when it has one
+ */
+static void emit_neg_shl(X86Emitter *e, const TACInst *inst) {
+  char d[X86_OPERAND_SIZE], a[X86_OPERAND_SIZE], op[16];
+  if (inst->op == TAC_OP_NEG) {
+    snprintf(op, sizeof(op), "negl\t");
+  } else {
+    snprintf(op, sizeof(op), "sall\t$%d, ", inst->arg2.value & 31);
+  }
+  format_operand(e, inst->arg1, a);
+  int dst_reg = machine_register(e, inst->result);
+
+  if (dst_reg < 0) {
+    fprintf(e->out, "\tmovl\t%s, %%eax\n\t%s%%eax\n", a, op);
+    store_eax(e, inst->result);
+    return;
+  }
+  format_operand(e, inst->result, d);
+  if (machine_register(e, inst->arg1) != dst_reg) {
+    fprintf(e->out, "\tmovl\t%s, %s\n", a, d);
+  }
+  fprintf(e->out, "\t%s%s\n", op, d);
+  store_home(e, inst->result);
+}
+
+/**
+ * @brief dst := a >> k, rounding toward zero like a / 2^k
+ */
+static void emit_shr(X86Emitter *e, const TACInst *inst) {
+  char a[X86_OPERAND_SIZE];
+  int k = inst->arg2.value & 31;
+  fprintf(e->out, "\tmovl\t%s, %%eax\n", format_operand(e, inst->arg1, a));
+  if (k > 0) {
+    /* Negative dividends are biased by 2^k - 1 before the shift */
+    fprintf(e->out, "\tleal\t%u(%%rax), %%edx\n\ttestl\t%%eax, %%eax\n"
+                    "\tcmovsl\t%%edx, %%eax\n\tsarl\t$%d, %%eax\n",
+            (1u << k) - 1u, k);
+  }
+  store_eax(e, inst->result);
+}
+
+/**
+ * @brief Condition code of a conditional jump
+ */
+static const char *condition_code(TACOpType op) {
+  switch (op) {
+  case TAC_OP_EQ:
+    return "e";
+  case TAC_OP_NE:
+    return "ne";
+  case TAC_OP_LT:
+    return "l";
+  case TAC_OP_LE:
+    return "le";
+  case TAC_OP_GT:
+    return "g";
+  default:
+    return "ge";
+  }
+}
+
+/**
+ * @brief Get the relation holding when the operands are swapped
+ */
+static TACOpType swap_relop(TACOpType op) {
+  switch (op) {
+  case TAC_OP_LT:
+    return TAC_OP_GT;
+  case TAC_OP_GT:
+    return TAC_OP_LT;
+  case TAC_OP_LE:
+    return TAC_OP_GE;
+  case TAC_OP_GE:
+    return TAC_OP_LE;
+  default:
+    return op;
+  }
+}
+
+/**
+ * @brief if a relop b goto L, as cmp and jcc
+ */
+static void emit_cond_jump(X86Emitter *e, const TACInst *inst) {
+  TACOpType op = inst->op;
+  TACOperand lhs = inst->arg1;
+  TACOperand rhs = inst->arg2;
+  int label = inst->result.id;
+
+  if (lhs.kind == TAC_OPND_CONST && rhs.kind == TAC_OPND_CONST) {
+    if (tac_eval_relop(op, lhs.value, rhs.value)) {
+      fprintf(e->out, "\tjmp\t.L%d\n", label);
+    }
+    return;
+  }
+  if (lhs.kind == TAC_OPND_CONST) {
+    TACOperand t = lhs;
+    lhs = rhs;
+    rhs = t;
+    op = swap_relop(op);
+  }
+
+  char a[X86_OPERAND_SIZE], b[X86_OPERAND_SIZE];
+  format_operand(e, lhs, a);
+  format_operand(e, rhs, b);
+  if (in_memory(e, lhs) && in_memory(e, rhs)) {
+    fprintf(e->out, "\tmovl\t%s, %%eax\n", a);
+    strcpy(a, "%eax");
+  }
+  fprintf(e->out, "\tcmpl\t%s, %s\n\tj%s\t.L%d\n", b, a, condition_code(op),
+          label);
+}
+
+/**
+ * @brief Check whether a label follows instruction i, possibly among others
+ */
+static bool label_follows(const TACProgram *program, int i, int label) {
+  for (int j = i + 1;
+       j < program->count && program->instructions[j].op == TAC_OP_LABEL;
+       j++) {
+    if (program->instructions[j].result.id == label) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Emit tac_run()
+ */
+static bool emit_function(X86Emitter *e) {
+  const TACProgram *program = e->program;
+  FILE *out = e->out;
+
+  fprintf(out, "\t.text\n\t.globl\ttac_run\n\t.type\ttac_run, @function\n");
+  fprintf(out, "tac_run:\n");
+  for (int r = 0; r < X86_CALLEE_SAVED; r++) {
+    fprintf(out, "\tpushq\t%s\n", register_name64(x86_allocatable[r]));
+  }
+  /* Variables start at zero, in registers as in memory */
+  for (int r = 0; r < X86_ALLOCATABLE; r++) {
+    const char *name = x86_register_name32(x86_allocatable[r]);
+    fprintf(out, "\txorl\t%s, %s\n", name, name);
+  }
+
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    switch (inst->op) {
+    case TAC_OP_ASSIGN:
+      emit_assign(e, inst);
+      break;
+    case TAC_OP_ADD:
+    case TAC_OP_SUB:
+    case TAC_OP_MUL:
+      emit_arith(e, inst);
+      break;
+    case TAC_OP_DIV:
+      emit_div(e, inst);
+      break;
+    case TAC_OP_NEG:
+      emit_neg_shl(e, inst);
+      break;
+    case TAC_OP_SHL:
+    case TAC_OP_SHR:
+      if (inst->arg2.kind != TAC_OPND_CONST) {
+        DEBUG_PRINT("x86-64 backend needs a constant shift count");
+        return false;
+      }
+      if (inst->op == TAC_OP_SHL) {
+        emit_neg_shl(e, inst);
+      } else {
+        emit_shr(e, inst);
+      }
+      break;
+    case TAC_OP_EQ:
+    case TAC_OP_NE:
+    case TAC_OP_LT:
+    case TAC_OP_LE:
+    case TAC_OP_GT:
+    case TAC_OP_GE:
+      emit_cond_jump(e, inst);
+      break;
+    case TAC_OP_GOTO:
+      if (!label_follows(program, i, inst->result.id)) {
+        fprintf(out, "\tjmp\t.L%d\n", inst->result.id);
+      }
+      break;
+    case TAC_OP_LABEL:
+      fprintf(out, ".L%d:\n", inst->result.id);
+      break;
+    case TAC_OP_RETURN:
+      fprintf(out, "\tjmp\t.Lexit\n");
+      break;
+    default:
+      DEBUG_PRINT("x86-64 backend cannot translate %s",
+                  tac_op_type_to_string(inst->op));
+      return false;
+    }
+  }
+
+  fprintf(out, ".Lexit:\n\txorl\t%%eax, %%eax\n.Lreturn:\n");
+  for (int r = X86_CALLEE_SAVED - 1; r >= 0; r--) {
+    fprintf(out, "\tpopq\t%s\n", register_name64(x86_allocatable[r]));
+  }
+  fprintf(out, "\tret\n.Ldivzero:\n\tmovl\t$1, %%eax\n\tjmp\t.Lreturn\n");
+  fprintf(out, "\t.size\ttac_run, .-tac_run\n\n");
+  return true;
+}
+
+/**
+ * @brief Emit main(), which times tac_run() and prints the variables
+ */
+static void emit_main(X86Emitter *e) {
+  FILE *out = e->out;
+  /* Two timespecs at 0(%rsp) and 16(%rsp); the stack stays 16-byte aligned
+   * after three pushes and 48 bytes of locals */
+  fprintf(out, "\t.globl\tmain\n\t.type\tmain, @function\nmain:\n"
+               "\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n"
+               "\tpushq\t%%rbx\n\tpushq\t%%r12\n\tsubq\t$48, %%rsp\n"
+               "\tmovl\t$1, %%edi\n\tmovq\t%%rsp, %%rsi\n"
+               "\tcall\tclock_gettime@PLT\n"
+               "\tcall\ttac_run\n\tmovl\t%%eax, %%r12d\n"
+               "\tmovl\t$1, %%edi\n\tleaq\t16(%%rsp), %%rsi\n"
+               "\tcall\tclock_gettime@PLT\n");
+  fprintf(out, "\tmovq\t16(%%rsp), %%rax\n\tsubq\t(%%rsp), %%rax\n"
+               "\timulq\t$1000000000, %%rax, %%rax\n"
+               "\taddq\t24(%%rsp), %%rax\n\tsubq\t8(%%rsp), %%rax\n"
+               "\tcvtsi2sdq\t%%rax, %%xmm0\n"
+               "\tdivsd\t.Lmillion(%%rip), %%xmm0\n"
+               "\tmovq\tstderr@GOTPCREL(%%rip), %%rax\n"
+               "\tmovq\t(%%rax), %%rdi\n\tleaq\t.Lfmt_time(%%rip), %%rsi\n"
+               "\tmovl\t$1, %%eax\n\tcall\tfprintf@PLT\n");
+  fprintf(out, "\ttestl\t%%r12d, %%r12d\n\tje\t.Lmain_vars\n"
+               "\tmovq\tstderr@GOTPCREL(%%rip), %%rax\n"
+               "\tmovq\t(%%rax), %%rsi\n\tleaq\t.Lfmt_error(%%rip), %%rdi\n"
+               "\tcall\tfputs@PLT\n");
+  fprintf(out, ".Lmain_vars:\n\txorl\t%%ebx, %%ebx\n.Lmain_loop:\n"
+               "\tcmpl\t$%d, %%ebx\n\tjge\t.Lmain_done\n"
+               "\tleaq\ttac_var_names(%%rip), %%rax\n"
+               "\tmovq\t(%%rax,%%rbx,8), %%rsi\n"
+               "\tleaq\ttac_vars(%%rip), %%rax\n"
+               "\tmovl\t(%%rax,%%rbx,4), %%edx\n"
+               "\tleaq\t.Lfmt_var(%%rip), %%rdi\n"
+               "\txorl\t%%eax, %%eax\n\tcall\tprintf@PLT\n"
+               "\tincl\t%%ebx\n\tjmp\t.Lmain_loop\n",
+          e->program->var_count);
+  fprintf(out, ".Lmain_done:\n\tmovl\t%%r12d, %%eax\n\taddq\t$48, %%rsp\n"
+               "\tpopq\t%%r12\n\tpopq\t%%rbx\n\tpopq\t%%rbp\n\tret\n"
+               "\t.size\tmain, .-main\n\n");
+}
+
+/**
+ * @brief Emit variable storage, names and format strings
+ */
+static void emit_data(X86Emitter *e) {
+  const TACProgram *program = e->program;
+  FILE *out = e->out;
+
+  fprintf(out, "\t.bss\n\t.align\t4\ntac_vars:\n\t.zero\t%d\n",
+          4 * (program->var_count > 0 ? program->var_count : 1));
+  fprintf(out, "tac_temps:\n\t.zero\t%d\n\n",
+          4 * (program->temp_count > 0 ? program->temp_count : 1));
+
+  fprintf(out, "\t.section\t.rodata\n\t.align\t8\n.Lmillion:\n"
+               "\t.double\t1000000.0\n");
+  fprintf(out, ".Lfmt_time:\n\t.string\t\"Native run %%.3f ms\\n\"\n");
+  fprintf(out, ".Lfmt_error:\n\t.string\t\"Runtime error: Division by "
+               "zero\\n\"\n");
+  fprintf(out, ".Lfmt_var:\n\t.string\t\"  %%s = %%d\\n\"\n");
+  for (int v = 0; v < program->var_count; v++) {
+    /* Identifiers need no escaping */
+    fprintf(out, ".Lname%d:\n\t.string\t\"%s\"\n", v,
+            tac_program_var_name(program, v));
+  }
+
+  fprintf(out, "\n\t.section\t.data.rel.ro,\"aw\"\n\t.align\t8\n"
+               "tac_var_names:\n");
+  for (int v = 0; v < program->var_count; v++) {
+    fprintf(out, "\t.quad\t.Lname%d\n", v);
+  }
+  fprintf(out, "\t.quad\t0\n\n\t.section\t.note.GNU-stack,\"\",@progbits\n");
+}
+
+/**
+ * @brief Write a program as GNU assembler source
+ */
+bool x86_emit_program(const TACProgram *program, FILE *out, X86Stats *stats) {
+  if (!program || !out) {
+    return false;
+  }
+
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    return false;
+  }
+  RegAllocation *alloc =
+      regalloc_linear_scan(program, cfg, X86_ALLOCATABLE);
+  cfg_destroy(cfg);
+  if (!alloc) {
+    return false;
+  }
+
+  X86Emitter e = {program, alloc, out, 0};
+  fprintf(out, "# Generated by the TAC x86-64 backend\n");
+  bool ok = emit_function(&e);
+  if (ok) {
+    emit_main(&e);
+    emit_data(&e);
+  }
+  if (stats) {
+    stats->intervals = alloc->intervals;
+    stats->spilled = alloc->spilled;
+    stats->registers_used = alloc->registers_used;
+  }
+  regalloc_destroy(alloc);
+  return ok;
+}
+
+/**
+ * @brief Write a program as assembler source to a file
+ */
+bool x86_write_program(const TACProgram *program, const char *filename,
+                       X86Stats *stats) {
+  if (!program || !filename) {
+    return false;
+  }
+
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    return false;
+  }
+  bool ok = x86_emit_program(program, file, stats);
+  if (fclose(file) != 0) {
+    ok = false;
+  }
+  return ok;
+}
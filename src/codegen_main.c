@@ -3,8 +3,18 @@
  * @brief Driver program for three-address code generation using syntax-directed
  * translation
  */
+#include "codegen/c_backend.h"
+#include "codegen/cfg.h"
+#include "codegen/dataflow.h"
+#include "codegen/native.h"
 #include "codegen/sdt_codegen.h"
+#include "codegen/ssa.h"
 #include "codegen/tac.h"
+#include "codegen/tac_bytecode.h"
+#include "codegen/tac_jit.h"
+#include "codegen/tac_opt.h"
+#include "codegen/tac_vm.h"
+#include "codegen/x86_64.h"
 #include "common.h"
 #include "lexer/lexer.h"
 #include "parser/parser.h"
@@ -13,12 +23,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 /* Command-line options */
 static struct option long_options[] = {{"help", no_argument, NULL, 'h'},
                                        {"file", required_argument, NULL, 'f'},
                                        {"output", required_argument, NULL, 'o'},
+                                       {"time", no_argument, NULL, 't'},
+                                       {"optimize", required_argument, NULL,
+                                        'O'},
+                                       {"cfg", no_argument, NULL, 'g'},
+                                       {"dataflow", no_argument, NULL, 'd'},
+                                       {"run", no_argument, NULL, 'r'},
+                                       {"emit", required_argument, NULL, 'e'},
+                                       {"native", no_argument, NULL, 'x'},
+                                       {"jit", no_argument, NULL, 'j'},
+                                       {"ssa", no_argument, NULL, 's'},
+                                       {"one-pass", no_argument, NULL, '1'},
+                                       {"parallel", required_argument, NULL,
+                                        'p'},
                                        {NULL, 0, NULL, 0}};
 
 /**
@@ -30,6 +54,291 @@ static void print_usage(const char *program_name) {
   printf("  -h, --help                Display this help message\n");
   printf("  -f, --file FILEPATH       Input file path (default: stdin)\n");
   printf("  -o, --output FILEPATH     Output file path (default: stdout)\n");
+  printf("  -t, --time                Report phase timings and peak memory\n");
+  printf("  -O, --optimize LEVEL      Optimization level (0-1, default: 0)\n");
+  printf("  -g, --cfg                 Print the control-flow graph\n");
+  printf("  -d, --dataflow            Run the dataflow analyses and report "
+         "their cost\n");
+  printf("  -r, --run                 Execute the program and print the "
+         "variables\n");
+  printf("  -e, --emit FORMAT         Output format: tac, tacb (bytecode, "
+         "needs -o), asm (x86-64) or c (default: tac)\n");
+  printf("  -x, --native              Build the asm (or, with -e c, the C) "
+         "output with gcc, run it and compare with -r\n");
+  printf("  -j, --jit                 Compile in-process to x86-64, run and "
+         "compare with -r\n");
+  printf("  -s, --ssa                 Translate into SSA form and back before "
+         "output\n");
+  printf("  -1, --one-pass            Generate code while parsing with an LR "
+         "parser, without a syntax tree\n");
+  printf("  -p, --parallel THREADS    Generate the top-level statements on "
+         "THREADS threads\n");
+}
+
+/**
+ * @brief Output formats selected with --emit
+ */
+typedef enum { EMIT_TAC, EMIT_BYTECODE, EMIT_ASM, EMIT_C } EmitFormat;
+
+/**
+ * @brief Print phase timings and the peak resident set size
+ */
+static void print_timings(double t_start, double t_lex, double t_parse,
+                          double t_codegen, double t_optimize,
+                          double t_output, int generated,
+                          const TACProgram *program,
+                          const TACPeepholeStats *peephole) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  printf("\nTimings:\n");
+  printf("  tokenize  %10.3f ms\n", (t_lex - t_start) * 1e3);
+  printf("  parse     %10.3f ms\n", (t_parse - t_lex) * 1e3);
+  printf("  codegen   %10.3f ms (%d instructions)\n",
+         (t_codegen - t_parse) * 1e3, generated);
+  printf("  optimize  %10.3f ms (%d instructions, %d temporaries)\n",
+         (t_optimize - t_codegen) * 1e3, program ? program->count : 0,
+         program ? program->temp_count : 0);
+  printf("  output    %10.3f ms\n", (t_output - t_optimize) * 1e3);
+  printf("  peak RSS  %10ld KB\n", usage.ru_maxrss);
+
+  printf("\nPeephole rewrites:\n");
+  for (int r = 0; r < TAC_PEEPHOLE_RULE_COUNT; r++) {
+    printf("  %-18s %6d\n", tac_opt_peephole_rule_name((TACPeepholeRule)r),
+           peephole->rewrites[r]);
+  }
+}
+
+/**
+ * @brief Print the size and cost of one dataflow solution
+ */
+static void print_analysis(const char *name, DataflowResult *result,
+                           double t_begin) {
+  double elapsed = (now_seconds() - t_begin) * 1e3;
+  if (!result) {
+    printf("  %-12s failed\n", name);
+    return;
+  }
+  printf("  %-12s %10.3f ms (%d bits, %d visits)\n", name, elapsed,
+         result->bits, result->visits);
+  dataflow_result_destroy(result);
+}
+
+/**
+ * @brief Run the standard dataflow analyses and report their cost
+ */
+static void print_dataflow(const TACProgram *program) {
+  double t_begin = now_seconds();
+  CFG *cfg = cfg_build(program);
+  if (!cfg) {
+    fprintf(stderr, "Failed to build control-flow graph\n");
+    return;
+  }
+
+  printf("\nDataflow (%d blocks, %d locations):\n", cfg->block_count,
+         dataflow_location_count(program));
+  printf("  %-12s %10.3f ms\n", "cfg", (now_seconds() - t_begin) * 1e3);
+  t_begin = now_seconds();
+  print_analysis("liveness", dataflow_liveness(program, cfg, true), t_begin);
+  t_begin = now_seconds();
+  print_analysis("reaching",
+                 dataflow_reaching_definitions(program, cfg, NULL), t_begin);
+  t_begin = now_seconds();
+  print_analysis("available", dataflow_available_expressions(program, cfg),
+                 t_begin);
+  cfg_destroy(cfg);
+}
+
+/**
+ * @brief Take the program through SSA form and back, reporting the cost
+ *
+ * @param print_phis Also print the phis of every block
+ */
+static bool round_trip_ssa(TACProgram *program, bool print_phis) {
+  double t_begin = now_seconds();
+  CFG *cfg = cfg_build(program);
+  SSAForm *ssa = cfg ? ssa_build(program, cfg) : NULL;
+  if (!ssa) {
+    fprintf(stderr, "Failed to build SSA form\n");
+    cfg_destroy(cfg);
+    return false;
+  }
+  double t_build = now_seconds();
+  printf("\nSSA round trip (%d blocks, %d locations):\n", cfg->block_count,
+         ssa->location_count);
+  printf("  values    %10d (%d phis)\n", ssa->value_count, ssa->phi_count);
+  printf("  build     %10.3f ms\n", (t_build - t_begin) * 1e3);
+  if (print_phis) {
+    ssa_print(ssa);
+  }
+
+  t_begin = now_seconds();
+  bool ok = ssa_to_tac(ssa, program);
+  printf("  out       %10.3f ms (%d instructions)\n",
+         (now_seconds() - t_begin) * 1e3, program->count);
+  ssa_destroy(ssa);
+  cfg_destroy(cfg);
+  if (!ok) {
+    fprintf(stderr, "Failed to translate out of SSA form\n");
+  }
+  return ok;
+}
+
+/**
+ * @brief Execute the program on the virtual machine and print the results
+ *
+ * @param vm_out Output: the VM after the run, for comparison with native
+ * code (NULL if loading failed)
+ */
+static bool run_program(const TACProgram *program, TACVM **vm_out) {
+  TACVM *vm = tac_vm_create(program);
+  *vm_out = vm;
+  if (!vm) {
+    fprintf(stderr, "Program cannot be executed\n");
+    return false;
+  }
+
+  bool ok = tac_vm_run(vm);
+  printf("\nExecution:\n");
+  printf("  executed  %10llu instructions (%llu dispatches)\n",
+         (unsigned long long)vm->stats.executed,
+         (unsigned long long)vm->stats.dispatched);
+  printf("  jumps     %10llu executed (%llu taken)\n",
+         (unsigned long long)vm->stats.jumps,
+         (unsigned long long)vm->stats.taken);
+  printf("  load      %10.3f ms (%d instructions, %d slots)\n",
+         vm->stats.load_seconds * 1e3, vm->code_count, vm->slot_count);
+  printf("  run       %10.3f ms\n", vm->stats.run_seconds * 1e3);
+  if (!ok && vm->error_line > 0) {
+    fprintf(stderr, "Runtime error at line %d: %s\n", vm->error_line,
+            tac_vm_error(vm));
+  } else if (!ok) {
+    fprintf(stderr, "Runtime error: %s\n", tac_vm_error(vm));
+  }
+  printf("\nVariables:\n");
+  tac_vm_print_vars(vm);
+  return ok;
+}
+
+/**
+ * @brief Build the program with gcc, from x86-64 assembly or from C, run it
+ * and compare its results and run time with the virtual machine
+ *
+ * @param vm VM after a run, or NULL to print the variables instead
+ * @param from_c Build the C backend's output with C_BACKEND_CFLAGS
+ */
+static bool run_native(const TACProgram *program, const TACVM *vm,
+                       bool from_c) {
+  char dir[] = "/tmp/codegen-XXXXXX";
+  if (!mkdtemp(dir)) {
+    fprintf(stderr, "Failed to create a build directory\n");
+    return false;
+  }
+  char source[sizeof(dir) + 16];
+  char executable[sizeof(dir) + 16];
+  snprintf(source, sizeof(source), "%s/program.%s", dir, from_c ? "c" : "s");
+  snprintf(executable, sizeof(executable), "%s/program", dir);
+
+  X86Stats stats = {0};
+  NativeResult result = {0};
+  bool ok = (from_c ? c_write_program(program, source)
+                    : x86_write_program(program, source, &stats)) &&
+            native_build(source, executable, from_c ? C_BACKEND_CFLAGS : "",
+                         &result) &&
+            native_run(executable, program->var_count, &result);
+
+  if (ok) {
+    if (from_c) {
+      printf("\nNative (C, gcc %s):\n", C_BACKEND_CFLAGS);
+    } else {
+      printf("\nNative:\n");
+      printf("  registers %10d used (%d intervals, %d spilled)\n",
+             stats.registers_used, stats.intervals, stats.spilled);
+    }
+    printf("  build     %10.3f ms\n", result.build_seconds * 1e3);
+    printf("  run       %10.3f ms", result.run_seconds * 1e3);
+    if (vm && result.run_seconds > 0) {
+      printf(" (%.2fx the interpreter)",
+             vm->stats.run_seconds / result.run_seconds);
+    }
+    printf("\n");
+    if (vm) {
+      int differ = 0;
+      for (int v = 0; v < program->var_count; v++) {
+        differ += result.values[v] != tac_vm_get_var(vm, v);
+      }
+      printf("  results   %10s", differ ? "DIFFER" : "match");
+      printf(differ ? " (%d variables)\n" : "\n", differ);
+      ok = differ == 0;
+    } else {
+      printf("\nVariables:\n");
+      for (int v = 0; v < result.value_count; v++) {
+        printf("  %s = %d\n", tac_program_var_name(program, v),
+               result.values[v]);
+      }
+    }
+    ok = ok && result.status == 0;
+  } else {
+    fprintf(stderr, "Native build or run failed\n");
+  }
+
+  native_result_free(&result);
+  remove(executable);
+  remove(source);
+  remove(dir);
+  return ok;
+}
+
+/**
+ * @brief Compile the program in-process, run it and compare its results and
+ * run time with the virtual machine
+ *
+ * @param vm VM after a run, or NULL to print the variables instead
+ */
+static bool run_jit(const TACProgram *program, const TACVM *vm) {
+  TACJIT *jit = tac_jit_create(program);
+  if (!jit) {
+    fprintf(stderr, "Program cannot be compiled or executed\n");
+    return false;
+  }
+
+  bool ok = tac_jit_run(jit);
+  printf("\nJIT:\n");
+  if (tac_jit_is_compiled(jit)) {
+    printf("  compile   %10.3f ms (%zu bytes, %d fixups, %d registers)\n",
+           jit->stats.compile_seconds * 1e3, jit->stats.code_bytes,
+           jit->stats.fixups, jit->stats.registers_used);
+  } else {
+    printf("  compile   fell back to the interpreter (%s)\n",
+           jit->fallback_reason);
+  }
+  printf("  run       %10.3f ms", jit->stats.run_seconds * 1e3);
+  if (vm && jit->stats.run_seconds > 0) {
+    printf(" (%.2fx the interpreter)",
+           vm->stats.run_seconds / jit->stats.run_seconds);
+  }
+  printf("\n");
+  if (!ok) {
+    fprintf(stderr, "Runtime error: %s\n", tac_jit_error(jit));
+  }
+  if (vm) {
+    int differ = 0;
+    for (int v = 0; v < program->var_count; v++) {
+      differ += tac_jit_get_var(jit, v) != tac_vm_get_var(vm, v);
+    }
+    printf("  results   %10s", differ ? "DIFFER" : "match");
+    printf(differ ? " (%d variables)\n" : "\n", differ);
+    ok = ok && differ == 0;
+  } else {
+    printf("\nVariables:\n");
+    for (int v = 0; v < program->var_count; v++) {
+      printf("  %s = %d\n", tac_program_var_name(program, v),
+             tac_jit_get_var(jit, v));
+    }
+  }
+
+  tac_jit_destroy(jit);
+  return ok;
 }
 
 /**
@@ -67,10 +376,21 @@ int main(int argc, char *argv[]) {
   /* Parse command-line arguments */
   char *input_file = NULL;
   char *output_file = NULL;
+  bool report_time = false;
+  bool print_cfg = false;
+  bool run_dataflow = false;
+  bool execute = false;
+  bool native = false;
+  bool jit = false;
+  bool ssa = false;
+  bool one_pass = false;
+  int threads = 1;
+  EmitFormat emit = EMIT_TAC;
+  int opt_level = 0;
   int c;
   int option_index = 0;
 
-  while ((c = getopt_long(argc, argv, "hf:o:", long_options, &option_index)) !=
+  while ((c = getopt_long(argc, argv, "hf:o:tO:gdre:xjs1p:", long_options, &option_index)) !=
          -1) {
     switch (c) {
     case 'h':
@@ -82,6 +402,51 @@ int main(int argc, char *argv[]) {
     case 'o':
       output_file = optarg;
       break;
+    case 't':
+      report_time = true;
+      break;
+    case 'g':
+      print_cfg = true;
+      break;
+    case 'd':
+      run_dataflow = true;
+      break;
+    case 'r':
+      execute = true;
+      break;
+    case 'x':
+      native = true;
+      break;
+    case 'j':
+      jit = true;
+      break;
+    case 's':
+      ssa = true;
+      break;
+    case '1':
+      one_pass = true;
+      break;
+    case 'p':
+      threads = atoi(optarg);
+      break;
+    case 'e':
+      if (strcmp(optarg, "tac") == 0) {
+        emit = EMIT_TAC;
+      } else if (strcmp(optarg, "tacb") == 0) {
+        emit = EMIT_BYTECODE;
+      } else if (strcmp(optarg, "asm") == 0) {
+        emit = EMIT_ASM;
+      } else if (strcmp(optarg, "c") == 0) {
+        emit = EMIT_C;
+      } else {
+        fprintf(stderr, "Unknown output format '%s'\n", optarg);
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'O':
+      opt_level = atoi(optarg);
+      break;
     case '?':
       /* getopt_long already printed an error message */
       print_usage(argv[0]);
@@ -91,6 +456,11 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (emit == EMIT_BYTECODE && !output_file) {
+    fprintf(stderr, "Bytecode output needs an output file (-o)\n");
+    return EXIT_FAILURE;
+  }
+
   printf("Compiler v%s\n", PROJECT_VERSION_STRING);
 
   /* Determine parser type from Kconfig settings */
@@ -106,6 +476,10 @@ int main(int argc, char *argv[]) {
 #else
   parser_type = PARSER_TYPE_RECURSIVE_DESCENT; // Default
 #endif
+  /* Actions run on reductions, so one-pass translation needs an LR parser */
+  if (one_pass && parser_type == PARSER_TYPE_RECURSIVE_DESCENT) {
+    parser_type = PARSER_TYPE_SLR1;
+  }
 
   /* Read input source */
   char *source;
@@ -133,6 +507,7 @@ int main(int argc, char *argv[]) {
 
   /* Tokenize input */
   printf("Tokenizing input...\n");
+  double t_start = now_seconds();
   if (!lexer_tokenize(lexer, source)) {
     fprintf(stderr, "Tokenization failed\n");
     lexer_destroy(lexer);
@@ -140,11 +515,34 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  double t_lex = now_seconds();
+
+  /* Create syntax-directed translation code generator */
+  printf("Creating SDT code generator...\n");
+  SDTCodeGen *sdt_gen = sdt_codegen_create();
+  if (!sdt_gen) {
+    fprintf(stderr, "Failed to create SDT code generator\n");
+    free(source);
+    lexer_destroy(lexer);
+    return EXIT_FAILURE;
+  }
+
+  /* Initialize SDT code generator */
+  printf("Initializing SDT code generator...\n");
+  if (!sdt_codegen_init(sdt_gen)) {
+    fprintf(stderr, "Failed to initialize SDT code generator\n");
+    sdt_codegen_destroy(sdt_gen);
+    free(source);
+    lexer_destroy(lexer);
+    return EXIT_FAILURE;
+  }
+
   /* Create parser */
   printf("Creating %s parser...\n", parser_type_to_string(parser_type));
   Parser *parser = parser_create(parser_type);
   if (!parser) {
     fprintf(stderr, "Failed to create parser\n");
+    sdt_codegen_destroy(sdt_gen);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
@@ -154,77 +552,127 @@ int main(int argc, char *argv[]) {
   printf("Initializing parser...\n");
   if (!parser_init(parser)) {
     fprintf(stderr, "Failed to initialize parser\n");
+    sdt_codegen_destroy(sdt_gen);
     parser_destroy(parser);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
   }
 
+  /* In one pass, the parser runs the semantic actions as it reduces */
+  if (one_pass) {
+    parser->sdt_gen = sdt_gen;
+  }
+
   /* Parse input to generate syntax tree */
-  printf("Parsing input...\n");
+  printf(one_pass ? "Parsing input and generating three-address code...\n"
+                  : "Parsing input...\n");
   SyntaxTree *syntax_tree = parser_parse(parser, lexer);
   if (!syntax_tree) {
     fprintf(stderr, "Parsing failed\n");
+    sdt_codegen_destroy(sdt_gen);
     parser_destroy(parser);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
   }
 
+  double t_parse = now_seconds();
+
   /* Get the root node of the syntax tree */
   SyntaxTreeNode *root = syntax_tree_get_root(syntax_tree);
-  if (!root) {
+  if (!root && !one_pass) {
     fprintf(stderr, "Syntax tree is empty\n");
+    sdt_codegen_destroy(sdt_gen);
     parser_destroy(parser);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
   }
 
-  /* Create syntax-directed translation code generator */
-  printf("Creating SDT code generator...\n");
-  SDTCodeGen *sdt_gen = sdt_codegen_create();
-  if (!sdt_gen) {
-    fprintf(stderr, "Failed to create SDT code generator\n");
+  /* Generate three-address code using syntax tree */
+  if (!one_pass) {
+    printf("Generating three-address code from syntax tree...\n");
+    sdt_codegen_generate_parallel(sdt_gen, syntax_tree, threads);
+  }
+
+  /* Get the generated program from the code generator */
+  TACProgram *program = sdt_gen->program;
+  double t_codegen = now_seconds();
+
+  if (!program || sdt_codegen_get_error(sdt_gen)) {
+    fprintf(stderr, "Failed to generate three-address code\n");
+    const char *error = sdt_codegen_get_error(sdt_gen);
+    if (error) {
+      fprintf(stderr, "Error: %s\n", error);
+    }
+    sdt_codegen_destroy(sdt_gen);
     parser_destroy(parser);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
   }
 
-  /* Initialize SDT code generator */
-  printf("Initializing SDT code generator...\n");
-  if (!sdt_codegen_init(sdt_gen)) {
-    fprintf(stderr, "Failed to initialize SDT code generator\n");
+  int generated = program->count;
+  TACPeepholeStats peephole = {{0}};
+  if (!tac_optimize(program, opt_level, &peephole)) {
+    fprintf(stderr, "Optimization failed\n");
     sdt_codegen_destroy(sdt_gen);
+    syntax_tree_destroy(syntax_tree);
     parser_destroy(parser);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
   }
 
-  /* Generate three-address code using syntax tree */
-  printf("Generating three-address code from syntax tree...\n");
-  sdt_codegen_generate(sdt_gen, root);
-
-  /* Get the generated program from the code generator */
-  TACProgram *program = sdt_gen->program;
-
-  if (!program) {
-    fprintf(stderr, "Failed to generate three-address code\n");
-    const char *error = sdt_codegen_get_error(sdt_gen);
-    if (error) {
-      fprintf(stderr, "Error: %s\n", error);
-    }
+  if (ssa && !round_trip_ssa(program, print_cfg)) {
     sdt_codegen_destroy(sdt_gen);
+    syntax_tree_destroy(syntax_tree);
     parser_destroy(parser);
     free(source);
     lexer_destroy(lexer);
     return EXIT_FAILURE;
   }
 
-  /* Output three-address code */
-  if (output_file) {
+  /* Share temporaries whose lifetimes do not overlap */
+  tac_opt_recycle_temps(program);
+  double t_optimize = now_seconds();
+
+  /* Output three-address code, assembly or C */
+  if (emit == EMIT_ASM || emit == EMIT_C) {
+    const char *what = emit == EMIT_ASM ? "assembly" : "C source";
+    bool written;
+    if (output_file) {
+      printf("Writing %s to file: %s\n", what, output_file);
+      written = emit == EMIT_ASM
+                    ? x86_write_program(program, output_file, NULL)
+                    : c_write_program(program, output_file);
+    } else {
+      printf("\nGenerated %s:\n", what);
+      written = emit == EMIT_ASM ? x86_emit_program(program, stdout, NULL)
+                                 : c_emit_program(program, stdout);
+    }
+    if (!written) {
+      fprintf(stderr, "Failed to generate %s\n", what);
+      sdt_codegen_destroy(sdt_gen);
+      syntax_tree_destroy(syntax_tree);
+      parser_destroy(parser);
+      free(source);
+      lexer_destroy(lexer);
+      return EXIT_FAILURE;
+    }
+  } else if (emit == EMIT_BYTECODE) {
+    printf("Writing bytecode to file: %s\n", output_file);
+    if (!tac_bytecode_write(program, output_file)) {
+      fprintf(stderr, "Failed to write bytecode to file '%s'\n", output_file);
+      sdt_codegen_destroy(sdt_gen);
+      syntax_tree_destroy(syntax_tree);
+      parser_destroy(parser);
+      free(source);
+      lexer_destroy(lexer);
+      return EXIT_FAILURE;
+    }
+  } else if (output_file) {
     printf("Writing three-address code to file: %s\n", output_file);
     if (!tac_program_write_to_file(program, output_file)) {
       fprintf(stderr, "Failed to write output to file '%s'\n", output_file);
@@ -240,6 +688,36 @@ int main(int argc, char *argv[]) {
     tac_program_print(program);
   }
 
+  if (print_cfg) {
+    CFG *cfg = cfg_build(program);
+    if (cfg) {
+      printf("\n");
+      cfg_print(cfg);
+      cfg_destroy(cfg);
+    } else {
+      fprintf(stderr, "Failed to build control-flow graph\n");
+    }
+  }
+
+  if (run_dataflow) {
+    print_dataflow(program);
+  }
+
+  TACVM *vm = NULL;
+  bool run_ok = !execute || run_program(program, &vm);
+  if (native) {
+    run_ok = run_native(program, vm, emit == EMIT_C) && run_ok;
+  }
+  if (jit) {
+    run_ok = run_jit(program, vm) && run_ok;
+  }
+  tac_vm_destroy(vm);
+
+  if (report_time) {
+    print_timings(t_start, t_lex, t_parse, t_codegen, t_optimize,
+                  now_seconds(), generated, program, &peephole);
+  }
+
   /* Clean up */
   syntax_tree_destroy(syntax_tree);
   sdt_codegen_destroy(sdt_gen);
@@ -247,5 +725,5 @@ int main(int argc, char *argv[]) {
   free(source);
   lexer_destroy(lexer);
 
-  return EXIT_SUCCESS;
+  return run_ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
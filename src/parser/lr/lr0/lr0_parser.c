@@ -163,6 +163,7 @@ Parser *lr0_parser_create(void) {
   parser->type = PARSER_TYPE_LR0;
   parser->grammar = NULL;
   parser->production_tracker = NULL;
+  parser->sdt_gen = NULL; /* Set for one-pass code generation */
   parser->init = lr0_parser_init;
   parser->parse = lr0_parser_parse;
   parser->print_leftmost_derivation = lr0_parser_print_leftmost_derivation;
@@ -268,6 +268,7 @@ Parser *lr1_parser_create(void) {
   parser->type = PARSER_TYPE_LR1;
   parser->grammar = NULL;
   parser->production_tracker = NULL;
+  parser->sdt_gen = NULL; /* Set for one-pass code generation */
   parser->init = lr1_parser_init;
   parser->parse = lr1_parser_parse;
   parser->print_leftmost_derivation = lr1_parser_print_leftmost_derivation;
@@ -10,6 +10,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef CONFIG_TAC
+#include "codegen/sdt_codegen.h"
+#endif
+
 /**
  * @brief Get the index of a terminal in the grammar
  */
@@ -226,9 +230,46 @@ static bool pop_stacks(LRParserData *data, int count) {
   return true;
 }
 
+/**
+ * @brief Run the code generator's action for a shifted terminal
+ */
+static bool translate_shift(Parser *parser, LRParserData *data,
+                            const Token *token) {
+#ifdef CONFIG_TAC
+  return sdt_codegen_shift(parser->sdt_gen, data->stack_top, token);
+#else
+  (void)parser;
+  (void)data;
+  (void)token;
+  return false;
+#endif
+}
+
+/**
+ * @brief Run the code generator's action for a production about to be
+ * reduced, whose right-hand side is the top length symbols of the stack
+ */
+static bool translate_reduce(Parser *parser, LRParserData *data,
+                             int production_id, int length) {
+#ifdef CONFIG_TAC
+  return sdt_codegen_reduce(parser->sdt_gen, data->stack_top - length + 1,
+                            production_id, length);
+#else
+  (void)parser;
+  (void)data;
+  (void)production_id;
+  (void)length;
+  return false;
+#endif
+}
+
 /**
  * @brief Parse input using LR parsing algorithm with enhanced error recovery
  *
+ * When the parser has a code generator, the semantic actions run as
+ * terminals are shifted and productions reduced, and no syntax tree is
+ * built: the returned tree is empty.
+ *
  * @param parser Parser object
  * @param data LR parser data
  * @param lexer Lexer with tokenized input
@@ -245,7 +286,12 @@ SyntaxTree *lr_parser_parse(Parser *parser, LRParserData *data, Lexer *lexer) {
     return NULL;
   }
 
-  lexer_print_tokens(lexer);
+  /* Translate in one pass instead of building the tree */
+  bool one_pass = parser->sdt_gen != NULL;
+
+  if (!one_pass) {
+    lexer_print_tokens(lexer);
+  }
 
   const Token *token = get_current_token(data);
   if (!token) {
@@ -315,6 +361,15 @@ SyntaxTree *lr_parser_parse(Parser *parser, LRParserData *data, Lexer *lexer) {
                    "Failed to push onto parser stacks");
           break;
         }
+      } else if (one_pass) {
+        /* Push new state and run the terminal's action */
+        if (!push_stacks(data, action.value, NULL) ||
+            !translate_shift(parser, data, token)) {
+          data->has_error = true;
+          snprintf(data->error_message, sizeof(data->error_message),
+                   "Failed to translate token");
+          break;
+        }
       } else {
         /* Create syntax tree node for the terminal */
         SyntaxTreeNode *node = syntax_tree_create_terminal(*token, symbol_name);
@@ -345,6 +400,12 @@ SyntaxTree *lr_parser_parse(Parser *parser, LRParserData *data, Lexer *lexer) {
 
         /* Check if we can accept EOF at this point */
         if (eof_action.type == ACTION_ACCEPT) {
+          /* One-pass translation has no tree to root */
+          if (one_pass) {
+            accepted = true;
+            break;
+          }
+
           /* Find appropriate root node for the syntax tree */
           if (data->stack_top >= 1) {
             /* First try to find a program node */
@@ -412,96 +473,110 @@ SyntaxTree *lr_parser_parse(Parser *parser, LRParserData *data, Lexer *lexer) {
       int production_id = action.value;
       Production *prod = &parser->grammar->productions[production_id];
 
-      /* Create node for the non-terminal */
       const char *nt_name =
           parser->grammar
               ->symbols[parser->grammar->nonterminal_indices[prod->lhs]]
               .name;
-      SyntaxTreeNode *node =
-          syntax_tree_create_nonterminal(prod->lhs, nt_name, production_id);
-      if (!node) {
-        data->has_error = true;
-        snprintf(data->error_message, sizeof(data->error_message),
-                 "Failed to create syntax tree node for non-terminal");
-        break;
-      }
-
-      /* Store program node if this is a program (P) node */
-      if (prod->lhs == NT_P) {
-        program_node = node;
-      }
 
       /* Check if this is an epsilon production */
       bool is_epsilon_production =
           (prod->rhs_length == 1 && prod->rhs[0].type == SYMBOL_EPSILON);
 
-      /* Handle epsilon productions */
-      if (is_epsilon_production) {
-        /* Create and add epsilon node as child */
-        SyntaxTreeNode *epsilon_node = syntax_tree_create_epsilon();
-        if (!epsilon_node) {
+      SyntaxTreeNode *node = NULL;
+      if (one_pass) {
+        /* Run the production's action and pop its right-hand side */
+        int rhs_length = is_epsilon_production ? 0 : prod->rhs_length;
+        if (!translate_reduce(parser, data, production_id, rhs_length) ||
+            !pop_stacks(data, rhs_length)) {
+          data->has_error = true;
+          snprintf(data->error_message, sizeof(data->error_message),
+                   "Failed to translate production %s", prod->display_str);
+          break;
+        }
+      } else {
+        /* Create node for the non-terminal */
+        node = syntax_tree_create_nonterminal(data->syntax_tree, prod->lhs,
+                                              nt_name, production_id);
+        if (!node) {
           data->has_error = true;
           snprintf(data->error_message, sizeof(data->error_message),
-                   "Failed to create epsilon node");
+                   "Failed to create syntax tree node for non-terminal");
           break;
         }
 
-        /* Add epsilon node as child */
-        syntax_tree_add_child(node, epsilon_node);
+        /* Store program node if this is a program (P) node */
+        if (prod->lhs == NT_P) {
+          program_node = node;
+        }
 
-        /* For epsilon productions, we don't pop anything from stack */
-        DEBUG_PRINT("Reduced by epsilon production %d (%s)", production_id,
-                    prod->display_str);
-      } else {
-        /* Handle normal productions */
-        int rhs_length = prod->rhs_length;
-
-        /* Fix: Add children in correct order (not reversed) */
-        /* Create a temporary array to hold children in correct order */
-        SyntaxTreeNode **temp_children = NULL;
-        if (rhs_length > 0) {
-          temp_children =
-              (SyntaxTreeNode **)malloc(rhs_length * sizeof(SyntaxTreeNode *));
-          if (!temp_children) {
+        /* Handle epsilon productions */
+        if (is_epsilon_production) {
+          /* Create and add epsilon node as child */
+          SyntaxTreeNode *epsilon_node = syntax_tree_create_epsilon();
+          if (!epsilon_node) {
             data->has_error = true;
             snprintf(data->error_message, sizeof(data->error_message),
-                     "Failed to allocate memory for syntax tree children");
+                     "Failed to create epsilon node");
             break;
           }
 
-          /* Collect children in correct order */
-          for (int i = 0; i < rhs_length; i++) {
-            int stack_index = data->stack_top - rhs_length + 1 + i;
-            if (stack_index < 0) {
+          /* Add epsilon node as child */
+          syntax_tree_add_child(node, epsilon_node);
+
+          /* For epsilon productions, we don't pop anything from stack */
+          DEBUG_PRINT("Reduced by epsilon production %d (%s)", production_id,
+                      prod->display_str);
+        } else {
+          /* Handle normal productions */
+          int rhs_length = prod->rhs_length;
+
+          /* Fix: Add children in correct order (not reversed) */
+          /* Create a temporary array to hold children in correct order */
+          SyntaxTreeNode **temp_children = NULL;
+          if (rhs_length > 0) {
+            temp_children = (SyntaxTreeNode **)malloc(
+                rhs_length * sizeof(SyntaxTreeNode *));
+            if (!temp_children) {
               data->has_error = true;
               snprintf(data->error_message, sizeof(data->error_message),
-                       "Stack underflow during reduction");
-              free(temp_children);
+                       "Failed to allocate memory for syntax tree children");
               break;
             }
-            temp_children[i] = data->node_stack[stack_index];
-          }
 
-          if (data->has_error) {
-            break;
-          }
+            /* Collect children in correct order */
+            for (int i = 0; i < rhs_length; i++) {
+              int stack_index = data->stack_top - rhs_length + 1 + i;
+              if (stack_index < 0) {
+                data->has_error = true;
+                snprintf(data->error_message, sizeof(data->error_message),
+                         "Stack underflow during reduction");
+                free(temp_children);
+                break;
+              }
+              temp_children[i] = data->node_stack[stack_index];
+            }
 
-          /* Add children in correct order */
-          for (int i = 0; i < rhs_length; i++) {
-            if (temp_children[i]) { /* Skip NULL nodes (EOF) */
-              syntax_tree_add_child(node, temp_children[i]);
+            if (data->has_error) {
+              break;
             }
-          }
 
-          free(temp_children);
-        }
+            /* Add children in correct order */
+            for (int i = 0; i < rhs_length; i++) {
+              if (temp_children[i]) { /* Skip NULL nodes (EOF) */
+                syntax_tree_add_child(node, temp_children[i]);
+              }
+            }
 
-        /* Pop the RHS symbols from the stack */
-        if (!pop_stacks(data, rhs_length)) {
-          data->has_error = true;
-          snprintf(data->error_message, sizeof(data->error_message),
-                   "Failed to pop from parser stacks");
-          break;
+            free(temp_children);
+          }
+
+          /* Pop the RHS symbols from the stack */
+          if (!pop_stacks(data, rhs_length)) {
+            data->has_error = true;
+            snprintf(data->error_message, sizeof(data->error_message),
+                     "Failed to pop from parser stacks");
+            break;
+          }
         }
       }
 
@@ -574,7 +649,9 @@ SyntaxTree *lr_parser_parse(Parser *parser, LRParserData *data, Lexer *lexer) {
 
     case ACTION_ACCEPT:
       /* Set the root of the syntax tree */
-      if (data->stack_top >= 0) {
+      if (one_pass) {
+        accepted = true;
+      } else if (data->stack_top >= 0) {
         /* Look for program node first */
         if (program_node) {
           syntax_tree_set_root(data->syntax_tree, program_node);
@@ -618,6 +695,15 @@ SyntaxTree *lr_parser_parse(Parser *parser, LRParserData *data, Lexer *lexer) {
 
     case ACTION_ERROR:
     default:
+      /* Recovery would desynchronize the code generator's attributes */
+      if (one_pass) {
+        data->has_error = true;
+        snprintf(data->error_message, sizeof(data->error_message),
+                 "Syntax error during one-pass translation");
+        report_syntax_error(parser, data, token, NULL);
+        break;
+      }
+
       /* Use enhanced error recovery mechanism */
       if (enhanced_error_recovery(parser, data, token)) {
         /* Get the updated current token and continue parsing */
@@ -297,6 +297,7 @@ Parser *slr1_parser_create(void) {
   parser->type = PARSER_TYPE_SLR1;
   parser->grammar = NULL;
   parser->production_tracker = NULL;
+  parser->sdt_gen = NULL; /* Set for one-pass code generation */
   parser->init = slr1_parser_init;
   parser->parse = slr1_parser_parse;
   parser->print_leftmost_derivation = slr1_parser_print_leftmost_derivation;
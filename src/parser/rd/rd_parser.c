@@ -112,7 +112,8 @@ static void production_tracker_rollback_to(ProductionTracker *tracker,
  */
 static SyntaxTreeNode *create_nt_node(Nonterminal nt, const char *name,
                                       RDParserData *data) {
-  SyntaxTreeNode *node = syntax_tree_create_nonterminal(nt, name, -1);
+  SyntaxTreeNode *node = syntax_tree_create_nonterminal(
+      data ? data->syntax_tree : NULL, nt, name, -1);
   if (!node && data) {
     set_error(data, "Failed to create syntax tree node for %s", name);
   }
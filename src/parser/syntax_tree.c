@@ -21,41 +21,33 @@ SyntaxTree *syntax_tree_create(void) {
   }
 
   tree->root = NULL;
+  tree->node_count = 0;
   DEBUG_PRINT("Created new syntax tree");
   return tree;
 }
 
 /**
- * @brief Helper function to destroy a syntax tree node recursively
+ * @brief Helper function to destroy a syntax tree node and its subtree
+ *
+ * Walks down to a leaf, frees it and climbs back through the parent
+ * pointers, so the C stack does not grow with the depth of the tree.
  */
 void destroy_syntax_tree_node(SyntaxTreeNode *node) {
-  if (!node) {
-    return;
-  }
-
-  /* Free symbol name */
-  if (node->symbol_name) {
-    free(node->symbol_name);
-  }
-
-#ifdef CONFIG_TAC
-  void sdt_attributes_destroy(struct SDTAttributes * attributes);
-  /* Free semantic attributes */
-  if (node->attributes) {
-    sdt_attributes_destroy(node->attributes);
-  }
-#endif
-
-  /* Free children and recursively destroy them */
-  if (node->children) {
-    for (int i = 0; i < node->children_count; i++) {
-      destroy_syntax_tree_node(node->children[i]);
+  SyntaxTreeNode *current = node;
+  while (current) {
+    /* Descend into the last remaining child */
+    if (current->children_count > 0) {
+      current = current->children[--current->children_count];
+      continue;
     }
-    free(node->children);
-  }
 
-  /* Free the node itself */
-  free(node);
+    /* Free a node whose children are all gone */
+    SyntaxTreeNode *parent = current == node ? NULL : current->parent;
+    free(current->symbol_name);
+    free(current->children);
+    free(current);
+    current = parent;
+  }
 }
 
 /**
@@ -74,7 +66,8 @@ void syntax_tree_destroy(SyntaxTree *tree) {
 /**
  * @brief Create a non-terminal node
  */
-SyntaxTreeNode *syntax_tree_create_nonterminal(int nonterminal_id,
+SyntaxTreeNode *syntax_tree_create_nonterminal(SyntaxTree *tree,
+                                               int nonterminal_id,
                                                const char *symbol_name,
                                                int production_id) {
   SyntaxTreeNode *node = (SyntaxTreeNode *)safe_malloc(sizeof(SyntaxTreeNode));
@@ -96,10 +89,7 @@ SyntaxTreeNode *syntax_tree_create_nonterminal(int nonterminal_id,
   node->children_count = 0;
   node->children_capacity = 0;
   node->production_id = production_id;
-
-#ifdef CONFIG_TAC
-  node->attributes = NULL;
-#endif
+  node->id = tree ? tree->node_count++ : -1;
 
   DEBUG_PRINT("Created non-terminal node: %s (ID: %d, Production: %d)",
               symbol_name, nonterminal_id, production_id);
@@ -132,9 +122,7 @@ SyntaxTreeNode *syntax_tree_create_terminal(Token token,
   node->children_capacity = 0;
   node->production_id = -1;
 
-#ifdef CONFIG_TAC
-  node->attributes = NULL;
-#endif
+  node->id = -1;
   DEBUG_PRINT("Created terminal node: %s", symbol_name);
   return node;
 }
@@ -161,9 +149,7 @@ SyntaxTreeNode *syntax_tree_create_epsilon(void) {
   node->children_capacity = 0;
   node->production_id = -1;
 
-#ifdef CONFIG_TAC
-  node->attributes = NULL;
-#endif
+  node->id = -1;
 
   DEBUG_PRINT("Created epsilon node");
   return node;
@@ -0,0 +1,255 @@
+/**
+ * @file tacdump_main.c
+ * @brief Inspection tool for three-address code bytecode files
+ */
+#include "codegen/tac.h"
+#include "codegen/tac_bytecode.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Command-line options */
+static struct option long_options[] = {{"help", no_argument, NULL, 'h'},
+                                       {"tac", no_argument, NULL, 't'},
+                                       {NULL, 0, NULL, 0}};
+
+/**
+ * @brief Print usage information
+ */
+static void print_usage(const char *program_name) {
+  printf("Usage: %s [options] FILE\n", program_name);
+  printf("Options:\n");
+  printf("  -h, --help                Display this help message\n");
+  printf("  -t, --tac                 Print the program as three-address "
+         "code, like codegen -o\n");
+}
+
+/**
+ * @brief Render operand k of a record as text
+ *
+ * @param listing Show constants as pool entries and jump targets as records
+ */
+static const char *operand_to_string(const TACBytecode *bytecode,
+                                     const TACBytecodeInst *record, int k,
+                                     bool listing, char *buffer,
+                                     size_t buffer_size) {
+  int32_t operand = record->operand[k];
+  switch (record->kind[k]) {
+  case TAC_OPND_VAR:
+    snprintf(buffer, buffer_size, "%s",
+             tac_bytecode_var_name(bytecode, operand));
+    break;
+  case TAC_OPND_TEMP:
+    snprintf(buffer, buffer_size, "t%d", operand);
+    break;
+  case TAC_OPND_CONST:
+    if (listing) {
+      snprintf(buffer, buffer_size, "#%d(%d)", operand,
+               bytecode->constants[operand]);
+    } else {
+      snprintf(buffer, buffer_size, "%d", bytecode->constants[operand]);
+    }
+    break;
+  case TAC_OPND_LABEL:
+    if (k == 0 && record->op == TAC_OP_LABEL) {
+      snprintf(buffer, buffer_size, "L%d", operand);
+    } else if (listing) {
+      snprintf(buffer, buffer_size, "L%d@%d",
+               tac_bytecode_label_id(bytecode, operand), operand);
+    } else {
+      snprintf(buffer, buffer_size, "L%d",
+               tac_bytecode_label_id(bytecode, operand));
+    }
+    break;
+  default:
+    snprintf(buffer, buffer_size, "%s", listing ? "-" : "");
+    break;
+  }
+  return buffer;
+}
+
+/**
+ * @brief Print the header, the pools and one line per record
+ */
+static void print_listing(const TACBytecode *bytecode) {
+  const TACBytecodeHeader *header = bytecode->header;
+  printf("TAC bytecode version %u, %llu bytes\n", header->version,
+         (unsigned long long)header->file_size);
+  printf("  instructions %10u\n", header->inst_count);
+  printf("  constants    %10u\n", header->const_count);
+  printf("  variables    %10u\n", header->var_count);
+  printf("  temporaries  %10u\n", header->temp_count);
+  printf("  labels       %10u\n", header->label_count);
+
+  printf("\nSections:\n");
+  printf("  constants    offset %10llu\n",
+         (unsigned long long)header->const_offset);
+  printf("  variables    offset %10llu\n",
+         (unsigned long long)header->var_offset);
+  printf("  strings      offset %10llu, %llu bytes\n",
+         (unsigned long long)header->string_offset,
+         (unsigned long long)header->string_size);
+  printf("  instructions offset %10llu, %u bytes each\n",
+         (unsigned long long)header->inst_offset, header->inst_size);
+
+  printf("\nConstants:\n");
+  for (uint32_t i = 0; i < header->const_count; i++) {
+    printf("  #%-8u %d\n", i, bytecode->constants[i]);
+  }
+
+  printf("\nVariables:\n");
+  for (uint32_t i = 0; i < header->var_count; i++) {
+    printf("  %-9u %s\n", i, tac_bytecode_var_name(bytecode, (int)i));
+  }
+
+  printf("\nInstructions:\n");
+  printf("  %8s  %-7s %-14s %-14s %-14s %s\n", "index", "op", "result", "arg1",
+         "arg2", "line");
+  for (uint32_t i = 0; i < header->inst_count; i++) {
+    const TACBytecodeInst *record = &bytecode->instructions[i];
+    char r[64], a1[64], a2[64];
+    printf("  %8u  %-7s %-14s %-14s %-14s %d\n", i,
+           tac_op_type_to_string((TACOpType)record->op),
+           operand_to_string(bytecode, record, 0, true, r, sizeof(r)),
+           operand_to_string(bytecode, record, 1, true, a1, sizeof(a1)),
+           operand_to_string(bytecode, record, 2, true, a2, sizeof(a2)),
+           record->lineno);
+  }
+}
+
+/**
+ * @brief Print the program in the text format of tac_program_write_to_file()
+ */
+static void print_tac(const TACBytecode *bytecode) {
+  uint32_t count = bytecode->header->inst_count;
+  for (uint32_t i = 0; i < count; i++) {
+    const TACBytecodeInst *record = &bytecode->instructions[i];
+    char r[64], a1[64], a2[64];
+    operand_to_string(bytecode, record, 0, false, r, sizeof(r));
+    operand_to_string(bytecode, record, 1, false, a1, sizeof(a1));
+    operand_to_string(bytecode, record, 2, false, a2, sizeof(a2));
+
+    /* Labels share the line of the instruction they precede */
+    if (record->op == TAC_OP_LABEL) {
+      printf("%s: ", r);
+      if (i + 1 >= count || bytecode->instructions[i + 1].op == TAC_OP_LABEL) {
+        printf("\n");
+      }
+      continue;
+    }
+    if (i == 0 || bytecode->instructions[i - 1].op != TAC_OP_LABEL) {
+      printf("    ");
+    }
+
+    switch (record->op) {
+    case TAC_OP_ASSIGN:
+      printf("%s := %s\n", r, a1);
+      break;
+    case TAC_OP_ADD:
+      printf("%s := %s + %s\n", r, a1, a2);
+      break;
+    case TAC_OP_SUB:
+      printf("%s := %s - %s\n", r, a1, a2);
+      break;
+    case TAC_OP_MUL:
+      printf("%s := %s * %s\n", r, a1, a2);
+      break;
+    case TAC_OP_DIV:
+      printf("%s := %s / %s\n", r, a1, a2);
+      break;
+    case TAC_OP_NEG:
+      printf("%s := -%s\n", r, a1);
+      break;
+    case TAC_OP_SHL:
+      printf("%s := %s << %s\n", r, a1, a2);
+      break;
+    case TAC_OP_SHR:
+      printf("%s := %s >> %s\n", r, a1, a2);
+      break;
+    case TAC_OP_EQ:
+      printf("if %s = %s goto %s\n", a1, a2, r);
+      break;
+    case TAC_OP_NE:
+      printf("if %s != %s goto %s\n", a1, a2, r);
+      break;
+    case TAC_OP_LT:
+      printf("if %s < %s goto %s\n", a1, a2, r);
+      break;
+    case TAC_OP_LE:
+      printf("if %s <= %s goto %s\n", a1, a2, r);
+      break;
+    case TAC_OP_GT:
+      printf("if %s > %s goto %s\n", a1, a2, r);
+      break;
+    case TAC_OP_GE:
+      printf("if %s >= %s goto %s\n", a1, a2, r);
+      break;
+    case TAC_OP_GOTO:
+      printf("goto %s\n", r);
+      break;
+    case TAC_OP_PARAM:
+      printf("param %s\n", r);
+      break;
+    case TAC_OP_CALL:
+      printf("call %s, %s\n", r, a1);
+      break;
+    case TAC_OP_RETURN:
+      printf("return %s\n", r);
+      break;
+    default:
+      printf("Unknown operation\n");
+      break;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  /* Parse command-line arguments */
+  bool tac = false;
+  int c;
+  int option_index = 0;
+
+  while ((c = getopt_long(argc, argv, "ht", long_options, &option_index)) !=
+         -1) {
+    switch (c) {
+    case 'h':
+      print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    case 't':
+      tac = true;
+      break;
+    case '?':
+      /* getopt_long already printed an error message */
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    default:
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  /* Map the file and check it before following any operand */
+  TACBytecode *bytecode = tac_bytecode_open(argv[optind]);
+  if (!bytecode) {
+    return EXIT_FAILURE;
+  }
+  if (!tac_bytecode_verify(bytecode)) {
+    fprintf(stderr, "Error: %s: malformed bytecode\n", argv[optind]);
+    tac_bytecode_close(bytecode);
+    return EXIT_FAILURE;
+  }
+
+  if (tac) {
+    print_tac(bytecode);
+  } else {
+    print_listing(bytecode);
+  }
+
+  tac_bytecode_close(bytecode);
+  return EXIT_SUCCESS;
+}
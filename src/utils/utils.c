@@ -6,6 +6,7 @@
 #include "utils.h"
 #include <ctype.h>
 #include <limits.h>
+#include <time.h>
 
 /**
  * Safe memory allocation with error checking
@@ -44,6 +45,24 @@ char *safe_strdup(const char *str) {
   return dup;
 }
 
+/**
+ * Allocate an array of ints filled with -1
+ */
+int *alloc_ints(int n) {
+  int *array = (int *)safe_malloc(((size_t)n + 1) * sizeof(int));
+  memset(array, 0xff, ((size_t)n + 1) * sizeof(int));
+  return array;
+}
+
+/**
+ * Monotonic wall-clock time in seconds
+ */
+double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 /**
  * Read entire file into memory
  */
@@ -0,0 +1,537 @@
+/**
+ * @file test_main.c
+ * @brief Integration test running each sample through every execution path
+ *
+ * Every path must leave the variables exactly as the unoptimized program
+ * run on the virtual machine (codegen -O0 -r) does.
+ */
+
+#include "../unittest.h"
+#include "codegen/tac.h"
+#include "codegen/tac_bytecode.h"
+#include "codegen/tac_vm.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+TestSuite *current_suite = NULL;
+Test *current_test = NULL;
+
+/* Final variable values printed by one run */
+typedef struct {
+  char **names; /* Variable names, in variable id order */
+  int *values;  /* Final values */
+  int count;    /* Number of variables */
+} VarDump;
+
+/* Code generator under test and the samples it runs */
+static const char *codegen_path;
+static char **sample_files;
+static int sample_count;
+
+/* Result of codegen -O0 -r for each sample */
+static VarDump *reference_dumps;
+
+/* Free the contents of a VarDump */
+static void free_var_dump(VarDump *dump) {
+  for (int i = 0; i < dump->count; i++) {
+    free(dump->names[i]);
+  }
+  free(dump->names);
+  free(dump->values);
+  dump->names = NULL;
+  dump->values = NULL;
+  dump->count = 0;
+}
+
+/* Append one variable to a VarDump */
+static void add_var(VarDump *dump, const char *name, int value) {
+  dump->names = (char **)safe_realloc(dump->names, (dump->count + 1) *
+                                                       sizeof(char *));
+  dump->values =
+      (int *)safe_realloc(dump->values, (dump->count + 1) * sizeof(int));
+  dump->names[dump->count] = safe_strdup(name);
+  dump->values[dump->count] = value;
+  dump->count++;
+}
+
+/**
+ * Run the code generator on a sample and read the last variable listing
+ * it prints ("Variables:" followed by "  name = value" lines)
+ */
+static bool run_codegen(const char *options, const char *sample,
+                        VarDump *dump) {
+  char command[1024];
+  snprintf(command, sizeof(command), "%s %s -f %s 2>/dev/null", codegen_path,
+           options, sample);
+  FILE *pipe = popen(command, "r");
+  if (!pipe) {
+    fprintf(stderr, "Failed to run: %s\n", command);
+    return false;
+  }
+
+  bool listing = false;
+  char line[512];
+  while (fgets(line, sizeof(line), pipe)) {
+    char name[256];
+    int value;
+    if (strcmp(line, "Variables:\n") == 0) {
+      free_var_dump(dump);
+      listing = true;
+    } else if (listing && sscanf(line, "  %255s = %d", name, &value) == 2) {
+      add_var(dump, name, value);
+    } else {
+      listing = false;
+    }
+  }
+
+  int status = pclose(pipe);
+  if (status != 0) {
+    fprintf(stderr, "Command failed with status %d: %s\n", status, command);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Decode operand k of a verified record, resolving constants from the pool
+ * and jump targets back to label ids
+ */
+static TACOperand decode_operand(const TACBytecode *bytecode,
+                                 const TACBytecodeInst *record, int k) {
+  int32_t operand = record->operand[k];
+  switch (record->kind[k]) {
+  case TAC_OPND_VAR:
+    return tac_var(operand);
+  case TAC_OPND_TEMP:
+    return tac_temp(operand);
+  case TAC_OPND_CONST:
+    return tac_const(bytecode->constants[operand]);
+  case TAC_OPND_LABEL:
+    if (k == 0 && record->op == TAC_OP_LABEL) {
+      return tac_label(operand);
+    }
+    return tac_label(tac_bytecode_label_id(bytecode, operand));
+  default:
+    return tac_none();
+  }
+}
+
+/**
+ * Load a bytecode file, run it on the virtual machine and collect the
+ * variables
+ */
+static bool run_bytecode(const char *filename, VarDump *dump) {
+  TACBytecode *bytecode = tac_bytecode_open(filename);
+  if (!bytecode) {
+    return false;
+  }
+  if (!tac_bytecode_verify(bytecode)) {
+    fprintf(stderr, "Malformed bytecode: %s\n", filename);
+    tac_bytecode_close(bytecode);
+    return false;
+  }
+
+  TACProgram *program = tac_program_create();
+  const TACBytecodeHeader *header = bytecode->header;
+  for (uint32_t v = 0; v < header->var_count; v++) {
+    tac_program_add_var(program, tac_bytecode_var_name(bytecode, (int)v));
+  }
+  for (uint32_t i = 0; i < header->inst_count; i++) {
+    const TACBytecodeInst *record = &bytecode->instructions[i];
+    tac_program_add_inst(program, (TACOpType)record->op,
+                         decode_operand(bytecode, record, 0),
+                         decode_operand(bytecode, record, 1),
+                         decode_operand(bytecode, record, 2), record->lineno);
+  }
+  tac_bytecode_close(bytecode);
+
+  TACVM *vm = tac_vm_create(program);
+  bool ok = vm && tac_vm_run(vm);
+  if (ok) {
+    free_var_dump(dump);
+    for (int v = 0; v < program->var_count; v++) {
+      add_var(dump, tac_program_var_name(program, v), tac_vm_get_var(vm, v));
+    }
+  } else {
+    fprintf(stderr, "Bytecode run failed: %s\n",
+            vm ? tac_vm_error(vm) : "undefined label");
+  }
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+  return ok;
+}
+
+/* Compare a dump with the reference of a sample, reporting the first
+ * difference */
+static bool dumps_match(const VarDump *expected, const VarDump *actual,
+                        const char *options, const char *sample) {
+  if (expected->count != actual->count) {
+    fprintf(stderr, "%s, %s: %d variables, expected %d\n", sample, options,
+            actual->count, expected->count);
+    return false;
+  }
+  for (int i = 0; i < expected->count; i++) {
+    if (strcmp(expected->names[i], actual->names[i]) != 0 ||
+        expected->values[i] != actual->values[i]) {
+      fprintf(stderr, "%s, %s: %s = %d, expected %s = %d\n", sample, options,
+              actual->names[i], actual->values[i], expected->names[i],
+              expected->values[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Run every sample with the given options and compare with the reference */
+static bool samples_match(const char *options) {
+  bool ok = true;
+  for (int s = 0; s < sample_count; s++) {
+    VarDump dump = {NULL, NULL, 0};
+    ok = run_codegen(options, sample_files[s], &dump) &&
+         dumps_match(&reference_dumps[s], &dump, options, sample_files[s]) &&
+         ok;
+    free_var_dump(&dump);
+  }
+  return ok;
+}
+
+/* Create an empty temporary file, filling in the XXXXXX of path */
+static bool make_temp(char *path) {
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to create a temporary file: %s\n", path);
+    return false;
+  }
+  close(fd);
+  return true;
+}
+
+/* Write the three-address code generated with the given options to path */
+static bool write_tac(const char *options, const char *sample,
+                      const char *path) {
+  char command[256];
+  snprintf(command, sizeof(command), "%s -o %s", options, path);
+  VarDump dump = {NULL, NULL, 0};
+  bool ok = run_codegen(command, sample, &dump);
+  free_var_dump(&dump);
+  return ok;
+}
+
+/**
+ * Check that a sample generates byte-identical three-address code with
+ * the reference options and with the options under test
+ */
+static bool tac_identical(const char *reference, const char *options,
+                          const char *sample) {
+  char expected_path[] = "/tmp/test_codegen-XXXXXX";
+  char actual_path[] = "/tmp/test_codegen-XXXXXX";
+  if (!make_temp(expected_path)) {
+    return false;
+  }
+  if (!make_temp(actual_path)) {
+    remove(expected_path);
+    return false;
+  }
+
+  char *expected = NULL, *actual = NULL;
+  bool ok = write_tac(reference, sample, expected_path) &&
+            write_tac(options, sample, actual_path) &&
+            (expected = read_file(expected_path)) != NULL &&
+            (actual = read_file(actual_path)) != NULL;
+  if (ok && strcmp(expected, actual) != 0) {
+    fprintf(stderr, "%s: %s and %s generate different code\n", sample,
+            reference, options);
+    ok = false;
+  }
+
+  free(expected);
+  free(actual);
+  remove(expected_path);
+  remove(actual_path);
+  return ok;
+}
+
+/* Run tac_identical on a sample written from source text */
+static bool source_identical(const char *reference, const char *options,
+                             const char *source) {
+  char path[] = "/tmp/test_codegen-XXXXXX";
+  if (!make_temp(path)) {
+    return false;
+  }
+  FILE *file = fopen(path, "w");
+  bool ok = file && fputs(source, file) >= 0;
+  if (file) {
+    ok = fclose(file) == 0 && ok;
+  }
+  ok = ok && tac_identical(reference, options, path);
+  remove(path);
+  return ok;
+}
+
+/* Run tac_identical on every sample */
+static bool samples_identical(const char *reference, const char *options) {
+  bool ok = true;
+  for (int s = 0; s < sample_count; s++) {
+    ok = tac_identical(reference, options, sample_files[s]) && ok;
+  }
+  return ok;
+}
+
+/* Test function implementations */
+static void test_optimized(void) {
+  ASSERT_TRUE(samples_match("-O1 -r"), "-O1 changed the results");
+}
+
+static void test_ssa_round_trip(void) {
+  ASSERT_TRUE(samples_match("-O0 -s -r"),
+              "SSA round trip changed the results");
+  ASSERT_TRUE(samples_match("-O1 -s -r"),
+              "SSA round trip changed the optimized results");
+}
+
+static void test_one_pass(void) {
+  ASSERT_TRUE(samples_match("-1 -r"),
+              "One-pass generation changed the results");
+  ASSERT_TRUE(samples_match("-1 -O1 -r"),
+              "One-pass generation changed the optimized results");
+}
+
+static void test_one_pass_identical(void) {
+  ASSERT_TRUE(samples_identical("-O0", "-1 -O0"),
+              "One-pass generation changed the code");
+  ASSERT_TRUE(samples_identical("-O1", "-1 -O1"),
+              "One-pass generation changed the optimized code");
+}
+
+static void test_parallel(void) {
+  ASSERT_TRUE(samples_match("-p 3 -r"),
+              "Parallel generation changed the results");
+}
+
+static void test_parallel_identical(void) {
+  /* One large statement leaves the ranges after it empty */
+  const char *dominant =
+      "i = 0;\n"
+      "while i < 20 do\n"
+      "begin\n"
+      "  if j < i then\n"
+      "    while j < i do\n"
+      "    begin\n"
+      "      if j - 2 * (j / 2) = 0 then j = j + 1 else j = j + (k + 1) * 3;\n"
+      "    end\n"
+      "  else if i < 5 then i = i + 1 else i = i + 2 * (m + 1);\n"
+      "end;\n"
+      "a = i + j;\n"
+      "if a > 0 then b = 1 else b = 2;\n"
+      "c = (a + b) * (a - b);\n";
+  const char *few = "x = 1;\nif x < 2 then y = x + 1 else y = 0;\n";
+
+  ASSERT_TRUE(samples_identical("-O0", "-p 3 -O0"),
+              "Parallel generation changed the code");
+  ASSERT_TRUE(samples_identical("-O1", "-p 3 -O1"),
+              "Parallel generation changed the optimized code");
+  ASSERT_TRUE(source_identical("-O0", "-p 8 -O0", few),
+              "Fewer statements than threads changed the code");
+  ASSERT_TRUE(source_identical("-O0", "-p 2 -O0", few),
+              "One statement per thread changed the code");
+  ASSERT_TRUE(source_identical("-O0", "-p 4 -O0", dominant),
+              "A dominant statement changed the code");
+  ASSERT_TRUE(source_identical("-O1", "-p 4 -O1", dominant),
+              "A dominant statement changed the optimized code");
+}
+
+static void test_jit(void) {
+  ASSERT_TRUE(samples_match("-O0 -j"), "JIT results differ");
+  ASSERT_TRUE(samples_match("-O1 -j"), "Optimized JIT results differ");
+}
+
+static void test_native(void) {
+  ASSERT_TRUE(samples_match("-O0 -x -o /dev/null"),
+              "Unoptimized native results from assembly differ");
+  ASSERT_TRUE(samples_match("-O1 -x -o /dev/null"),
+              "Native results from assembly differ");
+  ASSERT_TRUE(samples_match("-O1 -e c -x -o /dev/null"),
+              "Native results from C differ");
+}
+
+static void test_bytecode_round_trip(void) {
+  char path[] = "/tmp/test_codegen-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT(fd >= 0, "Failed to create a bytecode file");
+  close(fd);
+
+  bool ok = true;
+  for (int s = 0; s < sample_count; s++) {
+    char options[128];
+    snprintf(options, sizeof(options), "-O1 -e tacb -o %s", path);
+    VarDump dump = {NULL, NULL, 0};
+    ok = run_codegen(options, sample_files[s], &dump) &&
+         run_bytecode(path, &dump) &&
+         dumps_match(&reference_dumps[s], &dump, "tacb", sample_files[s]) &&
+         ok;
+    free_var_dump(&dump);
+  }
+  remove(path);
+  ASSERT_TRUE(ok, "Bytecode round trip changed the results");
+}
+
+/* Write size bytes to a file, replacing its contents */
+static bool write_bytes(const char *path, const char *data, size_t size) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  bool ok = fwrite(data, 1, size, file) == size;
+  return fclose(file) == 0 && ok;
+}
+
+/**
+ * Write a damaged copy of a bytecode file and check that it is rejected,
+ * by tac_bytecode_open() or, if the header is intact, by
+ * tac_bytecode_verify()
+ */
+static bool bytecode_rejected(const char *path, const char *data, size_t size,
+                              bool by_open) {
+  if (!write_bytes(path, data, size)) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return false;
+  }
+  TACBytecode *bytecode = tac_bytecode_open(path);
+  bool rejected = by_open ? bytecode == NULL
+                          : bytecode != NULL && !tac_bytecode_verify(bytecode);
+  tac_bytecode_close(bytecode);
+  return rejected;
+}
+
+static void test_bytecode_malformed(void) {
+  /* x := 0; L0: x := x + 1; if x < 3 goto L0 */
+  TACProgram *program = tac_program_create();
+  int x = tac_program_add_var(program, "x");
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(x), tac_const(0),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_LABEL, tac_label(0), tac_none(),
+                       tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_ADD, tac_var(x), tac_var(x),
+                       tac_const(1), 2);
+  tac_program_add_inst(program, TAC_OP_LT, tac_label(0), tac_var(x),
+                       tac_const(3), 2);
+
+  char path[] = "/tmp/test_codegen-XXXXXX";
+  ASSERT(make_temp(path), "Failed to create a bytecode file");
+  bool written = tac_bytecode_write(program, path);
+  tac_program_destroy(program);
+  char *data = written ? read_file(path) : NULL;
+  TACBytecode *bytecode = data ? tac_bytecode_open(path) : NULL;
+  bool valid = bytecode && tac_bytecode_verify(bytecode);
+  TACBytecodeHeader header = {0};
+  if (bytecode) {
+    header = *bytecode->header;
+  }
+  tac_bytecode_close(bytecode);
+  if (!valid) {
+    free(data);
+    remove(path);
+  }
+  ASSERT_TRUE(valid, "The intact bytecode was not accepted");
+
+  size_t size = header.file_size;
+  char *copy = (char *)safe_malloc(size + TAC_BYTECODE_ALIGN);
+  memset(copy + size, 0, TAC_BYTECODE_ALIGN);
+  TACBytecodeHeader *copy_header = (TACBytecodeHeader *)copy;
+  TACBytecodeInst *records = (TACBytecodeInst *)(copy + header.inst_offset);
+
+  /* Truncated in the last record and in the header, extended, a corrupt
+   * magic, and sections past the end of the file */
+  memcpy(copy, data, size);
+  bool corrupt = bytecode_rejected(path, copy, size - 1, true);
+  corrupt = bytecode_rejected(path, copy, size + TAC_BYTECODE_ALIGN, true) &&
+            corrupt;
+  corrupt = bytecode_rejected(path, copy, sizeof(header) / 2, true) && corrupt;
+  copy[0] ^= 0x20;
+  corrupt = bytecode_rejected(path, copy, size, true) && corrupt;
+  memcpy(copy, data, size);
+  copy_header->inst_count++;
+  corrupt = bytecode_rejected(path, copy, size, true) && corrupt;
+  memcpy(copy, data, size);
+  copy_header->inst_offset = size + TAC_BYTECODE_ALIGN;
+  corrupt = bytecode_rejected(path, copy, size, true) && corrupt;
+
+  /* A variable, a constant and a jump target out of range */
+  memcpy(copy, data, size);
+  records[2].operand[1] = (int32_t)header.var_count;
+  bool range = bytecode_rejected(path, copy, size, false);
+  memcpy(copy, data, size);
+  records[0].operand[1] = (int32_t)header.const_count;
+  range = bytecode_rejected(path, copy, size, false) && range;
+  memcpy(copy, data, size);
+  records[3].operand[0] = (int32_t)header.inst_count;
+  range = bytecode_rejected(path, copy, size, false) && range;
+
+  /* The loop jump retargeted to the addition */
+  memcpy(copy, data, size);
+  records[3].operand[0] = 2;
+  bool jump = bytecode_rejected(path, copy, size, false);
+
+  free(copy);
+  free(data);
+  remove(path);
+  ASSERT_TRUE(corrupt, "A truncated or corrupt file was opened");
+  ASSERT_TRUE(range, "An operand out of range was accepted");
+  ASSERT_TRUE(jump, "A jump to a non-label was accepted");
+}
+
+/**
+ * Main function
+ */
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    printf("Usage: ./build/test_main CODEGEN SAMPLE...\n");
+    return EXIT_FAILURE;
+  }
+  codegen_path = argv[1];
+  sample_files = argv + 2;
+  sample_count = argc - 2;
+
+  /* Run the reference once per sample */
+  reference_dumps = (VarDump *)safe_malloc(sample_count * sizeof(VarDump));
+  for (int s = 0; s < sample_count; s++) {
+    VarDump *dump = &reference_dumps[s];
+    dump->names = NULL;
+    dump->values = NULL;
+    dump->count = 0;
+    if (!run_codegen("-O0 -r", sample_files[s], dump) || dump->count == 0) {
+      fprintf(stderr, "No reference results for sample: %s\n",
+              sample_files[s]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* Initialize test suite */
+  TEST_SUITE_INIT(codegen);
+
+  /* Add tests to suite */
+  TEST_SUITE_ADD_TEST(codegen, test_optimized);
+  TEST_SUITE_ADD_TEST(codegen, test_ssa_round_trip);
+  TEST_SUITE_ADD_TEST(codegen, test_one_pass);
+  TEST_SUITE_ADD_TEST(codegen, test_one_pass_identical);
+  TEST_SUITE_ADD_TEST(codegen, test_parallel);
+  TEST_SUITE_ADD_TEST(codegen, test_parallel_identical);
+  TEST_SUITE_ADD_TEST(codegen, test_jit);
+  TEST_SUITE_ADD_TEST(codegen, test_native);
+  TEST_SUITE_ADD_TEST(codegen, test_bytecode_round_trip);
+  TEST_SUITE_ADD_TEST(codegen, test_bytecode_malformed);
+
+  /* Run the test suite */
+  TEST_SUITE_RUN(codegen);
+
+  for (int s = 0; s < sample_count; s++) {
+    free_var_dump(&reference_dumps[s]);
+  }
+  free(reference_dumps);
+
+  return codegen_suite.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,1031 @@
+/**
+ * @file test_opt.c
+ * @brief Unit tests for the optimization passes
+ */
+
+#include "../unittest.h"
+#include "codegen/cfg.h"
+#include "codegen/dataflow.h"
+#include "codegen/tac.h"
+#include "codegen/tac_opt.h"
+#include "codegen/tac_vm.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Global variables for test tracking */
+TestSuite *current_suite = NULL;
+Test *current_test = NULL;
+
+/* Variables of the programs built below */
+enum { VAR_I, VAR_D, VAR_B };
+enum { VAR_IV, VAR_SUM, VAR_BOUND };
+enum { VAR_X, VAR_Y, VAR_Z };
+enum { VAR_M, VAR_N, VAR_P, VAR_Q };
+
+/* Test function declarations */
+static void test_licm_zero_trip_division_by_variable(void);
+static void test_licm_zero_trip_division_by_zero(void);
+static void test_licm_hoists_division_by_constant(void);
+static void test_optimize_zero_trip_division(void);
+static void test_unroll_remainder_constant_bound(void);
+static void test_unroll_remainder_variable_bound(void);
+static void test_unroll_remainder_counting_down(void);
+static void test_fold_int_min_div_minus_one(void);
+static void test_peephole_divide_to_shift_negative(void);
+static void test_peephole_negate_int_min(void);
+static void test_peephole_reassociate_overflow(void);
+static void test_peephole_self_subtraction(void);
+static void test_value_numbering_commutative(void);
+static void test_value_numbering_kill(void);
+static void test_cleanup_goto_cycle(void);
+static void test_cleanup_branch_inversion(void);
+static void test_cleanup_store_before_trap(void);
+static void test_copy_propagation_chain(void);
+static void test_dataflow_diamond(void);
+static void test_dataflow_loop(void);
+static void test_rotate_unlabeled_exit(void);
+static void test_reorder_blocks(void);
+
+/**
+ * Build "i = init; d = divisor; b = 7; while i < 3 do i = i + b / d" the way
+ * the code generator does, testing the condition at the top. With by_const,
+ * the division reads the constant divisor instead of d.
+ */
+static TACProgram *build_division_loop(int init, int divisor, bool by_const) {
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "i");
+  tac_program_add_var(program, "d");
+  tac_program_add_var(program, "b");
+  TACOperand head = tac_program_new_label(program);
+  TACOperand body = tac_program_new_label(program);
+  TACOperand exit = tac_program_new_label(program);
+  TACOperand quotient = tac_program_new_temp(program);
+  TACOperand sum = tac_program_new_temp(program);
+
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_I),
+                       tac_const(init), tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_D),
+                       tac_const(divisor), tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_B), tac_const(7),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_LABEL, head, tac_none(), tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_LT, body, tac_var(VAR_I), tac_const(3),
+                       2);
+  tac_program_add_inst(program, TAC_OP_GOTO, exit, tac_none(), tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_LABEL, body, tac_none(), tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_DIV, quotient, tac_var(VAR_B),
+                       by_const ? tac_const(divisor) : tac_var(VAR_D), 2);
+  tac_program_add_inst(program, TAC_OP_ADD, sum, tac_var(VAR_I), quotient, 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_I), sum,
+                       tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_GOTO, head, tac_none(), tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_LABEL, exit, tac_none(), tac_none(), 2);
+  return program;
+}
+
+/**
+ * Run a program on the virtual machine
+ *
+ * @return TACVM* VM after the run, or NULL after a runtime error
+ */
+static TACVM *run_program(const TACProgram *program) {
+  TACVM *vm = tac_vm_create(program);
+  if (vm && !tac_vm_run(vm)) {
+    fprintf(stderr, "Runtime error: %s\n", tac_vm_error(vm));
+    tac_vm_destroy(vm);
+    return NULL;
+  }
+  return vm;
+}
+
+/* Index of the first instruction with an operation, or -1 */
+static int find_op(const TACProgram *program, TACOpType op) {
+  for (int i = 0; i < program->count; i++) {
+    if (program->instructions[i].op == op) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Build the rotated loop "do s = s + i; i = i + step; while i op n" with
+ * i = init and n = bound. With by_const, the test reads the constant bound
+ * instead of n.
+ */
+static TACProgram *build_counted_loop(int init, int step, TACOpType op,
+                                      int bound, bool by_const) {
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "i");
+  tac_program_add_var(program, "s");
+  tac_program_add_var(program, "n");
+  TACOperand head = tac_program_new_label(program);
+  TACOperand sum = tac_program_new_temp(program);
+
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_IV),
+                       tac_const(init), tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_SUM), tac_const(0),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_BOUND),
+                       tac_const(bound), tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_LABEL, head, tac_none(), tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_ADD, sum, tac_var(VAR_SUM),
+                       tac_var(VAR_IV), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_SUM), sum,
+                       tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_ADD, tac_var(VAR_IV), tac_var(VAR_IV),
+                       tac_const(step), 2);
+  tac_program_add_inst(program, op, head, tac_var(VAR_IV),
+                       by_const ? tac_const(bound) : tac_var(VAR_BOUND), 2);
+  return program;
+}
+
+/**
+ * Unroll a counted loop by 4 and check that it leaves every variable as
+ * the original does
+ */
+static bool unrolled_matches(int init, int step, TACOpType op, int bound,
+                             bool by_const) {
+  TACProgram *original = build_counted_loop(init, step, op, bound, by_const);
+  TACProgram *unrolled = build_counted_loop(init, step, op, bound, by_const);
+  bool ok = tac_opt_unroll_loops(unrolled, 4) == 1;
+  if (!ok) {
+    fprintf(stderr, "Loop from %d by %d to %d was not unrolled\n", init,
+            step, bound);
+  }
+
+  TACVM *expected = run_program(original);
+  TACVM *actual = ok ? run_program(unrolled) : NULL;
+  ok = expected && actual;
+  for (int v = 0; ok && v < original->var_count; v++) {
+    if (tac_vm_get_var(expected, v) != tac_vm_get_var(actual, v)) {
+      fprintf(stderr, "Loop from %d by %d to %d: %s = %d, expected %d\n",
+              init, step, bound, tac_program_var_name(original, v),
+              tac_vm_get_var(actual, v), tac_vm_get_var(expected, v));
+      ok = false;
+    }
+  }
+
+  tac_vm_destroy(expected);
+  tac_vm_destroy(actual);
+  tac_program_destroy(original);
+  tac_program_destroy(unrolled);
+  return ok;
+}
+
+/**
+ * Build "x = value; y = x op b", computing through a temporary
+ */
+static TACProgram *build_binary(TACOpType op, int value, TACOperand b) {
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "x");
+  tac_program_add_var(program, "y");
+  TACOperand result = tac_program_new_temp(program);
+
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X),
+                       tac_const(value), tac_none(), 1);
+  tac_program_add_inst(program, op, result, tac_var(VAR_X), b, 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), result,
+                       tac_none(), 2);
+  return program;
+}
+
+/**
+ * Build "x = value; y = (x op c1) op c2", computing through temporaries
+ */
+static TACProgram *build_chain(TACOpType op, int value, int c1, int c2) {
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "x");
+  tac_program_add_var(program, "y");
+  TACOperand inner = tac_program_new_temp(program);
+  TACOperand outer = tac_program_new_temp(program);
+
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X),
+                       tac_const(value), tac_none(), 1);
+  tac_program_add_inst(program, op, inner, tac_var(VAR_X), tac_const(c1), 2);
+  tac_program_add_inst(program, op, outer, inner, tac_const(c2), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), outer,
+                       tac_none(), 2);
+  return program;
+}
+
+/**
+ * Run the peephole pass on the second of two copies of a program, check
+ * that the rule fired and that both copies leave y the same. Destroys both.
+ */
+static bool peephole_matches(TACProgram *original, TACProgram *rewritten,
+                             TACPeepholeRule rule) {
+  TACPeepholeStats stats;
+  int x = original->instructions[0].arg1.value;
+  bool ok = tac_opt_peephole(rewritten, &stats) > 0 && stats.rewrites[rule] > 0;
+  if (!ok) {
+    fprintf(stderr, "Rule '%s' did not fire for x = %d\n",
+            tac_opt_peephole_rule_name(rule), x);
+  }
+
+  TACVM *expected = run_program(original);
+  TACVM *actual = ok ? run_program(rewritten) : NULL;
+  ok = expected && actual;
+  if (ok && tac_vm_get_var(expected, VAR_Y) != tac_vm_get_var(actual, VAR_Y)) {
+    fprintf(stderr, "Rule '%s' with x = %d: y = %d, expected %d\n",
+            tac_opt_peephole_rule_name(rule), x, tac_vm_get_var(actual, VAR_Y),
+            tac_vm_get_var(expected, VAR_Y));
+    ok = false;
+  }
+
+  tac_vm_destroy(expected);
+  tac_vm_destroy(actual);
+  tac_program_destroy(original);
+  tac_program_destroy(rewritten);
+  return ok;
+}
+
+/**
+ * Build "m = 6; n = 4; p = m op1 n; q = n op2 m" through temporaries, with
+ * "m = 10" between the two expressions when reassign is set
+ */
+static TACProgram *build_two_expressions(TACOpType op1, TACOpType op2,
+                                         bool reassign) {
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "m");
+  tac_program_add_var(program, "n");
+  tac_program_add_var(program, "p");
+  tac_program_add_var(program, "q");
+  TACOperand first = tac_program_new_temp(program);
+  TACOperand second = tac_program_new_temp(program);
+
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_M), tac_const(6),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_N), tac_const(4),
+                       tac_none(), 1);
+  tac_program_add_inst(program, op1, first, tac_var(VAR_M), tac_var(VAR_N), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_P), first,
+                       tac_none(), 2);
+  if (reassign) {
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_M),
+                         tac_const(10), tac_none(), 3);
+  }
+  tac_program_add_inst(program, op2, second, tac_var(VAR_N), tac_var(VAR_M),
+                       4);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Q), second,
+                       tac_none(), 4);
+  return program;
+}
+
+/* Check the final values of p and q on the virtual machine */
+static bool leaves_p_q(const TACProgram *program, int p, int q) {
+  TACVM *vm = run_program(program);
+  bool ok = vm && tac_vm_get_var(vm, VAR_P) == p &&
+            tac_vm_get_var(vm, VAR_Q) == q;
+  if (vm && !ok) {
+    fprintf(stderr, "p = %d, q = %d, expected %d and %d\n",
+            tac_vm_get_var(vm, VAR_P), tac_vm_get_var(vm, VAR_Q), p, q);
+  }
+  tac_vm_destroy(vm);
+  return ok;
+}
+
+/**
+ * Create a program over the variables x, y and z
+ */
+static TACProgram *create_xyz_program(void) {
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "x");
+  tac_program_add_var(program, "y");
+  tac_program_add_var(program, "z");
+  return program;
+}
+
+/**
+ * Build "x = 1; y = 5 / z; x = 2" through a temporary, dividing by the
+ * constant divisor instead of z when it is nonzero
+ */
+static TACProgram *build_store_around_division(int divisor) {
+  TACProgram *program = create_xyz_program();
+  TACOperand quotient = tac_program_new_temp(program);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), tac_const(1),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_DIV, quotient, tac_const(5),
+                       divisor ? tac_const(divisor) : tac_var(VAR_Z), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), quotient,
+                       tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), tac_const(2),
+                       tac_none(), 3);
+  return program;
+}
+
+/**
+ * Build "x = 1; if x < 2 then y = 4 else y = 3; z = x + y" the way the
+ * code generator does, with the blocks at instructions 0, 2, 4 and 6
+ */
+static TACProgram *build_diamond(void) {
+  TACProgram *program = create_xyz_program();
+  TACOperand then_label = tac_program_new_label(program);
+  TACOperand join = tac_program_new_label(program);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), tac_const(1),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_LT, then_label, tac_var(VAR_X),
+                       tac_const(2), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), tac_const(3),
+                       tac_none(), 3);
+  tac_program_add_inst(program, TAC_OP_GOTO, join, tac_none(), tac_none(), 3);
+  tac_program_add_inst(program, TAC_OP_LABEL, then_label, tac_none(),
+                       tac_none(), 4);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), tac_const(4),
+                       tac_none(), 4);
+  tac_program_add_inst(program, TAC_OP_LABEL, join, tac_none(), tac_none(),
+                       5);
+  tac_program_add_inst(program, TAC_OP_ADD, tac_var(VAR_Z), tac_var(VAR_X),
+                       tac_var(VAR_Y), 5);
+  return program;
+}
+
+/**
+ * Build "x = 0; L0: if x >= 3 goto L1; t = x + 1; x = t; y = x; goto L0;
+ * L1: z = y", with the blocks at instructions 0, 1, 3 and 7
+ */
+static TACProgram *build_while_loop(void) {
+  TACProgram *program = create_xyz_program();
+  TACOperand head = tac_program_new_label(program);
+  TACOperand exit = tac_program_new_label(program);
+  TACOperand sum = tac_program_new_temp(program);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), tac_const(0),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_LABEL, head, tac_none(), tac_none(), 2);
+  tac_program_add_inst(program, TAC_OP_GE, exit, tac_var(VAR_X), tac_const(3),
+                       2);
+  tac_program_add_inst(program, TAC_OP_ADD, sum, tac_var(VAR_X), tac_const(1),
+                       3);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), sum,
+                       tac_none(), 3);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y),
+                       tac_var(VAR_X), tac_none(), 4);
+  tac_program_add_inst(program, TAC_OP_GOTO, head, tac_none(), tac_none(), 4);
+  tac_program_add_inst(program, TAC_OP_LABEL, exit, tac_none(), tac_none(), 5);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Z), tac_var(VAR_Y),
+                       tac_none(), 5);
+  return program;
+}
+
+/**
+ * Check that the facts entering (or leaving) the block of an instruction
+ * are exactly the given bits
+ */
+static bool facts_equal(const DataflowResult *result, int inst, bool in,
+                        const int *bits, int count) {
+  BitWord *set = (BitWord *)calloc((size_t)result->words + 1, sizeof(BitWord));
+  int block = cfg_block_of(result->cfg, inst);
+  if (in) {
+    dataflow_in(result, block, set);
+  } else {
+    dataflow_out(result, block, set);
+  }
+
+  bool ok = true;
+  int found = 0;
+  for (int b = bitset_next(set, 0, result->bits); b >= 0;
+       b = bitset_next(set, b + 1, result->bits)) {
+    bool expected = false;
+    for (int k = 0; k < count; k++) {
+      expected = expected || bits[k] == b;
+    }
+    ok = ok && expected;
+    found++;
+  }
+  if (!ok || found != count) {
+    fprintf(stderr, "%s of the block at %d: %d facts, expected %d\n",
+            in ? "In set" : "Out set", inst, found, count);
+    ok = false;
+  }
+  free(set);
+  return ok;
+}
+
+/* Test function implementations */
+static void test_licm_zero_trip_division_by_variable(void) {
+  /* The loop never runs, so b / d with d = 0 must not run either */
+  TACProgram *program = build_division_loop(5, 0, false);
+  ASSERT(tac_opt_licm(program) == 0, "Division by a variable was hoisted");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Zero-trip loop raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_I), 5, "i changed in a zero-trip loop");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_licm_zero_trip_division_by_zero(void) {
+  /* Invariant operands are not enough: b / 0 traps wherever it runs */
+  TACProgram *program = build_division_loop(5, 0, true);
+  ASSERT(tac_opt_licm(program) == 0, "Division by zero was hoisted");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Zero-trip loop raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_I), 5, "i changed in a zero-trip loop");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_licm_hoists_division_by_constant(void) {
+  /* b / 7 cannot trap, so it moves into the preheader */
+  TACProgram *program = build_division_loop(0, 7, true);
+  ASSERT(tac_opt_licm(program) > 0, "Division by 7 was not hoisted");
+  ASSERT(find_op(program, TAC_OP_DIV) < find_op(program, TAC_OP_LT),
+         "Division is still inside the loop");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Loop raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_I), 3, "Wrong loop result");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_optimize_zero_trip_division(void) {
+  /* Every -O1 pass together, after constants reach the loop */
+  for (int by_const = 0; by_const <= 1; by_const++) {
+    TACProgram *program = build_division_loop(5, 0, by_const);
+    ASSERT(tac_optimize(program, 1, NULL), "Optimization failed");
+
+    TACVM *vm = run_program(program);
+    ASSERT(vm != NULL, "Optimized zero-trip loop raised an error");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_I), 5, "i changed in a zero-trip loop");
+
+    tac_vm_destroy(vm);
+    tac_program_destroy(program);
+  }
+}
+
+static void test_unroll_remainder_constant_bound(void) {
+  /* Trip counts above the peeling limit leaving 1, 2 and 3 iterations
+   * for the remainder loop */
+  ASSERT_TRUE(unrolled_matches(0, 3, TAC_OP_LT, 103, true),
+              "35 iterations by 4 went wrong");
+  ASSERT_TRUE(unrolled_matches(0, 5, TAC_OP_LT, 101, true),
+              "21 iterations by 4 went wrong");
+  ASSERT_TRUE(unrolled_matches(1, 7, TAC_OP_LE, 200, true),
+              "29 iterations by 4 went wrong");
+  ASSERT_TRUE(unrolled_matches(0, 1, TAC_OP_LT, 40, true),
+              "40 iterations by 4 went wrong");
+}
+
+static void test_unroll_remainder_variable_bound(void) {
+  /* Every remainder, including loops shorter than one chunk */
+  for (int bound = -2; bound <= 30; bound++) {
+    ASSERT_TRUE(unrolled_matches(0, 3, TAC_OP_LT, bound, false),
+                "Loop with bound in a variable went wrong");
+  }
+}
+
+static void test_unroll_remainder_counting_down(void) {
+  for (int bound = -30; bound <= 2; bound++) {
+    ASSERT_TRUE(unrolled_matches(0, -3, TAC_OP_GT, bound, false),
+                "Loop counting down went wrong");
+  }
+  ASSERT_TRUE(unrolled_matches(100, -7, TAC_OP_GE, 0, true),
+              "15 iterations down by 4 went wrong");
+  ASSERT_TRUE(unrolled_matches(200, -9, TAC_OP_GT, 0, true),
+              "23 iterations down by 4 went wrong");
+}
+
+static void test_fold_int_min_div_minus_one(void) {
+  /* The quotient overflows; folding must wrap to INT_MIN like the VM and
+   * the backends do, not trap or fold to something else */
+  TACProgram *program = tac_program_create();
+  tac_program_add_var(program, "m");
+  tac_program_add_var(program, "n");
+  TACOperand quotient = tac_program_new_temp(program);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(0), tac_const(INT_MIN),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_DIV, quotient, tac_var(0),
+                       tac_const(-1), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(1), quotient,
+                       tac_none(), 2);
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "INT_MIN / -1 raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, 1), INT_MIN, "VM did not wrap to INT_MIN");
+  tac_vm_destroy(vm);
+
+  ASSERT(tac_opt_fold_constants(program) > 0, "Nothing was folded");
+  ASSERT_EQ(find_op(program, TAC_OP_DIV), -1, "Division was not folded");
+  const TACInst *last = &program->instructions[program->count - 1];
+  ASSERT(last->op == TAC_OP_ASSIGN && last->arg1.kind == TAC_OPND_CONST &&
+             last->arg1.value == INT_MIN,
+         "n was not folded to INT_MIN");
+
+  vm = run_program(program);
+  ASSERT(vm != NULL, "Folded program raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, 1), INT_MIN, "Folded result is not INT_MIN");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_peephole_divide_to_shift_negative(void) {
+  /* Division rounds toward zero, so -7 / 2 is -3, not -4 */
+  static const int values[] = {-7, -8, -9, -1, INT_MIN, INT_MIN + 1, 0, 7};
+  static const int divisors[] = {2, 4, 8, 1 << 30};
+  for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+    for (size_t d = 0; d < sizeof(divisors) / sizeof(divisors[0]); d++) {
+      TACOperand b = tac_const(divisors[d]);
+      ASSERT_TRUE(peephole_matches(build_binary(TAC_OP_DIV, values[v], b),
+                                   build_binary(TAC_OP_DIV, values[v], b),
+                                   TAC_PEEPHOLE_DIV_TO_SHIFT),
+                  "x / 2^k changed the quotient");
+      ASSERT_TRUE(peephole_matches(build_binary(TAC_OP_MUL, values[v], b),
+                                   build_binary(TAC_OP_MUL, values[v], b),
+                                   TAC_PEEPHOLE_MUL_TO_SHIFT),
+                  "x * 2^k changed the product");
+    }
+  }
+}
+
+static void test_peephole_negate_int_min(void) {
+  /* -INT_MIN wraps to INT_MIN, as do INT_MIN * -1 and INT_MIN / -1 */
+  static const int values[] = {INT_MIN, INT_MIN + 1, -5, 0, INT_MAX};
+  for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+    ASSERT_TRUE(peephole_matches(
+                    build_binary(TAC_OP_DIV, values[v], tac_const(-1)),
+                    build_binary(TAC_OP_DIV, values[v], tac_const(-1)),
+                    TAC_PEEPHOLE_NEGATE),
+                "x / -1 changed the quotient");
+    ASSERT_TRUE(peephole_matches(
+                    build_binary(TAC_OP_MUL, values[v], tac_const(-1)),
+                    build_binary(TAC_OP_MUL, values[v], tac_const(-1)),
+                    TAC_PEEPHOLE_NEGATE),
+                "x * -1 changed the product");
+  }
+}
+
+static void test_peephole_reassociate_overflow(void) {
+  /* The combined constant wraps, e.g. INT_MAX + 1 becomes INT_MIN */
+  static const int values[] = {INT_MIN, -1, 0, 1, INT_MAX};
+  for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+    int x = values[v];
+    ASSERT_TRUE(peephole_matches(build_chain(TAC_OP_ADD, x, INT_MAX, 1),
+                                 build_chain(TAC_OP_ADD, x, INT_MAX, 1),
+                                 TAC_PEEPHOLE_REASSOCIATE),
+                "(x + INT_MAX) + 1 changed the sum");
+    ASSERT_TRUE(peephole_matches(build_chain(TAC_OP_SUB, x, 1, INT_MAX),
+                                 build_chain(TAC_OP_SUB, x, 1, INT_MAX),
+                                 TAC_PEEPHOLE_REASSOCIATE),
+                "(x - 1) - INT_MAX changed the difference");
+    ASSERT_TRUE(peephole_matches(build_chain(TAC_OP_ADD, x, INT_MIN, -1),
+                                 build_chain(TAC_OP_ADD, x, INT_MIN, -1),
+                                 TAC_PEEPHOLE_REASSOCIATE),
+                "(x + INT_MIN) + -1 changed the sum");
+    ASSERT_TRUE(peephole_matches(build_chain(TAC_OP_MUL, x, 65537, 65537),
+                                 build_chain(TAC_OP_MUL, x, 65537, 65537),
+                                 TAC_PEEPHOLE_REASSOCIATE),
+                "(x * 65537) * 65537 changed the product");
+  }
+}
+
+static void test_peephole_self_subtraction(void) {
+  static const int values[] = {INT_MIN, -1, 0, 42, INT_MAX};
+  for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+    ASSERT_TRUE(peephole_matches(
+                    build_binary(TAC_OP_SUB, values[v], tac_var(VAR_X)),
+                    build_binary(TAC_OP_SUB, values[v], tac_var(VAR_X)),
+                    TAC_PEEPHOLE_ZERO),
+                "x - x is not zero");
+  }
+}
+
+static void test_value_numbering_commutative(void) {
+  /* n + m and n * m are m + n and m * n computed again */
+  TACProgram *program = build_two_expressions(TAC_OP_ADD, TAC_OP_ADD, false);
+  ASSERT_EQ(tac_opt_value_numbering(program), 1, "n + m was not reused");
+  ASSERT_EQ(find_op(program, TAC_OP_ADD), 2, "m + n is not computed first");
+  ASSERT_EQ(program->instructions[4].op, TAC_OP_ASSIGN,
+            "n + m was not replaced by a copy");
+  ASSERT_TRUE(leaves_p_q(program, 10, 10), "Wrong sums");
+  tac_program_destroy(program);
+
+  program = build_two_expressions(TAC_OP_MUL, TAC_OP_MUL, false);
+  ASSERT_EQ(tac_opt_value_numbering(program), 1, "n * m was not reused");
+  ASSERT_TRUE(leaves_p_q(program, 24, 24), "Wrong products");
+  tac_program_destroy(program);
+
+  /* n - m is not m - n */
+  program = build_two_expressions(TAC_OP_SUB, TAC_OP_SUB, false);
+  ASSERT_EQ(tac_opt_value_numbering(program), 0, "n - m was reused");
+  ASSERT_TRUE(leaves_p_q(program, 2, -2), "Wrong differences");
+  tac_program_destroy(program);
+}
+
+static void test_value_numbering_kill(void) {
+  /* m = 10 between the two sums makes n + m a new value */
+  TACProgram *program = build_two_expressions(TAC_OP_ADD, TAC_OP_ADD, true);
+  ASSERT_EQ(tac_opt_value_numbering(program), 0,
+            "n + m was reused after m changed");
+  ASSERT_TRUE(leaves_p_q(program, 10, 14), "Wrong sums after reassignment");
+  tac_program_destroy(program);
+
+  /* The only location holding m + n is overwritten before it is needed */
+  program = tac_program_create();
+  tac_program_add_var(program, "m");
+  tac_program_add_var(program, "n");
+  tac_program_add_var(program, "p");
+  tac_program_add_var(program, "q");
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_M), tac_const(6),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_N), tac_const(4),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_ADD, tac_var(VAR_P), tac_var(VAR_M),
+                       tac_var(VAR_N), 2);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_P), tac_const(0),
+                       tac_none(), 3);
+  tac_program_add_inst(program, TAC_OP_ADD, tac_var(VAR_Q), tac_var(VAR_M),
+                       tac_var(VAR_N), 4);
+  ASSERT_EQ(tac_opt_value_numbering(program), 0,
+            "m + n was copied from an overwritten location");
+  ASSERT_TRUE(leaves_p_q(program, 0, 10), "Wrong sum after p changed");
+  tac_program_destroy(program);
+}
+
+static void test_cleanup_goto_cycle(void) {
+  /* "x = 1; if x > 5 goto L0; if x < 2 goto L2; y = 1; goto L4;
+   *  L0: goto L1; L1: goto L0; L2: goto L3; L3: y = 7; L4:" */
+  TACProgram *program = create_xyz_program();
+  TACOperand labels[5];
+  for (int l = 0; l < 5; l++) {
+    labels[l] = tac_program_new_label(program);
+  }
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), tac_const(1),
+                       tac_none(), 1);
+  tac_program_add_inst(program, TAC_OP_GT, labels[0], tac_var(VAR_X),
+                       tac_const(5), 2);
+  tac_program_add_inst(program, TAC_OP_LT, labels[2], tac_var(VAR_X),
+                       tac_const(2), 3);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), tac_const(1),
+                       tac_none(), 4);
+  tac_program_add_inst(program, TAC_OP_GOTO, labels[4], tac_none(),
+                       tac_none(), 4);
+  tac_program_add_inst(program, TAC_OP_LABEL, labels[0], tac_none(),
+                       tac_none(), 5);
+  tac_program_add_inst(program, TAC_OP_GOTO, labels[1], tac_none(),
+                       tac_none(), 5);
+  tac_program_add_inst(program, TAC_OP_LABEL, labels[1], tac_none(),
+                       tac_none(), 6);
+  tac_program_add_inst(program, TAC_OP_GOTO, labels[0], tac_none(),
+                       tac_none(), 6);
+  tac_program_add_inst(program, TAC_OP_LABEL, labels[2], tac_none(),
+                       tac_none(), 7);
+  tac_program_add_inst(program, TAC_OP_GOTO, labels[3], tac_none(),
+                       tac_none(), 7);
+  tac_program_add_inst(program, TAC_OP_LABEL, labels[3], tac_none(),
+                       tac_none(), 8);
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), tac_const(7),
+                       tac_none(), 8);
+  tac_program_add_inst(program, TAC_OP_LABEL, labels[4], tac_none(),
+                       tac_none(), 9);
+
+  ASSERT(tac_opt_cleanup(program) > 0, "Nothing was cleaned up");
+
+  /* The branch into the cycle still ends in a goto back to itself */
+  int branch = find_op(program, TAC_OP_GT);
+  ASSERT(branch >= 0, "The branch into the cycle was removed");
+  int target = program->instructions[branch].result.id;
+  int at = -1;
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *inst = &program->instructions[i];
+    if (inst->op == TAC_OP_LABEL && inst->result.id == target) {
+      at = i;
+    }
+  }
+  ASSERT(at >= 0 && at + 1 < program->count, "The cycle lost its label");
+  const TACInst *jump = &program->instructions[at + 1];
+  ASSERT(jump->op == TAC_OP_GOTO && jump->result.id == target,
+         "The cycle was not threaded into a goto to itself");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Threaded program raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), 7, "The chain L2 -> L3 went wrong");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_cleanup_branch_inversion(void) {
+  /* "if x < 2 goto L0; goto L1; L0: y = 5; L1:" becomes
+   * "if x >= 2 goto L1; y = 5; L1:" */
+  for (int x = 1; x <= 3; x += 2) {
+    TACProgram *program = create_xyz_program();
+    TACOperand then_label = tac_program_new_label(program);
+    TACOperand exit = tac_program_new_label(program);
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X),
+                         tac_const(x), tac_none(), 1);
+    tac_program_add_inst(program, TAC_OP_LT, then_label, tac_var(VAR_X),
+                         tac_const(2), 2);
+    tac_program_add_inst(program, TAC_OP_GOTO, exit, tac_none(), tac_none(),
+                         2);
+    tac_program_add_inst(program, TAC_OP_LABEL, then_label, tac_none(),
+                         tac_none(), 3);
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y),
+                         tac_const(5), tac_none(), 3);
+    tac_program_add_inst(program, TAC_OP_LABEL, exit, tac_none(), tac_none(),
+                         4);
+
+    ASSERT(tac_opt_cleanup(program) > 0, "Nothing was cleaned up");
+    ASSERT_EQ(find_op(program, TAC_OP_GOTO), -1, "The goto is still there");
+    int branch = find_op(program, TAC_OP_GE);
+    ASSERT(branch >= 0 && program->instructions[branch].result.id == exit.id,
+           "The branch was not inverted to jump to the exit");
+
+    TACVM *vm = run_program(program);
+    ASSERT(vm != NULL, "Inverted program raised an error");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), x < 2 ? 5 : 0,
+              "The inverted branch went the wrong way");
+
+    tac_vm_destroy(vm);
+    tac_program_destroy(program);
+  }
+}
+
+static void test_cleanup_store_before_trap(void) {
+  /* 5 / z traps with z = 0, and x = 1 is what the program leaves then */
+  TACProgram *program = build_store_around_division(0);
+  tac_opt_cleanup(program);
+  ASSERT(program->instructions[0].op == TAC_OP_ASSIGN &&
+             program->instructions[0].result.kind == TAC_OPND_VAR &&
+             program->instructions[0].result.id == VAR_X,
+         "x = 1 was removed before a division that may trap");
+
+  TACVM *vm = tac_vm_create(program);
+  ASSERT(vm != NULL, "Failed to create the VM");
+  ASSERT(!tac_vm_run(vm), "Division by zero did not trap");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_X), 1, "x is not 1 when the program traps");
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+
+  /* 5 / 2 cannot trap, so nothing observes x = 1 */
+  program = build_store_around_division(2);
+  int count = program->count;
+  ASSERT(tac_opt_cleanup(program) > 0, "Nothing was cleaned up");
+  ASSERT_EQ(program->count, count - 1, "x = 1 was not removed");
+
+  vm = run_program(program);
+  ASSERT(vm != NULL, "Cleaned up program raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_X), 2, "Wrong final x");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), 2, "Wrong final y");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_copy_propagation_chain(void) {
+  /* "t0 := x + y; t1 := t0; ...; z := tn" must leave x + y in z */
+  for (int links = 1; links <= 3; links++) {
+    TACProgram *program = create_xyz_program();
+    TACOperand temps[4];
+    for (int t = 0; t <= links; t++) {
+      temps[t] = tac_program_new_temp(program);
+    }
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X), tac_const(6),
+                         tac_none(), 1);
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Y), tac_const(4),
+                         tac_none(), 1);
+    tac_program_add_inst(program, TAC_OP_ADD, temps[0], tac_var(VAR_X),
+                         tac_var(VAR_Y), 2);
+    for (int t = 1; t <= links; t++) {
+      tac_program_add_inst(program, TAC_OP_ASSIGN, temps[t], temps[t - 1],
+                           tac_none(), 2);
+    }
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Z), temps[links],
+                         tac_none(), 2);
+
+    ASSERT(tac_opt_copy_propagation(program) > 0, "Nothing was propagated");
+    int sum = find_op(program, TAC_OP_ADD);
+    ASSERT(sum >= 0, "The sum was removed");
+
+    TACVM *vm = run_program(program);
+    ASSERT(vm != NULL, "Propagated program raised an error");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_Z), 10, "The write to z was lost");
+
+    tac_vm_destroy(vm);
+    tac_program_destroy(program);
+  }
+}
+
+static void test_dataflow_diamond(void) {
+  TACProgram *program = build_diamond();
+  CFG *cfg = cfg_build(program);
+  ASSERT(cfg != NULL && cfg->block_count == 4, "Expected four blocks");
+
+  /* Only x and y are read before being written in a block */
+  DataflowResult *live = dataflow_liveness(program, cfg, false);
+  ASSERT(live != NULL, "Liveness failed");
+  int x = live->item_bit[VAR_X];
+  int y = live->item_bit[VAR_Y];
+  ASSERT(x >= 0 && y >= 0 && live->item_bit[VAR_Z] < 0,
+         "Wrong tracked locations");
+  ASSERT_TRUE(facts_equal(live, 0, true, NULL, 0), "Live into the entry");
+  ASSERT_TRUE(facts_equal(live, 0, false, (int[]){x}, 1), "Live out of entry");
+  ASSERT_TRUE(facts_equal(live, 2, true, (int[]){x}, 1), "Live into else");
+  ASSERT_TRUE(facts_equal(live, 2, false, (int[]){x, y}, 2),
+              "Live out of else");
+  ASSERT_TRUE(facts_equal(live, 4, true, (int[]){x}, 1), "Live into then");
+  ASSERT_TRUE(facts_equal(live, 6, true, (int[]){x, y}, 2), "Live into join");
+  ASSERT_TRUE(facts_equal(live, 6, false, NULL, 0), "Live out of join");
+  dataflow_result_destroy(live);
+
+  /* Each location's value at entry is the first bit of its range */
+  DataflowResult *reach = dataflow_reaching_definitions(program, cfg, NULL);
+  ASSERT(reach != NULL, "Reaching definitions failed");
+  int x_entry = reach->location_offset[VAR_X];
+  int y_entry = reach->location_offset[VAR_Y];
+  int x0 = reach->item_bit[0];
+  int y2 = reach->item_bit[2];
+  int y5 = reach->item_bit[5];
+  ASSERT(x0 >= 0 && y2 >= 0 && y5 >= 0, "Definitions are not tracked");
+  ASSERT_TRUE(facts_equal(reach, 0, true, (int[]){x_entry, y_entry}, 2),
+              "Reaching the entry");
+  ASSERT_TRUE(facts_equal(reach, 2, true, (int[]){x0, y_entry}, 2),
+              "Reaching else");
+  ASSERT_TRUE(facts_equal(reach, 4, true, (int[]){x0, y_entry}, 2),
+              "Reaching then");
+  ASSERT_TRUE(facts_equal(reach, 6, true, (int[]){x0, y2, y5}, 3),
+              "Reaching the join");
+  dataflow_result_destroy(reach);
+
+  cfg_destroy(cfg);
+  tac_program_destroy(program);
+}
+
+static void test_dataflow_loop(void) {
+  TACProgram *program = build_while_loop();
+  CFG *cfg = cfg_build(program);
+  ASSERT(cfg != NULL && cfg->block_count == 4, "Expected four blocks");
+  ASSERT_EQ(cfg->loop_count, 1, "Expected one loop");
+
+  /* The temporary lives within the body only */
+  DataflowResult *live = dataflow_liveness(program, cfg, false);
+  ASSERT(live != NULL, "Liveness failed");
+  int x = live->item_bit[VAR_X];
+  int y = live->item_bit[VAR_Y];
+  ASSERT(x >= 0 && y >= 0 && live->item_bit[program->var_count] < 0,
+         "Wrong tracked locations");
+  ASSERT_TRUE(facts_equal(live, 0, true, (int[]){y}, 1), "Live into entry");
+  ASSERT_TRUE(facts_equal(live, 1, true, (int[]){x, y}, 2),
+              "Live into the header");
+  ASSERT_TRUE(facts_equal(live, 3, true, (int[]){x}, 1), "Live into the body");
+  ASSERT_TRUE(facts_equal(live, 3, false, (int[]){x, y}, 2),
+              "Live around the back edge");
+  ASSERT_TRUE(facts_equal(live, 7, true, (int[]){y}, 1), "Live into exit");
+  dataflow_result_destroy(live);
+
+  DataflowResult *reach = dataflow_reaching_definitions(program, cfg, NULL);
+  ASSERT(reach != NULL, "Reaching definitions failed");
+  int x0 = reach->item_bit[0];
+  int x4 = reach->item_bit[4];
+  int y5 = reach->item_bit[5];
+  int y_entry = reach->location_offset[VAR_Y];
+  ASSERT(x0 >= 0 && x4 >= 0 && y5 >= 0, "Definitions are not tracked");
+  int around[] = {x0, x4, y_entry, y5};
+  ASSERT_TRUE(facts_equal(reach, 1, true, around, 4), "Reaching the header");
+  ASSERT_TRUE(facts_equal(reach, 3, true, around, 4), "Reaching the body");
+  ASSERT_TRUE(facts_equal(reach, 3, false, (int[]){x4, y5}, 2),
+              "Leaving the body");
+  ASSERT_TRUE(facts_equal(reach, 7, true, around, 4), "Reaching the exit");
+  dataflow_result_destroy(reach);
+
+  cfg_destroy(cfg);
+  tac_program_destroy(program);
+}
+
+static void test_rotate_unlabeled_exit(void) {
+  /* "x = init; L0: if x < 3 goto L1; z = x; goto L2; L1: x = x + 1;
+   *  goto L0; L2:": the header jumps into the body and falls through to
+   * an exit with no label of its own */
+  for (int init = 0; init <= 5; init += 5) {
+    TACProgram *program = create_xyz_program();
+    TACOperand head = tac_program_new_label(program);
+    TACOperand body = tac_program_new_label(program);
+    TACOperand end = tac_program_new_label(program);
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X),
+                         tac_const(init), tac_none(), 1);
+    tac_program_add_inst(program, TAC_OP_LABEL, head, tac_none(), tac_none(),
+                         2);
+    tac_program_add_inst(program, TAC_OP_LT, body, tac_var(VAR_X),
+                         tac_const(3), 2);
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_Z),
+                         tac_var(VAR_X), tac_none(), 3);
+    tac_program_add_inst(program, TAC_OP_GOTO, end, tac_none(), tac_none(), 3);
+    tac_program_add_inst(program, TAC_OP_LABEL, body, tac_none(), tac_none(),
+                         4);
+    tac_program_add_inst(program, TAC_OP_ADD, tac_var(VAR_X), tac_var(VAR_X),
+                         tac_const(1), 4);
+    tac_program_add_inst(program, TAC_OP_GOTO, head, tac_none(), tac_none(),
+                         4);
+    tac_program_add_inst(program, TAC_OP_LABEL, end, tac_none(), tac_none(),
+                         5);
+    int labels = program->label_count;
+
+    ASSERT_EQ(tac_opt_rotate_loops(program), 1, "The loop was not rotated");
+    ASSERT_EQ(program->label_count, labels + 1, "No exit label was added");
+    const TACInst *exit_label = &program->instructions[3];
+    ASSERT(exit_label->op == TAC_OP_LABEL && exit_label->result.id == labels,
+           "The exit label is not at the start of the exit");
+    const TACInst *leave = &program->instructions[program->count - 2];
+    ASSERT(leave->op == TAC_OP_GOTO && leave->result.id == labels,
+           "The rotated test does not leave through the exit label");
+    ASSERT_EQ(program->instructions[program->count - 3].op, TAC_OP_LT,
+              "The back edge does not test the condition");
+
+    TACVM *vm = run_program(program);
+    ASSERT(vm != NULL, "Rotated loop raised an error");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_X), init < 3 ? 3 : init,
+              "Wrong final x");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_Z), init < 3 ? 3 : init,
+              "The exit did not run once");
+
+    tac_vm_destroy(vm);
+    tac_program_destroy(program);
+  }
+}
+
+static void test_reorder_blocks(void) {
+  /* Move the loop body in front of the header, entering through the
+   * back-edge goto: "...; goto L0; L1: body; L0: if i < 3 goto L1;
+   * goto L2; L2:" */
+  TACProgram *program = build_division_loop(0, 7, false);
+  int count = program->count;
+  static const int order[] = {0, 1, 2, 10, 6, 7, 8, 9, 3, 4, 5, 11};
+  ASSERT_EQ(count, (int)(sizeof(order) / sizeof(order[0])),
+            "Unexpected loop layout");
+
+  int bad[] = {0, 1, count};
+  ASSERT(!tac_program_reorder(program, bad, 3),
+         "An index past the end was accepted");
+  ASSERT_EQ(program->count, count, "A rejected reorder changed the program");
+
+  ASSERT(tac_program_reorder(program, order, count), "Reorder failed");
+  ASSERT_EQ(program->count, count, "Reorder changed the length");
+  ASSERT_EQ(program->instructions[3].op, TAC_OP_GOTO,
+            "The goto did not move in front of the body");
+
+  /* Every jump still has exactly one label to go to */
+  for (int i = 0; i < program->count; i++) {
+    const TACInst *jump = &program->instructions[i];
+    if (!tac_op_is_jump(jump->op)) {
+      continue;
+    }
+    int targets = 0;
+    for (int j = 0; j < program->count; j++) {
+      const TACInst *label = &program->instructions[j];
+      targets += label->op == TAC_OP_LABEL &&
+                 label->result.id == jump->result.id;
+    }
+    ASSERT_EQ(targets, 1, "A jump lost its label");
+  }
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Reordered loop raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_I), 3, "Reordered loop went wrong");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+/**
+ * Main function for running the tests
+ */
+int main(void) {
+  /* Initialize test suite */
+  TEST_SUITE_INIT(opt);
+
+  /* Add tests to suite */
+  TEST_SUITE_ADD_TEST(opt, test_licm_zero_trip_division_by_variable);
+  TEST_SUITE_ADD_TEST(opt, test_licm_zero_trip_division_by_zero);
+  TEST_SUITE_ADD_TEST(opt, test_licm_hoists_division_by_constant);
+  TEST_SUITE_ADD_TEST(opt, test_optimize_zero_trip_division);
+  TEST_SUITE_ADD_TEST(opt, test_unroll_remainder_constant_bound);
+  TEST_SUITE_ADD_TEST(opt, test_unroll_remainder_variable_bound);
+  TEST_SUITE_ADD_TEST(opt, test_unroll_remainder_counting_down);
+  TEST_SUITE_ADD_TEST(opt, test_fold_int_min_div_minus_one);
+  TEST_SUITE_ADD_TEST(opt, test_peephole_divide_to_shift_negative);
+  TEST_SUITE_ADD_TEST(opt, test_peephole_negate_int_min);
+  TEST_SUITE_ADD_TEST(opt, test_peephole_reassociate_overflow);
+  TEST_SUITE_ADD_TEST(opt, test_peephole_self_subtraction);
+  TEST_SUITE_ADD_TEST(opt, test_value_numbering_commutative);
+  TEST_SUITE_ADD_TEST(opt, test_value_numbering_kill);
+  TEST_SUITE_ADD_TEST(opt, test_cleanup_goto_cycle);
+  TEST_SUITE_ADD_TEST(opt, test_cleanup_branch_inversion);
+  TEST_SUITE_ADD_TEST(opt, test_cleanup_store_before_trap);
+  TEST_SUITE_ADD_TEST(opt, test_copy_propagation_chain);
+  TEST_SUITE_ADD_TEST(opt, test_dataflow_diamond);
+  TEST_SUITE_ADD_TEST(opt, test_dataflow_loop);
+  TEST_SUITE_ADD_TEST(opt, test_rotate_unlabeled_exit);
+  TEST_SUITE_ADD_TEST(opt, test_reorder_blocks);
+
+  /* Run the test suite */
+  TEST_SUITE_RUN(opt);
+
+  return opt_suite.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
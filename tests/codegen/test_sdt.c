@@ -0,0 +1,276 @@
+/**
+ * @file test_sdt.c
+ * @brief Unit tests for syntax-directed translation of deep syntax trees
+ *
+ * The trees are built directly, since the lexer caps the number of tokens,
+ * and translated on a thread with a small stack: the work stack of the
+ * translation must not grow the C stack with the depth of the tree.
+ */
+
+#include "../unittest.h"
+#include "codegen/sdt_codegen.h"
+#include "codegen/tac.h"
+#include "codegen/tac_vm.h"
+#include "parser/grammar.h"
+#include "parser/syntax_tree.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Global variables for test tracking */
+TestSuite *current_suite = NULL;
+Test *current_test = NULL;
+
+/* Stack of the translating thread, far below what recursion would need */
+#define SDT_TEST_STACK (64 * 1024)
+
+/* Nesting depth of the generated trees */
+#define SDT_TEST_DEPTH 20000
+
+/* Test function declarations */
+static void test_deep_parentheses(void);
+static void test_deep_while(void);
+static void test_deep_while_begin(void);
+
+/**
+ * Create a non-terminal node with the given children
+ */
+static SyntaxTreeNode *nonterminal(SyntaxTree *tree, int nonterminal_id,
+                                   const char *name, int production,
+                                   int count, ...) {
+  SyntaxTreeNode *node =
+      syntax_tree_create_nonterminal(tree, nonterminal_id, name, production);
+  va_list children;
+  va_start(children, count);
+  for (int i = 0; i < count; i++) {
+    syntax_tree_add_child(node, va_arg(children, SyntaxTreeNode *));
+  }
+  va_end(children);
+  return node;
+}
+
+/**
+ * Create a non-terminal node deriving the empty string
+ */
+static SyntaxTreeNode *empty(SyntaxTree *tree, int nonterminal_id,
+                             const char *name, int production) {
+  return nonterminal(tree, nonterminal_id, name, production, 1,
+                     syntax_tree_create_epsilon());
+}
+
+static SyntaxTreeNode *terminal(TokenType type, const char *name) {
+  Token token;
+  memset(&token, 0, sizeof(token));
+  token.type = type;
+  return syntax_tree_create_terminal(token, name);
+}
+
+static SyntaxTreeNode *identifier(const char *lexeme) {
+  Token token;
+  memset(&token, 0, sizeof(token));
+  token.type = TK_IDN;
+  snprintf(token.str_val, sizeof(token.str_val), "%s", lexeme);
+  return syntax_tree_create_terminal(token, "id");
+}
+
+static SyntaxTreeNode *integer(int value) {
+  Token token;
+  memset(&token, 0, sizeof(token));
+  token.type = TK_DEC;
+  token.num_val = value;
+  return syntax_tree_create_terminal(token, "int10");
+}
+
+/**
+ * E → R X, R → F Y with empty tails
+ */
+static SyntaxTreeNode *expression(SyntaxTree *tree, SyntaxTreeNode *F) {
+  SyntaxTreeNode *R =
+      nonterminal(tree, NT_R, "R", PROD_R_F_Y, 2, F,
+                  empty(tree, NT_Y, "Y", PROD_Y_EPSILON));
+  return nonterminal(tree, NT_E, "E", PROD_E_R_X, 2, R,
+                     empty(tree, NT_X, "X", PROD_X_EPSILON));
+}
+
+/**
+ * S → x = value
+ */
+static SyntaxTreeNode *assign_x(SyntaxTree *tree, SyntaxTreeNode *value) {
+  return nonterminal(tree, NT_S, "S", PROD_S_ASSIGN, 3, identifier("x"),
+                     terminal(TK_EQ, "="), value);
+}
+
+/**
+ * S → while x < 1 do body
+ */
+static SyntaxTreeNode *while_x(SyntaxTree *tree, SyntaxTreeNode *body) {
+  SyntaxTreeNode *x = expression(
+      tree, nonterminal(tree, NT_F, "F", PROD_F_ID, 1, identifier("x")));
+  SyntaxTreeNode *one = expression(
+      tree, nonterminal(tree, NT_F, "F", PROD_F_INT10, 1, integer(1)));
+  SyntaxTreeNode *O = nonterminal(tree, NT_O, "O", PROD_O_LT, 2,
+                                  terminal(TK_LT, "<"), one);
+  SyntaxTreeNode *C = nonterminal(tree, NT_C, "C", PROD_C_E_O, 2, x, O);
+  return nonterminal(tree, NT_S, "S", PROD_S_WHILE_C_DO_S, 4,
+                     terminal(TK_WHILE, "while"), C, terminal(TK_DO, "do"),
+                     body);
+}
+
+/**
+ * L → S ;
+ */
+static SyntaxTreeNode *statement(SyntaxTree *tree, SyntaxTreeNode *S) {
+  return nonterminal(tree, NT_L, "L", PROD_L_S_SEMI, 2, S,
+                     terminal(TK_SEMI, ";"));
+}
+
+/**
+ * P → L T, with S as the only statement
+ */
+static SyntaxTree *program_of(SyntaxTree *tree, SyntaxTreeNode *S) {
+  syntax_tree_set_root(tree,
+                       nonterminal(tree, NT_P, "P", PROD_P_LT, 2,
+                                   statement(tree, S),
+                                   empty(tree, NT_T, "T", PROD_T_EPSILON)));
+  return tree;
+}
+
+/**
+ * Translation run on the small-stack thread
+ */
+typedef struct SDTJob {
+  SyntaxTree *tree;   /* Tree to translate, destroyed afterwards */
+  SDTCodeGen *gen;    /* Code generator */
+} SDTJob;
+
+static void *translate(void *arg) {
+  SDTJob *job = (SDTJob *)arg;
+  sdt_codegen_generate(job->gen, job->tree);
+  syntax_tree_destroy(job->tree);
+  return NULL;
+}
+
+/**
+ * Translate a tree on a thread with a small stack and run the result
+ *
+ * @return TACVM* VM after the run, or NULL on failure
+ */
+static TACVM *translate_and_run(SyntaxTree *tree, SDTCodeGen **gen) {
+  SDTJob job = {tree, sdt_codegen_create()};
+  *gen = job.gen;
+  if (!job.gen) {
+    syntax_tree_destroy(tree);
+    return NULL;
+  }
+
+  pthread_attr_t attr;
+  pthread_t worker;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, SDT_TEST_STACK);
+  bool started = pthread_create(&worker, &attr, translate, &job) == 0;
+  pthread_attr_destroy(&attr);
+  if (!started) {
+    fprintf(stderr, "Failed to start the translating thread\n");
+    syntax_tree_destroy(tree);
+    return NULL;
+  }
+  pthread_join(worker, NULL);
+
+  if (job.gen->has_error) {
+    fprintf(stderr, "Translation failed: %s\n", job.gen->error_message);
+    return NULL;
+  }
+  TACVM *vm = tac_vm_create(job.gen->program);
+  if (vm && !tac_vm_run(vm)) {
+    fprintf(stderr, "Runtime error: %s\n", tac_vm_error(vm));
+    tac_vm_destroy(vm);
+    return NULL;
+  }
+  return vm;
+}
+
+/* Test function implementations */
+static void test_deep_parentheses(void) {
+  /* x = ((...(1)...)) */
+  SyntaxTree *tree = syntax_tree_create();
+  SyntaxTreeNode *E = expression(
+      tree, nonterminal(tree, NT_F, "F", PROD_F_INT10, 1, integer(1)));
+  for (int d = 0; d < SDT_TEST_DEPTH; d++) {
+    E = expression(tree, nonterminal(tree, NT_F, "F", PROD_F_PAREN, 3,
+                                     terminal(TK_SLP, "("), E,
+                                     terminal(TK_SRP, ")")));
+  }
+  program_of(tree, assign_x(tree, E));
+
+  SDTCodeGen *gen;
+  TACVM *vm = translate_and_run(tree, &gen);
+  ASSERT(vm != NULL, "Deep parentheses were not translated");
+  ASSERT_EQ(gen->program->count, 1, "Parentheses generated code");
+  ASSERT_EQ(tac_vm_get_var(vm, 0), 1, "x is not 1");
+
+  tac_vm_destroy(vm);
+  sdt_codegen_destroy(gen);
+}
+
+static void test_deep_while(void) {
+  /* while x < 1 do while x < 1 do ... x = 1 */
+  SyntaxTree *tree = syntax_tree_create();
+  SyntaxTreeNode *S = assign_x(
+      tree, expression(tree, nonterminal(tree, NT_F, "F", PROD_F_INT10, 1,
+                                         integer(1))));
+  for (int d = 0; d < SDT_TEST_DEPTH; d++) {
+    S = while_x(tree, S);
+  }
+  program_of(tree, S);
+
+  SDTCodeGen *gen;
+  TACVM *vm = translate_and_run(tree, &gen);
+  ASSERT(vm != NULL, "Nested loops were not translated");
+  ASSERT_EQ(tac_vm_get_var(vm, 0), 1, "x is not 1");
+
+  tac_vm_destroy(vm);
+  sdt_codegen_destroy(gen);
+}
+
+static void test_deep_while_begin(void) {
+  /* while x < 1 do begin while x < 1 do begin ... x = 1; end; end */
+  SyntaxTree *tree = syntax_tree_create();
+  SyntaxTreeNode *S = assign_x(
+      tree, expression(tree, nonterminal(tree, NT_F, "F", PROD_F_INT10, 1,
+                                         integer(1))));
+  for (int d = 0; d < SDT_TEST_DEPTH; d++) {
+    SyntaxTreeNode *block = nonterminal(
+        tree, NT_S, "S", PROD_S_BEGIN_L_END, 3, terminal(TK_BEGIN, "begin"),
+        statement(tree, S), terminal(TK_END, "end"));
+    S = while_x(tree, block);
+  }
+  program_of(tree, S);
+
+  SDTCodeGen *gen;
+  TACVM *vm = translate_and_run(tree, &gen);
+  ASSERT(vm != NULL, "Nested loops with blocks were not translated");
+  ASSERT_EQ(tac_vm_get_var(vm, 0), 1, "x is not 1");
+
+  tac_vm_destroy(vm);
+  sdt_codegen_destroy(gen);
+}
+
+/**
+ * Main function for running the tests
+ */
+int main(void) {
+  /* Initialize test suite */
+  TEST_SUITE_INIT(sdt);
+
+  /* Add tests to suite */
+  TEST_SUITE_ADD_TEST(sdt, test_deep_parentheses);
+  TEST_SUITE_ADD_TEST(sdt, test_deep_while);
+  TEST_SUITE_ADD_TEST(sdt, test_deep_while_begin);
+
+  /* Run the test suite */
+  TEST_SUITE_RUN(sdt);
+
+  return sdt_suite.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file test_ssa.c
+ * @brief Unit tests for SSA construction and out-of-SSA translation
+ */
+
+#include "../unittest.h"
+#include "codegen/cfg.h"
+#include "codegen/ssa.h"
+#include "codegen/tac.h"
+#include "codegen/tac_vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Global variables for test tracking */
+TestSuite *current_suite = NULL;
+Test *current_test = NULL;
+
+/* Variables of the programs built below: a, b and c are permuted by the
+ * loop, x, y and z read them after it */
+enum { VAR_A, VAR_B, VAR_C, VAR_I, VAR_X, VAR_Y, VAR_Z, VAR_COUNT };
+
+/* Test function declarations */
+static void test_round_trip_keeps_results(void);
+static void test_phi_swap(void);
+static void test_phi_swap_on_conditional_back_edge(void);
+static void test_phi_rotation_on_conditional_back_edge(void);
+
+/* Loop built by build_loop(): the label it starts with and the jump back */
+typedef struct {
+  int header; /* Instruction defining the loop's label */
+  int back;   /* Jump closing the loop */
+} LoopShape;
+
+/**
+ * Build a loop running trips times over the copies a := a, b := b and
+ * c := c, with a, b, c = 1, 2, 3 before it and x, y, z := a, b, c after.
+ *
+ * The copies stand for what copy propagation leaves behind once it
+ * forwards the phis of a, b and c into each other. With rotated, the loop
+ * is tested at the bottom by a conditional jump back, otherwise at the top
+ * and closed by a goto.
+ */
+static TACProgram *build_loop(int trips, bool rotated, LoopShape *shape) {
+  TACProgram *program = tac_program_create();
+  const char *names[VAR_COUNT] = {"a", "b", "c", "i", "x", "y", "z"};
+  for (int v = 0; v < VAR_COUNT; v++) {
+    tac_program_add_var(program, names[v]);
+  }
+  TACOperand head = tac_program_new_label(program);
+  TACOperand exit = tac_program_new_label(program);
+
+  for (int v = VAR_A; v <= VAR_C; v++) {
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(v),
+                         tac_const(v - VAR_A + 1), tac_none(), 1);
+  }
+  tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_I), tac_const(0),
+                       tac_none(), 1);
+  shape->header =
+      tac_program_add_inst(program, TAC_OP_LABEL, head, tac_none(), tac_none(),
+                           2);
+  if (!rotated) {
+    tac_program_add_inst(program, TAC_OP_GE, exit, tac_var(VAR_I),
+                         tac_const(trips), 2);
+  }
+  for (int v = VAR_A; v <= VAR_C; v++) {
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(v), tac_var(v),
+                         tac_none(), 2);
+  }
+  tac_program_add_inst(program, TAC_OP_ADD, tac_var(VAR_I), tac_var(VAR_I),
+                       tac_const(1), 2);
+  if (rotated) {
+    shape->back = tac_program_add_inst(program, TAC_OP_LT, head,
+                                       tac_var(VAR_I), tac_const(trips), 2);
+  } else {
+    shape->back = tac_program_add_inst(program, TAC_OP_GOTO, head, tac_none(),
+                                       tac_none(), 2);
+  }
+  tac_program_add_inst(program, TAC_OP_LABEL, exit, tac_none(), tac_none(), 3);
+  for (int v = VAR_A; v <= VAR_C; v++) {
+    tac_program_add_inst(program, TAC_OP_ASSIGN, tac_var(VAR_X + v - VAR_A),
+                         tac_var(v), tac_none(), 3);
+  }
+  return program;
+}
+
+/* The phi of a location in block b, or NULL */
+static const SSAPhi *find_phi(const SSAForm *ssa, int b, int location) {
+  for (int p = ssa->phi_offset[b]; p < ssa->phi_offset[b + 1]; p++) {
+    if (ssa->phis[p].location == location) {
+      return &ssa->phis[p];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Translate a program into SSA form and back. When rotate > 1, the
+ * back-edge arguments of the loop's phis are first rewired so that a takes
+ * b's value, b takes c's and so on over the first rotate variables: the
+ * copies on that edge then form a cycle.
+ */
+static bool round_trip(TACProgram *program, const LoopShape *shape,
+                       int rotate) {
+  CFG *cfg = cfg_build(program);
+  SSAForm *ssa = cfg ? ssa_build(program, cfg) : NULL;
+  bool ok = ssa != NULL;
+
+  if (ok && rotate > 1) {
+    int header = cfg_block_of(cfg, shape->header);
+    int back = cfg_block_of(cfg, shape->back);
+    int k = 0;
+    while (cfg->pred[cfg->pred_offset[header] + k] != back) {
+      k++;
+    }
+    for (int v = 0; ok && v < rotate; v++) {
+      const SSAPhi *phi = find_phi(ssa, header, VAR_A + v);
+      const SSAPhi *next = find_phi(ssa, header, VAR_A + (v + 1) % rotate);
+      ok = phi && next;
+      if (ok) {
+        ssa->phi_args[phi->args + k] = next->value;
+      }
+    }
+  }
+
+  ok = ok && ssa_to_tac(ssa, program);
+  ssa_destroy(ssa);
+  cfg_destroy(cfg);
+  return ok;
+}
+
+/**
+ * Run a program on the virtual machine
+ *
+ * @return TACVM* VM after the run, or NULL after a runtime error
+ */
+static TACVM *run_program(const TACProgram *program) {
+  TACVM *vm = tac_vm_create(program);
+  if (vm && !tac_vm_run(vm)) {
+    fprintf(stderr, "Runtime error: %s\n", tac_vm_error(vm));
+    tac_vm_destroy(vm);
+    return NULL;
+  }
+  return vm;
+}
+
+/* Test function implementations */
+static void test_round_trip_keeps_results(void) {
+  for (int rotated = 0; rotated <= 1; rotated++) {
+    LoopShape shape;
+    TACProgram *program = build_loop(5, rotated, &shape);
+    ASSERT(round_trip(program, &shape, 0), "Round trip failed");
+
+    TACVM *vm = run_program(program);
+    ASSERT(vm != NULL, "Program raised an error");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_X), 1, "x changed");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), 2, "y changed");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_Z), 3, "z changed");
+    ASSERT_EQ(tac_vm_get_var(vm, VAR_I), 5, "i changed");
+
+    tac_vm_destroy(vm);
+    tac_program_destroy(program);
+  }
+}
+
+static void test_phi_swap(void) {
+  /* a, b = b, a on each of the 5 back edges, before the goto: the copies
+   * need a temporary */
+  LoopShape shape;
+  TACProgram *program = build_loop(5, false, &shape);
+  ASSERT(round_trip(program, &shape, 2), "Round trip failed");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Program raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_X), 2, "a was not swapped an odd time");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), 1, "b was not swapped an odd time");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Z), 3, "c was changed");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_phi_swap_on_conditional_back_edge(void) {
+  /* 4 iterations take the back edge 3 times; copies placed before the
+   * jump would also run on the way out (the lost-copy problem) */
+  LoopShape shape;
+  TACProgram *program = build_loop(4, true, &shape);
+  ASSERT(round_trip(program, &shape, 2), "Round trip failed");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Program raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_X), 2, "a was swapped on the exit edge");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), 1, "b was swapped on the exit edge");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Z), 3, "c was changed");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+static void test_phi_rotation_on_conditional_back_edge(void) {
+  /* a, b, c = b, c, a twice: one cycle of three copies per back edge */
+  LoopShape shape;
+  TACProgram *program = build_loop(3, true, &shape);
+  ASSERT(round_trip(program, &shape, 3), "Round trip failed");
+
+  TACVM *vm = run_program(program);
+  ASSERT(vm != NULL, "Program raised an error");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_X), 3, "Wrong a after two rotations");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Y), 1, "Wrong b after two rotations");
+  ASSERT_EQ(tac_vm_get_var(vm, VAR_Z), 2, "Wrong c after two rotations");
+
+  tac_vm_destroy(vm);
+  tac_program_destroy(program);
+}
+
+/**
+ * Main function for running the tests
+ */
+int main(void) {
+  /* Initialize test suite */
+  TEST_SUITE_INIT(ssa);
+
+  /* Add tests to suite */
+  TEST_SUITE_ADD_TEST(ssa, test_round_trip_keeps_results);
+  TEST_SUITE_ADD_TEST(ssa, test_phi_swap);
+  TEST_SUITE_ADD_TEST(ssa, test_phi_swap_on_conditional_back_edge);
+  TEST_SUITE_ADD_TEST(ssa, test_phi_rotation_on_conditional_back_edge);
+
+  /* Run the test suite */
+  TEST_SUITE_RUN(ssa);
+
+  return ssa_suite.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file test_symbol_table.c
+ * @brief Unit tests for symbol table scopes
+ */
+
+#include "../unittest.h"
+#include "sdt/symbol_table/symbol_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Global variables for test tracking */
+TestSuite *current_suite = NULL;
+Test *current_test = NULL;
+
+/* Names declared in the innermost scope, enough to grow the hash table */
+#define MANY_NAMES 200
+
+/* Test function declarations */
+static void test_scope_shadowing(void);
+static void test_scope_rehash(void);
+static void test_scope_redeclaration(void);
+
+/**
+ * Declare a variable in the current scope and give it an id
+ */
+static bool declare(SymbolTable *table, const char *name, int id) {
+  if (!symbol_table_add_variable(table, name, sizeof(int))) {
+    return false;
+  }
+  symbol_table_lookup(table, name)->id = id;
+  return true;
+}
+
+/**
+ * Check that a name resolves to the declaration with an id and scope
+ */
+static bool resolves_to(SymbolTable *table, const char *name, int id,
+                        int scope) {
+  SymbolTableEntry *entry = symbol_table_lookup(table, name);
+  if (!entry || entry->id != id || entry->scope != scope) {
+    fprintf(stderr, "%s: id %d in scope %d, expected id %d in scope %d\n",
+            name, entry ? entry->id : -1, entry ? entry->scope : -1, id,
+            scope);
+    return false;
+  }
+  return true;
+}
+
+/* Test function implementations */
+static void test_scope_shadowing(void) {
+  SymbolTable *table = symbol_table_create();
+  ASSERT(table != NULL, "Failed to create symbol table");
+  ASSERT_TRUE(declare(table, "a", 1) && declare(table, "b", 2),
+              "Global declarations failed");
+
+  ASSERT_TRUE(symbol_table_enter_scope(table), "Failed to enter scope 1");
+  ASSERT_TRUE(declare(table, "a", 10), "Shadowing a failed");
+  ASSERT_TRUE(resolves_to(table, "a", 10, 1), "a does not see scope 1");
+  ASSERT_TRUE(resolves_to(table, "b", 2, 0), "b is no longer global");
+
+  ASSERT_TRUE(symbol_table_enter_scope(table), "Failed to enter scope 2");
+  ASSERT_TRUE(declare(table, "a", 20) && declare(table, "c", 30),
+              "Scope 2 declarations failed");
+  ASSERT_TRUE(resolves_to(table, "a", 20, 2), "a does not see scope 2");
+
+  ASSERT_TRUE(symbol_table_exit_scope(table), "Failed to exit scope 2");
+  ASSERT_TRUE(resolves_to(table, "a", 10, 1), "a did not fall back to 1");
+  ASSERT(symbol_table_lookup(table, "c") == NULL, "c outlived its scope");
+
+  ASSERT_TRUE(symbol_table_exit_scope(table), "Failed to exit scope 1");
+  ASSERT_TRUE(resolves_to(table, "a", 1, 0), "a did not fall back to 0");
+  ASSERT_TRUE(resolves_to(table, "b", 2, 0), "b was lost");
+  ASSERT_TRUE(!symbol_table_exit_scope(table), "Exited the global scope");
+
+  symbol_table_destroy(table);
+}
+
+static void test_scope_rehash(void) {
+  SymbolTable *table = symbol_table_create();
+  ASSERT(table != NULL, "Failed to create symbol table");
+  ASSERT_TRUE(declare(table, "a", 1), "Global declaration failed");
+  ASSERT_TRUE(symbol_table_enter_scope(table), "Failed to enter scope 1");
+  ASSERT_TRUE(declare(table, "a", 10), "Shadowing a failed");
+
+  /* Fill the innermost scope until the slots are rebuilt */
+  ASSERT_TRUE(symbol_table_enter_scope(table), "Failed to enter scope 2");
+  ASSERT_TRUE(declare(table, "a", 20), "Shadowing a again failed");
+  int buckets = table->bucket_count;
+  char name[32];
+  for (int i = 0; i < MANY_NAMES; i++) {
+    snprintf(name, sizeof(name), "v%d", i);
+    ASSERT_TRUE(declare(table, name, 100 + i), "Declaration failed");
+  }
+  ASSERT(table->bucket_count > buckets, "The hash table did not grow");
+  ASSERT_TRUE(resolves_to(table, "a", 20, 2), "Rehash lost the innermost a");
+  for (int i = 0; i < MANY_NAMES; i++) {
+    snprintf(name, sizeof(name), "v%d", i);
+    ASSERT_TRUE(resolves_to(table, name, 100 + i, 2), "Rehash lost a name");
+  }
+
+  ASSERT_TRUE(symbol_table_exit_scope(table), "Failed to exit scope 2");
+  ASSERT_TRUE(resolves_to(table, "a", 10, 1), "a did not fall back to 1");
+  for (int i = 0; i < MANY_NAMES; i++) {
+    snprintf(name, sizeof(name), "v%d", i);
+    ASSERT(symbol_table_lookup(table, name) == NULL,
+           "A name outlived its scope");
+  }
+
+  ASSERT_TRUE(symbol_table_exit_scope(table), "Failed to exit scope 1");
+  ASSERT_TRUE(resolves_to(table, "a", 1, 0), "a did not fall back to 0");
+
+  symbol_table_destroy(table);
+}
+
+static void test_scope_redeclaration(void) {
+  SymbolTable *table = symbol_table_create();
+  ASSERT(table != NULL, "Failed to create symbol table");
+  ASSERT_TRUE(declare(table, "a", 1), "Global declaration failed");
+  ASSERT_TRUE(!symbol_table_add_variable(table, "a", sizeof(int)),
+              "a was declared twice in one scope");
+
+  ASSERT_TRUE(symbol_table_enter_scope(table), "Failed to enter scope 1");
+  ASSERT_TRUE(declare(table, "a", 10), "Shadowing a failed");
+  ASSERT_TRUE(!symbol_table_add_variable(table, "a", sizeof(int)),
+              "a was declared twice in scope 1");
+  ASSERT_TRUE(symbol_table_exit_scope(table), "Failed to exit scope 1");
+
+  /* The scope is gone, so a can be shadowed afresh */
+  ASSERT_TRUE(symbol_table_enter_scope(table), "Failed to reenter scope 1");
+  ASSERT_TRUE(declare(table, "a", 11), "Shadowing a again failed");
+  ASSERT_TRUE(resolves_to(table, "a", 11, 1), "a does not see scope 1");
+  ASSERT_TRUE(symbol_table_exit_scope(table), "Failed to exit scope 1");
+  ASSERT_TRUE(resolves_to(table, "a", 1, 0), "a did not fall back to 0");
+
+  symbol_table_destroy(table);
+}
+
+/**
+ * Main function for running the tests
+ */
+int main(void) {
+  /* Initialize test suite */
+  TEST_SUITE_INIT(symbol_table);
+
+  /* Add tests to suite */
+  TEST_SUITE_ADD_TEST(symbol_table, test_scope_shadowing);
+  TEST_SUITE_ADD_TEST(symbol_table, test_scope_rehash);
+  TEST_SUITE_ADD_TEST(symbol_table, test_scope_redeclaration);
+
+  /* Run the test suite */
+  TEST_SUITE_RUN(symbol_table);
+
+  return symbol_table_suite.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Random program generator for the compiler's source language.
+ *
+ * "straight" mode emits assignments and if/else statements over a pool of
+ * variables, for codegen throughput tests. "loops" mode emits terminating
+ * while loops with invariant and repeated subexpressions, for measuring the
+ * runtime effect of optimizations.
+ */
+
+static int var_count = 16;
+static int trip_count = 100;
+
+static void emit_var(FILE *out) { fprintf(out, "v%d", rand() % var_count); }
+
+static void emit_literal(FILE *out, int value) {
+  switch (rand() % 3) {
+  case 0:
+    fprintf(out, "%d", value);
+    break;
+  case 1:
+    fprintf(out, value ? "0%o" : "%d", value);
+    break;
+  default:
+    fprintf(out, "0x%x", value);
+    break;
+  }
+}
+
+static void emit_expr(FILE *out, int depth);
+
+static void emit_factor(FILE *out, int depth) {
+  int r = rand() % 10;
+  if (depth > 0 && r == 0) {
+    fprintf(out, "(");
+    emit_expr(out, depth - 1);
+    fprintf(out, ")");
+  } else if (r < 4) {
+    emit_literal(out, rand() % 256);
+  } else {
+    emit_var(out);
+  }
+}
+
+static void emit_term(FILE *out, int depth) {
+  emit_factor(out, depth);
+  int n = rand() % 3;
+  for (int i = 0; i < n; i++) {
+    if (rand() % 4 == 0) {
+      /* Only divide by non-zero literals */
+      fprintf(out, " / ");
+      emit_literal(out, rand() % 15 + 1);
+    } else {
+      fprintf(out, " * ");
+      emit_factor(out, depth);
+    }
+  }
+}
+
+static void emit_expr(FILE *out, int depth) {
+  emit_term(out, depth);
+  int n = rand() % 3;
+  for (int i = 0; i < n; i++) {
+    fprintf(out, rand() % 2 ? " + " : " - ");
+    emit_term(out, depth);
+  }
+}
+
+static void emit_cond(FILE *out) {
+  const char *relops[] = {"<", ">", "=", "<=", ">=", "<>"};
+  emit_expr(out, 1);
+  fprintf(out, " %s ", relops[rand() % 6]);
+  emit_expr(out, 1);
+}
+
+static void emit_assign(FILE *out) {
+  emit_var(out);
+  fprintf(out, " = ");
+  emit_expr(out, 2);
+}
+
+static void emit_straight_stmt(FILE *out, int depth) {
+  int r = rand() % 10;
+  if (depth > 0 && r == 0) {
+    fprintf(out, "if ");
+    emit_cond(out);
+    fprintf(out, " then ");
+    emit_straight_stmt(out, depth - 1);
+    if (rand() % 2) {
+      fprintf(out, " else ");
+      emit_straight_stmt(out, depth - 1);
+    }
+  } else if (depth > 0 && r == 1) {
+    fprintf(out, "begin ");
+    emit_straight_stmt(out, depth - 1);
+    fprintf(out, "; end");
+  } else {
+    emit_assign(out);
+  }
+}
+
+/*
+ * Each loop block resets its counters, so every loop terminates: one arm
+ * advances the accumulator by a positive amount until it catches up with
+ * i * k, the other arm advances the counter.
+ */
+static void emit_loop_block(FILE *out, int block) {
+  int k = rand() % 8 + 1;
+  fprintf(out, "b%d = %d; c%d = %d; acc%d = 0; i%d = 0;\n", block,
+          rand() % 9 + 1, block, rand() % 9 + 1, block, block);
+  switch (rand() % 3) {
+  case 0:
+    fprintf(out,
+            "while i%d < %d do if acc%d < i%d * %d then acc%d = acc%d + b%d "
+            "* c%d + 1 else i%d = i%d + 1;\n",
+            block, trip_count, block, block, k, block, block, block, block,
+            block, block);
+    break;
+  case 1:
+    fprintf(out,
+            "while i%d < %d do if acc%d < i%d * %d then acc%d = acc%d + (b%d "
+            "+ c%d) * (b%d + c%d) / 4 + 1 else i%d = i%d + 1;\n",
+            block, trip_count, block, block, k * 4, block, block, block,
+            block, block, block, block, block);
+    break;
+  default:
+    fprintf(out, "while i%d < %d do i%d = i%d + 1;\n", block, trip_count,
+            block, block);
+    fprintf(out, "acc%d = acc%d + i%d * 0x10 + 017;\n", block, block, block);
+    break;
+  }
+}
+
+int main(int argc, char **argv) {
+  int count = 10;
+  const char *outfile = NULL;
+  const char *mode = "straight";
+  unsigned int seed = (unsigned int)time(NULL);
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc)
+      count = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      outfile = argv[++i];
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+      seed = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+      mode = argv[++i];
+    else if (!strcmp(argv[i], "-v") && i + 1 < argc)
+      var_count = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+      trip_count = atoi(argv[++i]);
+    else {
+      fprintf(stderr,
+              "Usage: %s [-n count] [-o outfile] [-s seed] "
+              "[-m straight|loops] [-v vars] [-l trip_count]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (var_count < 1)
+    var_count = 1;
+
+  srand(seed);
+  FILE *out = outfile ? fopen(outfile, "w") : stdout;
+  if (!out) {
+    perror("fopen");
+    return 1;
+  }
+  for (int i = 0; i < count; i++) {
+    if (!strcmp(mode, "loops")) {
+      emit_loop_block(out, i);
+    } else {
+      emit_straight_stmt(out, 2);
+      fprintf(out, ";\n");
+    }
+  }
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}